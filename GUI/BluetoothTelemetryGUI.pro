@@ -5,14 +5,34 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 TARGET = BluetoothTelemetryGUI
 TEMPLATE = app
 
-CONFIG += c++11
+CONFIG += c++11 thread
 
 SOURCES += \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    dashboardwidget.cpp \
+    logmodel.cpp \
+    rxworker.cpp \
+    ../common/frame_reasm.c \
+    ../common/transport.c \
+    ../common/crc32c.c \
+    ../common/lat_hist.c \
+    ../common/link_stats.c \
+    ../common/telemetry_delta.c \
+    ../common/ctrl_msg.c \
+    ../common/shm_ring.c \
+    ../common/vehicle_store.c \
+    ../common/hexfmt.c
 
 HEADERS += \
-    mainwindow.h
+    mainwindow.h \
+    dashboardwidget.h \
+    logmodel.h \
+    rxworker.h \
+    spscqueue.h
+
+# Shared protocol code lives next to the command-line tools
+INCLUDEPATH += ..
 
 # Bluetooth library
 LIBS += -lbluetooth
@@ -0,0 +1,336 @@
+#include "dashboardwidget.h"
+
+#include <QPaintEvent>
+#include <QPainter>
+#include <QPainterPath>
+#include <QResizeEvent>
+#include <string.h>
+
+// Same palette the style sheets used
+static const QColor kBlue(0x34, 0x98, 0xdb);
+static const QColor kOrange(0xf3, 0x9c, 0x12);
+static const QColor kRed(0xe7, 0x4c, 0x3c);
+static const QColor kGreen(0x27, 0xae, 0x60);
+static const QColor kLime(0x2e, 0xcc, 0x71);
+static const QColor kGrey(0x95, 0xa5, 0xa6);
+static const QColor kTitle(0x2c, 0x3e, 0x50);
+static const QColor kText(0x34, 0x49, 0x5e);
+static const QColor kMuted(0x7f, 0x8c, 0x8d);
+static const QColor kTrack(0xec, 0xf0, 0xf1);
+static const QColor kTrackBorder(0xbd, 0xc3, 0xc7);
+
+static const int kMargin = 12;
+static const int kTitleWidth = 130;
+static const int kGaugePen = 14;
+static const int kLamp = 16;
+static const int kMaxRpm = 255 * 46;
+static const int kTempMin = -20, kTempMax = 120;
+
+static const QColor &bandColor(int band, const QColor &normal)
+{
+    return band == BandCritical ? kRed : band == BandWarn ? kOrange : normal;
+}
+
+DashboardWidget::DashboardWidget(QWidget *parent)
+    : QWidget(parent),
+      cellsPainted(0),
+      haveData(false)
+{
+    memset(&shown, 0, sizeof(shown));
+    for (int i = 0; i < CellCount; i++) key[i] = -1;
+
+    titleFont = font();
+    titleFont.setPixelSize(13);
+    titleFont.setBold(true);
+    valueFont = titleFont;
+    valueFont.setPixelSize(14);
+    speedFont = titleFont;
+    speedFont.setPixelSize(28);
+    unitFont = titleFont;
+    unitFont.setPixelSize(12);
+
+    // The background pixmap covers every pixel; Qt need not clear first
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+QSize DashboardWidget::sizeHint() const
+{
+    return QSize(900, 320);
+}
+
+QSize DashboardWidget::minimumSizeHint() const
+{
+    return QSize(640, 260);
+}
+
+void DashboardWidget::setTelemetry(const telemetry_t *t)
+{
+    shown = *t;
+    haveData = true;
+    for (int i = 0; i < CellCount; i++) {
+        int k = cellKey(i, t);
+        if (k == key[i]) continue;
+        key[i] = k;
+        update(cells[i]);
+    }
+}
+
+void DashboardWidget::clear()
+{
+    haveData = false;
+    for (int i = 0; i < CellCount; i++) key[i] = -1;
+    update();
+}
+
+/* Everything a cell's pixels depend on, as one int (never -1) */
+int DashboardWidget::cellKey(int cell, const telemetry_t *t)
+{
+    switch (cell) {
+    case Speed:       return dashSpeedRpm(t);
+    case Throttle:    return t->throttle;
+    case Odometer:    return t->total_miles;
+    case Battery:     return t->battery;
+    case EngineTemp:  return dashEngineTempC(t) + 1000;
+    case BatteryTemp: return t->battery_temp;
+    case State:       return t->state & 3;
+    case Mode:        return t->mode & 3;
+    case Turn:        return t->turn_signal & 3;
+    case Night:       return t->night_mode ? 1 : 0;
+    case Beam:        return t->beam ? 1 : 0;
+    case Horn:        return t->horn ? 1 : 0;
+    case Alert:       return t->alert;
+    case Maps:        return t->maps ? 1 : 0;
+    }
+    return 0;
+}
+
+/* Speed gauge on the left, measurements in the middle, lamps on the right */
+void DashboardWidget::layoutCells()
+{
+    int w = width(), h = height() - 2 * kMargin;
+    int g = qMin(h, w * 32 / 100);
+    gauge = QRect(kMargin, kMargin + (h - g) / 2, g, g);
+    cells[Speed] = gauge;
+    titles[Speed] = QRect();
+
+    int x0 = gauge.right() + 24;
+    int midW = (w - x0 - kMargin) * 55 / 100;
+    static const int mid[] = { Throttle, Odometer, Battery, EngineTemp, BatteryTemp };
+    for (int i = 0; i < 5; i++) {
+        int y = kMargin + h * i / 5, rh = h * (i + 1) / 5 - h * i / 5;
+        titles[mid[i]] = QRect(x0, y, kTitleWidth, rh);
+        cells[mid[i]] = QRect(x0 + kTitleWidth, y, midW - kTitleWidth, rh);
+    }
+    // Bars sit right of a 70 px value
+    for (int c : { Battery, EngineTemp }) {
+        const QRect &r = cells[c];
+        QRect track(r.x() + 70, r.center().y() - 9, r.width() - 78, 18);
+        if (c == Battery) batteryTrack = track;
+        else tempTrack = track;
+    }
+
+    int x1 = x0 + midW + 24;
+    static const int right[] = { State, Mode, Turn, Night, Beam, Horn, Alert, Maps };
+    for (int i = 0; i < 8; i++) {
+        int y = kMargin + h * i / 8, rh = h * (i + 1) / 8 - h * i / 8;
+        titles[right[i]] = QRect(x1, y, kTitleWidth, rh);
+        cells[right[i]] = QRect(x1 + kTitleWidth, y, w - kMargin - x1 - kTitleWidth, rh);
+    }
+}
+
+void DashboardWidget::buildBackground()
+{
+    static const char *const title[CellCount] = {
+        "", "⏱ Throttle:", "👋 Odometer:", "🔋 Battery:", "🌡️ Engine Temp:", "🌡️ Battery Temp:",
+        "⚙️ State:", "🏎️ Mode:", "➡️ Turn Signal:", "🌙 Night Mode:", "💡 High Beam:", "📢 Horn:",
+        "⚠️ Alert:", "🗺️ Maps:"
+    };
+    qreal dpr = devicePixelRatioF();
+    background = QPixmap(size() * dpr);
+    background.setDevicePixelRatio(dpr);
+    background.fill(Qt::white);
+
+    QPainter p(&background);
+    p.setRenderHint(QPainter::Antialiasing);
+
+    // Gauge track and its fixed labels
+    QRectF arc = QRectF(gauge).adjusted(kGaugePen, kGaugePen, -kGaugePen, -kGaugePen);
+    p.setPen(QPen(kTrack, kGaugePen, Qt::SolidLine, Qt::RoundCap));
+    p.drawArc(arc, 225 * 16, -270 * 16);
+    p.setFont(unitFont);
+    p.setPen(kMuted);
+    p.drawText(gauge.adjusted(0, gauge.height() / 2 + 20, 0, 0), Qt::AlignHCenter | Qt::AlignTop, "RPM");
+    p.drawText(QRect(gauge.left(), gauge.bottom() - 40, gauge.width() / 2, 20), Qt::AlignCenter, "0");
+    p.drawText(QRect(gauge.center().x(), gauge.bottom() - 40, gauge.width() / 2, 20), Qt::AlignCenter,
+               QString::number(kMaxRpm));
+
+    p.setFont(titleFont);
+    p.setPen(kTitle);
+    for (int i = 0; i < CellCount; i++) {
+        if (!titles[i].isNull()) p.drawText(titles[i], Qt::AlignVCenter | Qt::AlignLeft, title[i]);
+    }
+
+    p.setPen(QPen(kTrackBorder, 2));
+    p.setBrush(kTrack);
+    p.drawRoundedRect(QRectF(batteryTrack).adjusted(1, 1, -1, -1), 5, 5);
+    p.drawRoundedRect(QRectF(tempTrack).adjusted(1, 1, -1, -1), 5, 5);
+}
+
+void DashboardWidget::resizeEvent(QResizeEvent *e)
+{
+    QWidget::resizeEvent(e);
+    layoutCells();
+    buildBackground();
+}
+
+void DashboardWidget::paintEvent(QPaintEvent *e)
+{
+    if (background.devicePixelRatio() != devicePixelRatioF()) buildBackground();
+
+    QPainter p(this);
+    qreal dpr = background.devicePixelRatio();
+    const QRegion &dirty = e->region();
+    for (const QRect &r : dirty) {
+        p.drawPixmap(r.topLeft(), background, QRectF(r.x() * dpr, r.y() * dpr, r.width() * dpr, r.height() * dpr));
+    }
+
+    p.setRenderHint(QPainter::Antialiasing);
+    for (int i = 0; i < CellCount; i++) {
+        if (!dirty.intersects(cells[i])) continue;
+        p.save();
+        p.setClipRect(cells[i]);
+        paintCell(p, i);
+        p.restore();
+        cellsPainted++;
+    }
+}
+
+void DashboardWidget::paintBar(QPainter &p, const QRect &track, double fraction, const QColor &color)
+{
+    fraction = qBound(0.0, fraction, 1.0);
+    if (fraction <= 0) return;
+    QRectF fill = QRectF(track).adjusted(3, 3, -3, -3);
+    fill.setWidth(fill.width() * fraction);
+    p.setPen(Qt::NoPen);
+    p.setBrush(color);
+    p.drawRoundedRect(fill, 3, 3);
+}
+
+void DashboardWidget::paintLamp(QPainter &p, int cell, const QColor &color, const QString &text,
+                                const QColor &textColor)
+{
+    const QRect &r = cells[cell];
+    p.setPen(Qt::NoPen);
+    p.setBrush(color);
+    p.drawEllipse(QRectF(r.x() + 2, r.center().y() - kLamp / 2.0, kLamp, kLamp));
+    p.setFont(valueFont);
+    p.setPen(textColor);
+    p.drawText(r.adjusted(kLamp + 12, 0, 0, 0), Qt::AlignVCenter | Qt::AlignLeft, text);
+}
+
+void DashboardWidget::paintCell(QPainter &p, int cell)
+{
+    static const char *const state_str[] = {"", "N", "D", "P"};
+    static const char *const mode_str[] = {"", "ECON", "COMF", "SPORT"};
+    static const char *const signal_str[] = {"none", "right", "left", "hazard"};
+    const QRect &r = cells[cell];
+    const telemetry_t *t = &shown;
+
+    if (!haveData) {
+        if (cell >= State && cell <= Horn) {
+            paintLamp(p, cell, kGrey, "--", kMuted);
+        } else {
+            p.setFont(cell == Speed ? speedFont : valueFont);
+            p.setPen(kMuted);
+            p.drawText(r, (cell == Speed ? Qt::AlignCenter : Qt::AlignVCenter | Qt::AlignLeft), "--");
+        }
+        return;
+    }
+
+    switch (cell) {
+    case Speed: {
+        int rpm = dashSpeedRpm(t);
+        const QColor &c = bandColor(dashSpeedBand(rpm), kBlue);
+        QRectF arc = QRectF(gauge).adjusted(kGaugePen, kGaugePen, -kGaugePen, -kGaugePen);
+        if (rpm > 0) {
+            p.setPen(QPen(c, kGaugePen, Qt::SolidLine, Qt::RoundCap));
+            p.drawArc(arc, 225 * 16, -(int)(270 * 16 * (double)rpm / kMaxRpm));
+        }
+        p.setFont(speedFont);
+        p.setPen(c);
+        p.drawText(r, Qt::AlignCenter, QString::number(rpm));
+        break;
+    }
+    case Throttle:
+    case BatteryTemp:
+        p.setFont(valueFont);
+        p.setPen(kText);
+        p.drawText(r, Qt::AlignVCenter | Qt::AlignLeft,
+                   QString::number(cell == Throttle ? t->throttle : t->battery_temp));
+        break;
+    case Odometer:
+        p.setFont(valueFont);
+        p.setPen(kText);
+        p.drawText(r, Qt::AlignVCenter | Qt::AlignLeft, QString("%1 km").arg(t->total_miles * 1.60934, 0, 'f', 1));
+        break;
+    case Battery: {
+        const QColor &c = bandColor(dashBatteryBand(t->battery), kGreen);
+        p.setFont(valueFont);
+        p.setPen(c);
+        p.drawText(r, Qt::AlignVCenter | Qt::AlignLeft, QString("%1%").arg(t->battery));
+        paintBar(p, batteryTrack, t->battery / 100.0, c);
+        break;
+    }
+    case EngineTemp: {
+        int temp = dashEngineTempC(t);
+        const QColor &c = bandColor(dashEngineTempBand(temp), kBlue);
+        p.setFont(valueFont);
+        p.setPen(c);
+        p.drawText(r, Qt::AlignVCenter | Qt::AlignLeft, QString("%1 °C").arg(temp));
+        paintBar(p, tempTrack, (double)(temp - kTempMin) / (kTempMax - kTempMin), c);
+        break;
+    }
+    case State:
+        paintLamp(p, cell, t->state ? kLime : kGrey, state_str[t->state & 3], t->state ? kGreen : kMuted);
+        break;
+    case Mode: {
+        static const QColor *const lamp[] = { &kGrey, &kGreen, &kBlue, &kRed };   // -, ECON, COMF, SPORT
+        paintLamp(p, cell, *lamp[t->mode & 3], mode_str[t->mode & 3], kTitle);
+        break;
+    }
+    case Turn: {
+        int s = t->turn_signal & 3;
+        paintLamp(p, cell, s == 3 ? kOrange : s ? kLime : kGrey, signal_str[s], kTitle);
+        break;
+    }
+    case Night:
+    case Beam:
+    case Horn: {
+        bool on = cell == Night ? t->night_mode : cell == Beam ? t->beam : t->horn;
+        paintLamp(p, cell, on ? kLime : kGrey, on ? "ON" : "OFF", on ? kGreen : kMuted);
+        break;
+    }
+    case Alert: {
+        QString text = QString::number(t->alert);
+        p.setFont(valueFont);
+        if (t->alert > 0) {
+            QRect badge = p.fontMetrics().boundingRect(text).adjusted(-10, -5, 10, 5);
+            badge.moveTopLeft(QPoint(r.x(), r.center().y() - badge.height() / 2));
+            p.setPen(Qt::NoPen);
+            p.setBrush(QColor(0xfa, 0xdb, 0xd8));
+            p.drawRoundedRect(badge, 4, 4);
+            p.setPen(kRed);
+            p.drawText(badge, Qt::AlignCenter, text);
+        } else {
+            p.setPen(kGreen);
+            p.drawText(r, Qt::AlignVCenter | Qt::AlignLeft, text);
+        }
+        break;
+    }
+    case Maps:
+        p.setFont(valueFont);
+        p.setPen(kText);
+        p.drawText(r, Qt::AlignVCenter | Qt::AlignLeft, t->maps ? "ON" : "OFF");
+        break;
+    }
+}
@@ -0,0 +1,97 @@
+/*
+ * dashboardwidget.h - The telemetry dashboard as one custom-painted widget
+ *
+ * Replaces the grid of styled labels, lamps and progress bars. Everything
+ * that does not depend on the data (panel, titles, gauge and bar tracks)
+ * is painted once into a pixmap when the widget is resized; lamps, lit or
+ * not, are cells like the rest. A frame then only costs the cells whose
+ * shown value changed:
+ *
+ *   setTelemetry()  compares each cell with what it shows and update()s
+ *                   just the rectangles that differ
+ *   paintEvent()    copies the background under the dirty region and
+ *                   paints the cells that intersect it
+ *
+ * Fonts, colours and pens are built once; no style sheets are involved.
+ */
+
+#ifndef DASHBOARDWIDGET_H
+#define DASHBOARDWIDGET_H
+
+#include <QColor>
+#include <QFont>
+#include <QPixmap>
+#include <QRect>
+#include <QWidget>
+
+#include "common/telemetry_codec.h"
+
+// Severity bands
+enum DashBand { BandNormal = 0, BandWarn = 1, BandCritical = 2 };
+
+static inline int dashSpeedRpm(const telemetry_t *t) { return t->speed * 46; }
+static inline int dashEngineTempC(const telemetry_t *t) { return (int)t->engine_temp - 20; }
+
+static inline int dashSpeedBand(int rpm)
+{
+    return rpm > 8000 ? BandCritical : rpm > 5000 ? BandWarn : BandNormal;
+}
+
+static inline int dashBatteryBand(int pct)
+{
+    return pct < 20 ? BandCritical : pct < 50 ? BandWarn : BandNormal;
+}
+
+static inline int dashEngineTempBand(int c)
+{
+    return c > 90 ? BandCritical : c > 70 ? BandWarn : BandNormal;
+}
+
+class DashboardWidget : public QWidget
+{
+public:
+    explicit DashboardWidget(QWidget *parent = nullptr);
+
+    // Repaints only the cells whose value changed
+    void setTelemetry(const telemetry_t *t);
+
+    // Back to "no data"
+    void clear();
+
+    QSize sizeHint() const override;
+    QSize minimumSizeHint() const override;
+
+    unsigned long cellsPainted;     // cell paints so far
+
+protected:
+    void paintEvent(QPaintEvent *e) override;
+    void resizeEvent(QResizeEvent *e) override;
+
+private:
+    enum Cell {
+        Speed, Throttle, Odometer, Battery, EngineTemp, BatteryTemp,
+        State, Mode, Turn, Night, Beam, Horn, Alert, Maps,
+        CellCount
+    };
+
+    QRect cells[CellCount];         // value areas; painted over the background
+    QRect titles[CellCount];
+    QRect gauge;                    // speed arc
+    QRect batteryTrack, tempTrack;
+    QPixmap background;
+
+    telemetry_t shown;
+    bool haveData;
+    int key[CellCount];             // what each cell shows, -1 = nothing yet
+
+    QFont titleFont, valueFont, speedFont, unitFont;
+
+    void layoutCells();
+    void buildBackground();
+    static int cellKey(int cell, const telemetry_t *t);
+    void paintCell(QPainter &p, int cell);
+    void paintBar(QPainter &p, const QRect &track, double fraction, const QColor &color);
+    void paintLamp(QPainter &p, int cell, const QColor &color, const QString &text, const QColor &textColor);
+};
+
+#endif // DASHBOARDWIDGET_H
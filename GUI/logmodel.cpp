@@ -0,0 +1,146 @@
+#include "logmodel.h"
+
+#include <QBrush>
+#include <QColor>
+
+LogModel::LogModel(size_t capacity, int flushMs, QObject *parent)
+    : QAbstractListModel(parent),
+      dropped(0),
+      ring(capacity ? capacity : 1),
+      first(0),
+      next(0),
+      minLevel(Data)
+{
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(flushMs);
+    connect(&flushTimer, &QTimer::timeout, this, &LogModel::flush);
+}
+
+LogModel::Level LogModel::levelOf(const QString &line)
+{
+    // The tag follows an optional "[HH:mm:ss] "
+    int tag = line.indexOf('[');
+    if (tag >= 0 && tag + 3 < line.size() && line[tag + 3] == QLatin1Char(':')) {
+        tag = line.indexOf('[', tag + 1);
+    }
+    if (tag < 0) return Info;
+
+    QStringView name = QStringView(line).mid(tag + 1, qMin(5, (int)line.size() - tag - 1));
+    if (name.startsWith(QLatin1String("ERROR"))) return Error;
+    if (name.startsWith(QLatin1String("WARN"))) return Warn;
+    if (name.startsWith(QLatin1String("RX]")) || name.startsWith(QLatin1String("TX]")) ||
+        name.startsWith(QLatin1String("HEX]"))) return Data;
+    return Info;
+}
+
+void LogModel::append(const QString &line)
+{
+    append(levelOf(line), line);
+}
+
+void LogModel::append(Level level, const QString &line)
+{
+    if (pending.size() == ring.size()) {
+        pending.pop_front();        // would fall out of the ring at this flush anyway
+        dropped++;
+    }
+    Entry e;
+    e.text = line.size() > LOG_LINE_MAX ? line.left(LOG_LINE_MAX) : line;
+    e.level = (uint8_t)level;
+    pending.push_back(std::move(e));
+    if (!flushTimer.isActive()) flushTimer.start();
+}
+
+void LogModel::flush()
+{
+    flushTimer.stop();
+    if (pending.empty()) return;
+
+    size_t cap = ring.size();
+    uint64_t newNext = next + pending.size();
+    uint64_t newFirst = newNext > cap && newNext - cap > first ? newNext - cap : first;
+
+    // Lines about to be overwritten leave the view first, as one removal
+    size_t gone = 0;
+    while (gone < rows.size() && rows[gone] < newFirst) gone++;
+    if (gone) {
+        beginRemoveRows(QModelIndex(), 0, (int)gone - 1);
+        rows.erase(rows.begin(), rows.begin() + (ptrdiff_t)gone);
+        endRemoveRows();
+    }
+    dropped += (unsigned long)(newFirst - first);
+    first = newFirst;
+
+    // Then the new lines arrive, as one insertion
+    added.clear();
+    for (Entry &e : pending) {
+        uint64_t n = next++;
+        Entry &slot = ring[n % cap];
+        slot = std::move(e);
+        if (matches(slot)) added.push_back(n);
+    }
+    pending.clear();
+    if (!added.empty()) {
+        int row = (int)rows.size();
+        beginInsertRows(QModelIndex(), row, row + (int)added.size() - 1);
+        rows.insert(rows.end(), added.begin(), added.end());
+        endInsertRows();
+    }
+}
+
+bool LogModel::matches(const Entry &e) const
+{
+    if (e.level < minLevel) return false;
+    return needle.isEmpty() || e.text.contains(needle, Qt::CaseInsensitive);
+}
+
+void LogModel::setFilter(Level level, const QString &text)
+{
+    flush();
+    beginResetModel();
+    minLevel = level;
+    needle = text;
+    rows.clear();
+    for (uint64_t n = first; n < next; n++) {
+        if (matches(ring[n % ring.size()])) rows.push_back(n);
+    }
+    endResetModel();
+}
+
+void LogModel::clear()
+{
+    flushTimer.stop();
+    beginResetModel();
+    pending.clear();
+    rows.clear();
+    for (uint64_t n = first; n < next; n++) ring[n % ring.size()].text.clear();
+    first = next;
+    endResetModel();
+}
+
+int LogModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : (int)rows.size();
+}
+
+QVariant LogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= (int)rows.size()) return QVariant();
+    const Entry &e = ring[rows[(size_t)index.row()] % ring.size()];
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return e.text;
+    case Qt::ForegroundRole: {
+        // Colours for the dark log background
+        static const QBrush brush[] = {
+            QBrush(QColor(0x95, 0xa5, 0xa6)),       // Data
+            QBrush(QColor(0xec, 0xf0, 0xf1)),       // Info
+            QBrush(QColor(0xf3, 0x9c, 0x12)),       // Warn
+            QBrush(QColor(0xe7, 0x4c, 0x3c)),       // Error
+        };
+        return brush[e.level & 3];
+    }
+    }
+    return QVariant();
+}
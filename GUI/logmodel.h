@@ -0,0 +1,74 @@
+/*
+ * logmodel.h - Fixed-capacity log for the GUI, shown through a QListView
+ *
+ * Lines live in a ring of LOG_CAPACITY entries; the oldest ones fall out
+ * as new ones arrive, so memory stays the same however long the session
+ * runs. append() only queues a line. The queue is moved into the ring
+ * once per UI tick (flush(), on a timer), as one row removal at the top
+ * and one row insertion at the bottom, so the view lays out and paints
+ * once per tick rather than once per line.
+ *
+ * The filter (minimum level, text) picks which lines are rows. Matching
+ * rows are kept as a queue of line numbers: appending and evicting are
+ * O(1) per line; changing the filter rescans the ring once.
+ */
+
+#ifndef LOGMODEL_H
+#define LOGMODEL_H
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QTimer>
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+#define LOG_CAPACITY 5000
+#define LOG_LINE_MAX 1024           // longer lines are cut
+
+class LogModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Level { Data = 0, Info, Warn, Error };    // Data: [RX]/[TX]/[HEX] traffic
+
+    LogModel(size_t capacity, int flushMs, QObject *parent = nullptr);
+
+    // The level is taken from the line's [TAG]
+    void append(const QString &line);
+    void append(Level level, const QString &line);
+
+    // Move queued lines into the ring now; normally the timer does it
+    void flush();
+
+    void setFilter(Level minLevel, const QString &text);
+    void clear();
+
+    static Level levelOf(const QString &line);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    unsigned long dropped;          // lines that fell out of the ring or the queue
+
+private:
+    struct Entry {
+        QString text;
+        uint8_t level;
+    };
+
+    std::vector<Entry> ring;
+    uint64_t first, next;           // line numbers held: [first, next)
+    std::deque<uint64_t> rows;      // line numbers that pass the filter
+    std::deque<Entry> pending;      // appended since the last flush, at most capacity
+    std::vector<uint64_t> added;    // flush() scratch
+    QTimer flushTimer;
+
+    Level minLevel;
+    QString needle;
+
+    bool matches(const Entry &e) const;
+};
+
+#endif // LOGMODEL_H
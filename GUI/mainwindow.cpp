@@ -11,30 +11,46 @@
 #include <QPalette>
 #include <QDialog>
 #include <QUrl>
+#include <QGuiApplication>
+#include <QScreen>
 
 #include <sys/socket.h>
-#include <bluetooth/bluetooth.h>
-#include <bluetooth/rfcomm.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
 #include <fcntl.h>
 
+#include "common/hexfmt.h"
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), 
       serverSocket(-1), 
       clientSocket(-1),
       serverNotifier(nullptr),
-      clientNotifier(nullptr),
       isRunning(false),
       echoMode(false),
       hexMode(false),
       msgCount(0),
       totalBytes(0),
-      blinkAnimation(nullptr)
+      crcErrors(0),
+      configId(0),
+      rxWorker(nullptr),
+      rxTimer(nullptr),
+      rxFramesDroppedLogged(0),
+      rxLogsDroppedLogged(0),
+      ringTimer(nullptr),
+      ringAttached(false),
+      ringVehicle(0),
+      ringLostLogged(0),
+      blinkAnimation(nullptr),
+      dashboard(nullptr),
+      logModel(nullptr),
+      logFollow(true)
 {
     setWindowTitle("Bluetooth Telemetry Server");
     setGeometry(100, 100, 1600, 900);
+    link_stats_init(&linkStats);
+    transport_parse("rfcomm://any/1", &listenAddr);
     
     applyModernStyle();
     setupUI();
@@ -42,6 +58,14 @@ MainWindow::MainWindow(QWidget *parent)
     // Timer to check client connection status
     clientCheckTimer = new QTimer(this);
     connect(clientCheckTimer, &QTimer::timeout, this, &MainWindow::checkClientConnection);
+    
+    ringTimer = new QTimer(this);
+    ringTimer->setTimerType(Qt::PreciseTimer);
+    connect(ringTimer, &QTimer::timeout, this, &MainWindow::drainRing);
+    
+    rxTimer = new QTimer(this);
+    rxTimer->setTimerType(Qt::PreciseTimer);
+    connect(rxTimer, &QTimer::timeout, this, &MainWindow::applyRxEvents);
 }
 
 MainWindow::~MainWindow()
@@ -133,6 +157,40 @@ void MainWindow::setupUI()
     hexModeCheck->setChecked(true);
     hexModeCheck->setStyleSheet("QCheckBox { font-size: 13px; padding: 5px; }");
     
+    // Where to listen: rfcomm://any/1, tcp://:5555, unix:///tmp/telem.sock, pty:///tmp/telem.pty
+    listenUriEdit = new QLineEdit("rfcomm://any/1", this);
+    listenUriEdit->setMinimumWidth(220);
+    listenUriEdit->setToolTip("rfcomm://any/1, tcp://:5555, unix:///tmp/telem.sock, pty:///tmp/telem.pty,\nshm:///tmp/telem.ring (read-only view of rfcomm_server_v2 --shm)");
+    listenUriEdit->setStyleSheet("QLineEdit { font-size: 13px; padding: 6px; border: 1px solid #bdc3c7; border-radius: 4px; }");
+    
+    // Pushed to the connected client as CONFIG_SET; v2 clients only
+    configIntervalSpin = new QSpinBox(this);
+    configIntervalSpin->setRange(1, 60000);
+    configIntervalSpin->setValue(150);
+    configIntervalSpin->setSuffix(" ms");
+    configIntervalSpin->setToolTip("Send interval for the connected client");
+    configIntervalSpin->setStyleSheet("QSpinBox { font-size: 13px; padding: 6px; border: 1px solid #bdc3c7; border-radius: 4px; }");
+    
+    sendConfigButton = new QPushButton("Set Interval", this);
+    sendConfigButton->setMinimumHeight(40);
+    sendConfigButton->setStyleSheet(
+        "QPushButton { "
+        "  background-color: #8e44ad; "
+        "  color: white; "
+        "  font-size: 14px; "
+        "  font-weight: bold; "
+        "  border: none; "
+        "  border-radius: 6px; "
+        "  padding: 10px 20px; "
+        "} "
+        "QPushButton:hover { "
+        "  background-color: #9b59b6; "
+        "} "
+        "QPushButton:pressed { "
+        "  background-color: #6c3483; "
+        "}"
+    );
+    
     openMapButton = new QPushButton("\U0001F30D Open IoV Map", this);
     openMapButton->setMinimumHeight(40);
     openMapButton->setStyleSheet(
@@ -157,12 +215,16 @@ void MainWindow::setupUI()
     controlLayout->addWidget(stopButton);
     controlLayout->addWidget(echoModeCheck);
     controlLayout->addWidget(hexModeCheck);
+    controlLayout->addWidget(listenUriEdit);
+    controlLayout->addWidget(configIntervalSpin);
+    controlLayout->addWidget(sendConfigButton);
     controlLayout->addWidget(openMapButton);
     controlLayout->addStretch();
     
     connect(startButton, &QPushButton::clicked, this, &MainWindow::onStartServer);
     connect(stopButton, &QPushButton::clicked, this, &MainWindow::onStopServer);
     connect(openMapButton, &QPushButton::clicked, this, &MainWindow::onOpenMap);
+    connect(sendConfigButton, &QPushButton::clicked, this, &MainWindow::onSendConfig);
     
     mainLayout->addWidget(controlGroup);
     
@@ -247,11 +309,35 @@ void MainWindow::setupUI()
         "}"
     );
     QVBoxLayout *logLayout = new QVBoxLayout(logGroup);
-    logOutput = new QTextEdit(this);
-    logOutput->setReadOnly(true);
+    
+    // Filters: minimum level and a substring
+    QHBoxLayout *filterLayout = new QHBoxLayout();
+    logLevelCombo = new QComboBox(this);
+    logLevelCombo->addItem("All", LogModel::Data);
+    logLevelCombo->addItem("Info and above", LogModel::Info);
+    logLevelCombo->addItem("Warnings and errors", LogModel::Warn);
+    logLevelCombo->addItem("Errors only", LogModel::Error);
+    logFilterEdit = new QLineEdit(this);
+    logFilterEdit->setPlaceholderText("Filter...");
+    logFilterEdit->setClearButtonEnabled(true);
+    QPushButton *clearLogButton = new QPushButton("Clear", this);
+    filterLayout->addWidget(logLevelCombo);
+    filterLayout->addWidget(logFilterEdit, 1);
+    filterLayout->addWidget(clearLogButton);
+    logLayout->addLayout(filterLayout);
+    
+    // A bounded model in a list view: only visible rows are laid out and painted
+    logModel = new LogModel(LOG_CAPACITY, refreshIntervalMs(), this);
+    logOutput = new QListView(this);
+    logOutput->setModel(logModel);
+    logOutput->setUniformItemSizes(true);
+    logOutput->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    logOutput->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    logOutput->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    logOutput->setTextElideMode(Qt::ElideRight);
     logOutput->setMaximumHeight(200);
     logOutput->setStyleSheet(
-        "QTextEdit { "
+        "QListView { "
         "  background-color: #2c3e50; "
         "  color: #ecf0f1; "
         "  font-family: 'Courier New', monospace; "
@@ -263,6 +349,19 @@ void MainWindow::setupUI()
     );
     logLayout->addWidget(logOutput);
     leftLayout->addWidget(logGroup);
+    
+    connect(logLevelCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::onLogFilterChanged);
+    connect(logFilterEdit, &QLineEdit::textChanged, this, &MainWindow::onLogFilterChanged);
+    connect(clearLogButton, &QPushButton::clicked, logModel, &LogModel::clear);
+    
+    // Follow new lines only while the view is scrolled to the bottom
+    connect(logModel, &QAbstractItemModel::rowsAboutToBeInserted, this, [this]() {
+        QScrollBar *bar = logOutput->verticalScrollBar();
+        logFollow = bar->value() >= bar->maximum() - 1;
+    });
+    connect(logModel, &QAbstractItemModel::rowsInserted, this, [this]() {
+        if (logFollow) logOutput->scrollToBottom();
+    });
 
     contentLayout->addLayout(leftLayout, 1);
 
@@ -361,175 +460,12 @@ void MainWindow::createTelemetryGroup(QGroupBox *&group)
         "}"
     );
     
-    QGridLayout *layout = new QGridLayout(group);
-    layout->setSpacing(12);
+    QVBoxLayout *layout = new QVBoxLayout(group);
     layout->setContentsMargins(15, 20, 15, 15);
     
-    int row = 0;
-    
-    // Speed - Large display
-    QLabel *speedTitle = new QLabel("⚡ Speed:", this);
-    speedTitle->setStyleSheet("QLabel { font-size: 13px; font-weight: bold; color: #2c3e50; }");
-    layout->addWidget(speedTitle, row, 0);
-    speedLabel = new QLabel("-- RPM", this);
-    speedLabel->setStyleSheet(
-        "QLabel { "
-        "  font-size: 24px; "
-        "  font-weight: bold; "
-        "  color: #3498db; "
-        "  background-color: #ecf0f1; "
-        "  border-radius: 6px; "
-        "  padding: 10px 20px; "
-        "}"
-    );
-    layout->addWidget(speedLabel, row++, 1, 1, 3);
-    
-    // Throttle
-    layout->addWidget(new QLabel("⏱ Throttle:", this), row, 0);
-    throttleLabel = new QLabel("--", this);
-    throttleLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #34495e; padding: 5px; }");
-    layout->addWidget(throttleLabel, row++, 1);
-    
-    // Odometer
-    layout->addWidget(new QLabel("👋 Odometer:", this), row, 0);
-    odometerLabel = new QLabel("-- km", this);
-    odometerLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #34495e; padding: 5px; }");
-    layout->addWidget(odometerLabel, row++, 1);
-    
-    // Battery with progress bar
-    layout->addWidget(new QLabel("🔋 Battery:", this), row, 0);
-    QHBoxLayout *batteryLayout = new QHBoxLayout();
-    batteryLabel = new QLabel("--%", this);
-    batteryLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #27ae60; padding: 5px; min-width: 50px; }");
-    batteryBar = new QProgressBar(this);
-    batteryBar->setRange(0, 100);
-    batteryBar->setTextVisible(false);
-    batteryBar->setMaximumHeight(20);
-    batteryBar->setStyleSheet(
-        "QProgressBar { "
-        "  border: 2px solid #bdc3c7; "
-        "  border-radius: 5px; "
-        "  background-color: #ecf0f1; "
-        "} "
-        "QProgressBar::chunk { "
-        "  background: qlineargradient(x1:0, y1:0, x2:1, y2:0, stop:0 #27ae60, stop:1 #2ecc71); "
-        "  border-radius: 3px; "
-        "}"
-    );
-    batteryLayout->addWidget(batteryLabel);
-    batteryLayout->addWidget(batteryBar);
-    layout->addLayout(batteryLayout, row++, 1, 1, 3);
-    
-    // Engine Temp with progress bar and color coding
-    layout->addWidget(new QLabel("🌡️ Engine Temp:", this), row, 0);
-    QHBoxLayout *tempLayout = new QHBoxLayout();
-    engineTempLabel = new QLabel("-- °C", this);
-    engineTempLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; padding: 5px; min-width: 60px; }");
-    engineTempBar = new QProgressBar(this);
-    engineTempBar->setRange(-20, 43);
-    engineTempBar->setTextVisible(false);
-    engineTempBar->setMaximumHeight(20);
-    engineTempBar->setStyleSheet(
-        "QProgressBar { "
-        "  border: 2px solid #bdc3c7; "
-        "  border-radius: 5px; "
-        "  background-color: #ecf0f1; "
-        "} "
-        "QProgressBar::chunk { "
-        "  background: qlineargradient(x1:0, y1:0, x2:1, y2:0, stop:0 #3498db, stop:0.5 #f39c12, stop:1 #e74c3c); "
-        "  border-radius: 3px; "
-        "}"
-    );
-    tempLayout->addWidget(engineTempLabel);
-    tempLayout->addWidget(engineTempBar);
-    layout->addLayout(tempLayout, row++, 1, 1, 3);
-    
-    // Battery Temp
-    layout->addWidget(new QLabel("🌡️ Battery Temp:", this), row, 0);
-    batteryTempLabel = new QLabel("--", this);
-    batteryTempLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #34495e; padding: 5px; }");
-    layout->addWidget(batteryTempLabel, row++, 1);
-    
-    // Second column - State indicators
-    row = 0;
-    
-    // State with styled frame
-    layout->addWidget(new QLabel("⚙️ State:", this), row, 4);
-    QHBoxLayout *stateLayout = new QHBoxLayout();
-    stateFrame = createIndicatorFrame();
-    stateLabel = new QLabel("--", this);
-    stateLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; padding: 5px; }");
-    stateLayout->addWidget(stateFrame);
-    stateLayout->addWidget(stateLabel);
-    stateLayout->addStretch();
-    layout->addLayout(stateLayout, row++, 5);
-    
-    // Mode with styled frame
-    layout->addWidget(new QLabel("🏎️ Mode:", this), row, 4);
-    QHBoxLayout *modeLayout = new QHBoxLayout();
-    modeFrame = createIndicatorFrame();
-    modeLabel = new QLabel("--", this);
-    modeLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; padding: 5px; }");
-    modeLayout->addWidget(modeFrame);
-    modeLayout->addWidget(modeLabel);
-    modeLayout->addStretch();
-    layout->addLayout(modeLayout, row++, 5);
-    
-    // Turn Signal with indicator
-    layout->addWidget(new QLabel("➡️ Turn Signal:", this), row, 4);
-    QHBoxLayout *turnLayout = new QHBoxLayout();
-    turnSignalFrame = createIndicatorFrame();
-    turnSignalLabel = new QLabel("--", this);
-    turnSignalLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; padding: 5px; }");
-    turnLayout->addWidget(turnSignalFrame);
-    turnLayout->addWidget(turnSignalLabel);
-    turnLayout->addStretch();
-    layout->addLayout(turnLayout, row++, 5);
-    
-    // Night Mode with indicator
-    layout->addWidget(new QLabel("🌙 Night Mode:", this), row, 4);
-    QHBoxLayout *nightLayout = new QHBoxLayout();
-    nightModeFrame = createIndicatorFrame();
-    nightModeLabel = new QLabel("OFF", this);
-    nightModeLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; padding: 5px; }");
-    nightLayout->addWidget(nightModeFrame);
-    nightLayout->addWidget(nightModeLabel);
-    nightLayout->addStretch();
-    layout->addLayout(nightLayout, row++, 5);
-    
-    // High Beam with indicator
-    layout->addWidget(new QLabel("💡 High Beam:", this), row, 4);
-    QHBoxLayout *beamLayout = new QHBoxLayout();
-    beamFrame = createIndicatorFrame();
-    beamLabel = new QLabel("OFF", this);
-    beamLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; padding: 5px; }");
-    beamLayout->addWidget(beamFrame);
-    beamLayout->addWidget(beamLabel);
-    beamLayout->addStretch();
-    layout->addLayout(beamLayout, row++, 5);
-    
-    // Horn with indicator
-    layout->addWidget(new QLabel("📢 Horn:", this), row, 4);
-    QHBoxLayout *hornLayout = new QHBoxLayout();
-    hornFrame = createIndicatorFrame();
-    hornLabel = new QLabel("OFF", this);
-    hornLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; padding: 5px; }");
-    hornLayout->addWidget(hornFrame);
-    hornLayout->addWidget(hornLabel);
-    hornLayout->addStretch();
-    layout->addLayout(hornLayout, row++, 5);
-    
-    // Alert
-    layout->addWidget(new QLabel("⚠️ Alert:", this), row, 4);
-    alertLabel = new QLabel("--", this);
-    alertLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #e74c3c; padding: 5px; }");
-    layout->addWidget(alertLabel, row++, 5);
-    
-    // Maps
-    layout->addWidget(new QLabel("🗺️ Maps:", this), row, 4);
-    mapsLabel = new QLabel("--", this);
-    mapsLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #34495e; padding: 5px; }");
-    layout->addWidget(mapsLabel, row++, 5);
+    // One painted widget instead of a grid of styled labels
+    dashboard = new DashboardWidget(group);
+    layout->addWidget(dashboard);
 }
 
 void MainWindow::createStatsGroup(QGroupBox *&group)
@@ -594,6 +530,25 @@ void MainWindow::createStatsGroup(QGroupBox *&group)
     );
     layout->addWidget(totalBytesLabel);
     
+    layout->addSpacing(30);
+    
+    QLabel *linkTitle = new QLabel("📶 Link:", this);
+    linkTitle->setStyleSheet("QLabel { font-size: 13px; font-weight: bold; color: #2c3e50; }");
+    layout->addWidget(linkTitle);
+    
+    linkStatsLabel = new QLabel("-", this);
+    linkStatsLabel->setStyleSheet(
+        "QLabel { "
+        "  font-size: 13px; "
+        "  font-weight: bold; "
+        "  color: #8e44ad; "
+        "  background-color: #ecf0f1; "
+        "  border-radius: 5px; "
+        "  padding: 8px 15px; "
+        "}"
+    );
+    layout->addWidget(linkStatsLabel);
+    
     layout->addStretch();
 }
 
@@ -608,11 +563,12 @@ void MainWindow::onStartServer()
         stopButton->setEnabled(true);
         echoModeCheck->setEnabled(false);
         hexModeCheck->setEnabled(false);
+        listenUriEdit->setEnabled(false);
         
         updateStatusIndicator(true, false);
-        statusLabel->setText("Server: Running on channel 1");
+        statusLabel->setText(QString("Server: Running on %1").arg(listenAddr.uri));
         statusLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #27ae60; }");
-        logMessage("[INFO] RFCOMM server started successfully");
+        logMessage(QString("[INFO] Server started on %1").arg(listenAddr.uri));
         logMessage(QString("[INFO] Echo mode: %1, Hex output: %2")
                    .arg(echoMode ? "ON" : "OFF")
                    .arg(hexMode ? "ON" : "OFF"));
@@ -630,6 +586,7 @@ void MainWindow::onStopServer()
     stopButton->setEnabled(false);
     echoModeCheck->setEnabled(true);
     hexModeCheck->setEnabled(true);
+    listenUriEdit->setEnabled(true);
     
     updateStatusIndicator(false, false);
     statusLabel->setText("Server: Stopped");
@@ -640,32 +597,29 @@ void MainWindow::onStopServer()
 
 bool MainWindow::startBluetoothServer()
 {
-    struct sockaddr_rc loc_addr = {0};
-    
-    serverSocket = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
-    if (serverSocket < 0) {
-        logMessage(QString("[ERROR] Failed to create socket: %1").arg(strerror(errno)));
+    QByteArray uri = listenUriEdit->text().trimmed().toUtf8();
+    if (uri.startsWith("shm://")) {
+        return attachRing(uri.constData() + 6);
+    }
+    if (transport_parse(uri.constData(), &listenAddr) < 0) {
+        logMessage(QString("[ERROR] Invalid listen URI: %1").arg(QString::fromUtf8(uri)));
         return false;
     }
     
-    loc_addr.rc_family = AF_BLUETOOTH;
-    loc_addr.rc_bdaddr = (bdaddr_t){{0, 0, 0, 0, 0, 0}};
-    loc_addr.rc_channel = 1;
-    
-    if (bind(serverSocket, (struct sockaddr *)&loc_addr, sizeof(loc_addr)) < 0) {
-        logMessage(QString("[ERROR] Failed to bind: %1").arg(strerror(errno)));
-        ::close(serverSocket);
-        serverSocket = -1;
+    int fd = transport_listen(&listenAddr, 1);
+    if (fd < 0) {
+        logMessage(QString("[ERROR] Failed to listen on %1: %2").arg(listenAddr.uri).arg(strerror(errno)));
         return false;
     }
     
-    if (listen(serverSocket, 1) < 0) {
-        logMessage(QString("[ERROR] Failed to listen: %1").arg(strerror(errno)));
-        ::close(serverSocket);
-        serverSocket = -1;
-        return false;
+    // A pty is already the connection; there is nothing to accept
+    if (!transport_is_listener(&listenAddr)) {
+        attachClient(fd, QString("pty:%1").arg(listenAddr.path));
+        return true;
     }
     
+    serverSocket = fd;
+    
     // Set up socket notifier for incoming connections
     serverNotifier = new QSocketNotifier(serverSocket, QSocketNotifier::Read, this);
     connect(serverNotifier, &QSocketNotifier::activated, this, &MainWindow::onServerSocketReady);
@@ -675,18 +629,84 @@ bool MainWindow::startBluetoothServer()
     return true;
 }
 
-void MainWindow::stopBluetoothServer()
+bool MainWindow::attachRing(const char *path)
 {
-    if (clientNotifier) {
-        clientNotifier->setEnabled(false);
-        delete clientNotifier;
-        clientNotifier = nullptr;
+    // Nothing to listen on; listenAddr only names the source in messages
+    memset(&listenAddr, 0, sizeof(listenAddr));
+    listenAddr.keep_fd = -1;
+    snprintf(listenAddr.uri, sizeof(listenAddr.uri), "shm://%s", path);
+    
+    if (shm_ring_connect(&ring, path) < 0) {
+        logMessage(QString("[ERROR] Failed to attach to %1: %2").arg(listenAddr.uri).arg(strerror(errno)));
+        return false;
     }
+    shm_ring_reader_init(&ringReader, &ring);
+    ringAttached = true;
+    ringVehicle = 0;
+    ringLostLogged = 0;
+    msgCount = 0;
+    crcErrors = 0;
+    link_stats_init(&linkStats);
     
-    if (clientSocket >= 0) {
-        ::close(clientSocket);
-        clientSocket = -1;
+    logMessage(QString("[INFO] Attached to receiver ring %1 (%2 slots), read-only")
+               .arg(path).arg(ring.nslots));
+    logMessage("[INFO] Following the first vehicle that sends a frame");
+    
+    // One repaint per tick however many frames arrived in between
+    ringTimer->start(refreshIntervalMs());
+    return true;
+}
+
+void MainWindow::drainRing()
+{
+    shm_ring_rec_t rec;
+    telemetry_t latest;
+    bool haveTelem = false;
+    
+    while (shm_ring_next(&ringReader, &rec) > 0) {
+        if (ringVehicle == 0) {
+            char name[VEHICLE_NAME_LEN];
+            ringVehicle = rec.key;
+            vehicle_key_str(rec.key, name, sizeof(name));
+            clientAddressLabel->setText(QString("Vehicle: %1").arg(name));
+            clientAddressLabel->setStyleSheet("QLabel { font-size: 13px; color: #27ae60; font-weight: bold; }");
+            updateStatusIndicator(true, true);
+        }
+        if (rec.key != ringVehicle) continue;
+        
+        frame_meta_t meta;
+        memset(&meta, 0, sizeof(meta));
+        meta.version = rec.version;
+        meta.type = rec.type;
+        meta.seq = rec.seq;
+        meta.ts_us = rec.ts_us;
+        link_stats_update(&linkStats, &meta, rec.rx_us);
+        latest = rec.telem;
+        haveTelem = true;
+        msgCount++;
+    }
+    
+    if (ringReader.lost != ringLostLogged) {
+        logMessage(QString("%1 [WARN] GUI fell behind the ring, %2 frame(s) skipped")
+                   .arg(getTimestamp()).arg(ringReader.lost - ringLostLogged));
+        ringLostLogged = ringReader.lost;
+    }
+    if (haveTelem) {
+        msgCountLabel->setText(QString::number(msgCount));
+        updateLinkStats();
+        displayTelemetry(&latest);
     }
+}
+
+void MainWindow::stopBluetoothServer()
+{
+    if (ringAttached) {
+        ringTimer->stop();
+        shm_ring_close(&ring);
+        ringAttached = false;
+    }
+    
+    detachClient();
     
     if (serverNotifier) {
         serverNotifier->setEnabled(false);
@@ -698,6 +718,7 @@ void MainWindow::stopBluetoothServer()
         ::close(serverSocket);
         serverSocket = -1;
     }
+    transport_cleanup(&listenAddr);
     
     if (clientCheckTimer) {
         clientCheckTimer->stop();
@@ -711,288 +732,226 @@ void MainWindow::onServerSocketReady()
 
 void MainWindow::acceptClientConnection()
 {
-    struct sockaddr_rc rem_addr = {0};
+    struct sockaddr_storage rem_addr;
     socklen_t opt = sizeof(rem_addr);
-    char addr[18] = {0};
+    char addr[TRANSPORT_PATH_LEN] = {0};
     
-    clientSocket = accept(serverSocket, (struct sockaddr *)&rem_addr, &opt);
-    if (clientSocket < 0) {
+    int fd = accept(serverSocket, (struct sockaddr *)&rem_addr, &opt);
+    if (fd < 0) {
         logMessage(QString("[ERROR] Accept failed: %1").arg(strerror(errno)));
         return;
     }
     
-    ba2str(&rem_addr.rc_bdaddr, addr);
-    clientAddressLabel->setText(QString("Client: %1").arg(addr));
+    transport_peer_name((struct sockaddr *)&rem_addr, opt, fd, addr, sizeof(addr));
+    attachClient(fd, QString::fromUtf8(addr));
+}
+
+void MainWindow::attachClient(int fd, const QString &peer)
+{
+    // One client at a time; a newcomer replaces the previous one
+    detachClient();
+    
+    clientSocket = fd;
+    clientAddressLabel->setText(QString("Client: %1").arg(peer));
     clientAddressLabel->setStyleSheet("QLabel { font-size: 13px; color: #27ae60; font-weight: bold; }");
     updateStatusIndicator(true, true);
-    logMessage(QString("%1 [INFO] Client connected: %2").arg(getTimestamp()).arg(addr));
+    logMessage(QString("%1 [INFO] Client connected: %2").arg(getTimestamp()).arg(peer));
     
     msgCount = 0;
     totalBytes = 0;
+    crcErrors = 0;
+    link_stats_init(&linkStats);
+    rxFramesDroppedLogged = 0;
+    rxLogsDroppedLogged = 0;
     msgCountLabel->setText("0");
     totalBytesLabel->setText("0");
+    linkStatsLabel->setText("-");
     
-    // Set up notifier for client data
-    clientNotifier = new QSocketNotifier(clientSocket, QSocketNotifier::Read, this);
-    connect(clientNotifier, &QSocketNotifier::activated, this, &MainWindow::onClientSocketReady);
+    rxWorker = new RxWorker(clientSocket, echoMode, hexMode);
+    if (!rxWorker->start()) {
+        logMessage(QString("[ERROR] Failed to start receive thread: %1").arg(strerror(errno)));
+        delete rxWorker;
+        rxWorker = nullptr;
+        ::close(clientSocket);
+        clientSocket = -1;
+        clientAddressLabel->setText("Client: Disconnected");
+        updateStatusIndicator(true, false);
+        return;
+    }
+    rxTimer->start(refreshIntervalMs());
     
     // Start timer to check connection
     clientCheckTimer->start(1000);
 }
 
-void MainWindow::onClientSocketReady()
+void MainWindow::detachClient()
 {
-    handleClientData();
+    if (rxWorker) {
+        rxTimer->stop();
+        rxWorker->stop();
+        applyRxEvents();            // whatever it queued before stopping
+        delete rxWorker;
+        rxWorker = nullptr;
+    }
+    
+    if (clientSocket >= 0) {
+        ::close(clientSocket);
+        clientSocket = -1;
+    }
 }
 
-void MainWindow::handleClientData()
+void MainWindow::applyRxEvents()
 {
-    uint8_t buf[1024];
-    ssize_t bytes_read;
-    
-    bytes_read = recv(clientSocket, buf, sizeof(buf) - 1, 0);
-    
-    if (bytes_read < 0) {
-        if (errno != EINTR && errno != EAGAIN) {
-            logMessage(QString("[ERROR] recv failed: %1").arg(strerror(errno)));
-            // Close client connection
-            if (clientNotifier) {
-                clientNotifier->setEnabled(false);
-                delete clientNotifier;
-                clientNotifier = nullptr;
-            }
-            ::close(clientSocket);
-            clientSocket = -1;
-            clientAddressLabel->setText("Client: Disconnected");
-            clientCheckTimer->stop();
+    if (!rxWorker) return;
+    
+    // Read before draining: everything the worker queued before it set
+    // closed (such as the disconnect line) is then in this pass
+    bool closed = rxWorker->closed.load(std::memory_order_acquire);
+    
+    RxLogLine line;
+    while (rxWorker->logs.pop(line)) {
+        if (line.kind == RxLogLine::Hex) {
+            logHex((const uint8_t *)line.data, line.len);
+        } else {
+            logMessage(QString("%1 %2").arg(getTimestamp(line.us))
+                       .arg(QString::fromUtf8(line.data, line.len)));
         }
-        return;
     }
     
-    if (bytes_read == 0) {
-        logMessage(QString("%1 [INFO] Client disconnected").arg(getTimestamp()));
-        if (clientNotifier) {
-            clientNotifier->setEnabled(false);
-            delete clientNotifier;
-            clientNotifier = nullptr;
+    // Every frame counts for link stats, only the newest is painted
+    RxFrame f;
+    telemetry_t latest;
+    bool haveTelem = false;
+    bool haveFrames = false;
+    while (rxWorker->frames.pop(f)) {
+        link_stats_update(&linkStats, &f.meta, f.rxUs);
+        haveFrames = true;
+        if (f.hasTelem) {
+            latest = f.telem;
+            haveTelem = true;
+            msgCount++;
         }
+    }
+    
+    unsigned long dropped = rxWorker->framesDropped.load(std::memory_order_relaxed);
+    if (dropped != rxFramesDroppedLogged) {
+        logMessage(QString("%1 [WARN] GUI fell behind the link, %2 frame(s) skipped")
+                   .arg(getTimestamp()).arg(dropped - rxFramesDroppedLogged));
+        rxFramesDroppedLogged = dropped;
+    }
+    dropped = rxWorker->logsDropped.load(std::memory_order_relaxed);
+    if (dropped != rxLogsDroppedLogged) {
+        logMessage(QString("%1 [WARN] %2 log line(s) skipped")
+                   .arg(getTimestamp()).arg(dropped - rxLogsDroppedLogged));
+        rxLogsDroppedLogged = dropped;
+    }
+    
+    unsigned long bytes = rxWorker->bytes.load(std::memory_order_relaxed);
+    if (bytes != totalBytes) {
+        totalBytes = bytes;
+        totalBytesLabel->setText(QString::number(totalBytes));
+    }
+    unsigned long crc = rxWorker->crcErrors.load(std::memory_order_relaxed);
+    if (haveFrames || crc != crcErrors) {
+        crcErrors = crc;
+        msgCountLabel->setText(QString::number(msgCount));
+        updateLinkStats();
+    }
+    if (haveTelem) {
+        displayTelemetry(&latest);
+    }
+    
+    if (closed) {
+        rxTimer->stop();
+        delete rxWorker;
+        rxWorker = nullptr;
         ::close(clientSocket);
         clientSocket = -1;
         clientAddressLabel->setText("Client: Disconnected");
         clientAddressLabel->setStyleSheet("QLabel { font-size: 13px; color: #e74c3c; font-weight: bold; }");
         updateStatusIndicator(true, false);
         clientCheckTimer->stop();
+    }
+}
+
+void MainWindow::onSendConfig()
+{
+    if (clientSocket < 0) {
+        logMessage("[WARN] No client connected");
         return;
     }
-    
-    totalBytes += bytes_read;
-    msgCount++;
-    
-    msgCountLabel->setText(QString::number(msgCount));
-    totalBytesLabel->setText(QString::number(totalBytes));
-    
-    logMessage(QString("%1 [RX] %2 bytes").arg(getTimestamp()).arg(bytes_read));
-    
-    if (hexMode) {
-        logHex(buf, bytes_read);
+    if (linkStats.version < FRAME_V2) {
+        logMessage("[WARN] Client does not speak v2 frames, config not sent");
+        return;
     }
     
-    // Parse telemetry
-    telemetry_t telem;
-    int parse_result = parseTelemetry(buf, bytes_read, &telem);
-    if (parse_result == 0) {
-        displayTelemetry(&telem);
-    } else {
-        logMessage(QString("[WARN] Failed to parse telemetry (code: %1)").arg(parse_result));
-    }
+    ctrl_cfg_t cfg;
+    cfg.key = CTRL_CFG_INTERVAL_MS;
+    cfg.value = (uint32_t)configIntervalSpin->value();
     
-    // Echo if enabled
-    if (echoMode) {
-        ssize_t sent = send(clientSocket, buf, bytes_read, 0);
-        if (sent < 0) {
-            logMessage(QString("[ERROR] send failed: %1").arg(strerror(errno)));
-        } else {
-            logMessage(QString("%1 [TX] Echoed %2 bytes").arg(getTimestamp()).arg(sent));
-        }
+    uint8_t out[FRAME_MAX_SIZE];
+    uint64_t nowUs = (uint64_t)QDateTime::currentMSecsSinceEpoch() * 1000u;
+    size_t n = ctrl_encode_config(++configId, nowUs, &cfg, 1, out);
+    if (transport_send(clientSocket, out, n) != (ssize_t)n) {
+        logMessage(QString("[ERROR] send failed: %1").arg(strerror(errno)));
+        return;
     }
+    logMessage(QString("%1 [CTRL] Config #%2 sent: interval_ms=%3")
+               .arg(getTimestamp()).arg(configId).arg(cfg.value));
 }
 
-void MainWindow::checkClientConnection()
+void MainWindow::updateLinkStats()
 {
-    if (clientSocket < 0) {
-        clientCheckTimer->stop();
+    if (linkStats.version == 0) return;
+    if (linkStats.version < FRAME_V2) {
+        linkStatsLabel->setText("v1 (no seq)");
+        return;
     }
+    // Wall-clock latency is only exact when sender and receiver share a clock
+    linkStatsLabel->setText(
+        QString("v2 · loss %1% · reorder %2 · CRC %3 · lat p50 %4 ms p99 %5 ms")
+            .arg(link_stats_loss_pct(&linkStats), 0, 'f', 2)
+            .arg(linkStats.reordered)
+            .arg(crcErrors)
+            .arg(lat_hist_quantile(&linkStats.latency, 0.50) / 1e6, 0, 'f', 1)
+            .arg(lat_hist_quantile(&linkStats.latency, 0.99) / 1e6, 0, 'f', 1));
 }
 
-int MainWindow::parseTelemetry(const uint8_t *data, size_t len, telemetry_t *telem)
+void MainWindow::checkClientConnection()
 {
-    // Expected frame: 0xCE, len(8), data[8], '\n' = 11 bytes
-    if (len < 11) {
-        return -1;  // incomplete frame
-    }
-    
-    if (data[0] != 0xCE) {
-        return -2;  // invalid start marker
-    }
-    
-    if (data[1] != 8) {
-        return -3;  // invalid length
-    }
-    
-    if (data[10] != '\n') {
-        return -4;  // missing delimiter
+    if (clientSocket < 0) {
+        clientCheckTimer->stop();
     }
-    
-    // Parse payload
-    telem->speed = data[2];
-    telem->throttle = data[3];
-    telem->total_miles = (uint16_t)data[4] | ((uint16_t)data[5] << 8);
-    telem->battery = data[6] & 0x7F;
-    telem->night_mode = (data[6] >> 7) & 0x01;
-    telem->engine_temp = data[7] & 0x3F;
-    telem->turn_signal = (data[7] >> 6) & 0x03;
-    telem->battery_temp = data[8] & 0x3F;
-    telem->horn = (data[8] >> 6) & 0x01;
-    telem->beam = (data[8] >> 7) & 0x01;
-    telem->alert = data[9] & 0x07;
-    telem->state = (data[9] >> 3) & 0x03;
-    telem->mode = (data[9] >> 5) & 0x03;
-    telem->maps = (data[9] >> 7) & 0x01;
-    
-    return 0;
 }
 
 void MainWindow::displayTelemetry(const telemetry_t *telem)
 {
-    const char *state_str[] = {"", "N", "D", "P"};
-    const char *mode_str[] = {"", "ECON", "COMF", "SPORT"};
-    const char *signal_str[] = {"none", "right", "left", "hazard"};
-    
-    // Speed - prominent display
-    int rpm = telem->speed * 46;
-    speedLabel->setText(QString("%1 RPM").arg(rpm));
-    if (rpm > 8000) {
-        speedLabel->setStyleSheet(
-            "QLabel { font-size: 24px; font-weight: bold; color: #e74c3c; "
-            "background-color: #fadbd8; border-radius: 6px; padding: 10px 20px; }");
-    } else if (rpm > 5000) {
-        speedLabel->setStyleSheet(
-            "QLabel { font-size: 24px; font-weight: bold; color: #f39c12; "
-            "background-color: #fef5e7; border-radius: 6px; padding: 10px 20px; }");
-    } else {
-        speedLabel->setStyleSheet(
-            "QLabel { font-size: 24px; font-weight: bold; color: #3498db; "
-            "background-color: #ecf0f1; border-radius: 6px; padding: 10px 20px; }");
-    }
-    
-    // Throttle
-    throttleLabel->setText(QString::number(telem->throttle));
-    
-    // Odometer
-    odometerLabel->setText(QString("%1 km").arg(telem->total_miles * 1.60934, 0, 'f', 1));
-    
-    // Battery with progress bar and color coding
-    batteryLabel->setText(QString("%1%").arg(telem->battery));
-    batteryBar->setValue(telem->battery);
-    if (telem->battery < 20) {
-        batteryLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #e74c3c; padding: 5px; min-width: 50px; }");
-        batteryBar->setStyleSheet(
-            "QProgressBar { border: 2px solid #e74c3c; border-radius: 5px; background-color: #fadbd8; } "
-            "QProgressBar::chunk { background-color: #e74c3c; border-radius: 3px; }");
-    } else if (telem->battery < 50) {
-        batteryLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #f39c12; padding: 5px; min-width: 50px; }");
-        batteryBar->setStyleSheet(
-            "QProgressBar { border: 2px solid #f39c12; border-radius: 5px; background-color: #fef5e7; } "
-            "QProgressBar::chunk { background-color: #f39c12; border-radius: 3px; }");
-    } else {
-        batteryLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #27ae60; padding: 5px; min-width: 50px; }");
-        batteryBar->setStyleSheet(
-            "QProgressBar { border: 2px solid #bdc3c7; border-radius: 5px; background-color: #ecf0f1; } "
-            "QProgressBar::chunk { background: qlineargradient(x1:0, y1:0, x2:1, y2:0, stop:0 #27ae60, stop:1 #2ecc71); border-radius: 3px; }");
-    }
-    
-    // Engine Temperature with bar and color coding
-    int engineTemp = (int)telem->engine_temp - 20;
-    engineTempLabel->setText(QString("%1 °C").arg(engineTemp));
-    engineTempBar->setValue(engineTemp);
-    if (engineTemp > 90) {
-        engineTempLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #e74c3c; padding: 5px; min-width: 60px; }");
-    } else if (engineTemp > 70) {
-        engineTempLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #f39c12; padding: 5px; min-width: 60px; }");
-    } else {
-        engineTempLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #3498db; padding: 5px; min-width: 60px; }");
-    }
-    
-    // Battery Temp
-    batteryTempLabel->setText(QString::number(telem->battery_temp));
-    
-    // State with indicator
-    updateIndicatorState(stateFrame, stateLabel, telem->state > 0, state_str[telem->state]);
-    
-    // Mode with color coding
-    modeLabel->setText(mode_str[telem->mode]);
-    QString modeColor;
-    switch(telem->mode) {
-        case 1: modeColor = "#27ae60"; break; // ECON - green
-        case 2: modeColor = "#3498db"; break; // COMF - blue
-        case 3: modeColor = "#e74c3c"; break; // SPORT - red
-        default: modeColor = "#95a5a6"; break;
-    }
-    modeFrame->setStyleSheet(QString(
-        "QFrame { background-color: %1; border-radius: 8px; min-width: 16px; max-width: 16px; "
-        "min-height: 16px; max-height: 16px; }").arg(modeColor));
-    
-    // Turn Signal with animated indicator
-    turnSignalLabel->setText(signal_str[telem->turn_signal]);
-    bool turnActive = (telem->turn_signal > 0);
-    if (turnActive) {
-        QString turnColor = (telem->turn_signal == 3) ? "#f39c12" : "#2ecc71"; // hazard=orange, else=green
-        turnSignalFrame->setStyleSheet(QString(
-            "QFrame { background-color: %1; border-radius: 8px; min-width: 16px; max-width: 16px; "
-            "min-height: 16px; max-height: 16px; }").arg(turnColor));
-    } else {
-        turnSignalFrame->setStyleSheet(
-            "QFrame { background-color: #95a5a6; border-radius: 8px; min-width: 16px; max-width: 16px; "
-            "min-height: 16px; max-height: 16px; }");
-    }
-    
-    // Night Mode
-    updateIndicatorState(nightModeFrame, nightModeLabel, telem->night_mode, telem->night_mode ? "ON" : "OFF");
-    
-    // High Beam
-    updateIndicatorState(beamFrame, beamLabel, telem->beam, telem->beam ? "ON" : "OFF");
-    
-    // Horn
-    updateIndicatorState(hornFrame, hornLabel, telem->horn, telem->horn ? "ON" : "OFF");
-    
-    // Alert
-    alertLabel->setText(QString::number(telem->alert));
-    if (telem->alert > 0) {
-        alertLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #e74c3c; "
-                                   "background-color: #fadbd8; padding: 5px 10px; border-radius: 4px; }");
-    } else {
-        alertLabel->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #27ae60; padding: 5px; }");
-    }
-    
-    // Maps
-    mapsLabel->setText(telem->maps ? "ON" : "OFF");
+    dashboard->setTelemetry(telem);
 }
 
 void MainWindow::logMessage(const QString &msg)
 {
-    logOutput->append(msg);
-    // Auto-scroll to bottom
-    QScrollBar *scrollBar = logOutput->verticalScrollBar();
-    scrollBar->setValue(scrollBar->maximum());
+    // Queued; the view gets all lines of a tick in one insertion
+    logModel->append(msg);
+}
+
+void MainWindow::onLogFilterChanged()
+{
+    logModel->setFilter((LogModel::Level)logLevelCombo->currentData().toInt(), logFilterEdit->text());
+    logOutput->scrollToBottom();
 }
 
 void MainWindow::logHex(const uint8_t *data, size_t len)
 {
-    QString hexStr = "[HEX] ";
-    for (size_t i = 0; i < len; i++) {
-        hexStr += QString("%1 ").arg(data[i], 2, 16, QChar('0')).toUpper();
-    }
-    logMessage(hexStr);
+    // The worker queues at most RX_LOG_LEN bytes per line
+    char line[HEXFMT_LINE_SIZE(RX_LOG_LEN)];
+    do {
+        size_t n = len < RX_LOG_LEN ? len : RX_LOG_LEN;
+        size_t chars = hexfmt_line(line, data, n) - 1;     // rows need no '\n'
+        logModel->append(LogModel::Data, QString::fromLatin1(line, (int)chars));
+        data += n;
+        len -= n;
+    } while (len > 0);
 }
 
 QString MainWindow::getTimestamp()
@@ -1000,6 +959,20 @@ QString MainWindow::getTimestamp()
     return QDateTime::currentDateTime().toString("[HH:mm:ss]");
 }
 
+QString MainWindow::getTimestamp(uint64_t us)
+{
+    return QDateTime::fromMSecsSinceEpoch((qint64)(us / 1000u)).toString("[HH:mm:ss]");
+}
+
+// Applying queued state faster than the screen shows it is wasted work
+int MainWindow::refreshIntervalMs()
+{
+    QScreen *screen = QGuiApplication::primaryScreen();
+    qreal hz = screen ? screen->refreshRate() : 60.0;
+    if (hz < 1.0) hz = 60.0;
+    return qMax(1, qRound(1000.0 / hz));
+}
+
 void MainWindow::applyModernStyle()
 {
     // Set modern application-wide style
@@ -1011,53 +984,6 @@ void MainWindow::applyModernStyle()
     );
 }
 
-QFrame* MainWindow::createIndicatorFrame()
-{
-    QFrame *frame = new QFrame(this);
-    frame->setFrameShape(QFrame::NoFrame);
-    frame->setStyleSheet(
-        "QFrame { "
-        "  background-color: #95a5a6; "
-        "  border-radius: 8px; "
-        "  min-width: 16px; "
-        "  max-width: 16px; "
-        "  min-height: 16px; "
-        "  max-height: 16px; "
-        "}"
-    );
-    return frame;
-}
-
-void MainWindow::updateIndicatorState(QFrame *frame, QLabel *label, bool active, const QString &text)
-{
-    if (active) {
-        frame->setStyleSheet(
-            "QFrame { "
-            "  background-color: #2ecc71; "
-            "  border-radius: 8px; "
-            "  min-width: 16px; "
-            "  max-width: 16px; "
-            "  min-height: 16px; "
-            "  max-height: 16px; "
-            "}"
-        );
-        label->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #27ae60; padding: 5px; }");
-    } else {
-        frame->setStyleSheet(
-            "QFrame { "
-            "  background-color: #95a5a6; "
-            "  border-radius: 8px; "
-            "  min-width: 16px; "
-            "  max-width: 16px; "
-            "  min-height: 16px; "
-            "  max-height: 16px; "
-            "}"
-        );
-        label->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #7f8c8d; padding: 5px; }");
-    }
-    label->setText(text);
-}
-
 void MainWindow::updateStatusIndicator(bool running, bool clientConnected)
 {
     if (clientConnected) {
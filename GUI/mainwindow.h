@@ -4,8 +4,11 @@
 #include <QMainWindow>
 #include <QLabel>
 #include <QPushButton>
-#include <QTextEdit>
+#include <QListView>
+#include <QComboBox>
 #include <QCheckBox>
+#include <QLineEdit>
+#include <QSpinBox>
 #include <QGroupBox>
 #include <QSocketNotifier>
 #include <QTimer>
@@ -15,23 +18,15 @@
 #include <QWebEngineView>
 #include <stdint.h>
 
-/* Telemetry data structure */
-typedef struct {
-    uint8_t speed;           // B0: 0-255 (rpm/46)
-    uint8_t throttle;        // B1: 0-255
-    uint16_t total_miles;    // B2-B3: 16-bit odometer
-    uint8_t battery;         // B4[0-6]: 0-100%
-    uint8_t night_mode;      // B4[7]: 0/1
-    uint8_t engine_temp;     // B5[0-5]: 0-63 (offset -20°C)
-    uint8_t turn_signal;     // B5[6-7]: 0=none, 1=right, 2=left, 3=hazard
-    uint8_t battery_temp;    // B6[0-5]: 0-63
-    uint8_t horn;            // B6[6]: 0/1
-    uint8_t beam;            // B6[7]: 0/1
-    uint8_t alert;           // B7[0-2]: 0-7
-    uint8_t state;           // B7[3-4]: 1=N, 2=D, 3=P
-    uint8_t mode;            // B7[5-6]: 1=ECON, 2=COMF, 3=SPORT
-    uint8_t maps;            // B7[7]: 0/1
-} telemetry_t;
+#include "common/ctrl_msg.h"
+#include "common/link_stats.h"
+#include "common/shm_ring.h"
+#include "common/telemetry_codec.h"
+#include "common/transport.h"
+#include "common/vehicle_store.h"
+#include "dashboardwidget.h"
+#include "logmodel.h"
+#include "rxworker.h"
 
 class MainWindow : public QMainWindow
 {
@@ -45,9 +40,12 @@ private slots:
     void onStartServer();
     void onStopServer();
     void onServerSocketReady();
-    void onClientSocketReady();
     void checkClientConnection();
     void onOpenMap();
+    void onSendConfig();
+    void drainRing();
+    void applyRxEvents();
+    void onLogFilterChanged();
 
 private:
     // UI Components
@@ -56,70 +54,77 @@ private:
     QPushButton *openMapButton;
     QCheckBox *echoModeCheck;
     QCheckBox *hexModeCheck;
-    QTextEdit *logOutput;
+    QLineEdit *listenUriEdit;
+    QSpinBox *configIntervalSpin;
+    QPushButton *sendConfigButton;
+    QListView *logOutput;
+    QComboBox *logLevelCombo;
+    QLineEdit *logFilterEdit;
+    LogModel *logModel;
+    bool logFollow;                 // view was at the bottom when lines arrived
     
-    // Telemetry display labels
+    // Status and telemetry display
     QLabel *statusLabel;
     QLabel *statusIndicator;
     QLabel *clientAddressLabel;
-    QLabel *speedLabel;
-    QLabel *throttleLabel;
-    QLabel *odometerLabel;
-    QLabel *batteryLabel;
-    QProgressBar *batteryBar;
-    QLabel *engineTempLabel;
-    QProgressBar *engineTempBar;
-    QLabel *batteryTempLabel;
-    QLabel *stateLabel;
-    QFrame *stateFrame;
-    QLabel *modeLabel;
-    QFrame *modeFrame;
-    QLabel *turnSignalLabel;
-    QFrame *turnSignalFrame;
-    QLabel *nightModeLabel;
-    QFrame *nightModeFrame;
-    QLabel *beamLabel;
-    QFrame *beamFrame;
-    QLabel *hornLabel;
-    QFrame *hornFrame;
-    QLabel *alertLabel;
-    QLabel *mapsLabel;
+    DashboardWidget *dashboard;
     QLabel *msgCountLabel;
     QLabel *coordsLabel;
     QLabel *totalBytesLabel;
+    QLabel *linkStatsLabel;
     QPropertyAnimation *blinkAnimation;
     QWebEngineView *mapView;
 
     // Bluetooth server state
+    transport_addr_t listenAddr;
     int serverSocket;
     int clientSocket;
     QSocketNotifier *serverNotifier;
-    QSocketNotifier *clientNotifier;
     QTimer *clientCheckTimer;
     bool isRunning;
     bool echoMode;
     bool hexMode;
     unsigned long msgCount;
     unsigned long totalBytes;
+    link_stats_t linkStats;
+    unsigned long crcErrors;
+    uint32_t configId;
+
+    // The client's socket is read and decoded on rxWorker's thread; rxTimer
+    // applies what it queued once per display refresh
+    RxWorker *rxWorker;
+    QTimer *rxTimer;
+    unsigned long rxFramesDroppedLogged;
+    unsigned long rxLogsDroppedLogged;
+
+    // shm:// mode: read the receiver daemon's ring instead of owning the link
+    shm_ring_t ring;
+    shm_ring_reader_t ringReader;
+    QTimer *ringTimer;
+    bool ringAttached;
+    uint64_t ringVehicle;           // followed vehicle, 0 until the first record
+    unsigned long ringLostLogged;
     
     // Helper methods
     void setupUI();
     void applyModernStyle();
     void createTelemetryGroup(QGroupBox *&group);
     void createStatsGroup(QGroupBox *&group);
-    QFrame* createIndicatorFrame();
-    void updateIndicatorState(QFrame *frame, QLabel *label, bool active, const QString &text);
     void updateStatusIndicator(bool running, bool clientConnected);
     bool startBluetoothServer();
     void stopBluetoothServer();
     void acceptClientConnection();
-    void handleClientData();
-    int parseTelemetry(const uint8_t *data, size_t len, telemetry_t *telem);
+    void attachClient(int fd, const QString &peer);
+    void detachClient();
+    bool attachRing(const char *path);
     void displayTelemetry(const telemetry_t *telem);
+    void updateLinkStats();
     void updateMapLocation(double lat, double lng);
     void logMessage(const QString &msg);
     void logHex(const uint8_t *data, size_t len);
     QString getTimestamp();
+    QString getTimestamp(uint64_t us);
+    int refreshIntervalMs();
 };
 
 #endif // MAINWINDOW_H
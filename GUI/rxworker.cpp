@@ -0,0 +1,265 @@
+#include "rxworker.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <system_error>
+
+#include "common/transport.h"
+
+static uint64_t realtimeUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+RxWorker::RxWorker(int fd, bool echo, bool hexDump)
+    : bytes(0),
+      crcErrors(0),
+      pongs(0),
+      framesDropped(0),
+      logsDropped(0),
+      echoesDropped(0),
+      closed(false),
+      fd(fd),
+      wakeFd(-1),
+      echo(echo),
+      hexDump(hexDump),
+      stopping(false),
+      nowUs(0),
+      framesPushed(0),
+      echoDropLogUs(0),
+      echoDropLogged(0)
+{
+    frame_reasm_init(&reasm);
+    telemetry_delta_dec_init(&deltaDec);
+    memset(&handlers, 0, sizeof(handlers));
+    handlers.fn[FRAME_TYPE_TELEMETRY] = onTelemetryFrame;
+    handlers.fn[FRAME_TYPE_DELTA] = onTelemetryFrame;
+    handlers.fn[FRAME_TYPE_PING] = onPingFrame;
+    handlers.fn[FRAME_TYPE_ACK] = onAckFrame;
+}
+
+RxWorker::~RxWorker()
+{
+    stop();
+}
+
+bool RxWorker::start()
+{
+    // Read until EAGAIN without ever blocking outside poll()
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) return false;
+
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFd < 0) return false;
+
+    try {
+        thread = std::thread(&RxWorker::run, this);
+    } catch (const std::system_error &e) {
+        ::close(wakeFd);
+        wakeFd = -1;
+        errno = e.code().value();
+        return false;
+    }
+    return true;
+}
+
+void RxWorker::stop()
+{
+    if (wakeFd < 0) return;
+    stopping.store(true, std::memory_order_release);
+    uint64_t one = 1;
+    ssize_t r = ::write(wakeFd, &one, sizeof(one));
+    (void)r;
+    if (thread.joinable()) thread.join();
+    ::close(wakeFd);
+    wakeFd = -1;
+}
+
+void RxWorker::run()
+{
+    struct pollfd pfd[2];
+    pfd[0].fd = fd;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = wakeFd;
+    pfd[1].events = POLLIN;
+
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            log("[ERROR] poll failed: %s", strerror(errno));
+            break;
+        }
+        if (pfd[1].revents) return;
+        if (pfd[0].revents && !drain()) break;
+    }
+    closed.store(true, std::memory_order_release);
+}
+
+/* Everything the socket holds right now. Returns false once the
+ * connection is gone. */
+bool RxWorker::drain()
+{
+    uint8_t buf[4096];
+    uint8_t frame[FRAME_MAX_SIZE];
+    int flen;
+
+    for (;;) {
+        // read(), not recv(): the client may be a pty
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            log("[ERROR] recv failed: %s", strerror(errno));
+            return false;
+        }
+        if (n == 0) {
+            log("[INFO] Client disconnected");
+            return false;
+        }
+
+        bytes.fetch_add((unsigned long)n, std::memory_order_relaxed);
+        log("[RX] %zd bytes", n);
+        if (hexDump) logHex(buf, (size_t)n);
+
+        // One read may hold several frames, a partial frame or keepalive
+        // bytes; the UI only paints the newest of them
+        unsigned long resyncBefore = reasm.resync_bytes;
+        unsigned long crcBefore = reasm.crc_errors;
+        unsigned long pushedBefore = framesPushed;
+        nowUs = realtimeUs();
+        size_t off = 0;
+        while (off < (size_t)n) {
+            off += frame_reasm_push(&reasm, buf + off, (size_t)n - off);
+            while ((flen = frame_reasm_next(&reasm, frame)) > 0) {
+                if (frame_dispatch(&handlers, this, nullptr, frame, (size_t)flen) == -7) {
+                    log("[WARN] Unhandled frame type 0x%02x", frame_type(frame));
+                }
+            }
+        }
+
+        if (reasm.crc_errors != crcBefore) {
+            crcErrors.store(reasm.crc_errors, std::memory_order_relaxed);
+            log("[WARN] %lu frame(s) failed CRC check", reasm.crc_errors - crcBefore);
+        }
+        if (framesPushed == pushedBefore && reasm.resync_bytes != resyncBefore) {
+            log("[WARN] Failed to parse telemetry (%lu resync bytes)", reasm.resync_bytes - resyncBefore);
+        }
+
+        if (echo) echoBack(buf, (size_t)n);
+    }
+}
+
+/* Non-blocking: a full send buffer drops the echo (or its tail), not the
+ * link. Drops are counted and reported at most once a second. */
+void RxWorker::echoBack(const uint8_t *buf, size_t len)
+{
+    ssize_t sent = transport_send(fd, buf, len);
+    if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        log("[ERROR] send failed: %s", strerror(errno));
+        return;
+    }
+    if (sent == (ssize_t)len) {
+        log("[TX] Echoed %zd bytes", sent);
+        return;
+    }
+
+    unsigned long dropped = echoesDropped.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint64_t now = realtimeUs();
+    if (now - echoDropLogUs >= 1000000u) {
+        log("[WARN] %lu echo(es) dropped or cut short, send buffer full",
+            dropped - echoDropLogged);
+        echoDropLogUs = now;
+        echoDropLogged = dropped;
+    }
+}
+
+void RxWorker::log(const char *fmt, ...)
+{
+    RxLogLine line;
+    va_list ap;
+
+    line.kind = RxLogLine::Text;
+    line.us = realtimeUs();
+    va_start(ap, fmt);
+    int n = vsnprintf(line.data, sizeof(line.data), fmt, ap);
+    va_end(ap);
+    line.len = (uint16_t)(n < 0 ? 0 : n < RX_LOG_LEN ? n : RX_LOG_LEN - 1);
+    if (!logs.push(line)) logsDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* Raw bytes for the hex view, RX_LOG_LEN at a time */
+void RxWorker::logHex(const uint8_t *data, size_t len)
+{
+    RxLogLine line;
+
+    line.kind = RxLogLine::Hex;
+    line.us = realtimeUs();
+    for (size_t off = 0; off < len; off += RX_LOG_LEN) {
+        line.len = (uint16_t)(len - off < RX_LOG_LEN ? len - off : RX_LOG_LEN);
+        memcpy(line.data, data + off, line.len);
+        if (!logs.push(line)) logsDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+int RxWorker::onTelemetryFrame(void *ctx, void *conn, const uint8_t *frame, size_t len)
+{
+    (void)conn;
+    RxWorker *w = static_cast<RxWorker *>(ctx);
+    RxFrame f;
+
+    // Keyframes and deltas both come back as the full state
+    int ret = telemetry_delta_decode(&w->deltaDec, frame, len, &f.telem, &f.meta);
+    if (ret == 0 || ret == -8) {
+        f.rxUs = w->nowUs;
+        f.hasTelem = ret == 0;
+        if (w->frames.push(f)) {
+            w->framesPushed++;
+        } else {
+            w->framesDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return ret;
+}
+
+int RxWorker::onPingFrame(void *ctx, void *conn, const uint8_t *frame, size_t len)
+{
+    (void)conn;
+    RxWorker *w = static_cast<RxWorker *>(ctx);
+    ctrl_msg_t m;
+    uint8_t out[FRAME_MAX_SIZE];
+
+    int ret = ctrl_decode(frame, len, &m);
+    if (ret < 0) return ret;
+
+    // Answered here, not after a UI round trip, so RTTs measure the link
+    size_t n = ctrl_encode_pong(&m.meta, w->nowUs, out);
+    if (transport_send(w->fd, out, n) == (ssize_t)n) w->pongs.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+}
+
+int RxWorker::onAckFrame(void *ctx, void *conn, const uint8_t *frame, size_t len)
+{
+    (void)conn;
+    RxWorker *w = static_cast<RxWorker *>(ctx);
+    ctrl_msg_t m;
+
+    int ret = ctrl_decode(frame, len, &m);
+    if (ret < 0) return ret;
+
+    if (m.status == CTRL_ACK_OK) {
+        w->log("[CTRL] Client applied config #%u", (unsigned)m.meta.seq);
+    } else {
+        w->log("[WARN] Client rejected config #%u: %s %s", (unsigned)m.meta.seq,
+               ctrl_ack_status_str(m.status), m.key ? ctrl_cfg_name(m.key) : "");
+    }
+    return 0;
+}
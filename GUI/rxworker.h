@@ -0,0 +1,102 @@
+/*
+ * rxworker.h - Client connection reader for the GUI, on its own thread
+ *
+ * The worker owns the receive side of one client fd: it sleeps in poll(),
+ * reads until EAGAIN, reassembles and decodes every frame, answers pings
+ * and echoes if asked. The UI thread never touches the socket for reading;
+ * it drains two single-producer queues once per display refresh:
+ *
+ *   frames  one RxFrame per decoded telemetry frame (state + link meta)
+ *   logs    log lines, and raw bytes for the hex view
+ *
+ * Both queues are bounded. When the UI falls behind, the worker drops and
+ * counts instead of blocking, so the socket keeps being drained.
+ *
+ * The fd stays owned by the caller: stop() before close(). Sending from
+ * the UI thread (config messages) is fine while the worker runs.
+ */
+
+#ifndef RXWORKER_H
+#define RXWORKER_H
+
+#include <atomic>
+#include <thread>
+#include <stdint.h>
+
+#include "common/ctrl_msg.h"
+#include "common/frame_reasm.h"
+#include "common/telemetry_codec.h"
+#include "common/telemetry_delta.h"
+#include "spscqueue.h"
+
+#define RX_FRAME_QUEUE 4096
+#define RX_LOG_QUEUE   1024
+#define RX_LOG_LEN     240
+
+struct RxFrame
+{
+    telemetry_t telem;
+    frame_meta_t meta;
+    uint64_t rxUs;              // wall clock at receipt
+    bool hasTelem;              // false: a delta without its keyframe, counts for link stats only
+};
+
+struct RxLogLine
+{
+    enum Kind { Text, Hex };
+    uint8_t kind;
+    uint16_t len;               // Hex: bytes in data
+    uint64_t us;                // wall clock when it happened
+    char data[RX_LOG_LEN];      // Text: NUL-terminated
+};
+
+class RxWorker
+{
+public:
+    RxWorker(int fd, bool echo, bool hexDump);
+    ~RxWorker();
+
+    // Returns false with errno set if the thread could not be started
+    bool start();
+    void stop();
+
+    SpscQueue<RxFrame, RX_FRAME_QUEUE> frames;
+    SpscQueue<RxLogLine, RX_LOG_QUEUE> logs;
+
+    // Written by the worker, read by anyone
+    std::atomic<unsigned long> bytes;
+    std::atomic<unsigned long> crcErrors;
+    std::atomic<unsigned long> pongs;
+    std::atomic<unsigned long> framesDropped;   // frames queue full
+    std::atomic<unsigned long> logsDropped;     // logs queue full
+    std::atomic<unsigned long> echoesDropped;   // send buffer full, echo cut or skipped
+    std::atomic<bool> closed;                   // peer gone or read failed; reason in logs
+
+private:
+    int fd;
+    int wakeFd;
+    bool echo;
+    bool hexDump;
+    std::thread thread;
+    std::atomic<bool> stopping;
+
+    // Worker thread only
+    frame_reasm_t reasm;
+    telemetry_delta_dec_t deltaDec;
+    frame_dispatch_t handlers;
+    uint64_t nowUs;
+    unsigned long framesPushed;
+    uint64_t echoDropLogUs;         // last "echo dropped" warning
+    unsigned long echoDropLogged;
+
+    void run();
+    bool drain();
+    void echoBack(const uint8_t *buf, size_t len);
+    void log(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    void logHex(const uint8_t *data, size_t len);
+    static int onTelemetryFrame(void *ctx, void *conn, const uint8_t *frame, size_t len);
+    static int onPingFrame(void *ctx, void *conn, const uint8_t *frame, size_t len);
+    static int onAckFrame(void *ctx, void *conn, const uint8_t *frame, size_t len);
+};
+
+#endif // RXWORKER_H
@@ -0,0 +1,59 @@
+/*
+ * spscqueue.h - Fixed-size lock-free queue for one producer and one consumer
+ *
+ * The producer (e.g. the socket thread) calls push(), the consumer (the UI
+ * thread) calls pop(); neither ever blocks or allocates. N must be a power
+ * of two. A full queue refuses the element and the producer decides what
+ * that costs.
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+template <typename T, size_t N>
+class SpscQueue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // Producer only
+    bool push(const T &v)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) return false;
+        slots[t & (N - 1)] = v;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    bool pop(T &out)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        out = slots[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Either side; exact only when the other side is idle
+    size_t size() const
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+private:
+    // Keep the two indices on separate cache lines
+    std::atomic<size_t> head;
+    char pad0[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail;
+    char pad1[64 - sizeof(std::atomic<size_t>)];
+    T slots[N];
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,182 @@
+/*
+ * bench_batch.c - Sender CPU per frame and added latency vs. frames per send()
+ *
+ * Compile: gcc -O2 -pthread -o bench_batch bench/bench_batch.c common/tx_batch.c common/transport.c common/lat_hist.c -lbluetooth
+ * Usage:   ./bench_batch [frames-per-round] [period-us]
+ *
+ * Frames go through bt-client's tx_batch over a Unix stream socketpair
+ * while a reader thread drains the other end.
+ *
+ * CPU: frames are encoded as fast as possible, K per send() (what
+ * bt-client --batch-frames K does). Reports the sending thread's CPU time
+ * per frame (CLOCK_THREAD_CPUTIME_ID, so the reader does not count) and
+ * syscalls per frame.
+ *
+ * Latency: frames are produced on a pacer grid (default every 2 ms) and
+ * flushed when tx_batch_due() says so, by count or by --batch-us age.
+ * Reports the measured time from building each frame until the send()
+ * that carried it returned. "bound" is the expected worst case,
+ * min((K-1) periods, batch-us), computed, not measured.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../common/lat_hist.h"
+#include "../common/pacer.h"
+#include "../common/telemetry_codec.h"
+#include "../common/tx_batch.h"
+
+#define LAT_FRAMES 256              // a multiple of every batch size
+
+static atomic_int g_reading = 1;
+static tx_batch_t g_batch;
+
+static double cpu_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *reader(void *arg) {
+    int fd = *(int *)arg;
+    static uint8_t buf[1 << 16];
+    while (atomic_load_explicit(&g_reading, memory_order_relaxed)) {
+        if (read(fd, buf, sizeof(buf)) <= 0) break;
+    }
+    return NULL;
+}
+
+static void flush(int fd, tx_batch_t *b, lat_hist_t *send_lat) {
+    if (tx_batch_flush(fd, b, send_lat) < 0) {
+        perror("send");
+        exit(1);
+    }
+}
+
+static void run_cpu(int fd, unsigned k, size_t nframes) {
+    tx_batch_t *b = &g_batch;
+    uint8_t frame[FRAME_SIZE];
+    telemetry_t t;
+    lat_hist_t send_lat;
+
+    memset(b, 0, sizeof(*b));
+    memset(&t, 0, sizeof(t));
+    lat_hist_init(&send_lat);
+
+    double c0 = cpu_sec(), w0 = now_sec();
+    for (size_t i = 0; i < nframes; i++) {
+        t.speed = (uint8_t)i;
+        t.throttle = (uint8_t)(i * 3);
+        telemetry_encode_frame(&t, frame);
+        tx_batch_put(b, frame, FRAME_SIZE, true, 0);
+        if (tx_batch_due(b, k, UINT64_MAX, 0)) flush(fd, b, &send_lat);
+    }
+    while (b->len) flush(fd, b, &send_lat);
+    double cpu = cpu_sec() - c0, wall = now_sec() - w0;
+
+    printf("%6u %12.0f %12.1f %10.3f\n",
+           k, nframes / wall, cpu * 1e9 / nframes, (double)b->sends / nframes);
+}
+
+static void run_latency(int fd, unsigned k, unsigned batch_us, uint64_t period_ns) {
+    tx_batch_t *b = &g_batch;
+    uint64_t batch_ns = (uint64_t)batch_us * 1000ull;
+    uint64_t built_ns[LAT_FRAMES];
+    uint8_t frame[FRAME_SIZE];
+    telemetry_t t;
+    lat_hist_t delay, send_lat;
+    pacer_t p;
+    size_t built = 0;
+
+    memset(b, 0, sizeof(*b));
+    memset(&t, 0, sizeof(t));
+    lat_hist_init(&delay);
+    lat_hist_init(&send_lat);
+    pacer_init(&p, period_ns, PACER_SKIP, 0);
+
+    // Sleep until the next frame or until the oldest queued one ages out,
+    // the way bt-client's send loop does
+    while (built < LAT_FRAMES || b->frames) {
+        uint64_t wake = built < LAT_FRAMES ? p.next_ns : UINT64_MAX;
+        if (b->frames && b->first_ns + batch_ns < wake) wake = b->first_ns + batch_ns;
+        if (wake == UINT64_MAX) break;
+        pacer_sleep_until(wake);
+
+        uint64_t now = pacer_now_ns();
+        if (built < LAT_FRAMES && now >= p.next_ns) {
+            t.speed = (uint8_t)built;
+            telemetry_encode_frame(&t, frame);
+            built_ns[built++] = now;
+            tx_batch_put(b, frame, FRAME_SIZE, true, now);
+            pacer_advance(&p, now);
+        }
+        if (tx_batch_due(b, k, batch_ns, now)) {
+            unsigned long sent = b->sent_frames;
+            flush(fd, b, &send_lat);
+            uint64_t done = pacer_now_ns();
+            for (; sent < b->sent_frames; sent++) lat_hist_add(&delay, done - built_ns[sent]);
+        }
+    }
+
+    double bound = (k - 1) * period_ns / 1e6;
+    if (batch_us / 1e3 < bound) bound = batch_us / 1e3;
+    printf("%6u %9u %10.3f %9.3f %9.3f %9.3f %9.3f\n",
+           k, batch_us, (double)b->sends / LAT_FRAMES,
+           lat_hist_quantile(&delay, 0.50) / 1e6, lat_hist_quantile(&delay, 0.99) / 1e6,
+           delay.max / 1e6, bound);
+}
+
+int main(int argc, char **argv) {
+    size_t nframes = (argc > 1) ? strtoul(argv[1], NULL, 10) : 2000000;
+    unsigned period_us = (argc > 2) ? (unsigned)strtoul(argv[2], NULL, 10) : 2000;
+    static const unsigned ks[] = { 1, 2, 4, 8, 16, 32, 64 };
+    // --batch-us 0 with K > 1 means 1 s in bt-client
+    static const struct { unsigned k, batch_us; } lat[] = {
+        { 1, 0 }, { 4, 1000000 }, { 16, 1000000 }, { 64, 1000000 },
+        { 16, 5000 }, { 64, 5000 }, { 64, 20000 },
+    };
+    int sv[2];
+    pthread_t tid;
+
+    if (period_us == 0) period_us = 1;
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        perror("socketpair");
+        return 1;
+    }
+    pthread_create(&tid, NULL, reader, &sv[1]);
+
+    printf("%zu frames per round, sender thread CPU only\n", nframes);
+    printf("%6s %12s %12s %10s\n", "batch", "frames/s", "cpu ns/fr", "send/fr");
+    for (size_t i = 0; i < sizeof(ks) / sizeof(ks[0]); i++) {
+        run_cpu(sv[0], ks[i], nframes);
+    }
+
+    printf("\n%d frames per round, one every %u us; build -> send() returned, measured\n",
+           LAT_FRAMES, period_us);
+    printf("%6s %9s %10s %9s %9s %9s %9s\n",
+           "batch", "batch-us", "send/fr", "p50 ms", "p99 ms", "max ms", "bound ms");
+    for (size_t i = 0; i < sizeof(lat) / sizeof(lat[0]); i++) {
+        run_latency(sv[0], lat[i].k, lat[i].batch_us, (uint64_t)period_us * 1000ull);
+    }
+
+    atomic_store(&g_reading, 0);
+    close(sv[0]);
+    pthread_join(tid, NULL);
+    close(sv[1]);
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * bench_batch_decode.c - Columnar batch decoder vs. the per-frame parser
+ *
+ * Compile: gcc -O2 -march=native -o bench_batch_decode bench/bench_batch_decode.c common/telemetry_batch.c
+ * Usage:   ./bench_batch_decode [frames]
+ *
+ * Decodes the same buffer three ways:
+ *   per-frame  telemetry_decode_frame() into an array of telemetry_t
+ *   scalar     telemetry_decode_batch_scalar() into columns
+ *   batch      telemetry_decode_batch() (AVX2 when compiled in)
+ * and checks that the columns and valid[] flags are bit-identical across
+ * all three. About 1% of the frames are corrupted so the invalid path is
+ * exercised too. Exits non-zero on any mismatch.
+ *
+ * The scalar path is what builds without AVX2 get; it must keep up with
+ * per-frame decoding, so its ratio is printed on its own line as well.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "../common/telemetry_batch.h"
+
+#define ROUNDS 5
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void alloc_columns(telemetry_columns_t *c, size_t n) {
+#define X(name, type, byte, shift, width) c->name = calloc(n, sizeof(type));
+    TELEM_FIELDS(X)
+#undef X
+}
+
+static void free_columns(telemetry_columns_t *c) {
+#define X(name, type, byte, shift, width) free(c->name);
+    TELEM_FIELDS(X)
+#undef X
+}
+
+static int compare_columns(const telemetry_columns_t *a, const telemetry_columns_t *b, size_t n) {
+    int bad = 0;
+#define X(name, type, byte, shift, width)                                   \
+    if (memcmp(a->name, b->name, n * sizeof(type)) != 0) {                  \
+        fprintf(stderr, "[FAIL] column " #name " differs\n");               \
+        bad = 1;                                                            \
+    }
+    TELEM_FIELDS(X)
+#undef X
+    return bad;
+}
+
+static void report(const char *name, double best, size_t n, double base) {
+    printf("%-10s %8.3f ms  %8.1f Mframes/s  %5.2fx\n",
+           name, best * 1e3, n / best / 1e6, base / best);
+}
+
+int main(int argc, char **argv) {
+    size_t n = (argc > 1) ? strtoul(argv[1], NULL, 10) : 4000000;
+    uint8_t *buf = malloc(n * FRAME_SIZE);
+    telemetry_t *aos = malloc(n * sizeof(*aos));
+    uint8_t *aos_ok = malloc(n);
+    uint8_t *valid_s = malloc(n);
+    uint8_t *valid_v = malloc(n);
+    telemetry_columns_t cs, cv;
+
+    if (!buf || !aos || !aos_ok || !valid_s || !valid_v) {
+        perror("malloc");
+        return 1;
+    }
+    alloc_columns(&cs, n);
+    alloc_columns(&cv, n);
+
+    srand(1);
+    for (size_t i = 0; i < n; i++) {
+        uint8_t *f = buf + i * FRAME_SIZE;
+        f[0] = FRAME_START;
+        f[1] = FRAME_PAYLOAD;
+        for (int j = 2; j < 10; j++) f[j] = (uint8_t)rand();
+        f[10] = FRAME_DELIM;
+        if (rand() % 100 == 0) f[rand() % FRAME_SIZE] ^= (uint8_t)(1 + rand() % 255);
+    }
+
+    double best_aos = 1e9, best_s = 1e9, best_v = 1e9;
+    size_t good_aos = 0, good_s = 0, good_v = 0;
+
+    for (int r = 0; r < ROUNDS; r++) {
+        double t0 = now_sec();
+        good_aos = 0;
+        for (size_t i = 0; i < n; i++) {
+            aos_ok[i] = telemetry_decode_frame(buf + i * FRAME_SIZE, FRAME_SIZE, &aos[i]) == 0;
+            good_aos += aos_ok[i];
+        }
+        double t1 = now_sec();
+        good_s = telemetry_decode_batch_scalar(buf, n, &cs, valid_s);
+        double t2 = now_sec();
+        good_v = telemetry_decode_batch(buf, n, &cv, valid_v);
+        double t3 = now_sec();
+
+        if (t1 - t0 < best_aos) best_aos = t1 - t0;
+        if (t2 - t1 < best_s) best_s = t2 - t1;
+        if (t3 - t2 < best_v) best_v = t3 - t2;
+    }
+
+    printf("%zu frames, %zu valid, batch path: %s (best of %d)\n",
+           n, good_v, telemetry_batch_impl(), ROUNDS);
+    report("per-frame", best_aos, n, best_aos);
+    report("scalar", best_s, n, best_aos);
+    report("batch", best_v, n, best_aos);
+    printf("scalar vs per-frame: %.2fx (%.2f vs %.2f ns/frame)\n",
+           best_aos / best_s, best_s * 1e9 / n, best_aos * 1e9 / n);
+
+    // Bit-exact equivalence
+    int bad = 0;
+    if (good_s != good_aos || good_v != good_aos) {
+        fprintf(stderr, "[FAIL] valid counts differ: %zu/%zu/%zu\n", good_aos, good_s, good_v);
+        bad = 1;
+    }
+    if (memcmp(valid_s, valid_v, n) != 0 || memcmp(valid_s, aos_ok, n) != 0) {
+        fprintf(stderr, "[FAIL] valid flags differ\n");
+        bad = 1;
+    }
+    bad |= compare_columns(&cs, &cv, n);
+    for (size_t i = 0; i < n && !bad; i++) {
+        if (!aos_ok[i]) continue;
+#define X(name, type, byte, shift, width)                                   \
+        if (aos[i].name != cv.name[i]) {                                    \
+            fprintf(stderr, "[FAIL] frame %zu field " #name "\n", i);       \
+            bad = 1;                                                        \
+        }
+        TELEM_FIELDS(X)
+#undef X
+    }
+    printf("equivalence: %s\n", bad ? "MISMATCH" : "bit-exact");
+
+    free_columns(&cs);
+    free_columns(&cv);
+    free(buf);
+    free(aos);
+    free(aos_ok);
+    free(valid_s);
+    free(valid_v);
+    return bad;
+}
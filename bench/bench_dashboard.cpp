@@ -0,0 +1,382 @@
+/*
+ * bench_dashboard.cpp - UI-thread time per telemetry frame for the GUI dashboard
+ *
+ * Compile: g++ -std=c++17 -O2 -fPIC -I. -IGUI $(pkg-config --cflags Qt6Widgets) \
+ *          -o bench_dashboard bench/bench_dashboard.cpp GUI/dashboardwidget.cpp \
+ *          $(pkg-config --libs Qt6Widgets)
+ * Usage:   QT_QPA_PLATFORM=offscreen ./bench_dashboard [frames]
+ *
+ * Builds the dashboard both ways in one window and feeds both the same drive:
+ * speed changing every frame, battery and temperatures drifting slowly and
+ * crossing their thresholds a few times, indicators toggling now and then.
+ *
+ * stylesheet  the original grid of labels, lamps and progress bars, with
+ *             setStyleSheet() on seven widgets and four indicators and
+ *             every setText() on each frame
+ * painted     DashboardWidget: cached background, only changed cells are
+ *             repainted
+ *
+ * Per frame it times the render call alone, and the render plus the
+ * polish, layout and paint it causes (the processEvents() that follows).
+ * A quarter of the frames repeat the previous state; their cost is shown
+ * separately, since the painted widget should make them nearly free.
+ * Also reported: frames over the 16.7 ms budget of a 60 Hz display, and
+ * the share of one core a 60 fps dashboard would take at the mean cost.
+ */
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QGridLayout>
+#include <QGroupBox>
+#include <QFrame>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QProgressBar>
+#include <QWidget>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "dashboardwidget.h"
+
+// The widgets of the original grid
+struct DashWidgets
+{
+    QLabel *speed, *throttle, *odometer, *battery;
+    QProgressBar *batteryBar;
+    QLabel *engineTemp;
+    QProgressBar *engineTempBar;
+    QLabel *batteryTemp;
+    QFrame *stateLamp;
+    QLabel *state;
+    QFrame *modeLamp;
+    QLabel *mode;
+    QFrame *turnLamp;
+    QLabel *turn;
+    QFrame *nightLamp;
+    QLabel *night;
+    QFrame *beamLamp;
+    QLabel *beam;
+    QFrame *hornLamp;
+    QLabel *horn;
+    QLabel *alert, *maps;
+};
+
+/* ---- The dashboard as it was: styles rebuilt on every frame ---- */
+
+static const char *kLampOff =
+    "QFrame { background-color: #95a5a6; border-radius: 8px; min-width: 16px; max-width: 16px; "
+    "min-height: 16px; max-height: 16px; }";
+
+static void legacyIndicator(QFrame *frame, QLabel *label, bool active, const QString &text)
+{
+    if (active) {
+        frame->setStyleSheet(
+            "QFrame { background-color: #2ecc71; border-radius: 8px; min-width: 16px; max-width: 16px; "
+            "min-height: 16px; max-height: 16px; }");
+        label->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #27ae60; padding: 5px; }");
+    } else {
+        frame->setStyleSheet(kLampOff);
+        label->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #7f8c8d; padding: 5px; }");
+    }
+    label->setText(text);
+}
+
+static void legacyRender(const DashWidgets &w, const telemetry_t *telem)
+{
+    const char *state_str[] = {"", "N", "D", "P"};
+    const char *mode_str[] = {"", "ECON", "COMF", "SPORT"};
+    const char *signal_str[] = {"none", "right", "left", "hazard"};
+
+    int rpm = telem->speed * 46;
+    w.speed->setText(QString("%1 RPM").arg(rpm));
+    if (rpm > 8000) {
+        w.speed->setStyleSheet(
+            "QLabel { font-size: 24px; font-weight: bold; color: #e74c3c; "
+            "background-color: #fadbd8; border-radius: 6px; padding: 10px 20px; }");
+    } else if (rpm > 5000) {
+        w.speed->setStyleSheet(
+            "QLabel { font-size: 24px; font-weight: bold; color: #f39c12; "
+            "background-color: #fef5e7; border-radius: 6px; padding: 10px 20px; }");
+    } else {
+        w.speed->setStyleSheet(
+            "QLabel { font-size: 24px; font-weight: bold; color: #3498db; "
+            "background-color: #ecf0f1; border-radius: 6px; padding: 10px 20px; }");
+    }
+    w.throttle->setText(QString::number(telem->throttle));
+    w.odometer->setText(QString("%1 km").arg(telem->total_miles * 1.60934, 0, 'f', 1));
+
+    w.battery->setText(QString("%1%").arg(telem->battery));
+    w.batteryBar->setValue(telem->battery);
+    if (telem->battery < 20) {
+        w.battery->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #e74c3c; padding: 5px; min-width: 50px; }");
+        w.batteryBar->setStyleSheet(
+            "QProgressBar { border: 2px solid #e74c3c; border-radius: 5px; background-color: #fadbd8; } "
+            "QProgressBar::chunk { background-color: #e74c3c; border-radius: 3px; }");
+    } else if (telem->battery < 50) {
+        w.battery->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #f39c12; padding: 5px; min-width: 50px; }");
+        w.batteryBar->setStyleSheet(
+            "QProgressBar { border: 2px solid #f39c12; border-radius: 5px; background-color: #fef5e7; } "
+            "QProgressBar::chunk { background-color: #f39c12; border-radius: 3px; }");
+    } else {
+        w.battery->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #27ae60; padding: 5px; min-width: 50px; }");
+        w.batteryBar->setStyleSheet(
+            "QProgressBar { border: 2px solid #bdc3c7; border-radius: 5px; background-color: #ecf0f1; } "
+            "QProgressBar::chunk { background: qlineargradient(x1:0, y1:0, x2:1, y2:0, stop:0 #27ae60, stop:1 #2ecc71); border-radius: 3px; }");
+    }
+
+    int engineTemp = (int)telem->engine_temp - 20;
+    w.engineTemp->setText(QString("%1 °C").arg(engineTemp));
+    w.engineTempBar->setValue(engineTemp);
+    if (engineTemp > 90) {
+        w.engineTemp->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #e74c3c; padding: 5px; min-width: 60px; }");
+    } else if (engineTemp > 70) {
+        w.engineTemp->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #f39c12; padding: 5px; min-width: 60px; }");
+    } else {
+        w.engineTemp->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #3498db; padding: 5px; min-width: 60px; }");
+    }
+    w.batteryTemp->setText(QString::number(telem->battery_temp));
+
+    legacyIndicator(w.stateLamp, w.state, telem->state > 0, state_str[telem->state & 3]);
+
+    w.mode->setText(mode_str[telem->mode & 3]);
+    QString modeColor;
+    switch (telem->mode) {
+        case 1: modeColor = "#27ae60"; break;
+        case 2: modeColor = "#3498db"; break;
+        case 3: modeColor = "#e74c3c"; break;
+        default: modeColor = "#95a5a6"; break;
+    }
+    w.modeLamp->setStyleSheet(QString(
+        "QFrame { background-color: %1; border-radius: 8px; min-width: 16px; max-width: 16px; "
+        "min-height: 16px; max-height: 16px; }").arg(modeColor));
+
+    w.turn->setText(signal_str[telem->turn_signal & 3]);
+    if (telem->turn_signal > 0) {
+        QString turnColor = (telem->turn_signal == 3) ? "#f39c12" : "#2ecc71";
+        w.turnLamp->setStyleSheet(QString(
+            "QFrame { background-color: %1; border-radius: 8px; min-width: 16px; max-width: 16px; "
+            "min-height: 16px; max-height: 16px; }").arg(turnColor));
+    } else {
+        w.turnLamp->setStyleSheet(kLampOff);
+    }
+
+    legacyIndicator(w.nightLamp, w.night, telem->night_mode, telem->night_mode ? "ON" : "OFF");
+    legacyIndicator(w.beamLamp, w.beam, telem->beam, telem->beam ? "ON" : "OFF");
+    legacyIndicator(w.hornLamp, w.horn, telem->horn, telem->horn ? "ON" : "OFF");
+
+    w.alert->setText(QString::number(telem->alert));
+    if (telem->alert > 0) {
+        w.alert->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #e74c3c; "
+                               "background-color: #fadbd8; padding: 5px 10px; border-radius: 4px; }");
+    } else {
+        w.alert->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; color: #27ae60; padding: 5px; }");
+    }
+    w.maps->setText(telem->maps ? "ON" : "OFF");
+}
+
+/* ---- The original grid ---- */
+
+static DashWidgets buildDashboard(QGroupBox *group)
+{
+    DashWidgets w;
+    QGridLayout *layout = new QGridLayout(group);
+    const char *value = "QLabel { font-size: 14px; font-weight: bold; color: #34495e; padding: 5px; }";
+    int row = 0;
+
+    w.speed = new QLabel("-- RPM");
+    layout->addWidget(new QLabel("Speed:"), row, 0);
+    layout->addWidget(w.speed, row++, 1, 1, 3);
+    w.throttle = new QLabel("--");
+    w.throttle->setStyleSheet(value);
+    layout->addWidget(new QLabel("Throttle:"), row, 0);
+    layout->addWidget(w.throttle, row++, 1);
+    w.odometer = new QLabel("-- km");
+    w.odometer->setStyleSheet(value);
+    layout->addWidget(new QLabel("Odometer:"), row, 0);
+    layout->addWidget(w.odometer, row++, 1);
+
+    QHBoxLayout *battery = new QHBoxLayout();
+    w.battery = new QLabel("--%");
+    w.batteryBar = new QProgressBar();
+    w.batteryBar->setRange(0, 100);
+    w.batteryBar->setTextVisible(false);
+    battery->addWidget(w.battery);
+    battery->addWidget(w.batteryBar);
+    layout->addWidget(new QLabel("Battery:"), row, 0);
+    layout->addLayout(battery, row++, 1, 1, 3);
+
+    QHBoxLayout *temp = new QHBoxLayout();
+    w.engineTemp = new QLabel("-- °C");
+    w.engineTempBar = new QProgressBar();
+    w.engineTempBar->setRange(-20, 43);
+    w.engineTempBar->setTextVisible(false);
+    temp->addWidget(w.engineTemp);
+    temp->addWidget(w.engineTempBar);
+    layout->addWidget(new QLabel("Engine Temp:"), row, 0);
+    layout->addLayout(temp, row++, 1, 1, 3);
+
+    w.batteryTemp = new QLabel("--");
+    w.batteryTemp->setStyleSheet(value);
+    layout->addWidget(new QLabel("Battery Temp:"), row, 0);
+    layout->addWidget(w.batteryTemp, row++, 1);
+
+    struct { const char *title; QFrame **lamp; QLabel **label; } lamps[] = {
+        { "State:", &w.stateLamp, &w.state },
+        { "Mode:", &w.modeLamp, &w.mode },
+        { "Turn Signal:", &w.turnLamp, &w.turn },
+        { "Night Mode:", &w.nightLamp, &w.night },
+        { "High Beam:", &w.beamLamp, &w.beam },
+        { "Horn:", &w.hornLamp, &w.horn },
+    };
+    row = 0;
+    for (auto &l : lamps) {
+        QHBoxLayout *h = new QHBoxLayout();
+        *l.lamp = new QFrame();
+        *l.label = new QLabel("--");
+        (*l.lamp)->setStyleSheet(kLampOff);
+        (*l.label)->setStyleSheet("QLabel { font-size: 14px; font-weight: bold; padding: 5px; }");
+        h->addWidget(*l.lamp);
+        h->addWidget(*l.label);
+        h->addStretch();
+        layout->addWidget(new QLabel(l.title), row, 4);
+        layout->addLayout(h, row++, 5);
+    }
+    w.alert = new QLabel("--");
+    layout->addWidget(new QLabel("Alert:"), row, 4);
+    layout->addWidget(w.alert, row++, 5);
+    w.maps = new QLabel("--");
+    w.maps->setStyleSheet(value);
+    layout->addWidget(new QLabel("Maps:"), row, 4);
+    layout->addWidget(w.maps, row++, 5);
+    return w;
+}
+
+/* ---- Drive ---- */
+
+static std::vector<telemetry_t> makeDrive(size_t frames)
+{
+    std::vector<telemetry_t> drive(frames);
+    telemetry_t t;
+    memset(&t, 0, sizeof(t));
+    t.battery = 100;
+    t.engine_temp = 60;
+    t.state = 2;
+    t.mode = 2;
+    srand(7);
+
+    for (size_t i = 0; i < frames; i++) {
+        // Speed wanders every frame across all three bands (0..255 * 46 rpm)
+        int speed = t.speed + rand() % 7 - 3;
+        if (i % 2000 < 1000) speed += 1;
+        else speed -= 1;
+        t.speed = (uint8_t)std::max(0, std::min(255, speed));
+        t.throttle = (uint8_t)std::min(100, t.speed / 2);
+        if (i % 50 == 0) t.total_miles++;
+        // Battery drains 100 -> 0 over the drive, temperature cycles slowly
+        t.battery = (uint8_t)(100 - 100 * i / frames);
+        t.engine_temp = (uint8_t)(60 + (i / 40) % 60);
+        t.battery_temp = (uint8_t)(25 + (i / 400) % 10);
+        // Indicators every few seconds at 100 frames/s
+        t.turn_signal = (uint8_t)((i / 300) % 4);
+        t.night_mode = (uint8_t)((i / 1000) % 2);
+        t.beam = (uint8_t)((i / 700) % 2);
+        t.horn = (uint8_t)(i % 900 < 30);
+        t.alert = (uint8_t)(i % 1500 < 100 ? 1 : 0);
+        if (i % 4 == 3) drive[i] = drive[i - 1];     // a quarter of the frames repeat the state
+        else drive[i] = t;
+    }
+    return drive;
+}
+
+struct Result {
+    std::vector<double> renderUs, totalUs;
+    double idleUs;                  // mean render+paint of frames identical to the previous
+};
+
+static double pct(std::vector<double> v, double q)
+{
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0 : v[(size_t)(q * (v.size() - 1))];
+}
+
+template <typename Render>
+static Result run(const std::vector<telemetry_t> &drive, Render render)
+{
+    Result r;
+    QElapsedTimer clock;
+    double idleSum = 0;
+    size_t idleN = 0;
+
+    for (size_t i = 0; i < drive.size(); i++) {
+        clock.start();
+        render(&drive[i]);
+        double renderUs = clock.nsecsElapsed() / 1e3;
+        QApplication::processEvents();     // polish, layout and paint what was marked dirty
+        double totalUs = clock.nsecsElapsed() / 1e3;
+        r.renderUs.push_back(renderUs);
+        r.totalUs.push_back(totalUs);
+        if (i > 0 && memcmp(&drive[i], &drive[i - 1], sizeof(telemetry_t)) == 0) {
+            idleSum += totalUs;
+            idleN++;
+        }
+    }
+    r.idleUs = idleN ? idleSum / idleN : 0;
+    return r;
+}
+
+static void report(const char *name, const Result &r, unsigned long cells)
+{
+    double sum = 0;
+    size_t over = 0;
+    for (double v : r.totalUs) {
+        sum += v;
+        if (v > 1e6 / 60) over++;
+    }
+    double mean = sum / r.totalUs.size();
+    printf("%-11s render p50 %7.1f p99 %7.1f us | render+paint p50 %7.1f p99 %7.1f mean %7.1f us"
+           " | unchanged frame %6.1f us\n",
+           name, pct(r.renderUs, 0.50), pct(r.renderUs, 0.99), pct(r.totalUs, 0.50),
+           pct(r.totalUs, 0.99), mean, r.idleUs);
+    printf("%-11s %zu frame(s) over 16.7 ms, %.1f%% of a core at 60 fps", "", over, mean * 60 / 1e4);
+    if (cells) printf(", %.1f cells painted/frame", (double)cells / r.totalUs.size());
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    QApplication app(argc, argv);
+    size_t frames = (argc > 1) ? strtoul(argv[1], NULL, 10) : 6000;
+    std::vector<telemetry_t> drive = makeDrive(frames);
+
+    // As in MainWindow::applyModernStyle(): every widget goes through the style sheet style
+    QWidget window;
+    window.setStyleSheet("QWidget { font-family: 'Segoe UI', Arial, sans-serif; } "
+                         "QLabel { color: #2c3e50; } QGroupBox { background-color: white; }");
+    QHBoxLayout *top = new QHBoxLayout(&window);
+    QGroupBox *oldGroup = new QGroupBox("stylesheet");
+    QGroupBox *newGroup = new QGroupBox("painted");
+    top->addWidget(oldGroup);
+    top->addWidget(newGroup);
+
+    DashWidgets oldW = buildDashboard(oldGroup);
+    QHBoxLayout *newLayout = new QHBoxLayout(newGroup);
+    DashboardWidget *dash = new DashboardWidget();
+    newLayout->addWidget(dash);
+
+    window.resize(1900, 400);
+    window.show();
+    QApplication::processEvents();
+
+    printf("%zu frames, %s platform\n", frames, qPrintable(QApplication::platformName()));
+    Result before = run(drive, [&](const telemetry_t *t) { legacyRender(oldW, t); });
+    report("stylesheet", before, 0);
+    unsigned long cellsBefore = dash->cellsPainted;
+    Result after = run(drive, [&](const telemetry_t *t) { dash->setTelemetry(t); });
+    report("painted", after, dash->cellsPainted - cellsBefore);
+    printf("UI-thread time per frame (p50 render+paint): %.1fx less\n",
+           pct(before.totalUs, 0.5) / std::max(0.1, pct(after.totalUs, 0.5)));
+    return 0;
+}
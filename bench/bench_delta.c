@@ -0,0 +1,212 @@
+/*
+ * bench_delta.c - Bytes on the wire and CPU cost of keyframe/delta frames
+ *
+ * Compile: gcc -O2 -o bench_delta bench/bench_delta.c common/telemetry_delta.c common/crc32c.c
+ * Usage:   ./bench_delta [frames] [rate-hz]
+ *
+ * Encodes three synthetic traces with the delta encoder at several
+ * keyframe intervals and compares the result against plain v1 and v2
+ * frames:
+ *   sim     what bt-client's simulator produces (rpm and voltage ramps)
+ *   drive   random walks on speed/throttle, slow odometer, battery and
+ *           temperature drift, the occasional indicator, beam or mode
+ *   parked  almost nothing changes
+ * Every encoded stream is decoded again and checked field by field against
+ * the input; exits non-zero on any mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "../common/telemetry_delta.h"
+
+#define ROUNDS 5
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t rng = 1;
+static uint32_t rnd(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static int walk(int v, int step, int lo, int hi) {
+    v += (int)(rnd() % (2 * step + 1)) - step;
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static void gen_sim(telemetry_t *t, size_t n) {
+    unsigned rpm = 0, volt = 630;
+    for (size_t i = 0; i < n; i++) {
+        rpm = (rpm + 50) % 12000;
+        volt = 630 + ((volt - 630 + 1) % 201);
+        memset(&t[i], 0, sizeof(t[i]));
+        t[i].speed = (uint8_t)(rpm / 46);
+        t[i].battery = (uint8_t)((volt - 630) / 2);
+        t[i].night_mode = 1;
+        t[i].engine_temp = 25;
+        t[i].state = 1;
+        t[i].mode = 1;
+    }
+}
+
+static void gen_drive(telemetry_t *t, size_t n) {
+    telemetry_t s;
+    memset(&s, 0, sizeof(s));
+    s.battery = 100;
+    s.engine_temp = 30;
+    s.battery_temp = 20;
+    s.state = 2;
+    s.mode = 2;
+    int speed = 40, thr = 80;
+
+    for (size_t i = 0; i < n; i++) {
+        speed = walk(speed, 3, 0, 255);
+        thr = walk(thr, 6, 0, 255);
+        s.speed = (uint8_t)speed;
+        s.throttle = (uint8_t)thr;
+        if (i % 25 == 0) s.total_miles++;
+        if (i % 600 == 0 && s.battery > 0) s.battery--;
+        if (i % 300 == 0) s.engine_temp = (uint8_t)walk(s.engine_temp, 1, 20, 63);
+        if (i % 900 == 0) s.battery_temp = (uint8_t)walk(s.battery_temp, 1, 10, 63);
+        if (rnd() % 200 == 0) s.turn_signal = (uint8_t)(s.turn_signal ? 0 : 1 + rnd() % 2);
+        if (rnd() % 500 == 0) s.beam ^= 1;
+        if (rnd() % 1000 == 0) s.horn ^= 1;
+        if (rnd() % 3000 == 0) s.mode = (uint8_t)(1 + rnd() % 3);
+        t[i] = s;
+    }
+}
+
+static void gen_parked(telemetry_t *t, size_t n) {
+    telemetry_t s;
+    memset(&s, 0, sizeof(s));
+    s.battery = 80;
+    s.engine_temp = 25;
+    s.state = 3;
+    s.mode = 1;
+    for (size_t i = 0; i < n; i++) {
+        if (i % 1200 == 0) s.engine_temp = (uint8_t)walk(s.engine_temp, 1, 20, 40);
+        t[i] = s;
+    }
+}
+
+static uint64_t ts_of(size_t i, double rate) {
+    return 1700000000000000ull + (uint64_t)(i * 1e6 / rate);
+}
+
+/* Encode with keyframes every key frames (0 = plain v2). Returns bytes. */
+static size_t encode_trace(const telemetry_t *t, size_t n, unsigned key, double rate,
+                           uint8_t *buf) {
+    telemetry_delta_enc_t e;
+    size_t off = 0;
+    telemetry_delta_enc_init(&e, key);
+    for (size_t i = 0; i < n; i++) {
+        if (key == 0) {
+            off += telemetry_encode_frame_v2(&t[i], (uint32_t)i, ts_of(i, rate), buf + off);
+        } else {
+            off += telemetry_delta_encode(&e, &t[i], (uint32_t)i, ts_of(i, rate), buf + off);
+        }
+    }
+    return off;
+}
+
+static int decode_trace(const telemetry_t *t, size_t n, const uint8_t *buf, size_t len) {
+    telemetry_delta_dec_t d;
+    size_t off = 0, i = 0;
+    telemetry_delta_dec_init(&d);
+    while (off < len) {
+        telemetry_t got;
+        frame_meta_t meta;
+        size_t flen = frame_total_len(buf + off);
+        if (telemetry_delta_decode(&d, buf + off, flen, &got, &meta) != 0 || meta.seq != i ||
+            i >= n) {
+            return -1;
+        }
+        uint8_t a[FRAME_PAYLOAD], b[FRAME_PAYLOAD];
+        telemetry_pack(&t[i], a);
+        telemetry_pack(&got, b);
+        if (memcmp(a, b, sizeof(a)) != 0) return -1;
+        off += flen;
+        i++;
+    }
+    return i == n ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    size_t n = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+    double rate = (argc > 2) ? atof(argv[2]) : 10.0;
+    static const unsigned keys[] = {0, 1, 10, 50, 255};
+    static const struct {
+        const char *name;
+        void (*gen)(telemetry_t *, size_t);
+    } traces[] = {
+        {"sim", gen_sim},
+        {"drive", gen_drive},
+        {"parked", gen_parked},
+    };
+
+    telemetry_t *t = malloc(n * sizeof(*t));
+    uint8_t *buf = malloc(n * FRAME_V2_SIZE);
+    if (!t || !buf) {
+        perror("malloc");
+        return 1;
+    }
+
+    printf("%zu frames per trace, bytes/s at %.0f Hz per vehicle, crc32c: %s\n\n",
+           n, rate, crc32c_impl());
+    printf("%-7s %-9s %10s %10s %9s %9s %9s %9s\n",
+           "trace", "encoding", "bytes/frm", "bytes/s", "vs v1", "vs v2", "enc ns", "dec ns");
+
+    int bad = 0;
+    for (size_t k = 0; k < sizeof(traces) / sizeof(traces[0]); k++) {
+        traces[k].gen(t, n);
+        printf("%-7s %-9s %10.2f %10.0f %9s %9s\n", traces[k].name, "v1",
+               (double)FRAME_SIZE, FRAME_SIZE * rate, "-", "-");
+
+        for (size_t j = 0; j < sizeof(keys) / sizeof(keys[0]); j++) {
+            double enc_best = 1e9, dec_best = 1e9;
+            size_t bytes = 0;
+
+            for (int r = 0; r < ROUNDS; r++) {
+                double t0 = now_sec();
+                bytes = encode_trace(t, n, keys[j], rate, buf);
+                double t1 = now_sec();
+                if (decode_trace(t, n, buf, bytes) != 0) {
+                    fprintf(stderr, "[FAIL] %s key %u: decoded state differs\n",
+                            traces[k].name, keys[j]);
+                    bad = 1;
+                    break;
+                }
+                double t2 = now_sec();
+                if (t1 - t0 < enc_best) enc_best = t1 - t0;
+                if (t2 - t1 < dec_best) dec_best = t2 - t1;
+            }
+
+            char label[24];
+            if (keys[j] == 0) snprintf(label, sizeof(label), "v2");
+            else snprintf(label, sizeof(label), "delta/%u", keys[j]);
+
+            double per = (double)bytes / n;
+            printf("%-7s %-9s %10.2f %10.0f %+8.1f%% %+8.1f%% %9.1f %9.1f\n",
+                   traces[k].name, label, per, per * rate,
+                   100.0 * (per - FRAME_SIZE) / FRAME_SIZE,
+                   100.0 * (per - FRAME_V2_SIZE) / FRAME_V2_SIZE,
+                   enc_best * 1e9 / n, dec_best * 1e9 / n);
+        }
+        printf("\n");
+    }
+
+    printf("dec ns includes comparing every decoded frame with its input.\n");
+    free(t);
+    free(buf);
+    return bad;
+}
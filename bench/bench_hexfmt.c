@@ -0,0 +1,147 @@
+/*
+ * bench_hexfmt.c - Hex dump lines: printf per byte vs. hexfmt
+ *
+ * Compile: gcc -O2 -march=native -o bench_hexfmt bench/bench_hexfmt.c common/hexfmt.c
+ * Usage:   ./bench_hexfmt [MB per size]
+ *
+ * Prints "[HEX] 4A 6F ... \n" lines the way the servers do in -x mode,
+ * into a stdio stream on /dev/null, for several line lengths:
+ *   printf     the old print_hex(): one printf("%02X ") per byte
+ *   scalar     hexfmt_scalar() (table only) into a buffer + one fwrite
+ *   hexfmt     hexfmt_line() (AVX2/SSSE3 when compiled in) + one fwrite
+ * plus hexfmt() alone, without any I/O. All outputs are compared with
+ * the printf text first; exits non-zero on any mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "../common/hexfmt.h"
+
+#define ROUNDS 5
+#define MAX_LEN 2048
+
+static const size_t sizes[] = { 29, 64, 256, MAX_LEN };   // 29: one v2 telemetry frame
+
+static char out[HEXFMT_LINE_SIZE(MAX_LEN)];
+static volatile size_t sink;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void line_printf(FILE *f, const uint8_t *data, size_t len) {
+    fprintf(f, "[HEX] ");
+    for (size_t i = 0; i < len; i++) {
+        fprintf(f, "%02X ", data[i]);
+    }
+    fprintf(f, "\n");
+}
+
+static void line_scalar(FILE *f, const uint8_t *data, size_t len) {
+    size_t n = sizeof(HEXFMT_TAG) - 1;
+    memcpy(out, HEXFMT_TAG, n);
+    n += hexfmt_scalar(out + n, data, len);
+    out[n++] = '\n';
+    fwrite(out, 1, n, f);
+}
+
+static void line_hexfmt(FILE *f, const uint8_t *data, size_t len) {
+    fwrite(out, 1, hexfmt_line(out, data, len), f);
+}
+
+static void line_noio(FILE *f, const uint8_t *data, size_t len) {
+    (void)f;
+    sink += hexfmt(out, data, len);
+}
+
+/* Best ns per line over ROUNDS runs of lines lines */
+static double run(void (*fn)(FILE *, const uint8_t *, size_t), FILE *f,
+                  const uint8_t *data, size_t len, size_t lines) {
+    double best = 1e9;
+    for (int r = 0; r < ROUNDS; r++) {
+        double t0 = now_sec();
+        for (size_t i = 0; i < lines; i++) fn(f, data + (i & 63), len);
+        fflush(f);
+        double t = now_sec() - t0;
+        if (t < best) best = t;
+    }
+    return best / lines * 1e9;
+}
+
+/* Output of fn captured through a memory stream */
+static int check(void (*fn)(FILE *, const uint8_t *, size_t), const char *name,
+                 const uint8_t *data, size_t len, const char *want, size_t want_len) {
+    char *got = NULL;
+    size_t got_len = 0;
+    FILE *m = open_memstream(&got, &got_len);
+    if (!m) {
+        perror("open_memstream");
+        return 1;
+    }
+    fn(m, data, len);
+    fclose(m);
+    int bad = got_len != want_len || memcmp(got, want, want_len) != 0;
+    if (bad) fprintf(stderr, "[FAIL] %s differs at %zu bytes\n", name, len);
+    free(got);
+    return bad;
+}
+
+int main(int argc, char **argv) {
+    double mb = (argc > 1) ? atof(argv[1]) : 4.0;
+    uint8_t data[MAX_LEN + 64];
+    FILE *null = fopen("/dev/null", "w");
+    int bad = 0;
+
+    if (!null) {
+        perror("/dev/null");
+        return 1;
+    }
+    srand(1);
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)rand();
+
+    printf("hexfmt path: %s, %.1f MB of input per size (best of %d)\n",
+           hexfmt_impl(), mb, ROUNDS);
+    printf("%6s  %12s  %12s  %12s  %12s  %8s\n",
+           "bytes", "printf ns", "scalar ns", "hexfmt ns", "no-I/O ns", "speedup");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t len = sizes[s];
+        size_t lines = (size_t)(mb * 1e6 / len) + 1;
+
+        // Reference text from the old code
+        char *want = NULL;
+        size_t want_len = 0;
+        FILE *m = open_memstream(&want, &want_len);
+        if (!m) {
+            perror("open_memstream");
+            return 1;
+        }
+        for (size_t off = 0; off < 64; off += 7) line_printf(m, data + off, len);
+        fclose(m);
+        for (size_t off = 0, pos = 0; off < 64; off += 7) {
+            size_t one = HEXFMT_LINE_SIZE(len);
+            bad |= check(line_scalar, "scalar", data + off, len, want + pos, one);
+            bad |= check(line_hexfmt, "hexfmt", data + off, len, want + pos, one);
+            pos += one;
+        }
+        free(want);
+
+        double t_printf = run(line_printf, null, data, len, lines);
+        double t_scalar = run(line_scalar, null, data, len, lines);
+        double t_hexfmt = run(line_hexfmt, null, data, len, lines);
+        double t_noio = run(line_noio, null, data, len, lines);
+
+        printf("%6zu  %12.1f  %12.1f  %12.1f  %12.1f  %7.1fx\n",
+               len, t_printf, t_scalar, t_hexfmt, t_noio, t_printf / t_hexfmt);
+    }
+
+    printf("equivalence: %s\n", bad ? "MISMATCH" : "identical");
+    fclose(null);
+    return bad;
+}
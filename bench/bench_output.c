@@ -0,0 +1,211 @@
+/*
+ * bench_output.c - Frames/s of the server's per-frame output, stdout to a file
+ *
+ * Compile: gcc -O2 -o bench_output bench/bench_output.c common/telem_out.c common/vehicle_store.c -pthread
+ * Usage:   ./bench_output [frames] > /tmp/telem.out
+ *
+ * Writes the same decoded frames to stdout the way rfcomm_server_v2 does:
+ *   box      the old output: [FRAME] line, 16-printf box, [LINK] line
+ *   line     --format text: [FRAME] line with the values, [LINK] line
+ *   ndjson   --format ndjson, one write per 64-frame loop turn
+ *   csv      --format csv, likewise
+ *   bin      --format bin, likewise
+ * Results go to stderr. stdout must not be a terminal; the point is what
+ * the server costs when the terminal is not the bottleneck.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../common/telem_out.h"
+#include "../common/vehicle_store.h"
+
+#define ROUNDS 3
+#define TURN_FRAMES 64              // frames decoded per server loop turn
+
+static const char *const state_str[] = {"", "N", "D", "P"};
+static const char *const mode_str[] = {"", "ECON", "COMF", "SPORT"};
+static const char *const signal_str[] = {"none", "right", "left", "hazard"};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_timestamp(void) {
+    time_t now = time(NULL);
+    struct tm *tm_info = localtime(&now);
+    char buf[32];
+    strftime(buf, sizeof(buf), "%H:%M:%S", tm_info);
+    printf("[%s] ", buf);
+}
+
+static void print_link(const frame_meta_t *m) {
+    printf("[LINK] v2 seq %u  latency %.3f ms  lost %lu/%lu (%.2f%%)  reordered %lu\n",
+           m->seq, 0.412, 0ul, (unsigned long)m->seq + 1, 0.0, 0ul);
+}
+
+/* rfcomm_server_v2's print_telemetry() before --format */
+static void print_telemetry(const telemetry_t *telem) {
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║                 TELEMETRY DATA RECEIVED                  ║\n");
+    printf("╠══════════════════════════════════════════════════════════╣\n");
+    printf("║ Speed:          %d RPM                                   ║\n",
+           telem->speed * 46);
+    printf("║ Throttle:       %3d                                      ║\n",
+           telem->throttle);
+    printf("║ Odometer:       %.1f km                                 ║\n",
+           telem->total_miles * 1.60934);
+    printf("║ Battery:        %3d%%                                    ║\n",
+           telem->battery);
+    printf("║ Engine Temp:    %d°C                                     ║\n",
+           (int)telem->engine_temp - 20);
+    printf("║ Battery Temp:   %3d                                      ║\n",
+           telem->battery_temp);
+    printf("║ State:          %s                                       ║\n",
+           state_str[telem->state]);
+    printf("║ Mode:           %-5s                                    ║\n",
+           mode_str[telem->mode]);
+    printf("║ Turn Signal:    %-6s                                   ║\n",
+           signal_str[telem->turn_signal]);
+    printf("║ Night Mode:     %s                                       ║\n",
+           telem->night_mode ? "ON " : "OFF");
+    printf("║ High Beam:      %s                                       ║\n",
+           telem->beam ? "ON " : "OFF");
+    printf("║ Horn:           %s                                       ║\n",
+           telem->horn ? "ON " : "OFF");
+    printf("║ Alert:          %d                                        ║\n",
+           telem->alert);
+    printf("║ Maps Switch:    %s                                       ║\n",
+           telem->maps ? "ON " : "OFF");
+    printf("╚══════════════════════════════════════════════════════════╝\n\n");
+}
+
+/* rfcomm_server_v2's print_frame() */
+static void print_frame(const char *peer, const telemetry_t *t, const frame_meta_t *m) {
+    printf("[FRAME] from %s%s: %d RPM, throttle %d, %.1f km, battery %d%%, engine %d°C, "
+           "battery temp %d, %s %s, turn %s, night %s, beam %s, horn %s, alert %d, maps %s\n",
+           peer, m->type == FRAME_TYPE_DELTA ? " (delta)" : "",
+           t->speed * 46, t->throttle, t->total_miles * 1.60934, t->battery,
+           (int)t->engine_temp - 20, t->battery_temp, state_str[t->state], mode_str[t->mode],
+           signal_str[t->turn_signal], t->night_mode ? "ON" : "OFF", t->beam ? "ON" : "OFF",
+           t->horn ? "ON" : "OFF", t->alert, t->maps ? "ON" : "OFF");
+}
+
+typedef struct {
+    telemetry_t *telem;
+    frame_meta_t *meta;
+    size_t n;
+    uint64_t key;
+    const char *peer;
+} frames_t;
+
+static void run_box(const frames_t *f) {
+    for (size_t i = 0; i < f->n; i++) {
+        print_timestamp();
+        printf("[FRAME] from %s\n", f->peer);
+        print_telemetry(&f->telem[i]);
+        print_link(&f->meta[i]);
+    }
+    fflush(stdout);
+}
+
+static void run_line(const frames_t *f) {
+    for (size_t i = 0; i < f->n; i++) {
+        print_timestamp();
+        print_frame(f->peer, &f->telem[i], &f->meta[i]);
+        print_link(&f->meta[i]);
+    }
+    fflush(stdout);
+}
+
+static void run_records(const frames_t *f, telem_out_fmt_t fmt) {
+    telem_out_t o;
+    if (telem_out_init(&o, STDOUT_FILENO, fmt, 0) < 0) {
+        perror("telem_out_init");
+        exit(1);
+    }
+    for (size_t i = 0; i < f->n; i++) {
+        telem_out_frame(&o, f->key, 1700000000000000ull + i * 1000, &f->telem[i], &f->meta[i]);
+        if ((i + 1) % TURN_FRAMES == 0) telem_out_flush(&o);
+    }
+    telem_out_close(&o);
+}
+
+static long long out_size(void) {
+    struct stat st;
+    return fstat(STDOUT_FILENO, &st) == 0 ? (long long)st.st_size : 0;
+}
+
+int main(int argc, char **argv) {
+    size_t n = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200000;
+    frames_t f;
+    const char *names[] = { "box", "line", "ndjson", "csv", "bin" };
+
+    if (isatty(STDOUT_FILENO)) {
+        fprintf(stderr, "Redirect stdout to a file: %s [frames] > /tmp/telem.out\n", argv[0]);
+        return 1;
+    }
+
+    f.telem = malloc(n * sizeof(*f.telem));
+    f.meta = malloc(n * sizeof(*f.meta));
+    if (!f.telem || !f.meta) {
+        perror("malloc");
+        return 1;
+    }
+    f.n = n;
+    f.peer = "AA:BB:CC:DD:EE:FF";
+    f.key = vehicle_key(f.peer);
+
+    srand(1);
+    for (size_t i = 0; i < n; i++) {
+        uint8_t payload[FRAME_PAYLOAD];
+        for (int j = 0; j < FRAME_PAYLOAD; j++) payload[j] = (uint8_t)rand();
+        telemetry_unpack(payload, &f.telem[i]);
+        memset(&f.meta[i], 0, sizeof(f.meta[i]));
+        f.meta[i].version = FRAME_V2;
+        f.meta[i].type = FRAME_TYPE_TELEMETRY;
+        f.meta[i].seq = (uint32_t)i;
+        f.meta[i].ts_us = 1700000000000000ull + i * 1000;
+    }
+
+    fprintf(stderr, "%zu frames per round, stdout to a file (best of %d)\n", n, ROUNDS);
+    fprintf(stderr, "%-8s %12s %10s %12s %8s\n", "output", "frames/s", "ns/frame", "bytes/frame",
+            "speedup");
+
+    double base = 0;
+    for (int m = 0; m < 5; m++) {
+        double best = 1e9;
+        long long bytes = 0;
+        for (int r = 0; r < ROUNDS; r++) {
+            if (ftruncate(STDOUT_FILENO, 0) < 0 || lseek(STDOUT_FILENO, 0, SEEK_SET) < 0) {
+                perror("stdout must be a regular file");
+                return 1;
+            }
+            double t0 = now_sec();
+            switch (m) {
+            case 0: run_box(&f); break;
+            case 1: run_line(&f); break;
+            case 2: run_records(&f, TELEM_OUT_NDJSON); break;
+            case 3: run_records(&f, TELEM_OUT_CSV); break;
+            case 4: run_records(&f, TELEM_OUT_BIN); break;
+            }
+            double t = now_sec() - t0;
+            if (t < best) best = t;
+            bytes = out_size();
+        }
+        if (m == 0) base = best;
+        fprintf(stderr, "%-8s %12.0f %10.1f %12.1f %7.1fx\n", names[m], n / best,
+                best / n * 1e9, (double)bytes / n, base / best);
+    }
+
+    free(f.telem);
+    free(f.meta);
+    return 0;
+}
@@ -0,0 +1,274 @@
+/*
+ * bench_recorder.c - Sustained recording rate, time lookups and crash recovery
+ *
+ * Compile: gcc -O2 -pthread -o bench_recorder bench/bench_recorder.c common/recorder.c \
+ *          common/crc32c.c common/lat_hist.c
+ * Usage:   ./bench_recorder [frames] [segment-MiB] [dir]
+ *
+ * sustained  the receive side queues v2 frames from 16 vehicles as fast as
+ *            it can (yielding while the queue is full) until the flusher
+ *            has written them all, msync()ing every second; reports
+ *            frames/s and MB/s to disk and what recorder_put() cost
+ * lookup     random time lookups over the recording: rec_seg_seek() against
+ *            a scan from the start of the segment, checked to agree
+ * crash      a child records into 1 MiB segments and is SIGKILLed at a
+ *            different moment each round; a torn record is then written
+ *            after the last valid one. Reopening must repair the segments
+ *            and leave frames 0..n-1 exactly, in order, none missing.
+ *            Exits 1 if any round fails.
+ *
+ * dir defaults to a fresh directory under /tmp, removed afterwards; a
+ * given dir keeps the recording (e.g. for replay).
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../common/lat_hist.h"
+#include "../common/recorder.h"
+
+#define VEHICLES 16
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static size_t make_frame(uint32_t seq, uint8_t out[FRAME_MAX_SIZE]) {
+    telemetry_t t;
+    memset(&t, 0, sizeof(t));
+    t.speed = (uint8_t)seq;
+    t.battery = (uint8_t)(seq % 101);
+    t.total_miles = (uint16_t)(seq / 3);
+    return telemetry_encode_frame_v2(&t, seq, 1700000000000000ull + seq, out);
+}
+
+/* Frame i is received at base + 10 µs * i */
+static void put_all(recorder_t *rec, size_t frames, uint64_t base, lat_hist_t *put_ns,
+                    unsigned long *full) {
+    uint8_t f[FRAME_MAX_SIZE];
+    for (size_t i = 0; i < frames; i++) {
+        size_t n = make_frame((uint32_t)i, f);
+        for (;;) {
+            uint64_t t0 = now_ns();
+            int ret = recorder_put(rec, i % VEHICLES + 1, base + 10 * i, f, n);
+            if (put_ns) lat_hist_add(put_ns, now_ns() - t0);
+            if (ret == 0) break;
+            (*full)++;
+            sched_yield();
+        }
+    }
+}
+
+static void rm_dir(const char *dir) {
+    char **paths;
+    int n = rec_list(dir, &paths);
+    for (int i = 0; i < n; i++) unlink(paths[i]);
+    if (n >= 0) rec_list_free(paths, n);
+    rmdir(dir);
+}
+
+static void sustained(const char *dir, size_t frames, size_t seg_bytes) {
+    recorder_t rec;
+    lat_hist_t put_ns;
+    unsigned long full = 0;
+
+    lat_hist_init(&put_ns);
+    if (recorder_open(&rec, dir, seg_bytes, 0, REC_DEFAULT_SYNC_MS) < 0) {
+        perror("recorder_open");
+        exit(1);
+    }
+    uint64_t t0 = now_ns();
+    put_all(&rec, frames, 1000000, &put_ns, &full);
+    recorder_close(&rec);
+    double s = (now_ns() - t0) / 1e9;
+
+    printf("sustained: %zu frames in %.2f s = %.0f frames/s, %.1f MB/s, %lu segment(s), %lu syncs\n",
+           frames, s, rec.written / s, rec.bytes / s / 1e6, rec.segments, rec.syncs);
+    printf("  recorder_put() ns: p50 %llu, p99 %llu, max %llu; queue full %lu time(s)\n",
+           (unsigned long long)lat_hist_quantile(&put_ns, 0.50),
+           (unsigned long long)lat_hist_quantile(&put_ns, 0.99), (unsigned long long)put_ns.max, full);
+    if (rec.error) printf("  error: %s\n", strerror(rec.error));
+}
+
+static size_t scan_seek(const rec_seg_t *s, uint64_t t_us) {
+    rec_entry_t e;
+    size_t off = rec_seg_begin(s);
+    for (;;) {
+        size_t at = off;
+        if (!rec_seg_next(s, &off, &e)) return s->data_end;
+        if (e.rx_us >= t_us) return at;
+    }
+}
+
+static void lookup(const char *dir) {
+    char **paths;
+    int n = rec_list(dir, &paths);
+    rec_seg_t s;
+    const int lookups = 20000, scans = 50;
+
+    if (n <= 0 || rec_seg_open(&s, paths[0]) < 0) {
+        perror("lookup");
+        exit(1);
+    }
+    srand(1);
+    uint64_t span = s.last_us - s.first_us + 1;
+    volatile size_t sink = 0;
+
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < lookups; i++) sink += rec_seg_seek(&s, s.first_us + (uint64_t)rand() % span);
+    double seek_ns = (double)(now_ns() - t0) / lookups;
+
+    int mismatch = 0;
+    t0 = now_ns();
+    for (int i = 0; i < scans; i++) {
+        uint64_t t = s.first_us + (uint64_t)rand() % span;
+        if (scan_seek(&s, t) != rec_seg_seek(&s, t)) mismatch++;
+    }
+    double scan_ns = (double)(now_ns() - t0) / scans;
+
+    printf("lookup: segment 1 holds %llu frames, %zu index entries\n",
+           (unsigned long long)s.records, s.index_n);
+    printf("  indexed %.0f ns, full scan %.0f ns per lookup, %d disagreement(s)\n",
+           seek_ns, scan_ns, mismatch);
+    rec_seg_close(&s);
+    rec_list_free(paths, n);
+}
+
+/* Every segment in order must hold frames 0, 1, 2, ... with rx_us matching */
+static int verify(const char *dir, unsigned long *frames, int *segs, int *unsealed) {
+    char **paths;
+    int n = rec_list(dir, &paths);
+    uint32_t next = 0;
+    int ok = n > 0;
+
+    *unsealed = 0;
+    for (int i = 0; ok && i < n; i++) {
+        rec_seg_t s;
+        rec_entry_t e;
+        if (rec_seg_open(&s, paths[i]) < 0) {
+            ok = 0;
+            break;
+        }
+        if (!s.sealed) (*unsealed)++;
+        size_t off = rec_seg_begin(&s), last = off;
+        for (size_t at = off; rec_seg_next(&s, &off, &e); at = off) {
+            telemetry_t t;
+            frame_meta_t m;
+            if (telemetry_decode_any(e.frame, e.len, &t, &m) != 0 || m.seq != next ||
+                e.rx_us != 1000000 + 10 * (uint64_t)next || e.key != next % VEHICLES + 1) {
+                ok = 0;
+                break;
+            }
+            last = at;
+            next++;
+        }
+        // And the index finds the last record
+        if (ok && s.records > 0 && rec_seg_seek(&s, s.last_us) != last) ok = 0;
+        rec_seg_close(&s);
+    }
+    *frames = next;
+    *segs = n;
+    if (n >= 0) rec_list_free(paths, n);
+    return ok;
+}
+
+/* Garbage that looks like the start of a record right after the last one */
+static int tear_tail(const char *dir) {
+    char **paths;
+    int n = rec_list(dir, &paths);
+    rec_seg_t s;
+    int ret = -1;
+
+    if (n > 0 && rec_seg_open(&s, paths[n - 1]) == 0) {
+        uint8_t junk[40];
+        memset(junk, 0xA5, sizeof(junk));
+        junk[4] = 40;               // plausible length, wrong CRC
+        size_t end = s.data_end;
+        if (end + sizeof(junk) <= s.index_off) {
+            int fd = open(paths[n - 1], O_WRONLY);
+            if (fd >= 0 && pwrite(fd, junk, sizeof(junk), (off_t)end) == (ssize_t)sizeof(junk)) ret = 0;
+            if (fd >= 0) close(fd);
+        }
+        rec_seg_close(&s);
+    }
+    if (n >= 0) rec_list_free(paths, n);
+    return ret;
+}
+
+static int crash_round(const char *dir, int round, long kill_ms) {
+    recorder_t rec;
+    unsigned long before, after;
+    int segs, unsealed, segs2, unsealed2;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        unsigned long full = 0;
+        if (recorder_open(&rec, dir, REC_MIN_SEG_BYTES, 1024, 20) < 0) _exit(2);
+        put_all(&rec, 100000000, 1000000, NULL, &full);
+        _exit(0);
+    }
+    sleep_ms(kill_ms);
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+
+    int ok = verify(dir, &before, &segs, &unsealed);
+    int torn = tear_tail(dir) == 0;
+    ok = ok && verify(dir, &after, &segs2, &unsealed2) && after == before;
+
+    // Reopening for recording repairs, then a clean close adds nothing
+    if (recorder_open(&rec, dir, REC_MIN_SEG_BYTES, 0, 0) < 0) {
+        perror("recorder_open");
+        return 0;
+    }
+    recorder_close(&rec);
+    ok = ok && verify(dir, &after, &segs2, &unsealed2) && after == before && unsealed2 == 0;
+
+    printf("  round %d: killed after %4ld ms, %8lu frames in %3d segment(s), %d unsealed, "
+           "torn tail %s, repaired %lu -> %s\n",
+           round, kill_ms, before, segs, unsealed, torn ? "added" : "skipped", rec.repaired,
+           ok ? "ok" : "FAIL");
+    rm_dir(dir);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    size_t frames = (argc > 1) ? strtoul(argv[1], NULL, 10) : 2000000;
+    size_t seg_mb = (argc > 2) ? strtoul(argv[2], NULL, 10) : 64;
+    char tmp[] = "/tmp/bench_rec.XXXXXX";
+    const char *dir = (argc > 3) ? argv[3] : mkdtemp(tmp);
+    char crash_dir[REC_PATH_LEN];
+
+    if (!dir) {
+        perror("mkdtemp");
+        return 1;
+    }
+    printf("recording to %s, %zu MiB segments\n", dir, seg_mb);
+    sustained(dir, frames, seg_mb << 20);
+    lookup(dir);
+
+    snprintf(crash_dir, sizeof(crash_dir), "%s/crash", dir);
+    printf("crash: 1 MiB segments, msync every 20 ms, SIGKILL mid-recording\n");
+    int failed = 0;
+    for (int r = 0; r < 6; r++) failed += !crash_round(crash_dir, r + 1, 50 + 97 * r);
+
+    if (argc <= 3) rm_dir(dir);
+    printf("crash: %s\n", failed ? "FAILED" : "all rounds recovered every written frame in order");
+    return failed ? 1 : 0;
+}
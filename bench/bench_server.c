@@ -0,0 +1,189 @@
+/*
+ * bench_server.c - Frames/s of the epoll server loop vs. client count
+ *
+ * Compile: gcc -O2 -pthread -o bench_server bench/bench_server.c common/telem_server.c common/frame_reasm.c \
+ *          common/crc32c.c common/transport.c -lbluetooth
+ * Usage:   ./bench_server [seconds-per-round]
+ *
+ * Runs telem_server_poll() on a Unix-domain listening socket (no radio
+ * needed) and connects 1..512 clients to it. A few sender threads blast
+ * pre-built 64-frame bursts round-robin over their share of the clients.
+ * Reports decoded frames/s and Jain's fairness index over per-client
+ * frame counts (1.0 = every client got the same share).
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "../common/telem_server.h"
+#include "../common/telemetry_codec.h"
+
+#define BURST_FRAMES  64
+#define MAX_SENDERS   4
+
+static atomic_ulong g_frames;
+static atomic_int g_server_run = 1;
+static atomic_int g_send_run;
+
+static double *g_per_conn;          // frames per finished connection
+static atomic_size_t g_done_conns;
+
+typedef struct {
+    int *fds;
+    size_t nfds;
+} sender_t;
+
+static uint8_t g_burst[BURST_FRAMES * FRAME_SIZE];
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void on_frame(void *ctx, telem_conn_t *c, const uint8_t *frame, size_t len) {
+    (void)ctx; (void)c; (void)frame; (void)len;
+    atomic_fetch_add_explicit(&g_frames, 1, memory_order_relaxed);
+}
+
+static void on_disconnect(void *ctx, telem_conn_t *c) {
+    (void)ctx;
+    size_t i = atomic_fetch_add(&g_done_conns, 1);
+    g_per_conn[i] = (double)c->reasm.frames;
+}
+
+static void *server_thread(void *arg) {
+    telem_server_t *srv = (telem_server_t *)arg;
+    while (atomic_load(&g_server_run)) {
+        telem_server_poll(srv, 20);
+    }
+    return NULL;
+}
+
+static void *sender_thread(void *arg) {
+    sender_t *sd = (sender_t *)arg;
+    size_t *off = calloc(sd->nfds, sizeof(*off));   // partial-burst progress
+
+    while (atomic_load_explicit(&g_send_run, memory_order_relaxed)) {
+        for (size_t i = 0; i < sd->nfds; i++) {
+            ssize_t w = send(sd->fds[i], g_burst + off[i], sizeof(g_burst) - off[i],
+                             MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (w > 0) off[i] = (off[i] + (size_t)w) % sizeof(g_burst);
+        }
+    }
+
+    free(off);
+    return NULL;
+}
+
+static void run_round(const char *path, size_t nclients, double secs) {
+    int *fds = calloc(nclients, sizeof(*fds));
+    sender_t senders[MAX_SENDERS];
+    pthread_t tids[MAX_SENDERS];
+    size_t nsend = nclients < MAX_SENDERS ? nclients : MAX_SENDERS;
+
+    struct sockaddr_un sa = { .sun_family = AF_UNIX };
+    snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", path);
+
+    for (size_t i = 0; i < nclients; i++) {
+        fds[i] = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fds[i], (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+            perror("connect");
+            exit(1);
+        }
+    }
+
+    atomic_store(&g_done_conns, 0);
+    atomic_store(&g_frames, 0);
+    atomic_store(&g_send_run, 1);
+
+    for (size_t t = 0; t < nsend; t++) {
+        size_t lo = nclients * t / nsend, hi = nclients * (t + 1) / nsend;
+        senders[t].fds = fds + lo;
+        senders[t].nfds = hi - lo;
+        pthread_create(&tids[t], NULL, sender_thread, &senders[t]);
+    }
+
+    double t0 = now_sec();
+    unsigned long f0 = atomic_load(&g_frames);
+    usleep((useconds_t)(secs * 1e6));
+    unsigned long f1 = atomic_load(&g_frames);
+    double dt = now_sec() - t0;
+
+    atomic_store(&g_send_run, 0);
+    for (size_t t = 0; t < nsend; t++) pthread_join(tids[t], NULL);
+    for (size_t i = 0; i < nclients; i++) close(fds[i]);
+    while (atomic_load(&g_done_conns) < nclients) usleep(1000);
+
+    // Jain's fairness index: (sum x)^2 / (n * sum x^2)
+    double sum = 0, sq = 0;
+    for (size_t i = 0; i < nclients; i++) {
+        sum += g_per_conn[i];
+        sq += g_per_conn[i] * g_per_conn[i];
+    }
+    double jain = sq > 0 ? (sum * sum) / (nclients * sq) : 0;
+
+    printf("%7zu clients  %10.0f frames/s  %7.1f MB/s  fairness %.3f\n",
+           nclients, (f1 - f0) / dt, (f1 - f0) * (double)FRAME_SIZE / dt / 1e6, jain);
+    free(fds);
+}
+
+int main(int argc, char **argv) {
+    double secs = (argc > 1) ? atof(argv[1]) : 1.0;
+    static const size_t rounds[] = { 1, 8, 64, 256, 512 };
+    char path[108];
+    telem_server_t srv;
+    telem_server_ops_t ops = { .on_frame = on_frame, .on_disconnect = on_disconnect };
+    pthread_t tid;
+
+    telemetry_t t;
+    memset(&t, 0, sizeof(t));
+    for (int i = 0; i < BURST_FRAMES; i++) {
+        t.speed = (uint8_t)i;
+        telemetry_encode_frame(&t, g_burst + i * FRAME_SIZE);
+    }
+
+    snprintf(path, sizeof(path), "/tmp/bench_server.%d.sock", (int)getpid());
+    unlink(path);
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un sa = { .sun_family = AF_UNIX };
+    snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", path);
+    if (bind(lfd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(lfd, SOMAXCONN) < 0) {
+        perror("bind/listen");
+        return 1;
+    }
+
+    if (telem_server_init(&srv, lfd, &ops, NULL) < 0) {
+        perror("telem_server_init");
+        return 1;
+    }
+    g_per_conn = calloc(rounds[sizeof(rounds) / sizeof(rounds[0]) - 1], sizeof(double));
+
+    pthread_create(&tid, NULL, server_thread, &srv);
+
+    printf("budget %zu bytes/turn, %.1f s per round\n", srv.budget, secs);
+    for (size_t i = 0; i < sizeof(rounds) / sizeof(rounds[0]); i++) {
+        run_round(path, rounds[i], secs);
+    }
+
+    atomic_store(&g_server_run, 0);
+    pthread_join(tid, NULL);
+    printf("budget yields: %lu\n", srv.budget_yields);
+
+    telem_server_close(&srv);
+    close(lfd);
+    unlink(path);
+    free(g_per_conn);
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * bench_shm_ring.c - Publish-to-consume latency of the shared-memory ring
+ *
+ * Compile: gcc -O2 -pthread -o bench_shm_ring bench/bench_shm_ring.c common/shm_ring.c \
+ *          common/lat_hist.c
+ * Usage:   ./bench_shm_ring [records] [period-us]
+ *
+ * A writer thread publishes decoded records at a fixed period. A reader
+ * thread attaches the way the GUI does (memfd over a socketpair, mapped
+ * read-only) and measures, for every record, the time from publish to the
+ * moment it was consumed:
+ *
+ *   spin      busy-polls the ring (sched_yield between empty polls)
+ *   1ms       polls every millisecond
+ *   16ms      polls every 16 ms, like the GUI's refresh timer
+ *   16ms/32   the same with a 32-slot ring, to show lapped readers
+ *   socket    baseline: each record written to a Unix socket, blocking read
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../common/lat_hist.h"
+#include "../common/shm_ring.h"
+
+typedef struct {
+    const char *name;
+    size_t slots;
+    long poll_us;                   // 0 = spin, -1 = socket baseline
+} bench_mode_t;
+
+typedef struct {
+    shm_ring_t ring;                // reader's read-only mapping
+    int sock;                       // socket baseline
+    long poll_us;
+    size_t records;
+    lat_hist_t lat;
+    unsigned long lost;
+    atomic_int done;
+} reader_t;
+
+static void sleep_us(long us) {
+    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+static void *reader(void *arg) {
+    reader_t *rd = (reader_t *)arg;
+    shm_ring_rec_t rec;
+
+    if (rd->poll_us < 0) {
+        for (size_t n = 0; n < rd->records; n++) {
+            if (read(rd->sock, &rec, sizeof(rec)) != (ssize_t)sizeof(rec)) break;
+            lat_hist_add(&rd->lat, shm_ring_now_ns() - rec.pub_ns);
+        }
+        return NULL;
+    }
+
+    shm_ring_reader_t r;
+    shm_ring_reader_init(&r, &rd->ring);
+    for (;;) {
+        int got = 0;
+        while (shm_ring_next(&r, &rec) > 0) {
+            lat_hist_add(&rd->lat, shm_ring_now_ns() - rec.pub_ns);
+            got = 1;
+        }
+        if (!got && atomic_load(&rd->done)) break;
+        if (rd->poll_us > 0) sleep_us(rd->poll_us);
+        else if (!got) sched_yield();
+    }
+    rd->lost = r.lost;
+    return NULL;
+}
+
+static void run_mode(const bench_mode_t *m, size_t records, long period_us) {
+    shm_ring_t ring;
+    reader_t rd;
+    int sv[2];
+    pthread_t tid;
+
+    memset(&rd, 0, sizeof(rd));
+    lat_hist_init(&rd.lat);
+    rd.poll_us = m->poll_us;
+    rd.records = records;
+
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = -1;
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0 ||
+        (m->poll_us >= 0 && shm_ring_create(&ring, m->slots) < 0)) {
+        perror("setup");
+        exit(1);
+    }
+    if (m->poll_us >= 0) {
+        // Attach through SCM_RIGHTS, as a separate process would
+        int fd;
+        if (shm_ring_send_fd(sv[0], ring.fd) < 0 || (fd = shm_ring_recv_fd(sv[1])) < 0 ||
+            shm_ring_attach(&rd.ring, fd) < 0) {
+            perror("attach");
+            exit(1);
+        }
+    }
+    rd.sock = sv[1];
+    pthread_create(&tid, NULL, reader, &rd);
+    sleep_us(10000);                // reader positioned before the first record
+
+    shm_ring_rec_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.version = FRAME_V2;
+    rec.type = FRAME_TYPE_TELEMETRY;
+    for (size_t i = 0; i < records; i++) {
+        rec.seq = (uint32_t)i;
+        rec.telem.speed = (uint8_t)i;
+        if (m->poll_us < 0) {
+            rec.pub_ns = shm_ring_now_ns();
+            if (write(sv[0], &rec, sizeof(rec)) != (ssize_t)sizeof(rec)) {
+                perror("write");
+                exit(1);
+            }
+        } else {
+            shm_ring_publish(&ring, &rec);
+        }
+        sleep_us(period_us);
+    }
+    atomic_store(&rd.done, 1);
+    pthread_join(tid, NULL);
+
+    printf("%-9s %7zu %10llu %10.1f %10.1f %10.1f %10.1f %8lu\n",
+           m->name, m->slots, (unsigned long long)rd.lat.samples,
+           lat_hist_quantile(&rd.lat, 0.50) / 1e3, lat_hist_quantile(&rd.lat, 0.90) / 1e3,
+           lat_hist_quantile(&rd.lat, 0.99) / 1e3, rd.lat.max / 1e3, rd.lost);
+
+    if (m->poll_us >= 0) shm_ring_close(&rd.ring);
+    shm_ring_close(&ring);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+int main(int argc, char **argv) {
+    size_t records = (argc > 1) ? strtoul(argv[1], NULL, 10) : 5000;
+    long period_us = (argc > 2) ? atol(argv[2]) : 200;
+    static const bench_mode_t modes[] = {
+        { "spin",     SHM_RING_DEFAULT_SLOTS, 0 },
+        { "1ms",      SHM_RING_DEFAULT_SLOTS, 1000 },
+        { "16ms",     SHM_RING_DEFAULT_SLOTS, 16000 },
+        { "16ms/32",  32,                     16000 },
+        { "socket",   0,                      -1 },
+    };
+
+    printf("%zu records every %ld us; publish -> consume latency in us\n", records, period_us);
+    printf("%-9s %7s %10s %10s %10s %10s %10s %8s\n",
+           "reader", "slots", "records", "p50", "p90", "p99", "max", "lost");
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        run_mode(&modes[i], records, period_us);
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * bench_vehicle_store.c - Per-vehicle store: writer rate under concurrent readers
+ *
+ * Compile: gcc -O2 -pthread -o bench_vehicle_store bench/bench_vehicle_store.c common/vehicle_store.c
+ * Usage:   ./bench_vehicle_store [seconds-per-round] [vehicles]
+ *
+ * Fills the store with 10k vehicles, then one writer thread (the receive
+ * loop's role) applies frames to random vehicles as fast as it can while
+ * 0..8 reader threads look up random vehicles. Every round runs twice:
+ * once with the store's lock-free reads, once with the same calls behind
+ * a pthread rwlock (writer exclusive, readers shared), which is what the
+ * store would need without its sequence counters.
+ *
+ * Readers check every snapshot: the writer stores the frame count in the
+ * odometer and the sequence number, so a torn copy shows up as a mismatch.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "../common/vehicle_store.h"
+
+#define MAX_READERS 8
+
+typedef struct {
+    vehicle_store_t vs;
+    uint64_t *keys;
+    long *slots;
+    uint32_t *frames;               // writer's own count per vehicle
+    size_t n;
+    int locked;                     // 1 = rwlock around every call
+    pthread_rwlock_t lock;
+    atomic_int running;
+} bench_t;
+
+typedef struct {
+    bench_t *b;
+    pthread_t tid;
+    unsigned seed;
+    unsigned long ops;
+    unsigned long torn;
+} worker_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t xorshift(unsigned *s) {
+    unsigned x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+static void *writer(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    bench_t *b = w->b;
+    telemetry_t t;
+    frame_meta_t meta = { .version = FRAME_V2, .type = FRAME_TYPE_TELEMETRY };
+    uint64_t now_us = 1;
+
+    memset(&t, 0, sizeof(t));
+    while (atomic_load_explicit(&b->running, memory_order_relaxed)) {
+        size_t v = xorshift(&w->seed) % b->n;
+        uint32_t f = ++b->frames[v];
+
+        t.speed = (uint8_t)w->ops;
+        t.total_miles = (uint16_t)f;
+        meta.seq = f;
+        meta.ts_us = now_us++;
+
+        if (b->locked) pthread_rwlock_wrlock(&b->lock);
+        vehicle_store_frame(&b->vs, b->slots[v], &t, &meta, now_us);
+        if (b->locked) pthread_rwlock_unlock(&b->lock);
+        w->ops++;
+    }
+    return NULL;
+}
+
+static void *reader(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    bench_t *b = w->b;
+    vehicle_state_t st;
+
+    while (atomic_load_explicit(&b->running, memory_order_relaxed)) {
+        uint64_t key = b->keys[xorshift(&w->seed) % b->n];
+
+        if (b->locked) pthread_rwlock_rdlock(&b->lock);
+        int ret = vehicle_store_get(&b->vs, key, &st);
+        if (b->locked) pthread_rwlock_unlock(&b->lock);
+
+        if (ret < 0 || st.key != key || st.last_seq != (uint32_t)st.frames ||
+            st.telem.total_miles != (uint16_t)st.frames) {
+            w->torn++;
+        }
+        w->ops++;
+    }
+    return NULL;
+}
+
+static void run_round(bench_t *b, int locked, int nreaders, double secs) {
+    worker_t wr = { .b = b, .seed = 12345 };
+    worker_t rd[MAX_READERS];
+    unsigned long reads = 0, torn = 0;
+
+    b->locked = locked;
+    atomic_store(&b->running, 1);
+    for (int i = 0; i < nreaders; i++) {
+        rd[i] = (worker_t){ .b = b, .seed = 777u * (unsigned)(i + 1) };
+        pthread_create(&rd[i].tid, NULL, reader, &rd[i]);
+    }
+    pthread_create(&wr.tid, NULL, writer, &wr);
+
+    double t0 = now_sec();
+    struct timespec ts = { (time_t)secs, (long)((secs - (time_t)secs) * 1e9) };
+    nanosleep(&ts, NULL);
+    atomic_store(&b->running, 0);
+    pthread_join(wr.tid, NULL);
+    for (int i = 0; i < nreaders; i++) {
+        pthread_join(rd[i].tid, NULL);
+        reads += rd[i].ops;
+        torn += rd[i].torn;
+    }
+    double wall = now_sec() - t0;
+
+    printf("%-9s %8d %14.2f %14.2f %10lu\n", locked ? "rwlock" : "seqlock", nreaders,
+           wr.ops / wall / 1e6, reads / wall / 1e6, torn);
+}
+
+int main(int argc, char **argv) {
+    double secs = (argc > 1) ? atof(argv[1]) : 1.0;
+    size_t n = (argc > 2) ? strtoul(argv[2], NULL, 10) : 10000;
+    static const int readers[] = { 0, 1, 2, 4, 8 };
+    static bench_t b;
+    char name[VEHICLE_NAME_LEN];
+
+    if (n == 0 || vehicle_store_init(&b.vs, n) < 0) {
+        perror("vehicle_store_init");
+        return 1;
+    }
+    b.n = n;
+    b.keys = calloc(n, sizeof(*b.keys));
+    b.slots = calloc(n, sizeof(*b.slots));
+    b.frames = calloc(n, sizeof(*b.frames));
+    if (!b.keys || !b.slots || !b.frames) {
+        perror("calloc");
+        return 1;
+    }
+    pthread_rwlock_init(&b.lock, NULL);
+
+    // Bluetooth addresses from one vendor prefix, like a fleet would have
+    for (size_t i = 0; i < n; i++) {
+        snprintf(name, sizeof(name), "00:1A:7D:%02X:%02X:%02X",
+                 (unsigned)(i >> 16) & 0xFF, (unsigned)(i >> 8) & 0xFF, (unsigned)i & 0xFF);
+        b.keys[i] = vehicle_key(name);
+        b.slots[i] = vehicle_store_connect(&b.vs, b.keys[i], name, 1);
+        if (b.slots[i] < 0) {
+            perror("vehicle_store_connect");
+            return 1;
+        }
+    }
+
+    printf("%zu vehicles, %zu slots, %zu-byte records, %.1f s per round\n",
+           vehicle_store_count(&b.vs), b.vs.mask + 1, sizeof(vehicle_state_t), secs);
+    printf("%-9s %8s %14s %14s %10s\n", "mode", "readers", "writes M/s", "reads M/s", "torn");
+    for (size_t i = 0; i < sizeof(readers) / sizeof(readers[0]); i++) {
+        run_round(&b, 0, readers[i], secs);
+        run_round(&b, 1, readers[i], secs);
+    }
+
+    pthread_rwlock_destroy(&b.lock);
+    vehicle_store_free(&b.vs);
+    free(b.keys);
+    free(b.slots);
+    free(b.frames);
+    return 0;
+}
@@ -8,26 +8,77 @@
 #include <signal.h>
 #include <time.h>
 #include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include <sys/socket.h>
-#include <bluetooth/bluetooth.h>
-#include <bluetooth/rfcomm.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include <fcntl.h>
+#include <poll.h>
+
+#include "common/ctrl_msg.h"
+#include "common/frame_reasm.h"
+#include "common/telemetry_codec.h"
+#include "common/telemetry_delta.h"
+#include "common/transport.h"
+#include "common/pacer.h"
+#include "common/lat_hist.h"
+#include "common/frame_spool.h"
+#include "common/rate_ctl.h"
+#include "common/tx_batch.h"
 
-/* ------------ Simulation State (incremental numbers) ------------- */
 static volatile bool g_running = true;
+static volatile sig_atomic_t g_dump_stats = 0;     // SIGUSR1
 
-static uint16_t rpm_vtl = 0;        // simulated motor RPM
-static uint16_t voltage_vtl = 630;  // 630..830 ~ maps to 0..100%
-static uint8_t  contemp_vtl = 25;   // 0..63 (offset -20 °C -> display)
-static uint8_t  mode_vtl = 1;       // 1..3
-static uint8_t  val_state = 1;      // 1=N,2=D,3=P (for packing)
-static uint16_t miles_acc = 0;      // 0..65535 (16-bit)
-
-static uint8_t  sein_left = 0;      // 0/1
-static uint8_t  sein_right = 0;     // 0/1
-static uint8_t  beams_on = 0;       // 0/1
-static uint8_t  night_mode = 1;     // 0/1
+/* ------------ Simulation State (incremental numbers) -------------
+ * One per simulated vehicle. The single-client mode drives one of these,
+ * the load generator (--vehicles) thousands.
+ */
+typedef struct {
+    uint16_t rpm_vtl;       // simulated motor RPM
+    uint16_t voltage_vtl;   // 630..830 ~ maps to 0..100%
+    uint8_t  contemp_vtl;   // 0..63 (offset -20 °C -> display)
+    uint8_t  mode_vtl;      // 1..3
+    uint8_t  val_state;     // 1=N,2=D,3=P (for packing)
+    uint16_t miles_acc;     // 0..65535 (16-bit)
+
+    uint8_t  sein_left;     // 0/1
+    uint8_t  sein_right;    // 0/1
+    uint8_t  beams_on;      // 0/1
+    uint8_t  night_mode;    // 0/1
+
+    // Pattern counters for simulate_tick()
+    uint8_t  thr;
+    int mode_cnt, state_cnt, sein_phase, beam_cnt, night_cnt;
+
+    pacer_t pace;           // load generator: send deadlines
+} vehicle_t;
+
+/* Vehicle 0 starts where the original single simulator did; the others
+ * get scattered phases so a fleet does not move in lockstep. */
+static void vehicle_init(vehicle_t *v, uint32_t id) {
+    memset(v, 0, sizeof(*v));
+    v->voltage_vtl = 630;
+    v->contemp_vtl = 25;
+    v->mode_vtl = 1;
+    v->val_state = 1;
+    v->night_mode = 1;
+
+    if (id == 0) return;
+
+    uint32_t x = id * 2654435761u;      // Knuth multiplicative hash
+    v->rpm_vtl     = (uint16_t)((x % 240) * 50);
+    v->voltage_vtl = (uint16_t)(630 + (x >> 8) % 201);
+    v->contemp_vtl = (uint8_t)((x >> 16) % 64);
+    v->miles_acc   = (uint16_t)(x >> 5);
+    v->thr         = (uint8_t)(x >> 24);
+    v->mode_cnt    = (int)(x % 30);
+    v->state_cnt   = (int)((x >> 3) % 50);
+    v->sein_phase  = (int)((x >> 7) % 80);
+    v->beam_cnt    = (int)((x >> 11) % 40);
+    v->night_cnt   = (int)((x >> 13) % 200);
+}
 
 /* ------------ Helpers ------------- */
 static void handle_sigint(int sig) {
@@ -35,6 +86,11 @@ static void handle_sigint(int sig) {
     g_running = false;
 }
 
+static void handle_sigusr1(int sig) {
+    (void)sig;
+    g_dump_stats = 1;
+}
+
 static uint8_t clamp_u8(int v, int lo, int hi) {
     if (v < lo) v = lo;
     if (v > hi) v = hi;
@@ -42,48 +98,47 @@ static uint8_t clamp_u8(int v, int lo, int hi) {
 }
 
 /*  B0 SPEED: val_speed = rpm_vtl / 46  (0..255) */
-static uint8_t show_speed(void) {
-    return (uint8_t)(rpm_vtl / 46);
+static uint8_t show_speed(const vehicle_t *v) {
+    return (uint8_t)(v->rpm_vtl / 46);
 }
 
 /*  B1 THROTTLE: not available -> simulate 0..255 sawtooth */
-static uint8_t show_throt(void) {
-    static uint8_t thr = 0;
-    thr += 3; // wraps naturally
-    return thr;
+static uint8_t show_throt(vehicle_t *v) {
+    v->thr += 3; // wraps naturally
+    return v->thr;
 }
 
 /* B2-B3 TOTAL DISTANCE: 16-bit, scale 0.5 (spec); we just send raw 16-bit counter */
-static uint8_t show_miles_lsb(void) {
-    return (uint8_t)(miles_acc & 0xFF);
+static uint8_t show_miles_lsb(const vehicle_t *v) {
+    return (uint8_t)(v->miles_acc & 0xFF);
 }
-static uint8_t show_miles_msb(void) {
-    return (uint8_t)((miles_acc >> 8) & 0xFF);
+static uint8_t show_miles_msb(const vehicle_t *v) {
+    return (uint8_t)((v->miles_acc >> 8) & 0xFF);
 }
 
 /* B4(L) BATTERY: 0..100 computed from 630..830 -> (v-630)/2 */
-static uint8_t show_battr(void) {
-    int val = (voltage_vtl > 630) ? ((int)voltage_vtl - 630) / 2 : 0;
+static uint8_t show_battr(const vehicle_t *v) {
+    int val = (v->voltage_vtl > 630) ? ((int)v->voltage_vtl - 630) / 2 : 0;
     if (val > 100) val = 100;
     return (uint8_t)val;
 }
 
 /* B4(H) NIGHT MODE: 1 bit at bit7 */
-static uint8_t show_night(void) {
-    return night_mode ? 1 : 0;
+static uint8_t show_night(const vehicle_t *v) {
+    return v->night_mode ? 1 : 0;
 }
 
 /* B5(L) ENGINE TEMP: 6-bit (0..63). We just return contemp_vtl limited to 6 bits. */
-static uint8_t show_enginetemp(void) {
-    return (uint8_t)(contemp_vtl & 0x3F);
+static uint8_t show_enginetemp(const vehicle_t *v) {
+    return (uint8_t)(v->contemp_vtl & 0x3F);
 }
 
 /* B5(H) SEIN (turn signals): 2-bit at bit6-7 of byte5 half? In our packing we put it in the high 2 bits of B5 */
-static uint8_t show_seinx(void) {
-    if (sein_left && sein_right) return 3;  // hazard
-    if (sein_right) return 1;               // right
-    if (sein_left)  return 2;               // left
-    return 0;                               
+static uint8_t show_seinx(const vehicle_t *v) {
+    if (v->sein_left && v->sein_right) return 3;  // hazard
+    if (v->sein_right) return 1;                  // right
+    if (v->sein_left)  return 2;                  // left
+    return 0;
 }
 
 /* B6(L1) BATTERY TEMP: 6-bit (we simulate constant 0) */
@@ -97,8 +152,8 @@ static uint8_t show_horns(void) {
 }
 
 /* B6(H) BEAM: 1 bit */
-static uint8_t show_beams(void) {
-    return beams_on ? 1 : 0;
+static uint8_t show_beams(const vehicle_t *v) {
+    return v->beams_on ? 1 : 0;
 }
 
 /* B7(L1) ALERTS: 3-bit */
@@ -107,13 +162,13 @@ static uint8_t show_alert(void) {
 }
 
 /* B7(L2) STATE: 2-bit (1=N,2=D,3=P) */
-static uint8_t show_state(void) {
-    return val_state & 0x03;
+static uint8_t show_state(const vehicle_t *v) {
+    return v->val_state & 0x03;
 }
 
 /* B7(H1) MODE: 2-bit (1=ECON,2=COMF,3=SPORT) */
-static uint8_t show_modes(void) {
-    return mode_vtl & 0x03;
+static uint8_t show_modes(const vehicle_t *v) {
+    return v->mode_vtl & 0x03;
 }
 
 /* B7(H2) MAPS SWITCH: 1 bit; simulate 0 */
@@ -121,92 +176,84 @@ static uint8_t show_maps(void) {
     return 0;
 }
 
-/* ----- Pack 9-byte frame exactly like Arduino code intent ----- 
- * Byte layout (per your notes):
- * B0: speed (8)
- * B1: throttle (8)
- * B2: miles LSB (8)
- * B3: miles MSB (8)
- * B4: battery (7) | night<<7 (1)
- * B5: eng_temp (6) | sein (2)
- * B6: batt_temp (6) | horn<<6 (1) | beam<<7 (1)
- * B7: alert (3) | state<<3 (2) | mode<<5 (2) | maps<<7 (1)
- * B8: '\n'
+static uint64_t realtime_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/* ----- Build one frame exactly like Arduino code intent -----
+ * The bit layout lives in common/telemetry_codec.h (TELEM_FIELDS); here we
+ * only gather the current values. Out-of-range values are masked to their
+ * field width by telemetry_pack(). proto 1 gives the 11-byte v1 frame,
+ * proto 2 adds seq, the send timestamp and a CRC; with a delta encoder
+ * only keyframes are full frames. Returns the length.
  */
-static void build_frame(uint8_t out[11]) {
-    uint8_t speed  = show_speed();
-    uint8_t throt  = show_throt();
-    uint8_t m_lsb  = show_miles_lsb();
-    uint8_t m_msb  = show_miles_msb();
-    uint8_t battr  = show_battr();        // 0..100 (7 bits)
-    uint8_t night  = show_night() & 0x01;
-
-    uint8_t etemp  = show_enginetemp() & 0x3F;
-    uint8_t sein   = show_seinx() & 0x03;
-
-    uint8_t btemp  = show_battrtemp() & 0x3F;
-    uint8_t horn   = show_horns() & 0x01;
-    uint8_t beam   = show_beams() & 0x01;
-
-    uint8_t alert  = show_alert() & 0x07;
-    uint8_t state  = show_state() & 0x03;
-    uint8_t mode   = show_modes() & 0x03;
-    uint8_t maps   = show_maps() & 0x01;
-
-    out[0] = 0xCE; // start byte
-    out[1] = 8;    // length byte
-    out[2] = speed;
-    out[3] = throt;
-    out[4] = m_lsb;
-    out[5] = m_msb;
-    out[6] = (uint8_t)((battr & 0x7F) | (night << 7));
-    out[7] = (uint8_t)((etemp & 0x3F) | (sein  << 6));
-    out[8] = (uint8_t)((btemp & 0x3F) | (horn  << 6) | (beam << 7));
-    out[9] = (uint8_t)((alert & 0x07) | (state << 3) | (mode << 5) | (maps << 7));
-    out[10] = '\n'; // delimiter
+static size_t build_frame(vehicle_t *v, int proto, uint32_t seq, telemetry_delta_enc_t *delta,
+                          uint8_t out[FRAME_MAX_SIZE]) {
+    telemetry_t t;
+
+    t.speed        = show_speed(v);
+    t.throttle     = show_throt(v);
+    t.total_miles  = (uint16_t)(show_miles_lsb(v) | (show_miles_msb(v) << 8));
+    t.battery      = show_battr(v);       // 0..100 (7 bits)
+    t.night_mode   = show_night(v);
+    t.engine_temp  = show_enginetemp(v);
+    t.turn_signal  = show_seinx(v);
+    t.battery_temp = show_battrtemp();
+    t.horn         = show_horns();
+    t.beam         = show_beams(v);
+    t.alert        = show_alert();
+    t.state        = show_state(v);
+    t.mode         = show_modes(v);
+    t.maps         = show_maps();
+
+    if (proto == 1) {
+        telemetry_encode_frame(&t, out);
+        return FRAME_SIZE;
+    }
+    if (delta) {
+        return telemetry_delta_encode(delta, &t, seq, realtime_us(), out);
+    }
+    return telemetry_encode_frame_v2(&t, seq, realtime_us(), out);
 }
 
 /* Increment and wrap the simulated signals to look "alive" */
-static void simulate_tick(void) {
-    rpm_vtl = (rpm_vtl + 50) % 12000;                 // 0..11950
-    voltage_vtl = 630 + ((voltage_vtl - 630 + 1) % 201); // 630..830
-    contemp_vtl = (contemp_vtl + 1) % 64;             // 0..63
-    miles_acc   = (uint16_t)(miles_acc + 7);          // wraps 16-bit
+static void simulate_tick(vehicle_t *v) {
+    v->rpm_vtl = (v->rpm_vtl + 50) % 12000;                     // 0..11950
+    v->voltage_vtl = 630 + ((v->voltage_vtl - 630 + 1) % 201);  // 630..830
+    v->contemp_vtl = (v->contemp_vtl + 1) % 64;                 // 0..63
+    v->miles_acc   = (uint16_t)(v->miles_acc + 7);              // wraps 16-bit
 
     // mode cycles 1->2->3->1...
-    static int mode_cnt = 0;
-    mode_cnt = (mode_cnt + 1) % 30;
-    if (mode_cnt == 0) {
-        mode_vtl++;
-        if (mode_vtl < 1 || mode_vtl > 3) mode_vtl = 1;
+    v->mode_cnt = (v->mode_cnt + 1) % 30;
+    if (v->mode_cnt == 0) {
+        v->mode_vtl++;
+        if (v->mode_vtl < 1 || v->mode_vtl > 3) v->mode_vtl = 1;
     }
 
     // state toggles: N->D->P->N...
-    static int state_cnt = 0;
-    state_cnt = (state_cnt + 1) % 50;
-    if (state_cnt == 0) {
-        val_state++;
-        if (val_state < 1 || val_state > 3) val_state = 1;
+    v->state_cnt = (v->state_cnt + 1) % 50;
+    if (v->state_cnt == 0) {
+        v->val_state++;
+        if (v->val_state < 1 || v->val_state > 3) v->val_state = 1;
     }
 
     // sein pattern: right, none, left, hazard, none...
-    static int sein_phase = 0;
-    sein_phase = (sein_phase + 1) % 80;
-    if (sein_phase < 15) { sein_right = 1; sein_left = 0; }
-    else if (sein_phase < 30) { sein_right = sein_left = 0; }
-    else if (sein_phase < 45) { sein_right = 0; sein_left = 1; }
-    else if (sein_phase < 60) { sein_right = sein_left = 1; }
-    else { sein_right = sein_left = 0; }
+    v->sein_phase = (v->sein_phase + 1) % 80;
+    if (v->sein_phase < 15) { v->sein_right = 1; v->sein_left = 0; }
+    else if (v->sein_phase < 30) { v->sein_right = v->sein_left = 0; }
+    else if (v->sein_phase < 45) { v->sein_right = 0; v->sein_left = 1; }
+    else if (v->sein_phase < 60) { v->sein_right = v->sein_left = 1; }
+    else { v->sein_right = v->sein_left = 0; }
 
     // beams on/off slowly
-    static int beam_cnt = 0;
-    beam_cnt = (beam_cnt + 1) % 40;
-    if (beam_cnt == 0) beams_on = !beams_on;
+    v->beam_cnt = (v->beam_cnt + 1) % 40;
+    if (v->beam_cnt == 0) v->beams_on = !v->beams_on;
 
     // night toggle very slow
-    static int night_cnt = 0;
-    night_cnt = (night_cnt + 1) % 200;
-    if (night_cnt == 0) night_mode = !night_mode;
+    v->night_cnt = (v->night_cnt + 1) % 200;
+    if (v->night_cnt == 0) v->night_mode = !v->night_mode;
 }
 
 /* Sleep helper in milliseconds */
@@ -217,14 +264,6 @@ static void msleep(unsigned ms) {
     nanosleep(&ts, NULL);
 }
 
-static uint64_t epoch_ms()
-{
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    return (uint64_t)ts.tv_sec * 1000 +
-           (uint64_t)ts.tv_nsec / 1000000;
-}
-
 static int enable_sockopts(int s)
 {
     int one = 1;
@@ -235,143 +274,1204 @@ static int enable_sockopts(int s)
     return 0;
 }
 
-static int connect_blocking_with_timeout(int s, struct sockaddr_rc *addr)
+/* Jitter is how late each send started against its grid deadline. */
+static void print_pacing_stats(const char *tag, const lat_hist_t *jitter,
+                               const lat_hist_t *send_lat, unsigned long ticks,
+                               unsigned long overruns, unsigned long skipped)
 {
-    // Non-blocking
-    fcntl(s, F_SETFL, O_NONBLOCK);
+    fprintf(stderr, "[%s] %lu ticks, %lu overruns, %lu deadlines skipped\n",
+            tag, ticks, overruns, skipped);
+    lat_hist_print(jitter, "  period jitter (late by)", stderr);
+    lat_hist_print(send_lat, "  send() latency", stderr);
+}
 
-    int ret = connect(s, (struct sockaddr *)addr, sizeof(*addr));
-    if (ret == 0) {
-        return 0;
+/* ---------- OPTIONS ---------- */
+typedef struct {
+    unsigned interval_ms;
+    int proto;                      // frame version, 1 or 2
+    unsigned delta_key;             // v2 deltas, keyframe every N; 0 = off
+    pacer_policy_t catchup;
+    unsigned max_burst;
+    bool verbose;
+
+    // Batching: flush after batch_frames frames or when the oldest queued
+    // frame is batch_us old, whichever comes first. 1/0 = send every frame.
+    unsigned batch_frames;
+    unsigned batch_us;
+
+    // Store-and-forward while the link is down
+    size_t spool_frames;            // in memory
+    const char *spool_file;         // optional mmap'd overflow
+    size_t spool_file_frames;
+    unsigned replay_rate;           // stale frames/s after a reconnect
+    unsigned backoff_min_ms;
+    unsigned backoff_max_ms;
+
+    unsigned report_s;              // periodic RTT report, 0 = off
+
+    // Adaptive period within [adapt_min_ms, adapt_max_ms]; max 0 = fixed
+    unsigned adapt_min_ms;
+    unsigned adapt_max_ms;
+    unsigned target_delay_ms;
+} client_opts_t;
+
+#define CONNECT_TIMEOUT_NS 5000000000ull
+
+/* Move the frames that never reached the kernel into the spool. A record
+ * that was half sent is lost with the connection, and so are deltas: the
+ * next connection starts a new delta stream, where they would be applied
+ * to the wrong keyframe. Pings and acks only meant something to the old
+ * connection. */
+static void tx_batch_salvage(tx_batch_t *b, frame_spool_t *spool)
+{
+    for (size_t pos = b->head_skip; pos < b->len; pos += tx_record_len(b->buf + pos)) {
+        if (!tx_record_is_sample(b->buf + pos)) continue;
+        uint8_t len = b->buf[pos + 1];
+        if (len > FRAME_PAYLOAD && len < FRAME_V2_MIN_LEN && b->buf[pos + 3] == FRAME_TYPE_DELTA) {
+            b->dropped++;
+            continue;
+        }
+        frame_spool_put(spool, b->buf + pos, tx_record_len(b->buf + pos));
     }
+    b->len = 0;
+    b->head_skip = 0;
+    b->stuck = 0;
+    b->frames = 0;
+}
 
-    if (errno != EINPROGRESS) {
-        return -1;
-    }
+/* Exponential backoff with "equal jitter": half the step is fixed, half
+ * random, so a fleet that lost the server together does not come back in
+ * lockstep. */
+static uint64_t backoff_next_ns(unsigned *step_ms, const client_opts_t *o)
+{
+    static uint32_t seed;
+    if (seed == 0) seed = (uint32_t)getpid() * 2654435761u ^ (uint32_t)pacer_now_ns();
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    unsigned half = *step_ms / 2;
+    uint64_t delay_ms = half + (half ? seed % (half + 1) : 0);
 
-    fd_set wfds;
-    FD_ZERO(&wfds);
-    FD_SET(s, &wfds);
+    *step_ms = (*step_ms >= o->backoff_max_ms / 2) ? o->backoff_max_ms : *step_ms * 2;
+    return delay_ms * 1000000ull;
+}
 
-    struct timeval tv = { .tv_sec = 5, .tv_usec = 0 };
+static void print_spool_stats(const frame_spool_t *sp, unsigned long reconnects)
+{
+    fprintf(stderr, "[SPOOL] buffered %lu, replayed %lu, dropped %lu, spilled %lu, "
+            "pending %zu, reconnects %lu\n",
+            sp->buffered, sp->replayed, sp->dropped, sp->spilled,
+            frame_spool_count(sp), reconnects);
+}
 
-    ret = select(s + 1, NULL, &wfds, NULL, &tv);
-    if (ret <= 0) {
-        errno = ETIMEDOUT;
-        return -1;
+/* ---------- ECHO RTT ----------
+ * A server in echo mode (-e) sends every frame back. The echoes are read
+ * while waiting for the next deadline, reassembled, and matched by
+ * sequence number to the time the frame was queued for sending, which
+ * gives the round trip on the sender's own clock. v2 only: v1 frames have
+ * no sequence number to match on. With batching, the RTT includes the
+ * time a frame waited in the batch.
+ *
+ * The same reader takes the server's control messages: pongs to our
+ * pings, and settings (CONFIG_SET), which the send loop applies and acks.
+ */
+#define ECHO_SLOTS 256          // frames in flight that can still be matched
+#define PING_NS          3000000000ull
+#define PONG_TIMEOUT_NS 10000000000ull  // link is dead after this much silence
+
+typedef struct {
+    frame_reasm_t reasm;
+    telemetry_delta_dec_t dec;  // echoed deltas need the stream state too
+    uint32_t seq[ECHO_SLOTS];
+    uint64_t sent_ns[ECHO_SLOTS];   // 0 = nothing outstanding
+    uint64_t min_ns;            // smallest RTT since echo_rx_take_min()
+    lat_hist_t *rtt;            // for the chunk being dispatched:
+    uint64_t rx_ns;             // where echoes go, and when it arrived
+
+    unsigned long echoed;
+    unsigned long unmatched;    // too old, or not ours
+
+    uint32_t ping_id;           // last ping sent
+    uint64_t ping_ns;           // when, 0 = answered
+    uint64_t pong_ns;           // last pong on this connection, 0 = none yet
+    uint64_t ping_rtt_ns;
+    unsigned long pings;
+    unsigned long pongs;
+    ctrl_msg_t config;          // CONFIG_SET for the send loop
+    bool config_pending;
+} echo_rx_t;
+
+/* A new connection is a new byte stream; outstanding sends stay valid. */
+static void echo_rx_reset(echo_rx_t *e)
+{
+    frame_reasm_init(&e->reasm);
+    telemetry_delta_dec_init(&e->dec);
+    e->ping_ns = e->pong_ns = 0;
+    e->config_pending = false;
+}
+
+static void echo_rx_init(echo_rx_t *e)
+{
+    memset(e, 0, sizeof(*e));
+    e->min_ns = UINT64_MAX;
+    echo_rx_reset(e);
+}
+
+/* Smallest RTT since the last call, 0 if nothing was echoed meanwhile. */
+static uint64_t echo_rx_take_min(echo_rx_t *e)
+{
+    uint64_t m = e->min_ns;
+    e->min_ns = UINT64_MAX;
+    return m == UINT64_MAX ? 0 : m;
+}
+
+static void echo_rx_sent(echo_rx_t *e, uint32_t seq, uint64_t now_ns)
+{
+    e->seq[seq % ECHO_SLOTS] = seq;
+    e->sent_ns[seq % ECHO_SLOTS] = now_ns;
+}
+
+/* Queue a ping (v2) or the bare keepalive byte (v1) in out. Returns its
+ * length. */
+static size_t echo_rx_ping(echo_rx_t *e, int proto, uint64_t now_ns, uint8_t *out)
+{
+    if (proto < 2) {
+        out[0] = FRAME_CTRL_PING;
+        return 1;
     }
+    e->pings++;
+    e->ping_ns = now_ns;
+    return ctrl_encode_ping(++e->ping_id, realtime_us(), out);
+}
 
-    int err = 0;
-    socklen_t len = sizeof(err);
-    getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &len);
+/* A server that answered pings before and has gone quiet for
+ * PONG_TIMEOUT_NS is gone, even if the socket has not noticed. */
+static bool echo_rx_peer_silent(const echo_rx_t *e, uint64_t now_ns)
+{
+    return e->pong_ns && now_ns - e->pong_ns > PONG_TIMEOUT_NS;
+}
 
-    if (err != 0) {
-        errno = err;
-        return -1;
+static int rx_on_telemetry(void *ctx, void *conn, const uint8_t *frame, size_t len)
+{
+    (void)conn;
+    echo_rx_t *e = (echo_rx_t *)ctx;
+    telemetry_t t;
+    frame_meta_t meta;
+    int ret = telemetry_delta_decode(&e->dec, frame, len, &t, &meta);
+    if ((ret != 0 && ret != -8) || meta.version < FRAME_V2) return ret;
+
+    unsigned slot = meta.seq % ECHO_SLOTS;
+    if (e->sent_ns[slot] && e->seq[slot] == meta.seq) {
+        uint64_t d = e->rx_ns - e->sent_ns[slot];
+        lat_hist_add(e->rtt, d);
+        if (d < e->min_ns) e->min_ns = d;
+        e->sent_ns[slot] = 0;
+        e->echoed++;
+    } else {
+        e->unmatched++;
     }
+    return 0;
+}
 
+static int rx_on_pong(void *ctx, void *conn, const uint8_t *frame, size_t len)
+{
+    (void)conn;
+    echo_rx_t *e = (echo_rx_t *)ctx;
+    ctrl_msg_t m;
+    int ret = ctrl_decode(frame, len, &m);
+    if (ret < 0) return ret;
+
+    e->pong_ns = e->rx_ns;
+    e->pongs++;
+    if (e->ping_ns && m.meta.seq == e->ping_id) {
+        e->ping_rtt_ns = e->rx_ns - e->ping_ns;
+        e->ping_ns = 0;
+    }
     return 0;
 }
 
-static int safe_reconnect(struct sockaddr_rc *addr)
+static int rx_on_config(void *ctx, void *conn, const uint8_t *frame, size_t len)
 {
-    int s;
+    (void)conn;
+    echo_rx_t *e = (echo_rx_t *)ctx;
+    int ret = ctrl_decode(frame, len, &e->config);
+    if (ret == 0) e->config_pending = true;
+    return ret;
+}
 
-RETRY:
-    s = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
-    if (s < 0) {
-        fprintf(stderr, "[ERR] socket: %s\n", strerror(errno));
-        usleep(200 * 1000);
-        goto RETRY;
-    }
+/* Our own pings and acks come back from an echo server; nothing to do */
+static const frame_dispatch_t client_rx = {{
+    [FRAME_TYPE_TELEMETRY]  = rx_on_telemetry,
+    [FRAME_TYPE_DELTA]      = rx_on_telemetry,
+    [FRAME_TYPE_PONG]       = rx_on_pong,
+    [FRAME_TYPE_CONFIG_SET] = rx_on_config,
+}};
+
+/* Drain everything readable on fd, timing echoes into rtt. Returns 0, or
+ * -1 when the peer has closed or the connection failed (errno set). */
+static int echo_rx_read(echo_rx_t *e, int fd, lat_hist_t *rtt)
+{
+    uint8_t buf[4096];
+    uint8_t frame[FRAME_MAX_SIZE];
+    int flen;
+
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n == 0) {
+            errno = ECONNRESET;
+            return -1;
+        }
+        if (n < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+        }
 
-    enable_sockopts(s);
+        e->rx_ns = pacer_now_ns();
+        e->rtt = rtt;
+        size_t off = 0;
+        while (off < (size_t)n) {
+            off += frame_reasm_push(&e->reasm, buf + off, (size_t)n - off);
+            while ((flen = frame_reasm_next(&e->reasm, frame)) > 0) {
+                frame_dispatch(&client_rx, e, NULL, frame, (size_t)flen);
+            }
+        }
+        if ((size_t)n < sizeof(buf)) return 0;
+    }
+}
 
-    if (connect_blocking_with_timeout(s, addr) == 0) {
-        fprintf(stderr, "[INFO] Reconnected.\n");
-        return s;
+/* Sleep until deadline_ns, reading echoes from fd as they arrive so their
+ * receive time is exact. fd < 0 just sleeps. Returns -1 if fd broke. */
+static int sleep_reading_echoes(int fd, echo_rx_t *e, lat_hist_t *rtt, uint64_t deadline_ns)
+{
+    if (fd < 0) {
+        pacer_sleep_until(deadline_ns);
+        return 0;
+    }
+    for (;;) {
+        uint64_t now = pacer_now_ns();
+        if (now >= deadline_ns) return 0;
+
+        struct timespec ts;
+        ts.tv_sec = (time_t)((deadline_ns - now) / 1000000000ull);
+        ts.tv_nsec = (long)((deadline_ns - now) % 1000000000ull);
+        struct pollfd p = { .fd = fd, .events = POLLIN };
+        if (ppoll(&p, 1, &ts, NULL) > 0 && echo_rx_read(e, fd, rtt) < 0) return -1;
     }
+}
 
-    fprintf(stderr, "[WARN] connect failed: %s\n", strerror(errno));
-    close(s);
+static void print_rtt(const char *name, const lat_hist_t *rtt, unsigned long echoed,
+                      unsigned long unmatched)
+{
+    lat_hist_print(rtt, name, stderr);
+    if (unmatched) fprintf(stderr, "  %lu echoes matched, %lu unmatched\n", echoed, unmatched);
+}
 
-    usleep(300 * 1000); // RFCOMM cooldown
-    goto RETRY;
+static void print_ctrl(const echo_rx_t *e, unsigned long configs)
+{
+    fprintf(stderr, "[CTRL] %lu pings, %lu pongs, last ping RTT %.2f ms, %lu configs applied\n",
+            e->pings, e->pongs, e->ping_rtt_ns / 1e6, configs);
 }
 
 /* ---------- CLIENT ---------- */
-static int run_client(const char *mac_addr,
-                      uint8_t channel,
-                      unsigned interval_ms,
-                      bool verbose)
+typedef enum { LINK_DOWN, LINK_CONNECTING, LINK_UP } link_state_t;
+
+/* What a CONFIG_SET may change while running */
+typedef struct {
+    pacer_t *pace;
+    rate_ctl_t *rc;             // NULL unless --adaptive
+    telemetry_delta_enc_t *delta;
+    unsigned *delta_key;
+    int proto;
+} client_live_t;
+
+/* Check every pair first, then apply all of them or none. Returns a
+ * CTRL_ACK_* status; *bad_key is the pair that failed. */
+static uint8_t client_apply_config(const client_live_t *l, const ctrl_msg_t *m, uint8_t *bad_key)
 {
-    struct sockaddr_rc addr = {0};
-    int s;
-
-    addr.rc_family = AF_BLUETOOTH;
-    str2ba(mac_addr, &addr.rc_bdaddr);
-    addr.rc_channel = channel;
+    for (size_t i = 0; i < m->ncfg; i++) {
+        const ctrl_cfg_t *c = &m->cfg[i];
+        *bad_key = c->key;
+        switch (c->key) {
+        case CTRL_CFG_INTERVAL_MS: {
+            uint64_t ns = (uint64_t)c->value * 1000000ull;
+            if (c->value < 1 || c->value > 60000) return CTRL_ACK_BAD_VALUE;
+            // Adaptive mode owns the period; only its bounds are binding
+            if (l->rc && (ns < l->rc->min_ns || ns > l->rc->max_ns)) return CTRL_ACK_BAD_VALUE;
+            break;
+        }
+        case CTRL_CFG_DELTA_KEY:
+            if (l->proto != 2 || c->value > TELEM_DELTA_MAX_KEY_INTERVAL) return CTRL_ACK_BAD_VALUE;
+            break;
+        default:
+            return CTRL_ACK_UNKNOWN_KEY;
+        }
+    }
 
-    fprintf(stderr, "[INFO] Connecting to %s ch %u...\n",
-            mac_addr, channel);
+    *bad_key = 0;
+    for (size_t i = 0; i < m->ncfg; i++) {
+        const ctrl_cfg_t *c = &m->cfg[i];
+        if (c->key == CTRL_CFG_INTERVAL_MS) {
+            l->pace->period_ns = (uint64_t)c->value * 1000000ull;
+            if (l->rc) l->rc->period_ns = l->pace->period_ns;
+        } else if (c->key == CTRL_CFG_DELTA_KEY) {
+            *l->delta_key = c->value;
+            if (c->value) l->delta->key_interval = c->value;
+            telemetry_delta_enc_reset(l->delta);
+        }
+    }
+    return CTRL_ACK_OK;
+}
 
-    s = safe_reconnect(&addr);
+static int run_client(const transport_addr_t *addr, const client_opts_t *o)
+{
+    int s = -1;
+    link_state_t link = LINK_DOWN;
+    vehicle_t veh;
+    pacer_t pace;
+    lat_hist_t jitter, send_lat, rtt, rtt_prev;
+    static tx_batch_t batch;
+    static echo_rx_t echo;
+    frame_spool_t spool;
+
+    unsigned backoff_ms = o->backoff_min_ms;
+    uint64_t retry_ns = 0, connect_ns = 0, down_ns = pacer_now_ns();
+    unsigned long reconnects = 0, connects = 0;
+    double replay_tokens = 0;
+    uint32_t seq = 0;
+    telemetry_delta_enc_t delta;
+    unsigned delta_key = o->delta_key;
+    unsigned long configs = 0;
+    static rate_ctl_t rc;
+    unsigned long rc_faster = 0, rc_slower = 0;
+    uint64_t built_bytes = 0, built_frames = 0;
+    double outq_per_frame = 0;      // TIOCOUTQ units one frame adds
+    bool outq_ok = true;
+
+    if (frame_spool_init(&spool, o->spool_frames, o->spool_file, o->spool_file_frames) < 0) {
+        fprintf(stderr, "[ERR] spool %s: %s\n", o->spool_file ? o->spool_file : "(memory)",
+                strerror(errno));
+        return 1;
+    }
+    if (spool.recovered) {
+        fprintf(stderr, "[INFO] %lu frames recovered from %s\n", spool.recovered, o->spool_file);
+    }
 
-    uint64_t last_ping = 0;
+    vehicle_init(&veh, 0);
+    telemetry_delta_enc_init(&delta, o->delta_key);
+    echo_rx_init(&echo);
+    lat_hist_init(&jitter);
+    lat_hist_init(&send_lat);
+    lat_hist_init(&rtt);
+    lat_hist_init(&rtt_prev);
+
+    fprintf(stderr, "[INFO] Connecting to %s...\n", addr->uri);
+
+    // Deadlines are absolute, so verbose printing and reconnects do not
+    // stretch the period; overruns are handled by the catch-up policy.
+    // Connecting is non-blocking: samples keep being produced (and
+    // spooled) while the link is down.
+    pacer_init(&pace, (uint64_t)o->interval_ms * 1000000ull, o->catchup, o->max_burst);
+    if (o->adapt_max_ms) {
+        rate_ctl_init(&rc, pace.period_ns, (uint64_t)o->adapt_min_ms * 1000000ull,
+                      (uint64_t)o->adapt_max_ms * 1000000ull,
+                      (uint64_t)o->target_delay_ms * 1000000ull, pace.next_ns);
+        pace.period_ns = rc.period_ns;
+    }
+    uint64_t last_tick_ns = pace.next_ns;
+    uint64_t last_ping_ns = pace.next_ns;
+    const client_live_t live = {
+        &pace, o->adapt_max_ms ? &rc : NULL, &delta, &delta_key, o->proto,
+    };
+    uint64_t report_ns = pace.next_ns + (uint64_t)o->report_s * 1000000000ull;
 
     while (g_running) {
-        uint8_t frame[11];
-        simulate_tick();
-        build_frame(frame);
+        uint8_t frame[FRAME_MAX_SIZE];
+        size_t flen;
+
+        if (g_dump_stats) {
+            g_dump_stats = 0;
+            print_pacing_stats("STATS", &jitter, &send_lat, pace.ticks, pace.overruns, pace.skipped);
+            print_spool_stats(&spool, reconnects);
+            print_rtt("[STATS] echo RTT", &rtt, echo.echoed, echo.unmatched);
+            if (o->proto == 2) print_ctrl(&echo, configs);
+            if (o->adapt_max_ms) rate_ctl_print(&rc, "[STATS] rate", stderr);
+        }
 
-        ssize_t w = send(s, frame, sizeof(frame), MSG_NOSIGNAL);
+        if (o->report_s && pacer_now_ns() >= report_ns) {
+            if (rtt.samples > rtt_prev.samples) {
+                lat_hist_t iv;
+                char name[32];
+                lat_hist_since(&iv, &rtt, &rtt_prev);
+                snprintf(name, sizeof(name), "[RTT] last %u s", o->report_s);
+                lat_hist_print(&iv, name, stderr);
+                rtt_prev = rtt;
+            }
+            if (o->adapt_max_ms) {
+                fprintf(stderr, "[RATE] period %.1f ms (%.1f Hz), last %u s: %lu faster, "
+                        "%lu slower; backlog %zu frames\n",
+                        rc.period_ns / 1e6, 1e9 / rc.period_ns, o->report_s,
+                        rc.increases - rc_faster, rc.decreases - rc_slower, rc.last_backlog);
+                rc_faster = rc.increases;
+                rc_slower = rc.decreases;
+            }
+            report_ns += (uint64_t)o->report_s * 1000000000ull;
+        }
 
-        if (w < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // Socket belum siap → tunggu sejenak
-                usleep(2000);
-                continue;
+        // A partial batch must not wait past its age limit for the next tick
+        if (link == LINK_UP && batch.frames > 0) {
+            uint64_t flush_at = batch.first_ns + (uint64_t)o->batch_us * 1000ull;
+            if (flush_at < pace.next_ns) {
+                if (sleep_reading_echoes(s, &echo, &rtt, flush_at) < 0) goto broken;
+                if (tx_batch_flush(s, &batch, &send_lat) < 0) goto broken;
             }
+        }
 
-            fprintf(stderr, "[ERR] write: %s. Reconnecting...\n",
-                    strerror(errno));
-            close(s);
-            s = safe_reconnect(&addr);
-            continue;
+        // Same as pacer_wait(), but echoes are read the moment they arrive
+        if (sleep_reading_echoes(link == LINK_UP ? s : -1, &echo, &rtt, pace.next_ns) < 0) {
+            goto broken;
+        }
+        if (link == LINK_UP && echo_rx_peer_silent(&echo, pacer_now_ns())) {
+            errno = ETIMEDOUT;
+            goto broken;
+        }
+        lat_hist_add(&jitter, pacer_advance(&pace, pacer_now_ns()));
+        if (!g_running) break;
+
+        if (echo.config_pending) {
+            uint8_t key, ack[FRAME_MAX_SIZE];
+            uint8_t st = client_apply_config(&live, &echo.config, &key);
+            fprintf(stderr, "[CTRL] config #%u from server:", echo.config.meta.seq);
+            for (size_t i = 0; i < echo.config.ncfg; i++) {
+                fprintf(stderr, " %s=%u", ctrl_cfg_name(echo.config.cfg[i].key),
+                        echo.config.cfg[i].value);
+            }
+            fprintf(stderr, " -> %s\n", ctrl_ack_status_str(st));
+            size_t n = ctrl_encode_ack(echo.config.meta.seq, realtime_us(), FRAME_TYPE_CONFIG_SET,
+                                       st, key, ack);
+            tx_batch_put(&batch, ack, n, false, pacer_now_ns());
+            echo.config_pending = false;
+            configs += (st == CTRL_ACK_OK);
+        }
+
+        // Deltas only on a live link in order: spooled and replayed
+        // frames, and the fresh ones sent between them, are keyframes
+        if (link != LINK_UP || frame_spool_count(&spool) > 0) {
+            telemetry_delta_enc_reset(&delta);
+        }
+        simulate_tick(&veh);
+        uint32_t frame_seq = seq++;
+        flen = build_frame(&veh, o->proto, frame_seq, delta_key ? &delta : NULL, frame);
+        built_bytes += flen;
+        built_frames++;
+
+        uint64_t now_ns = pacer_now_ns();
+        uint64_t dt_ns = now_ns - last_tick_ns;
+        last_tick_ns = now_ns;
+
+        // ---- link management, never blocks ----
+        if (link == LINK_DOWN && now_ns >= retry_ns) {
+            int in_progress;
+            s = transport_connect_start(addr, &in_progress);
+            if (s < 0) {
+                fprintf(stderr, "[WARN] connect failed: %s\n", strerror(errno));
+                retry_ns = now_ns + backoff_next_ns(&backoff_ms, o);
+            } else {
+                link = in_progress ? LINK_CONNECTING : LINK_UP;
+                connect_ns = now_ns;
+            }
+        }
+        if (link == LINK_CONNECTING) {
+            int r = transport_connect_check(s, 0);
+            if (r == 0 && now_ns - connect_ns > CONNECT_TIMEOUT_NS) {
+                errno = ETIMEDOUT;
+                r = -1;
+            }
+            if (r < 0) {
+                fprintf(stderr, "[WARN] connect failed: %s\n", strerror(errno));
+                close(s);
+                s = -1;
+                link = LINK_DOWN;
+                retry_ns = now_ns + backoff_next_ns(&backoff_ms, o);
+            } else if (r > 0) {
+                link = LINK_UP;
+            }
+        }
+        if (link == LINK_UP && connect_ns) {
+            enable_sockopts(s);
+            echo_rx_reset(&echo);
+            if (o->adapt_max_ms && outq_ok && transport_outq(s) < 0) {
+                fprintf(stderr, "[WARN] send queue depth unavailable (%s), adapting on "
+                        "short writes and echo RTT only.\n", strerror(errno));
+                outq_ok = false;
+            }
+            if (connects++ == 0) {
+                fprintf(stderr, "[INFO] Connected.\n");
+            } else {
+                reconnects++;
+                fprintf(stderr, "[INFO] Reconnected after %.1f s, %zu frames to replay.\n",
+                        (now_ns - down_ns) / 1e9, frame_spool_count(&spool));
+            }
+            connect_ns = 0;
+            backoff_ms = o->backoff_min_ms;
+            replay_tokens = 0;
         }
 
-        if ((size_t)w < sizeof(frame)) {
-            fprintf(stderr, "[ERR] Partial write. Reconnecting...\n");
-            close(s);
-            s = safe_reconnect(&addr);
+        if (link != LINK_UP) {
+            frame_spool_put(&spool, frame, flen);
             continue;
         }
 
-        if (verbose) {
+        // ---- replay stale frames at the catch-up rate, ahead of the fresh
+        // one, so the newest sample is always the last thing the server sees
+        if (frame_spool_count(&spool) > 0) {
+            replay_tokens += o->replay_rate * (dt_ns / 1e9);
+            if (replay_tokens > TX_BATCH_MAX_FRAMES) replay_tokens = TX_BATCH_MAX_FRAMES;
+
+            uint8_t old[FRAME_SPOOL_MAX_FRAME];
+            size_t n;
+            while (replay_tokens >= 1 && (n = frame_spool_peek(&spool, old)) > 0 &&
+                   tx_batch_fits(&batch, n + flen + 1)) {
+                tx_batch_put(&batch, old, n, true, now_ns);
+                if (old[1] >= FRAME_V2_MIN_LEN) echo_rx_sent(&echo, telem_load_le32(old + 4), now_ns);
+                frame_spool_pop(&spool);
+                replay_tokens -= 1;
+            }
+        } else {
+            replay_tokens = 0;
+        }
+
+        tx_batch_put(&batch, frame, flen, true, now_ns);
+        if (o->proto == 2) echo_rx_sent(&echo, frame_seq, now_ns);
+
+        if (o->verbose) {
             fprintf(stderr, "TX:");
-            for (int i = 0; i < 9; i++)
+            for (size_t i = 0; i < flen; i++)
                 fprintf(stderr, " %u", frame[i]);
             fprintf(stderr, "\n");
         }
 
-        uint64_t now = epoch_ms();
-        if (now - last_ping > 3000) {
-            char ping = 0xFF;
+        // The ping rides along with the next flush instead of costing a
+        // send() of its own
+        if (now_ns - last_ping_ns > PING_NS) {
+            uint8_t ping[FRAME_MAX_SIZE];
+            tx_batch_put(&batch, ping, echo_rx_ping(&echo, o->proto, now_ns, ping), false, now_ns);
+            last_ping_ns = now_ns;
+        }
 
-            ssize_t p = send(s, &ping, 1, MSG_NOSIGNAL);
-            if (p < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-                fprintf(stderr, "[ERR] silent disconnect.\n");
-                close(s);
-                s = safe_reconnect(&addr);
+        // ---- adapt the period to what the link drains. The backlog is
+        // taken before this tick's send, so it only holds frames that
+        // have waited a period already. The queue's unit is learnt from
+        // how much each send() adds to it.
+        int outq = (o->adapt_max_ms && outq_ok) ? transport_outq(s) : -1;
+        if (o->adapt_max_ms) {
+            double frame_bytes = (double)built_bytes / built_frames;
+            double unit = outq_per_frame > 0 ? outq_per_frame : frame_bytes;
+            size_t backlog = (size_t)((outq > 0 ? outq / unit : 0) + batch.stuck / frame_bytes);
+            uint64_t old = rc.period_ns;
+            if (rate_ctl_update(&rc, now_ns, backlog, echo_rx_take_min(&echo)) &&
+                rc.period_ns != old) {
+                pace.period_ns = rc.period_ns;
+                if (o->verbose) {
+                    fprintf(stderr, "[RATE] %.1f -> %.1f ms, backlog %zu frames\n",
+                            old / 1e6, rc.period_ns / 1e6, backlog);
+                }
+            }
+        }
+
+        if (tx_batch_due(&batch, o->batch_frames, (uint64_t)o->batch_us * 1000ull, now_ns)) {
+            unsigned long before = batch.sent_frames;
+            if (tx_batch_flush(s, &batch, &send_lat) < 0) goto broken;
+
+            int after = outq >= 0 ? transport_outq(s) : -1;
+            if (after > outq && batch.sent_frames > before) {
+                double u = (double)(after - outq) / (batch.sent_frames - before);
+                outq_per_frame = outq_per_frame > 0 ? outq_per_frame + (u - outq_per_frame) / 8 : u;
+            }
+        }
+        continue;
+
+broken:
+        fprintf(stderr, "[ERR] write: %s. Buffering while reconnecting...\n", strerror(errno));
+        close(s);
+        s = -1;
+        link = LINK_DOWN;
+        down_ns = pacer_now_ns();
+        retry_ns = down_ns + backoff_next_ns(&backoff_ms, o);
+        tx_batch_salvage(&batch, &spool);
+    }
+
+    if (link == LINK_UP) {
+        tx_batch_flush(s, &batch, &send_lat);
+    }
+    tx_batch_salvage(&batch, &spool);   // keep whatever did not make it
+
+    print_pacing_stats("STATS", &jitter, &send_lat, pace.ticks, pace.overruns, pace.skipped);
+    fprintf(stderr, "[STATS] %lu frames in %lu send() calls (%.2f frames/call), %lu dropped\n",
+            batch.sent_frames, batch.sends,
+            batch.sends ? (double)batch.sent_frames / batch.sends : 0.0, batch.dropped);
+    print_spool_stats(&spool, reconnects);
+    if (rtt.samples) print_rtt("[STATS] echo RTT", &rtt, echo.echoed, echo.unmatched);
+    if (o->proto == 2) print_ctrl(&echo, configs);
+    if (o->adapt_max_ms) rate_ctl_print(&rc, "[STATS] rate", stderr);
+    if (delta.keyframes + delta.deltas > 0 && (o->delta_key || delta_key)) {
+        fprintf(stderr, "[DELTA] %lu keyframes, %lu deltas, %.2f bytes/frame\n",
+                delta.keyframes, delta.deltas,
+                delta.keyframes + delta.deltas
+                    ? (double)delta.bytes / (delta.keyframes + delta.deltas) : 0.0);
+    }
+
+    frame_spool_free(&spool);
+    if (s >= 0) close(s);
+    return 0;
+}
+
+/* ---------- LOAD GENERATOR (--vehicles) ----------
+ * N simulated vehicles share C connections (one each by default), which
+ * are split over a few worker threads. Every vehicle sends at --rate Hz;
+ * its frames are queued in the connection's buffer and flushed with
+ * non-blocking sends. A "stall" is a send that could not take everything
+ * queued (the server or the link is not keeping up); it lasts until the
+ * buffer drains. Frames that do not fit the buffer are dropped, not
+ * delayed, so the offered load stays at N * rate.
+ */
+#define LOAD_MIN_OUTBUF   16384
+#define LOAD_RETRY_NS     1000000000ull
+#define LOAD_CONNECT_NS   1000000000ull     // give up on a connect after this
+#define LOAD_REPORT_TOP   10
+
+typedef struct {
+    unsigned id;
+    int fd;
+    vehicle_t *veh;
+    size_t nveh;
+
+    uint8_t *out;               // queued, not yet accepted by the kernel
+    size_t out_cap, out_off, out_len;
+    size_t rec_skip;            // tail of a half-sent record at out_off
+    unsigned queued;            // frames waiting for the batch to fill
+    uint32_t seq;               // v2 sequence, one stream per connection
+    telemetry_delta_enc_t delta;    // --delta: one vehicle per connection
+    uint64_t first_ns;          // when the oldest of them was queued
+    echo_rx_t *echo;            // v2 only
+
+    uint64_t last_ping_ns;
+    uint64_t retry_ns;          // reconnect no earlier than this
+    bool connecting;            // fd is set, the handshake is still running
+    uint64_t connect_ns;        // when it started
+    uint64_t stall_start_ns;    // 0 while flowing
+
+    unsigned long bytes;        // accepted by send()
+    unsigned long frames;
+    unsigned long sends;        // send() calls that moved data
+    unsigned long dropped;      // frames, buffer full
+    unsigned long stalls;
+    unsigned long connects;     // handshakes completed
+    unsigned long reconnects;
+    uint64_t stall_ns_total;
+    uint64_t stall_ns_max;
+} load_conn_t;
+
+typedef struct {
+    const transport_addr_t *addr;
+    const client_opts_t *opts;
+    load_conn_t *conns;
+    size_t nconns;
+
+    lat_hist_t jitter;          // per frame: send start - deadline
+    lat_hist_t send_lat;        // per flush: time inside send()
+    lat_hist_t rtt;             // per echoed frame
+
+    int epfd;                   // connects, echoes and the wake-up timer
+    int tfd;
+
+    atomic_ulong frames;        // running totals for the 1 s report
+    atomic_ulong dropped;
+    atomic_ulong stalls;
+} load_worker_t;
+
+/* The connection is up: start over with empty buffers. */
+static void load_up(load_conn_t *c, uint64_t now)
+{
+    c->connecting = false;
+    if (c->connects++ > 0) c->reconnects++;
+    enable_sockopts(c->fd);
+    telemetry_delta_enc_reset(&c->delta);
+    if (c->echo) echo_rx_reset(c->echo);
+    c->out_off = c->out_len = 0;
+    c->rec_skip = 0;
+    c->queued = 0;
+    c->stall_start_ns = 0;
+    c->last_ping_ns = now;
+}
+
+/* Start a non-blocking connect; load_connected() finishes it. Thousands
+ * of connections must not wait for each other's handshakes. */
+static void load_connect(load_conn_t *c, const transport_addr_t *addr, uint64_t now)
+{
+    int in_progress;
+    c->fd = transport_connect_start(addr, &in_progress);
+    if (c->fd < 0) {
+        c->retry_ns = now + LOAD_RETRY_NS;
+        return;
+    }
+    if (in_progress) {
+        c->connecting = true;
+        c->connect_ns = now;
+    } else {
+        load_up(c, now);
+    }
+}
+
+static void load_drop(load_conn_t *c, uint64_t now)
+{
+    close(c->fd);
+    c->fd = -1;
+    c->connecting = false;
+    c->retry_ns = now + LOAD_RETRY_NS;
+    if (c->stall_start_ns) c->stall_start_ns = 0;
+}
+
+/* Connecting: wait until writable. Up: echoes only, so nothing for v1. */
+static void load_watch(load_worker_t *w, load_conn_t *c, int op)
+{
+    struct epoll_event ev = { .events = c->connecting ? EPOLLOUT : EPOLLIN, .data.ptr = c };
+    if (!c->connecting && !c->echo) {
+        if (op == EPOLL_CTL_MOD) epoll_ctl(w->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+        return;
+    }
+    epoll_ctl(w->epfd, op, c->fd, &ev);
+}
+
+/* Finish a connect once the socket is writable or the handshake took too
+ * long. Returns true when the connection came up. */
+static bool load_connected(load_worker_t *w, load_conn_t *c, uint64_t now)
+{
+    int r = transport_connect_check(c->fd, 0);
+    if (r == 0 && now - c->connect_ns < LOAD_CONNECT_NS) return false;
+    if (r <= 0) {
+        load_drop(c, now);
+        return false;
+    }
+    load_up(c, now);
+    load_watch(w, c, EPOLL_CTL_MOD);
+    return true;
+}
+
+static void load_enqueue(load_conn_t *c, const uint8_t *buf, size_t len, uint64_t now)
+{
+    if (c->out_cap - c->out_len < len && c->out_off > 0) {
+        memmove(c->out, c->out + c->out_off, c->out_len - c->out_off);
+        c->out_len -= c->out_off;
+        c->out_off = 0;
+    }
+    if (c->out_cap - c->out_len < len) {
+        c->dropped++;
+        return;
+    }
+    memcpy(c->out + c->out_len, buf, len);
+    c->out_len += len;
+    if (tx_record_is_sample(buf) && c->queued++ == 0) c->first_ns = now;
+}
+
+/* Sleep until wake_ns on a timer and the connections, so a finished
+ * connect starts sending and each echo is timed when it arrives, not at
+ * the next tick. */
+static void load_wait(load_worker_t *w, uint64_t wake_ns)
+{
+    struct itimerspec its = {0};
+    its.it_value.tv_sec = (time_t)(wake_ns / 1000000000ull);
+    its.it_value.tv_nsec = (long)(wake_ns % 1000000000ull);
+    timerfd_settime(w->tfd, TFD_TIMER_ABSTIME, &its, NULL);
+
+    for (;;) {
+        struct epoll_event ev[64];
+        int n = epoll_wait(w->epfd, ev, 64, -1);
+        bool fired = false;
+
+        for (int i = 0; i < n; i++) {
+            load_conn_t *c = (load_conn_t *)ev[i].data.ptr;
+            if (!c) {
+                uint64_t expirations;
+                if (read(w->tfd, &expirations, sizeof(expirations)) < 0) {
+                    // Already drained; the wake-up still counts
+                }
+                fired = true;
+            } else if (c->fd >= 0 && c->connecting) {
+                if (load_connected(w, c, pacer_now_ns())) fired = true;
+            } else if (c->fd >= 0 && echo_rx_read(c->echo, c->fd, &w->rtt) < 0) {
+                load_drop(c, pacer_now_ns());
+            } else if (c->fd >= 0 && c->echo->config_pending) {
+                // Simulated vehicles keep the rate they were started with
+                uint8_t ack[FRAME_MAX_SIZE];
+                size_t len = ctrl_encode_ack(c->echo->config.meta.seq, realtime_us(),
+                                             FRAME_TYPE_CONFIG_SET, CTRL_ACK_UNSUPPORTED, 0, ack);
+                load_enqueue(c, ack, len, pacer_now_ns());
+                c->echo->config_pending = false;
             }
+        }
+        if (fired || pacer_now_ns() >= wake_ns) return;
+    }
+}
+
+/* Returns the bytes the kernel took, or -1 when the connection broke. */
+static ssize_t load_flush(load_conn_t *c, uint64_t now, lat_hist_t *send_lat)
+{
+    size_t pending = c->out_len - c->out_off;
+    if (pending == 0) return 0;
+
+    uint64_t t0 = pacer_now_ns();
+    ssize_t w = transport_send(c->fd, c->out + c->out_off, pending);
+    lat_hist_add(send_lat, pacer_now_ns() - t0);
+    if (w < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+        w = 0;
+    }
+
+    if (w > 0) {
+        c->sends++;
+        c->queued = 0;
+    }
 
-            last_ping = now;
+    // Count frames by walking the records the kernel took
+    size_t pos = c->out_off + c->rec_skip, end = c->out_off + (size_t)w;
+    while (pos < end) {
+        if (tx_record_is_sample(c->out + pos)) c->frames++;
+        pos += tx_record_len(c->out + pos);
+    }
+    c->rec_skip = pos - end;
+
+    c->out_off += (size_t)w;
+    if (c->out_off == c->out_len) {
+        c->out_off = c->out_len = 0;
+        if (c->stall_start_ns) {
+            uint64_t d = now - c->stall_start_ns;
+            c->stall_ns_total += d;
+            if (d > c->stall_ns_max) c->stall_ns_max = d;
+            c->stall_start_ns = 0;
         }
+    } else if (!c->stall_start_ns) {
+        c->stall_start_ns = now;
+        c->stalls++;
+    }
+
+    return w;
+}
 
-        msleep(interval_ms);
+static void *load_worker(void *arg)
+{
+    load_worker_t *w = (load_worker_t *)arg;
+    const client_opts_t *o = w->opts;
+    uint64_t batch_ns = (uint64_t)o->batch_us * 1000ull;
+
+    while (g_running) {
+        uint64_t now = pacer_now_ns();
+        uint64_t wake = now + 10000000ull;      // at least every 10 ms
+        unsigned long frames = 0, dropped = 0, stalls = 0;
+
+        for (size_t i = 0; i < w->nconns; i++) {
+            load_conn_t *c = &w->conns[i];
+            now = pacer_now_ns();
+
+            if (c->fd < 0) {
+                if (now < c->retry_ns) continue;
+                load_connect(c, w->addr, now);
+                if (c->fd < 0) continue;
+                load_watch(w, c, EPOLL_CTL_ADD);
+            }
+            if (c->connecting) {
+                // EPOLLOUT finishes it; only a timeout is caught here
+                if (!load_connected(w, c, now)) {
+                    if (c->connecting && c->connect_ns + LOAD_CONNECT_NS < wake)
+                        wake = c->connect_ns + LOAD_CONNECT_NS;
+                    continue;
+                }
+            }
+
+            unsigned long f0 = c->frames, d0 = c->dropped, s0 = c->stalls;
+
+            for (size_t k = 0; k < c->nveh; k++) {
+                vehicle_t *v = &c->veh[k];
+                // More than once only when PACER_BURST catches up
+                while (v->pace.next_ns <= now) {
+                    uint8_t frame[FRAME_MAX_SIZE];
+                    simulate_tick(v);
+                    uint32_t seq = c->seq++;
+                    size_t flen = build_frame(v, o->proto, seq,
+                                              o->delta_key ? &c->delta : NULL, frame);
+                    load_enqueue(c, frame, flen, now);
+                    if (c->echo) echo_rx_sent(c->echo, seq, now);
+                    lat_hist_add(&w->jitter, pacer_advance(&v->pace, now));
+                }
+                if (v->pace.next_ns < wake) wake = v->pace.next_ns;
+            }
+
+            if (now - c->last_ping_ns > PING_NS) {
+                uint8_t ping[FRAME_MAX_SIZE];
+                load_enqueue(c, ping, echo_rx_ping(c->echo, o->proto, now, ping), now);
+                c->last_ping_ns = now;
+            }
+
+            // Flush a full or aged batch, or keep pushing a stalled one
+            bool due = c->queued >= o->batch_frames ||
+                       (c->queued && now - c->first_ns >= batch_ns) ||
+                       c->stall_start_ns != 0;
+            ssize_t n = due ? load_flush(c, now, &w->send_lat) : 0;
+            if (n < 0) {
+                load_drop(c, now);
+                continue;
+            }
+            c->bytes += (unsigned long)n;
+            frames += c->frames - f0;
+            dropped += c->dropped - d0;
+            stalls += c->stalls - s0;
+
+            // Stalled: come back soon to push the rest
+            if (c->stall_start_ns && now + 1000000ull < wake) wake = now + 1000000ull;
+            if (c->queued && c->first_ns + batch_ns < wake) wake = c->first_ns + batch_ns;
+        }
+
+        atomic_fetch_add_explicit(&w->frames, frames, memory_order_relaxed);
+        atomic_fetch_add_explicit(&w->dropped, dropped, memory_order_relaxed);
+        atomic_fetch_add_explicit(&w->stalls, stalls, memory_order_relaxed);
+
+        load_wait(w, wake);
+    }
+
+    return NULL;
+}
+
+static int cmp_stall_desc(const void *a, const void *b)
+{
+    const load_conn_t *x = *(const load_conn_t *const *)a;
+    const load_conn_t *y = *(const load_conn_t *const *)b;
+    if (x->stall_ns_total != y->stall_ns_total)
+        return x->stall_ns_total < y->stall_ns_total ? 1 : -1;
+    return x->stalls < y->stalls ? 1 : (x->stalls > y->stalls ? -1 : 0);
+}
+
+static void load_report(load_conn_t *conns, size_t nconns, double secs, double target)
+{
+    unsigned long frames = 0, dropped = 0, stalls = 0, reconnects = 0, sends = 0;
+    size_t stalled = 0, down = 0;
+    load_conn_t **order = malloc(nconns * sizeof(*order));
+
+    for (size_t i = 0; i < nconns; i++) {
+        load_conn_t *c = &conns[i];
+        frames += c->frames;
+        dropped += c->dropped;
+        sends += c->sends;
+        stalls += c->stalls;
+        reconnects += c->reconnects;
+        if (c->stalls) stalled++;
+        if (c->fd < 0 || c->connecting) down++;
+        order[i] = c;
+    }
+
+    fprintf(stderr, "\n[LOAD] %.1f s: %lu frames, %.0f frames/s of %.0f target (%.1f%%)\n",
+            secs, frames, frames / secs, target, target > 0 ? 100.0 * frames / secs / target : 0.0);
+    fprintf(stderr, "[LOAD] %lu send() calls, %.2f frames/call\n",
+            sends, sends ? (double)frames / sends : 0.0);
+    fprintf(stderr, "[LOAD] dropped %lu frames, %lu reconnects, %zu of %zu connections down\n",
+            dropped, reconnects, down, nconns);
+    fprintf(stderr, "[LOAD] %lu stalls on %zu of %zu connections\n", stalls, stalled, nconns);
+
+    if (stalled && order) {
+        qsort(order, nconns, sizeof(*order), cmp_stall_desc);
+        fprintf(stderr, "  %6s %8s %10s %10s %8s\n", "conn", "stalls", "total ms", "max ms", "dropped");
+        for (size_t i = 0; i < nconns && i < LOAD_REPORT_TOP && order[i]->stalls; i++) {
+            load_conn_t *c = order[i];
+            fprintf(stderr, "  %6u %8lu %10.1f %10.1f %8lu\n", c->id, c->stalls,
+                    c->stall_ns_total / 1e6, c->stall_ns_max / 1e6, c->dropped);
+        }
+    }
+
+    free(order);
+}
+
+static void load_print_pacing(const load_worker_t *workers, unsigned nthreads,
+                              const vehicle_t *veh, unsigned nvehicles)
+{
+    lat_hist_t jitter, send_lat;
+    unsigned long ticks = 0, overruns = 0, skipped = 0;
+
+    lat_hist_init(&jitter);
+    lat_hist_init(&send_lat);
+    for (unsigned t = 0; t < nthreads; t++) {
+        lat_hist_merge(&jitter, &workers[t].jitter);
+        lat_hist_merge(&send_lat, &workers[t].send_lat);
+    }
+    // Plain counters owned by the workers; good enough for a report
+    for (unsigned i = 0; i < nvehicles; i++) {
+        ticks += __atomic_load_n(&veh[i].pace.ticks, __ATOMIC_RELAXED);
+        overruns += __atomic_load_n(&veh[i].pace.overruns, __ATOMIC_RELAXED);
+        skipped += __atomic_load_n(&veh[i].pace.skipped, __ATOMIC_RELAXED);
     }
 
-    close(s);
+    print_pacing_stats("LOAD", &jitter, &send_lat, ticks, overruns, skipped);
+}
+
+static int run_load(const transport_addr_t *addr, unsigned nvehicles, double rate_hz,
+                    unsigned nconns, unsigned nthreads, double duration_s,
+                    const client_opts_t *o)
+{
+    if (nconns == 0 || nconns > nvehicles) nconns = nvehicles;
+    if (o->delta_key && nconns != nvehicles) {
+        // The receiver keeps one delta state per connection
+        fprintf(stderr, "[ERR] --delta needs one vehicle per connection.\n");
+        return 1;
+    }
+    if (nthreads == 0) nthreads = 1;
+    if (nthreads > nconns) nthreads = nconns;
+
+    uint64_t period_ns = (uint64_t)(1e9 / rate_hz);
+    size_t frame_size = (o->proto == 1) ? FRAME_SIZE : FRAME_V2_SIZE;
+    vehicle_t *veh = calloc(nvehicles, sizeof(*veh));
+    load_conn_t *conns = calloc(nconns, sizeof(*conns));
+    load_worker_t *workers = calloc(nthreads, sizeof(*workers));
+    pthread_t *tids = calloc(nthreads, sizeof(*tids));
+    if (!veh || !conns || !workers || !tids) {
+        fprintf(stderr, "[ERR] out of memory\n");
+        return 1;
+    }
+
+    fprintf(stderr, "[LOAD] %u vehicles x %.1f Hz over %u connections to %s, %u threads\n",
+            nvehicles, rate_hz, nconns, addr->uri, nthreads);
+
+    // Spread first deadlines over one period so the fleet does not burst
+    uint64_t start = pacer_now_ns();
+    for (unsigned i = 0; i < nvehicles; i++) {
+        vehicle_init(&veh[i], i);
+        pacer_init(&veh[i].pace, period_ns, o->catchup, o->max_burst);
+        veh[i].pace.next_ns = start + period_ns * i / nvehicles;
+    }
+
+    size_t connected = 0, connecting = 0;
+    for (unsigned c = 0; c < nconns && g_running; c++) {
+        size_t lo = (size_t)nvehicles * c / nconns, hi = (size_t)nvehicles * (c + 1) / nconns;
+        load_conn_t *lc = &conns[c];
+
+        lc->id = c;
+        lc->veh = veh + lo;
+        lc->nveh = hi - lo;
+        telemetry_delta_enc_init(&lc->delta, o->delta_key);
+        lc->out_cap = (lc->nveh + o->batch_frames) * frame_size * 4;
+        if (lc->out_cap < LOAD_MIN_OUTBUF) lc->out_cap = LOAD_MIN_OUTBUF;
+        lc->out = malloc(lc->out_cap);
+        if (o->proto == 2) {
+            lc->echo = malloc(sizeof(*lc->echo));
+            if (lc->echo) echo_rx_init(lc->echo);
+        }
+        if (!lc->out || (o->proto == 2 && !lc->echo)) {
+            fprintf(stderr, "[ERR] out of memory\n");
+            return 1;
+        }
+
+        load_connect(lc, addr, pacer_now_ns());
+        if (lc->connecting) connecting++;
+        else if (lc->fd >= 0) connected++;
+    }
+    fprintf(stderr, "[LOAD] %zu/%u connections up, %zu connecting\n", connected, nconns, connecting);
+
+    for (unsigned t = 0; t < nthreads; t++) {
+        size_t lo = (size_t)nconns * t / nthreads, hi = (size_t)nconns * (t + 1) / nthreads;
+        workers[t].addr = addr;
+        workers[t].opts = o;
+        workers[t].conns = conns + lo;
+        workers[t].nconns = hi - lo;
+        lat_hist_init(&workers[t].jitter);
+        lat_hist_init(&workers[t].send_lat);
+        lat_hist_init(&workers[t].rtt);
+        workers[t].epfd = epoll_create1(EPOLL_CLOEXEC);
+        workers[t].tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (workers[t].epfd < 0 || workers[t].tfd < 0) {
+            perror("[ERR] epoll/timerfd");
+            return 1;
+        }
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+        epoll_ctl(workers[t].epfd, EPOLL_CTL_ADD, workers[t].tfd, &ev);
+        for (size_t i = 0; i < workers[t].nconns; i++) {
+            load_conn_t *lc = &workers[t].conns[i];
+            if (lc->fd >= 0) load_watch(&workers[t], lc, EPOLL_CTL_ADD);
+        }
+        pthread_create(&tids[t], NULL, load_worker, &workers[t]);
+    }
+
+    double target = nvehicles * rate_hz;
+    uint64_t t0 = pacer_now_ns(), last = t0;
+    unsigned long last_frames = 0, last_dropped = 0, last_stalls = 0;
+    lat_hist_t rtt, rtt_prev;
+    lat_hist_init(&rtt_prev);
+
+    while (g_running) {
+        msleep(1000);
+
+        if (g_dump_stats) {
+            g_dump_stats = 0;
+            load_print_pacing(workers, nthreads, veh, nvehicles);
+        }
+
+        unsigned long frames = 0, dropped = 0, stalls = 0;
+        for (unsigned t = 0; t < nthreads; t++) {
+            frames += atomic_load_explicit(&workers[t].frames, memory_order_relaxed);
+            dropped += atomic_load_explicit(&workers[t].dropped, memory_order_relaxed);
+            stalls += atomic_load_explicit(&workers[t].stalls, memory_order_relaxed);
+        }
+
+        // Echo RTT over the last second only
+        lat_hist_t iv;
+        lat_hist_init(&rtt);
+        for (unsigned t = 0; t < nthreads; t++) lat_hist_merge(&rtt, &workers[t].rtt);
+        lat_hist_since(&iv, &rtt, &rtt_prev);
+        rtt_prev = rtt;
+        char rtt_str[64] = "";
+        if (iv.samples) {
+            snprintf(rtt_str, sizeof(rtt_str), "  rtt p50 %.2f p99 %.2f ms",
+                     lat_hist_quantile(&iv, 0.50) / 1e6, lat_hist_quantile(&iv, 0.99) / 1e6);
+        }
+
+        uint64_t now = pacer_now_ns();
+        double dt = (now - last) / 1e9;
+        fprintf(stderr, "[LOAD] %6.0f s  %9.0f frames/s (%.1f%%)  stalls +%lu  dropped +%lu%s\n",
+                (now - t0) / 1e9, (frames - last_frames) / dt,
+                100.0 * (frames - last_frames) / dt / target,
+                stalls - last_stalls, dropped - last_dropped, rtt_str);
+        last = now;
+        last_frames = frames;
+        last_dropped = dropped;
+        last_stalls = stalls;
+
+        if (duration_s > 0 && (now - t0) / 1e9 >= duration_s) g_running = false;
+    }
+
+    for (unsigned t = 0; t < nthreads; t++) pthread_join(tids[t], NULL);
+
+    load_report(conns, nconns, (pacer_now_ns() - t0) / 1e9, target);
+    load_print_pacing(workers, nthreads, veh, nvehicles);
+
+    unsigned long echoed = 0, unmatched = 0;
+    lat_hist_init(&rtt);
+    for (unsigned t = 0; t < nthreads; t++) {
+        lat_hist_merge(&rtt, &workers[t].rtt);
+        if (workers[t].epfd >= 0) close(workers[t].epfd);
+        if (workers[t].tfd >= 0) close(workers[t].tfd);
+    }
+    for (unsigned c = 0; c < nconns; c++) {
+        if (conns[c].echo) {
+            echoed += conns[c].echo->echoed;
+            unmatched += conns[c].echo->unmatched;
+        }
+    }
+    if (rtt.samples) print_rtt("[LOAD] echo RTT", &rtt, echoed, unmatched);
+
+    for (unsigned c = 0; c < nconns; c++) {
+        if (conns[c].fd >= 0) close(conns[c].fd);
+        free(conns[c].out);
+        free(conns[c].echo);
+    }
+    free(conns);
+    free(veh);
+    free(workers);
+    free(tids);
     return 0;
 }
 
@@ -379,25 +1479,151 @@ static int run_client(const char *mac_addr,
 int main(int argc, char **argv)
 {
     const char *mac = NULL;
+    const char *uri = NULL;
     uint8_t channel = 1;
-    unsigned interval_ms = 150;
-    bool verbose = false;
+    client_opts_t opts = {
+        .interval_ms = 150,
+        .proto = 2,
+        .catchup = PACER_SKIP,
+        .max_burst = 0,
+        .verbose = false,
+        .batch_frames = 1,
+        .batch_us = 0,
+        .spool_frames = 4096,
+        .spool_file = NULL,
+        .spool_file_frames = 1u << 20,
+        .replay_rate = 100,
+        .backoff_min_ms = 200,
+        .backoff_max_ms = 10000,
+        .report_s = 10,
+        .adapt_min_ms = 0,
+        .adapt_max_ms = 0,
+        .target_delay_ms = 50,
+    };
+    unsigned vehicles = 0;
+    double rate_hz = 10.0;
+    unsigned nconns = 0;
+    unsigned nthreads = 4;
+    double duration_s = 0;
 
     for (int i=1; i<argc; i++) {
         if (!strcmp(argv[i], "--addr") && i+1 < argc) {
             mac = argv[++i];
+        } else if (!strcmp(argv[i], "--uri") && i+1 < argc) {
+            uri = argv[++i];
         } else if (!strcmp(argv[i], "--channel") && i+1 < argc) {
             channel = (uint8_t)atoi(argv[++i]);
         } else if (!strcmp(argv[i], "--interval-ms") && i+1 < argc) {
-            interval_ms = (unsigned)atoi(argv[++i]);
+            opts.interval_ms = (unsigned)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--proto") && i+1 < argc) {
+            opts.proto = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--delta") && i+1 < argc) {
+            opts.delta_key = (unsigned)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--report-s") && i+1 < argc) {
+            opts.report_s = (unsigned)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--adaptive") && i+1 < argc) {
+            if (sscanf(argv[++i], "%u:%u", &opts.adapt_min_ms, &opts.adapt_max_ms) != 2) {
+                fprintf(stderr, "[ERR] --adaptive MIN_MS:MAX_MS\n");
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--target-delay-ms") && i+1 < argc) {
+            opts.target_delay_ms = (unsigned)atoi(argv[++i]);
         } else if (!strcmp(argv[i], "--verbose")) {
-            verbose = true;
+            opts.verbose = true;
+        } else if (!strcmp(argv[i], "--vehicles") && i+1 < argc) {
+            vehicles = (unsigned)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--rate") && i+1 < argc) {
+            rate_hz = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--conns") && i+1 < argc) {
+            nconns = (unsigned)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads") && i+1 < argc) {
+            nthreads = (unsigned)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--duration") && i+1 < argc) {
+            duration_s = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--catchup") && i+1 < argc) {
+            const char *pol = argv[++i];
+            if (!strcmp(pol, "skip")) {
+                opts.catchup = PACER_SKIP;
+            } else if (!strcmp(pol, "burst")) {
+                opts.catchup = PACER_BURST;
+            } else {
+                fprintf(stderr, "[ERR] --catchup skip|burst\n");
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--max-burst") && i+1 < argc) {
+            opts.max_burst = (unsigned)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--batch-frames") && i+1 < argc) {
+            opts.batch_frames = (unsigned)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--batch-us") && i+1 < argc) {
+            opts.batch_us = (unsigned)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--spool-frames") && i+1 < argc) {
+            opts.spool_frames = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--spool-file") && i+1 < argc) {
+            opts.spool_file = argv[++i];
+        } else if (!strcmp(argv[i], "--spool-file-frames") && i+1 < argc) {
+            opts.spool_file_frames = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--replay-rate") && i+1 < argc) {
+            opts.replay_rate = (unsigned)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--backoff-max-ms") && i+1 < argc) {
+            opts.backoff_max_ms = (unsigned)atoi(argv[++i]);
         } else if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h")) {
             fprintf(stderr,
                 "Usage:\n"
                 "  sudo %s --addr AA:BB:CC:DD:EE:FF "
-                "[--channel 1] [--interval-ms 150] [--verbose]\n",
-                argv[0]);
+                "[--channel 1] [--interval-ms 150] [--verbose]\n"
+                "  %s --uri URI [--interval-ms 150] [--verbose]\n"
+                "  %s --uri URI --vehicles N [--rate 10] [--conns N] "
+                "[--threads 4] [--duration SEC]\n"
+                "\n"
+                "Pacing: [--catchup skip|burst] [--max-burst 4]\n"
+                "  Sends follow an absolute deadline grid. After an overrun,\n"
+                "  'skip' drops the missed deadlines, 'burst' sends up to\n"
+                "  --max-burst of them back to back. Jitter and send() latency\n"
+                "  histograms are printed on exit and on SIGUSR1.\n"
+                "\n"
+                "Batching: [--batch-frames 1] [--batch-us 0]\n"
+                "  Queue frames and flush them with one send() once K are\n"
+                "  queued or the oldest is T us old. Adds up to T us (or\n"
+                "  K-1 periods) of latency, saves K-1 syscalls per K frames.\n"
+                "\n"
+                "Outages: [--spool-frames 4096] [--spool-file PATH]\n"
+                "         [--spool-file-frames 1048576] [--replay-rate 100]\n"
+                "         [--backoff-max-ms 10000]\n"
+                "  Frames produced while disconnected are kept (memory first,\n"
+                "  then the mmap'd file; oldest dropped when full) and replayed\n"
+                "  at --replay-rate frames/s after reconnecting, before the\n"
+                "  fresh frame of each tick. Reconnects back off exponentially\n"
+                "  from 200 ms with jitter.\n"
+                "\n"
+                "Protocol: [--proto 2] [--delta N]\n"
+                "  2 sends frames with a sequence number, send timestamp and\n"
+                "  CRC-32C, so the server can show loss, reordering and latency.\n"
+                "  1 sends the original 11-byte frame for old receivers.\n"
+                "  --delta sends a full keyframe every N frames and only the\n"
+                "  changed fields in between (v2 only, N <= 255).\n"
+                "\n"
+                "Echo RTT: [--report-s 10]\n"
+                "  Against a server in echo mode (-e), echoed v2 frames are\n"
+                "  matched by sequence number and timed on arrival. The RTT\n"
+                "  histogram is printed every --report-s seconds (0 = only on\n"
+                "  exit and SIGUSR1); load mode adds p50/p99 to its 1 s line.\n"
+                "\n"
+                "Adaptive rate: [--adaptive MIN_MS:MAX_MS] [--target-delay-ms 50]\n"
+                "  Starts at --interval-ms and moves the period within the\n"
+                "  bounds so that frames wait no longer than the target in\n"
+                "  the send queue (TIOCOUTQ) or, with an echo server, on top\n"
+                "  of the base RTT: 1.5x slower while the delay grows past\n"
+                "  the target, a step faster while it is under half of it.\n"
+                "  Decisions are printed with --report-s, on exit and on\n"
+                "  SIGUSR1; --verbose logs every change. Single client only.\n"
+                "\n"
+                "URI: rfcomm://AA:BB:CC:DD:EE:FF/1, tcp://HOST:PORT,\n"
+                "     unix:///path/to.sock, pty:///path/to/pty\n"
+                "\n"
+                "--vehicles runs a load generator: N independent simulated\n"
+                "vehicles, each sending --rate frames/s, spread over --conns\n"
+                "connections (default one per vehicle) and --threads workers.\n",
+                argv[0], argv[0], argv[0]);
             return 0;
         } else {
             fprintf(stderr, "Unknown arg: %s\n", argv[i]);
@@ -405,15 +1631,68 @@ int main(int argc, char **argv)
         }
     }
 
-    if (!mac) {
-        fprintf(stderr, "[ERR] --addr <MAC> wajib.\n");
+    if (!mac && !uri) {
+        fprintf(stderr, "[ERR] --addr <MAC> atau --uri <URI> wajib.\n");
+        return 1;
+    }
+
+    if (opts.proto != 1 && opts.proto != 2) {
+        fprintf(stderr, "[ERR] --proto 1|2.\n");
+        return 1;
+    }
+    if (opts.delta_key && (opts.proto != 2 || opts.delta_key > TELEM_DELTA_MAX_KEY_INTERVAL)) {
+        fprintf(stderr, "[ERR] --delta 1..%d, hanya dengan --proto 2.\n",
+                TELEM_DELTA_MAX_KEY_INTERVAL);
+        return 1;
+    }
+    if (opts.batch_frames < 1 || opts.batch_frames > TX_BATCH_MAX_FRAMES) {
+        fprintf(stderr, "[ERR] --batch-frames 1..%d.\n", TX_BATCH_MAX_FRAMES);
+        return 1;
+    }
+    if (opts.spool_frames == 0) {
+        fprintf(stderr, "[ERR] --spool-frames harus > 0.\n");
+        return 1;
+    }
+    if (opts.backoff_max_ms < opts.backoff_min_ms) opts.backoff_max_ms = opts.backoff_min_ms;
+
+    if (opts.adapt_max_ms && (opts.adapt_min_ms == 0 || opts.adapt_min_ms > opts.adapt_max_ms ||
+                              opts.target_delay_ms == 0 || vehicles)) {
+        fprintf(stderr, "[ERR] --adaptive MIN:MAX dengan 0 < MIN <= MAX, --target-delay-ms > 0, "
+                "tanpa --vehicles.\n");
+        return 1;
+    }
+
+    if (opts.batch_frames > 1 && opts.batch_us == 0) {
+        opts.batch_us = 1000000;    // still bound the wait on a slow stream
+    }
+
+    if (vehicles && rate_hz <= 0) {
+        fprintf(stderr, "[ERR] --rate harus > 0.\n");
+        return 1;
+    }
+
+    char rfcomm_uri[64];
+    if (!uri) {
+        snprintf(rfcomm_uri, sizeof(rfcomm_uri), "rfcomm://%s/%u", mac, channel);
+        uri = rfcomm_uri;
+    }
+
+    transport_addr_t addr;
+    if (transport_parse(uri, &addr) < 0) {
+        fprintf(stderr, "[ERR] Invalid URI: %s\n", uri);
         return 1;
     }
 
     signal(SIGINT, handle_sigint);
     signal(SIGTERM, handle_sigint);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGUSR1, handle_sigusr1);
+
+    if (vehicles) {
+        return run_load(&addr, vehicles, rate_hz, nconns, nthreads, duration_s, &opts);
+    }
 
-    return run_client(mac, channel, interval_ms, verbose);
+    return run_client(&addr, &opts);
 }
 
 // #include <stdio.h>
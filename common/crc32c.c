@@ -0,0 +1,65 @@
+/*
+ * crc32c.c - CRC-32C (Castagnoli) for frame checksums
+ */
+
+#include "crc32c.h"
+
+#include <string.h>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#define CRC32C_IMPL "sse4.2"
+#else
+#define CRC32C_IMPL "table"
+#endif
+
+const char *crc32c_impl(void)
+{
+    return CRC32C_IMPL;
+}
+
+#if defined(__SSE4_2__)
+
+uint32_t crc32c(const void *buf, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    uint64_t crc = 0xFFFFFFFFu;
+
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        crc = _mm_crc32_u64(crc, w);
+    }
+    uint32_t c = (uint32_t)crc;
+    for (; len > 0; p++, len--) {
+        c = _mm_crc32_u8(c, *p);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+#else
+
+/* Reflected polynomial 0x82F63B78; the table is built by the compiler. */
+#define POLY 0x82F63B78u
+#define B1(c) (((c) >> 1) ^ (((c) & 1) ? POLY : 0))
+#define B8(c) B1(B1(B1(B1(B1(B1(B1(B1((uint32_t)(c)))))))))
+#define R4(n)  B8(n), B8((n) + 1), B8((n) + 2), B8((n) + 3)
+#define R16(n) R4(n), R4((n) + 4), R4((n) + 8), R4((n) + 12)
+#define R64(n) R16(n), R16((n) + 16), R16((n) + 32), R16((n) + 48)
+
+static const uint32_t crc_table[256] = {
+    R64(0), R64(64), R64(128), R64(192)
+};
+
+uint32_t crc32c(const void *buf, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    uint32_t c = 0xFFFFFFFFu;
+
+    while (len--) {
+        c = crc_table[(c ^ *p++) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+#endif
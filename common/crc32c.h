@@ -0,0 +1,29 @@
+/*
+ * crc32c.h - CRC-32C (Castagnoli) for frame checksums
+ *
+ * Uses the SSE4.2 crc32 instruction when built with -msse4.2 (or
+ * -march=native on any x86 from the last 15 years), a byte-wise table
+ * otherwise. Both give identical results.
+ */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* CRC-32C of buf (initial value and final xor 0xFFFFFFFF). */
+uint32_t crc32c(const void *buf, size_t len);
+
+/* "sse4.2" or "table" */
+const char *crc32c_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRC32C_H
@@ -0,0 +1,137 @@
+/*
+ * ctrl_msg.c - Typed control messages and per-type frame dispatch
+ */
+
+#include "ctrl_msg.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CTRL_CFG_SIZE 5         // key u8, value u32
+
+static const struct {
+    uint8_t key;
+    const char *name;
+} cfg_names[] = {
+    {CTRL_CFG_INTERVAL_MS, "interval_ms"},
+    {CTRL_CFG_DELTA_KEY,   "delta"},
+};
+
+TELEM_STATIC_ASSERT(FRAME_V2_OVERHEAD + CTRL_CFG_MAX * CTRL_CFG_SIZE <= FRAME_MAX_SIZE,
+                    "CONFIG_SET does not fit a frame");
+
+size_t ctrl_encode_ping(uint32_t id, uint64_t ts_us, uint8_t *out)
+{
+    static const uint8_t none[1];
+    return frame_v2_encode(FRAME_TYPE_PING, id, ts_us, none, 0, out);
+}
+
+size_t ctrl_encode_pong(const frame_meta_t *ping, uint64_t now_us, uint8_t *out)
+{
+    uint8_t body[8];
+    telem_store_le64(body, now_us);
+    return frame_v2_encode(FRAME_TYPE_PONG, ping->seq, ping->ts_us, body, sizeof(body), out);
+}
+
+size_t ctrl_encode_config(uint32_t id, uint64_t ts_us, const ctrl_cfg_t *cfg, size_t n,
+                          uint8_t *out)
+{
+    uint8_t body[CTRL_CFG_MAX * CTRL_CFG_SIZE];
+    if (n > CTRL_CFG_MAX) n = CTRL_CFG_MAX;
+    for (size_t i = 0; i < n; i++) {
+        body[i * CTRL_CFG_SIZE] = cfg[i].key;
+        telem_store_le32(body + i * CTRL_CFG_SIZE + 1, cfg[i].value);
+    }
+    return frame_v2_encode(FRAME_TYPE_CONFIG_SET, id, ts_us, body, n * CTRL_CFG_SIZE, out);
+}
+
+size_t ctrl_encode_ack(uint32_t id, uint64_t ts_us, uint8_t acked_type, uint8_t status,
+                       uint8_t key, uint8_t *out)
+{
+    const uint8_t body[3] = {acked_type, status, key};
+    return frame_v2_encode(FRAME_TYPE_ACK, id, ts_us, body, sizeof(body), out);
+}
+
+int ctrl_decode(const uint8_t *frame, size_t len, ctrl_msg_t *m)
+{
+    const uint8_t *body;
+    size_t body_len;
+    int ret = frame_v2_decode(frame, len, &m->meta, &body, &body_len);
+    if (ret < 0) return ret;
+    if (m->meta.short_hdr || !FRAME_TYPE_IS_CTRL(m->meta.type)) return -7;
+
+    switch (m->meta.type) {
+    case FRAME_TYPE_PING:
+        return 0;
+    case FRAME_TYPE_PONG:
+        if (body_len != 8) return -3;
+        m->peer_ts_us = telem_load_le64(body);
+        return 0;
+    case FRAME_TYPE_CONFIG_SET:
+        if (body_len == 0 || body_len % CTRL_CFG_SIZE || body_len / CTRL_CFG_SIZE > CTRL_CFG_MAX) {
+            return -3;
+        }
+        m->ncfg = body_len / CTRL_CFG_SIZE;
+        for (size_t i = 0; i < m->ncfg; i++) {
+            m->cfg[i].key = body[i * CTRL_CFG_SIZE];
+            m->cfg[i].value = telem_load_le32(body + i * CTRL_CFG_SIZE + 1);
+        }
+        return 0;
+    case FRAME_TYPE_ACK:
+        if (body_len != 3) return -3;
+        m->acked_type = body[0];
+        m->status = body[1];
+        m->key = body[2];
+        return 0;
+    default:
+        // A newer control type; the envelope is fine, the content unknown
+        return -7;
+    }
+}
+
+int ctrl_cfg_parse(const char *s, ctrl_cfg_t *cfg, size_t max)
+{
+    size_t n = 0;
+
+    while (*s) {
+        const char *eq = strchr(s, '=');
+        if (!eq || n >= max) return -1;
+
+        size_t klen = (size_t)(eq - s), k;
+        for (k = 0; k < sizeof(cfg_names) / sizeof(cfg_names[0]); k++) {
+            if (strlen(cfg_names[k].name) == klen && !strncmp(s, cfg_names[k].name, klen)) break;
+        }
+        if (k == sizeof(cfg_names) / sizeof(cfg_names[0])) return -1;
+
+        char *end;
+        errno = 0;
+        unsigned long v = strtoul(eq + 1, &end, 10);
+        if (end == eq + 1 || errno || v > UINT32_MAX || (*end && *end != ',')) return -1;
+
+        cfg[n].key = cfg_names[k].key;
+        cfg[n].value = (uint32_t)v;
+        n++;
+        s = *end ? end + 1 : end;
+    }
+    return (int)n;
+}
+
+const char *ctrl_cfg_name(uint8_t key)
+{
+    for (size_t k = 0; k < sizeof(cfg_names) / sizeof(cfg_names[0]); k++) {
+        if (cfg_names[k].key == key) return cfg_names[k].name;
+    }
+    return "?";
+}
+
+const char *ctrl_ack_status_str(uint8_t status)
+{
+    switch (status) {
+    case CTRL_ACK_OK:          return "ok";
+    case CTRL_ACK_UNKNOWN_KEY: return "unknown key";
+    case CTRL_ACK_BAD_VALUE:   return "bad value";
+    case CTRL_ACK_UNSUPPORTED: return "not supported";
+    default:                   return "?";
+    }
+}
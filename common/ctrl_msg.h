@@ -0,0 +1,109 @@
+/*
+ * ctrl_msg.h - Typed control messages and per-type frame dispatch
+ *
+ * Control messages are v2 frames of their own types, so they share the
+ * stream, the reassembler and the CRC with telemetry:
+ *
+ *   PING        seq = ping id, ts_us = sender time, no body
+ *   PONG        seq and ts_us copied from the ping; body = responder time u64
+ *   CONFIG_SET  seq = request id; body = 1..CTRL_CFG_MAX x (key u8, value u32)
+ *   ACK         seq = request id; body = acked type u8, status u8, key u8
+ *
+ * Control frames have a sequence space of their own and are not counted
+ * by link statistics. A v1 sender keeps using the bare FRAME_CTRL_PING byte,
+ * which nobody answers.
+ *
+ * Receivers look a handler up by type byte instead of trying every decoder
+ * in turn. A handler does its own decoding (and CRC check):
+ *
+ *     static const frame_dispatch_t table = {{
+ *         [FRAME_TYPE_TELEMETRY] = on_telemetry,
+ *         [FRAME_TYPE_DELTA]     = on_telemetry,
+ *         [FRAME_TYPE_PING]      = on_ping,
+ *     }};
+ *     frame_dispatch(&table, ctx, conn, frame, len);
+ */
+
+#ifndef CTRL_MSG_H
+#define CTRL_MSG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CTRL_CFG_MAX  8         // key/value pairs per CONFIG_SET
+
+/* CONFIG_SET keys */
+#define CTRL_CFG_INTERVAL_MS  0x01  // send period, ms
+#define CTRL_CFG_DELTA_KEY    0x02  // keyframe every N frames, 0 = no deltas
+
+/* ACK status */
+#define CTRL_ACK_OK           0
+#define CTRL_ACK_UNKNOWN_KEY  1
+#define CTRL_ACK_BAD_VALUE    2
+#define CTRL_ACK_UNSUPPORTED  3     // receiver takes no settings
+
+typedef struct {
+    uint8_t key;
+    uint32_t value;
+} ctrl_cfg_t;
+
+typedef struct {
+    frame_meta_t meta;
+    uint64_t peer_ts_us;            // PONG: responder's clock
+    ctrl_cfg_t cfg[CTRL_CFG_MAX];   // CONFIG_SET
+    size_t ncfg;
+    uint8_t acked_type;             // ACK
+    uint8_t status;
+    uint8_t key;                    // ACK: first key that failed, 0 if none
+} ctrl_msg_t;
+
+/* Handler for one frame type. ctx and conn are the caller's. Returns
+ * whatever the handler's decoder returned (0 on success). */
+typedef int (*frame_handler_fn)(void *ctx, void *conn, const uint8_t *frame, size_t len);
+
+typedef struct {
+    frame_handler_fn fn[256];
+} frame_dispatch_t;
+
+/* Call the handler for the frame's type. Returns its result, or -7 if the
+ * table has none. */
+static inline int frame_dispatch(const frame_dispatch_t *d, void *ctx, void *conn,
+                                 const uint8_t *frame, size_t len)
+{
+    if (len < 4) return -1;
+    frame_handler_fn fn = d->fn[frame_type(frame)];
+    return fn ? fn(ctx, conn, frame, len) : -7;
+}
+
+/* Encoders return the frame length; out needs FRAME_MAX_SIZE bytes. */
+size_t ctrl_encode_ping(uint32_t id, uint64_t ts_us, uint8_t *out);
+size_t ctrl_encode_pong(const frame_meta_t *ping, uint64_t now_us, uint8_t *out);
+/* n is clamped to CTRL_CFG_MAX. */
+size_t ctrl_encode_config(uint32_t id, uint64_t ts_us, const ctrl_cfg_t *cfg, size_t n,
+                          uint8_t *out);
+size_t ctrl_encode_ack(uint32_t id, uint64_t ts_us, uint8_t acked_type, uint8_t status,
+                       uint8_t key, uint8_t *out);
+
+/* Decode any control frame. Returns 0, the frame_v2_decode() codes,
+ * -3 for a body that does not fit its type, or -7 for a non-control type. */
+int ctrl_decode(const uint8_t *frame, size_t len, ctrl_msg_t *m);
+
+/* "interval_ms=100,delta=10" -> pairs. Returns the count, or -1 for an
+ * unknown key, a bad number or more than max pairs. */
+int ctrl_cfg_parse(const char *s, ctrl_cfg_t *cfg, size_t max);
+
+/* Printable names; "?" for unknown values. */
+const char *ctrl_cfg_name(uint8_t key);
+const char *ctrl_ack_status_str(uint8_t status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CTRL_MSG_H
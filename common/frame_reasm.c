@@ -0,0 +1,137 @@
+/*
+ * frame_reasm.c - Streaming reassembler for 0xCE telemetry frames
+ */
+
+#include "frame_reasm.h"
+
+#include <string.h>
+
+#define RING_MASK (FRAME_REASM_CAP - 1)
+
+#if (FRAME_REASM_CAP & RING_MASK) != 0
+#error "FRAME_REASM_CAP must be a power of two"
+#endif
+
+static inline uint8_t ring_at(const frame_reasm_t *r, size_t pos)
+{
+    return r->ring[pos & RING_MASK];
+}
+
+void frame_reasm_init(frame_reasm_t *r)
+{
+    r->head = 0;
+    r->tail = 0;
+    r->frames = 0;
+    r->resync_bytes = 0;
+    r->control_bytes = 0;
+    r->crc_errors = 0;
+}
+
+size_t frame_reasm_push(frame_reasm_t *r, const uint8_t *data, size_t len)
+{
+    size_t space = FRAME_REASM_CAP - (r->tail - r->head);
+    if (len > space) len = space;
+
+    // At most two memcpy: up to the end of the ring, then from the start
+    size_t off = r->tail & RING_MASK;
+    size_t first = FRAME_REASM_CAP - off;
+    if (first > len) first = len;
+
+    memcpy(r->ring + off, data, first);
+    memcpy(r->ring, data + first, len - first);
+    r->tail += len;
+
+    return len;
+}
+
+/* Skip bytes up to the next start marker. Keepalive bytes are counted
+ * separately from real garbage so the stats show true corruption. */
+static void skip_to_start(frame_reasm_t *r)
+{
+    while (r->head != r->tail) {
+        size_t off = r->head & RING_MASK;
+        size_t run = FRAME_REASM_CAP - off;
+        if (run > r->tail - r->head) run = r->tail - r->head;
+
+        const uint8_t *p = r->ring + off;
+        const uint8_t *hit = (const uint8_t *)memchr(p, FRAME_START, run);
+        size_t skipped = hit ? (size_t)(hit - p) : run;
+
+        for (size_t i = 0; i < skipped; i++) {
+            if (p[i] == FRAME_CTRL_PING) r->control_bytes++;
+            else r->resync_bytes++;
+        }
+        r->head += skipped;
+
+        if (hit) return;
+    }
+}
+
+/* Frame length implied by the header at head, 0 if it cannot start a
+ * frame, or (size_t)-1 if more bytes are needed to tell. */
+static size_t frame_len_at(const frame_reasm_t *r, size_t avail)
+{
+    uint8_t len = ring_at(r, r->head + 1);
+
+    if (len == FRAME_PAYLOAD) return FRAME_SIZE;
+    // Anything longer is v2: short frames fill the gap below FRAME_V2_MIN_LEN
+    if (len < FRAME_PAYLOAD || (size_t)len + 3 > FRAME_MAX_SIZE) return 0;
+    if (avail < 3) return (size_t)-1;
+    return ring_at(r, r->head + 2) == FRAME_V2 ? (size_t)len + 3 : 0;
+}
+
+int frame_reasm_next(frame_reasm_t *r, uint8_t out[FRAME_MAX_SIZE])
+{
+    for (;;) {
+        if (r->head != r->tail && ring_at(r, r->head) != FRAME_START) {
+            skip_to_start(r);
+        }
+
+        size_t avail = r->tail - r->head;
+        if (avail < 2) return 0;
+
+        // A start byte followed by an impossible header is data, not a frame
+        size_t flen = frame_len_at(r, avail);
+        if (flen == (size_t)-1) return 0;
+        if (flen == 0) {
+            r->head++;
+            r->resync_bytes++;
+            continue;
+        }
+
+        if (avail < flen) return 0;
+
+        if (ring_at(r, r->head + flen - 1) != FRAME_DELIM) {
+            r->head++;
+            r->resync_bytes++;
+            continue;
+        }
+
+        size_t off = r->head & RING_MASK;
+        size_t first = FRAME_REASM_CAP - off;
+        if (first >= flen) {
+            memcpy(out, r->ring + off, flen);
+        } else {
+            memcpy(out, r->ring + off, first);
+            memcpy(out + first, r->ring, flen - first);
+        }
+
+        // v2 carries a checksum: a frame that fails it is treated like any
+        // other false start, so a flipped byte cannot pass as data
+        if (flen != FRAME_SIZE) {
+            const uint8_t *body;
+            size_t body_len;
+            frame_meta_t meta;
+            if (frame_v2_decode(out, flen, &meta, &body, &body_len) != 0) {
+                r->head++;
+                r->resync_bytes++;
+                r->crc_errors++;
+                continue;
+            }
+        }
+
+        r->head += flen;
+        r->frames++;
+        return (int)flen;
+    }
+}
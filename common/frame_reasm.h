@@ -0,0 +1,67 @@
+/*
+ * frame_reasm.h - Streaming reassembler for 0xCE telemetry frames
+ *
+ * recv() on an RFCOMM/stream socket returns whatever the kernel has
+ * queued: several coalesced frames, a frame split in two, or a stray
+ * 0xFF keepalive in front of the next frame. The reassembler keeps a
+ * per-connection ring buffer, resynchronises on 0xCE/len/'\n' and hands
+ * out every complete frame, one at a time. v1 (11-byte) and v2
+ * (variable-length, CRC-checked) frames may be mixed on one stream.
+ *
+ * Typical use:
+ *
+ *     size_t off = 0;
+ *     while (off < n) {
+ *         off += frame_reasm_push(&r, buf + off, n - off);
+ *         while (frame_reasm_next(&r, frame) > 0)
+ *             handle(frame);
+ *     }
+ */
+
+#ifndef FRAME_REASM_H
+#define FRAME_REASM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAME_REASM_CAP  4096   // ring capacity, must be a power of two
+
+typedef struct {
+    uint8_t ring[FRAME_REASM_CAP];
+    size_t head;                    // read position (free-running)
+    size_t tail;                    // write position (free-running)
+
+    unsigned long frames;           // complete frames handed out
+    unsigned long resync_bytes;     // garbage skipped while hunting for a frame
+    unsigned long control_bytes;    // keepalive bytes skipped between frames
+    unsigned long crc_errors;       // v2 frames rejected by their checksum
+} frame_reasm_t;
+
+void frame_reasm_init(frame_reasm_t *r);
+
+/* Copy as much of data[0..len) into the ring as fits.
+ * Returns the number of bytes consumed; drain with frame_reasm_next()
+ * and push the remainder if it is less than len. */
+size_t frame_reasm_push(frame_reasm_t *r, const uint8_t *data, size_t len);
+
+/* Extract the next complete frame into out.
+ * Returns its length if a frame was written, 0 if more input is needed. */
+int frame_reasm_next(frame_reasm_t *r, uint8_t out[FRAME_MAX_SIZE]);
+
+/* Bytes currently buffered (partial frame or not yet scanned). */
+static inline size_t frame_reasm_pending(const frame_reasm_t *r)
+{
+    return r->tail - r->head;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_REASM_H
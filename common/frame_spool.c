@@ -0,0 +1,182 @@
+/*
+ * frame_spool.c - Bounded store-and-forward queue for frames
+ */
+
+#define _GNU_SOURCE
+#include "frame_spool.h"
+#include "telemetry_codec.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define SPOOL_MAGIC "TSPOOL1"
+
+struct frame_spool_file {
+    char magic[8];
+    uint32_t slot;
+    uint32_t reserved;
+    uint64_t cap;
+    uint64_t head;                  // free-running, like the memory ring
+    uint64_t tail;
+    uint8_t pad[24];                // header is one 64-byte line
+};
+
+TELEM_STATIC_ASSERT(sizeof(struct frame_spool_file) == 64, "spill header must be 64 bytes");
+
+static int open_spill(frame_spool_t *sp, const char *path, size_t frames)
+{
+    size_t len = sizeof(frame_spool_file_t) + frames * FRAME_SPOOL_SLOT;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+
+    // Reuse a previous run's spill only if it has the same geometry
+    frame_spool_file_t old;
+    int reuse = pread(fd, &old, sizeof(old), 0) == (ssize_t)sizeof(old) &&
+                memcmp(old.magic, SPOOL_MAGIC, sizeof(old.magic)) == 0 &&
+                old.slot == FRAME_SPOOL_SLOT && old.cap == frames &&
+                old.tail >= old.head && old.tail - old.head <= frames;
+
+    if (ftruncate(fd, (off_t)len) < 0) goto fail;
+
+    void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) goto fail;
+
+    sp->fd = fd;
+    sp->map_len = len;
+    sp->file = (frame_spool_file_t *)map;
+    sp->spill = (uint8_t *)map + sizeof(frame_spool_file_t);
+
+    if (reuse) {
+        sp->recovered = (unsigned long)(sp->file->tail - sp->file->head);
+    } else {
+        memset(sp->file, 0, sizeof(*sp->file));
+        memcpy(sp->file->magic, SPOOL_MAGIC, sizeof(sp->file->magic));
+        sp->file->slot = FRAME_SPOOL_SLOT;
+        sp->file->cap = frames;
+    }
+    return 0;
+
+fail:;
+    int err = errno;
+    close(fd);
+    errno = err;
+    return -1;
+}
+
+int frame_spool_init(frame_spool_t *sp, size_t mem_frames,
+                     const char *spill_path, size_t spill_frames)
+{
+    memset(sp, 0, sizeof(*sp));
+    sp->fd = -1;
+
+    if (mem_frames == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    sp->mem = malloc(mem_frames * FRAME_SPOOL_SLOT);
+    if (!sp->mem) return -1;
+    sp->mem_cap = mem_frames;
+
+    if (spill_path && spill_frames > 0 && open_spill(sp, spill_path, spill_frames) < 0) {
+        int err = errno;
+        free(sp->mem);
+        sp->mem = NULL;
+        errno = err;
+        return -1;
+    }
+
+    return 0;
+}
+
+static inline uint8_t *mem_slot(const frame_spool_t *sp, uint64_t pos)
+{
+    return sp->mem + (pos % sp->mem_cap) * FRAME_SPOOL_SLOT;
+}
+
+static inline uint8_t *spill_slot(const frame_spool_t *sp, uint64_t pos)
+{
+    return sp->spill + (pos % sp->file->cap) * FRAME_SPOOL_SLOT;
+}
+
+int frame_spool_put(frame_spool_t *sp, const uint8_t *frame, size_t len)
+{
+    if (len == 0 || len > FRAME_SPOOL_MAX_FRAME) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (sp->mem_tail - sp->mem_head == sp->mem_cap) {
+        if (sp->file) {
+            frame_spool_file_t *f = sp->file;
+            if (f->tail - f->head == f->cap) {
+                f->head++;
+                sp->dropped++;
+            }
+            memcpy(spill_slot(sp, f->tail), mem_slot(sp, sp->mem_head), FRAME_SPOOL_SLOT);
+            f->tail++;
+            sp->spilled++;
+        } else {
+            sp->dropped++;
+        }
+        sp->mem_head++;
+    }
+
+    uint8_t *slot = mem_slot(sp, sp->mem_tail++);
+    slot[0] = (uint8_t)len;
+    memcpy(slot + 1, frame, len);
+    sp->buffered++;
+    return 0;
+}
+
+/* Everything in the file is older than everything in memory. */
+static const uint8_t *oldest(const frame_spool_t *sp)
+{
+    if (sp->file && sp->file->tail != sp->file->head) return spill_slot(sp, sp->file->head);
+    if (sp->mem_tail != sp->mem_head) return mem_slot(sp, sp->mem_head);
+    return NULL;
+}
+
+size_t frame_spool_peek(const frame_spool_t *sp, uint8_t out[FRAME_SPOOL_MAX_FRAME])
+{
+    const uint8_t *slot = oldest(sp);
+    if (!slot) return 0;
+
+    size_t len = slot[0];
+    if (len > FRAME_SPOOL_MAX_FRAME) len = FRAME_SPOOL_MAX_FRAME;    // damaged file
+    memcpy(out, slot + 1, len);
+    return len;
+}
+
+void frame_spool_pop(frame_spool_t *sp)
+{
+    if (sp->file && sp->file->tail != sp->file->head) {
+        sp->file->head++;
+    } else if (sp->mem_tail != sp->mem_head) {
+        sp->mem_head++;
+    } else {
+        return;
+    }
+    sp->replayed++;
+}
+
+size_t frame_spool_count(const frame_spool_t *sp)
+{
+    size_t n = (size_t)(sp->mem_tail - sp->mem_head);
+    if (sp->file) n += (size_t)(sp->file->tail - sp->file->head);
+    return n;
+}
+
+void frame_spool_free(frame_spool_t *sp)
+{
+    if (sp->file) munmap(sp->file, sp->map_len);
+    if (sp->fd >= 0) close(sp->fd);
+    free(sp->mem);
+    memset(sp, 0, sizeof(*sp));
+    sp->fd = -1;
+}
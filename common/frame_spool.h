@@ -0,0 +1,78 @@
+/*
+ * frame_spool.h - Bounded store-and-forward queue for frames
+ *
+ * Holds frames produced while the link is down so they can be replayed
+ * after a reconnect. Oldest-first (FIFO) order is kept throughout:
+ *
+ *   - an in-memory ring of mem_frames slots takes every new frame;
+ *   - when it is full, its oldest frame moves to an optional spill file
+ *     (a ring mapped with mmap), so memory use stays fixed;
+ *   - when everything is full, the oldest frame is dropped: during a long
+ *     outage the newest data is the most valuable.
+ *
+ * The spill file is a plain ring with a small header. The mapping is
+ * shared, so frames in it survive a crash of the client; on the next
+ * start a file with a matching header is picked up again ("recovered").
+ *
+ * Each slot holds one frame of up to FRAME_SPOOL_MAX_FRAME bytes.
+ */
+
+#ifndef FRAME_SPOOL_H
+#define FRAME_SPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAME_SPOOL_SLOT      32                        // length byte + frame
+#define FRAME_SPOOL_MAX_FRAME (FRAME_SPOOL_SLOT - 1)
+
+typedef struct frame_spool_file frame_spool_file_t;    // mapped header
+
+typedef struct {
+    uint8_t *mem;                   // mem_cap slots
+    size_t mem_cap;
+    uint64_t mem_head, mem_tail;    // free-running
+
+    frame_spool_file_t *file;       // NULL without a spill file
+    uint8_t *spill;                 // slots after the header
+    size_t map_len;
+    int fd;
+
+    unsigned long buffered;         // frames put
+    unsigned long replayed;         // frames popped
+    unsigned long spilled;          // moved from memory to the file
+    unsigned long dropped;          // oldest frames overwritten
+    unsigned long recovered;        // found in the spill file at init
+} frame_spool_t;
+
+/* mem_frames > 0. spill_path may be NULL; otherwise the file is created
+ * (or reused when its header matches) with room for spill_frames.
+ * Returns 0, or -1 with errno set. */
+int frame_spool_init(frame_spool_t *sp, size_t mem_frames,
+                     const char *spill_path, size_t spill_frames);
+
+/* Queue a frame (len <= FRAME_SPOOL_MAX_FRAME), dropping the oldest one
+ * when full. Returns 0, or -1 (EINVAL) for an oversized frame. */
+int frame_spool_put(frame_spool_t *sp, const uint8_t *frame, size_t len);
+
+/* Copy the oldest frame to out without removing it.
+ * Returns its length, or 0 when the spool is empty. */
+size_t frame_spool_peek(const frame_spool_t *sp, uint8_t out[FRAME_SPOOL_MAX_FRAME]);
+
+/* Remove the oldest frame (after it was sent). */
+void frame_spool_pop(frame_spool_t *sp);
+
+size_t frame_spool_count(const frame_spool_t *sp);
+
+/* Unmap and close. Frames still in the spill file stay there. */
+void frame_spool_free(frame_spool_t *sp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_SPOOL_H
@@ -0,0 +1,202 @@
+/*
+ * hexfmt.c - Hex dump lines for the -x / hex-view modes
+ *
+ * SIMD layout: 16 input bytes become 48 output bytes, i.e. three 16-byte
+ * stores. The high and low nibbles are mapped to digits with one pshufb
+ * each and interleaved into two registers of digit pairs: a = bytes 0-7,
+ * b = bytes 8-15. Output byte k of store r (k + 16r = 3i + p) is digit p
+ * of input byte i, or a space for p == 2. out_a[r] / out_b[r] are the
+ * pshufb controls that pick those digits out of a and b; OR-ing both
+ * shuffles and the space pattern gives the store.
+ *
+ * The AVX2 path runs two blocks side by side, one per 128-bit lane, and
+ * swaps the lane halves back into order before storing.
+ */
+
+#include "hexfmt.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HEXFMT_IMPL "avx2"
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define HEXFMT_IMPL "ssse3"
+#else
+#define HEXFMT_IMPL "scalar"
+#endif
+
+#define DIGIT(n) ((char)((n) < 10 ? '0' + (n) : 'A' + (n) - 10))
+#define P(n) { DIGIT((n) >> 4), DIGIT((n) & 15) }
+#define P16(h) \
+    P(h * 16 + 0),  P(h * 16 + 1),  P(h * 16 + 2),  P(h * 16 + 3),  \
+    P(h * 16 + 4),  P(h * 16 + 5),  P(h * 16 + 6),  P(h * 16 + 7),  \
+    P(h * 16 + 8),  P(h * 16 + 9),  P(h * 16 + 10), P(h * 16 + 11), \
+    P(h * 16 + 12), P(h * 16 + 13), P(h * 16 + 14), P(h * 16 + 15)
+
+static const char hex_pair[256][2] = {
+    P16(0),  P16(1),  P16(2),  P16(3),  P16(4),  P16(5),  P16(6),  P16(7),
+    P16(8),  P16(9),  P16(10), P16(11), P16(12), P16(13), P16(14), P16(15)
+};
+
+#undef P
+#undef P16
+
+static size_t format_scalar(char *out, const uint8_t *data, size_t len)
+{
+    char *o = out;
+
+    for (size_t i = 0; i < len; i++) {
+        memcpy(o, hex_pair[data[i]], 2);
+        o[2] = ' ';
+        o += 3;
+    }
+    return (size_t)(o - out);
+}
+
+size_t hexfmt_scalar(char *out, const uint8_t *data, size_t len)
+{
+    return format_scalar(out, data, len);
+}
+
+const char *hexfmt_impl(void)
+{
+    return HEXFMT_IMPL;
+}
+
+#if defined(__SSSE3__)
+
+#define BLOCK 16
+
+// Digit c of the 32 digits of a block lives in a (c < 16) or b (c >= 16)
+#define POS(r, j)   (16 * (r) + (j))
+#define CH(r, j)    (2 * (POS(r, j) / 3) + POS(r, j) % 3)
+#define IS_SP(r, j) (POS(r, j) % 3 == 2)
+#define SEL_A(r, j) (IS_SP(r, j) || CH(r, j) >= 16 ? 0x80 : CH(r, j))
+#define SEL_B(r, j) (IS_SP(r, j) || CH(r, j) < 16 ? 0x80 : CH(r, j) - 16)
+#define SP(r, j)    (IS_SP(r, j) ? ' ' : 0)
+#define ROW(F, r) { \
+    F(r, 0),  F(r, 1),  F(r, 2),  F(r, 3),  F(r, 4),  F(r, 5),  F(r, 6),  F(r, 7),  \
+    F(r, 8),  F(r, 9),  F(r, 10), F(r, 11), F(r, 12), F(r, 13), F(r, 14), F(r, 15) }
+
+static const uint8_t out_a[3][16] __attribute__((aligned(16))) = {
+    ROW(SEL_A, 0), ROW(SEL_A, 1), ROW(SEL_A, 2)
+};
+static const uint8_t out_b[3][16] __attribute__((aligned(16))) = {
+    ROW(SEL_B, 0), ROW(SEL_B, 1), ROW(SEL_B, 2)
+};
+static const uint8_t out_sp[3][16] __attribute__((aligned(16))) = {
+    ROW(SP, 0), ROW(SP, 1), ROW(SP, 2)
+};
+static const char digits[16] __attribute__((aligned(16))) = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+#undef POS
+#undef CH
+#undef IS_SP
+#undef SEL_A
+#undef SEL_B
+#undef SP
+#undef ROW
+
+#endif // __SSSE3__
+
+#if defined(__AVX2__)
+
+#define STEP (2 * BLOCK)
+
+static inline __m256i load_both(const uint8_t *p)
+{
+    return _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)p));
+}
+
+size_t hexfmt(char *out, const uint8_t *data, size_t len)
+{
+    const __m256i lut = load_both((const uint8_t *)digits);
+    const __m256i nib = _mm256_set1_epi8(0x0F);
+    const __m256i ma0 = load_both(out_a[0]), ma1 = load_both(out_a[1]), ma2 = load_both(out_a[2]);
+    const __m256i mb0 = load_both(out_b[0]), mb1 = load_both(out_b[1]), mb2 = load_both(out_b[2]);
+    const __m256i sp0 = load_both(out_sp[0]), sp1 = load_both(out_sp[1]), sp2 = load_both(out_sp[2]);
+    size_t i = 0;
+
+    for (; i + STEP <= len; i += STEP) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), nib));
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, nib));
+        // Per lane: a = pairs of bytes 0-7, b = pairs of bytes 8-15
+        __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        __m256i b = _mm256_unpackhi_epi8(hi, lo);
+
+        __m256i r0 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a, ma0),
+                                                     _mm256_shuffle_epi8(b, mb0)), sp0);
+        __m256i r1 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a, ma1),
+                                                     _mm256_shuffle_epi8(b, mb1)), sp1);
+        __m256i r2 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a, ma2),
+                                                     _mm256_shuffle_epi8(b, mb2)), sp2);
+
+        // Low lanes hold block one, high lanes block two
+        char *o = out + 3 * i;
+        _mm256_storeu_si256((__m256i *)o, _mm256_permute2x128_si256(r0, r1, 0x20));
+        _mm256_storeu_si256((__m256i *)(o + 32), _mm256_permute2x128_si256(r2, r0, 0x30));
+        _mm256_storeu_si256((__m256i *)(o + 64), _mm256_permute2x128_si256(r1, r2, 0x31));
+    }
+
+    return 3 * i + format_scalar(out + 3 * i, data + i, len - i);
+}
+
+#elif defined(__SSSE3__)
+
+size_t hexfmt(char *out, const uint8_t *data, size_t len)
+{
+    const __m128i lut = _mm_load_si128((const __m128i *)digits);
+    const __m128i nib = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+
+    for (; i + BLOCK <= len; i += BLOCK) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), nib));
+        __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, nib));
+        __m128i a = _mm_unpacklo_epi8(hi, lo);
+        __m128i b = _mm_unpackhi_epi8(hi, lo);
+        char *o = out + 3 * i;
+
+        for (int r = 0; r < 3; r++) {
+            __m128i s = _mm_or_si128(
+                _mm_shuffle_epi8(a, _mm_load_si128((const __m128i *)out_a[r])),
+                _mm_shuffle_epi8(b, _mm_load_si128((const __m128i *)out_b[r])));
+            s = _mm_or_si128(s, _mm_load_si128((const __m128i *)out_sp[r]));
+            _mm_storeu_si128((__m128i *)(o + 16 * r), s);
+        }
+    }
+
+    return 3 * i + format_scalar(out + 3 * i, data + i, len - i);
+}
+
+#else
+
+size_t hexfmt(char *out, const uint8_t *data, size_t len)
+{
+    return format_scalar(out, data, len);
+}
+
+#endif
+
+size_t hexfmt_line(char *out, const uint8_t *data, size_t len)
+{
+    size_t n = sizeof(HEXFMT_TAG) - 1;
+
+    memcpy(out, HEXFMT_TAG, n);
+    n += hexfmt(out + n, data, len);
+    out[n++] = '\n';
+    return n;
+}
+
+int hexfmt_is_text(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] < 32 && data[i] != '\n' && data[i] != '\r' && data[i] != '\t') return 0;
+    }
+    return 1;
+}
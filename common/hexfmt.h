@@ -0,0 +1,52 @@
+/*
+ * hexfmt.h - Hex dump lines for the -x / hex-view modes
+ *
+ * Formats bytes as "4A 6F " (upper case, one space after each byte) into
+ * a buffer the caller owns: no allocation and no stdio, so a whole line
+ * can be handed to one fwrite()/write().
+ *
+ * Short buffers go through a 256-entry table of digit pairs. With -mavx2
+ * or -mssse3 (or -march=native), 16/32 bytes at a time are split into
+ * nibbles and mapped to digits with a byte shuffle. Both paths produce
+ * identical output.
+ */
+
+#ifndef HEXFMT_H
+#define HEXFMT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HEXFMT_TAG "[HEX] "
+
+/* Output size of hexfmt() for len bytes, and of hexfmt_line() with its
+ * tag and newline */
+#define HEXFMT_SIZE(len)       (3 * (size_t)(len))
+#define HEXFMT_LINE_SIZE(len)  (sizeof(HEXFMT_TAG) - 1 + HEXFMT_SIZE(len) + 1)
+
+/* Write len bytes as hex to out, which needs HEXFMT_SIZE(len) bytes.
+ * Returns the number of characters written; no NUL is added. */
+size_t hexfmt(char *out, const uint8_t *data, size_t len);
+
+/* Table-only reference implementation of the above. */
+size_t hexfmt_scalar(char *out, const uint8_t *data, size_t len);
+
+/* "[HEX] 4A 6F \n" into out (HEXFMT_LINE_SIZE(len) bytes). Returns the
+ * line length; no NUL is added. */
+size_t hexfmt_line(char *out, const uint8_t *data, size_t len);
+
+/* 1 if data has no control characters other than \t \r \n */
+int hexfmt_is_text(const uint8_t *data, size_t len);
+
+/* "avx2", "ssse3" or "scalar" */
+const char *hexfmt_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HEXFMT_H
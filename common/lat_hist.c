@@ -0,0 +1,107 @@
+/*
+ * lat_hist.c - Fixed-size log-linear latency histogram
+ */
+
+#include "lat_hist.h"
+
+#include <string.h>
+
+#define LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+
+void lat_hist_init(lat_hist_t *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void lat_hist_merge(lat_hist_t *dst, const lat_hist_t *src)
+{
+    for (size_t i = 0; i < LAT_HIST_BUCKETS; i++) {
+        dst->count[i] += LOAD(&src->count[i]);
+    }
+    dst->samples += LOAD(&src->samples);
+    dst->sum += LOAD(&src->sum);
+    if (LOAD(&src->min) < dst->min) dst->min = LOAD(&src->min);
+    if (LOAD(&src->max) > dst->max) dst->max = LOAD(&src->max);
+}
+
+static uint64_t bucket_lo(unsigned b)
+{
+    if (b < LAT_HIST_SUB) return b;
+    return (uint64_t)(LAT_HIST_SUB + b % LAT_HIST_SUB) << (b / LAT_HIST_SUB - 1);
+}
+
+static uint64_t bucket_width(unsigned b)
+{
+    return b < LAT_HIST_SUB ? 1 : (uint64_t)1 << (b / LAT_HIST_SUB - 1);
+}
+
+static uint64_t bucket_mid(unsigned b)
+{
+    return bucket_lo(b) + (bucket_width(b) >> 1);
+}
+
+void lat_hist_since(lat_hist_t *out, const lat_hist_t *now, const lat_hist_t *before)
+{
+    lat_hist_init(out);
+    for (unsigned i = 0; i < LAT_HIST_BUCKETS; i++) {
+        uint64_t c = LOAD(&now->count[i]) - before->count[i];
+        if (c == 0) continue;
+        out->count[i] = c;
+        out->samples += c;
+        if (out->min == UINT64_MAX) out->min = bucket_lo(i);
+        out->max = bucket_lo(i) + bucket_width(i) - 1;
+    }
+    out->sum = LOAD(&now->sum) - before->sum;
+}
+
+uint64_t lat_hist_quantile(const lat_hist_t *h, double q)
+{
+    uint64_t n = 0;
+    for (size_t i = 0; i < LAT_HIST_BUCKETS; i++) n += LOAD(&h->count[i]);
+    if (n == 0) return 0;
+
+    uint64_t rank = (uint64_t)(q * (double)(n - 1)) + 1;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < LAT_HIST_BUCKETS; i++) {
+        seen += LOAD(&h->count[i]);
+        if (seen >= rank) {
+            // Never report past the extremes actually seen
+            uint64_t v = bucket_mid(i);
+            uint64_t lo = LOAD(&h->min), hi = LOAD(&h->max);
+            if (v < lo) v = lo;
+            if (v > hi) v = hi;
+            return v;
+        }
+    }
+    return LOAD(&h->max);
+}
+
+static void put_ns(FILE *f, const char *label, uint64_t ns)
+{
+    if (ns >= 10000000ull) {
+        fprintf(f, " %s %.1fms", label, ns / 1e6);
+    } else {
+        fprintf(f, " %s %.1fus", label, ns / 1e3);
+    }
+}
+
+void lat_hist_print(const lat_hist_t *h, const char *name, FILE *f)
+{
+    uint64_t n = LOAD(&h->samples);
+
+    fprintf(f, "%-28s n=%-9llu", name, (unsigned long long)n);
+    if (n == 0) {
+        fprintf(f, "\n");
+        return;
+    }
+
+    put_ns(f, "min", LOAD(&h->min));
+    put_ns(f, "mean", LOAD(&h->sum) / n);
+    put_ns(f, "p50", lat_hist_quantile(h, 0.50));
+    put_ns(f, "p90", lat_hist_quantile(h, 0.90));
+    put_ns(f, "p99", lat_hist_quantile(h, 0.99));
+    put_ns(f, "p99.9", lat_hist_quantile(h, 0.999));
+    put_ns(f, "max", LOAD(&h->max));
+    fprintf(f, "\n");
+}
@@ -0,0 +1,83 @@
+/*
+ * lat_hist.h - Fixed-size log-linear latency histogram
+ *
+ * Values are nanoseconds. Each power of two is split into 16 linear
+ * sub-buckets, so a reported percentile is within ~6% of the true value
+ * over the whole uint64_t range, and adding a sample is a clz, a shift
+ * and an increment: cheap enough for every frame of a hot send loop.
+ *
+ * One thread adds samples; any thread may read or print concurrently
+ * (counters are accessed with relaxed atomics, so a snapshot can be a
+ * few samples behind but is never torn).
+ *
+ *     lat_hist_t h;
+ *     lat_hist_init(&h);
+ *     lat_hist_add(&h, t1 - t0);
+ *     lat_hist_print(&h, "send()", stderr);
+ */
+
+#ifndef LAT_HIST_H
+#define LAT_HIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LAT_HIST_SUB_BITS 4
+#define LAT_HIST_SUB      (1u << LAT_HIST_SUB_BITS)
+#define LAT_HIST_BUCKETS  (64 * LAT_HIST_SUB)
+
+typedef struct {
+    uint64_t count[LAT_HIST_BUCKETS];
+    uint64_t samples;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+} lat_hist_t;
+
+void lat_hist_init(lat_hist_t *h);
+
+static inline unsigned lat_hist_bucket(uint64_t v)
+{
+    if (v < LAT_HIST_SUB) return (unsigned)v;
+    unsigned msb = 63u - (unsigned)__builtin_clzll(v);
+    unsigned sub = (unsigned)(v >> (msb - LAT_HIST_SUB_BITS)) & (LAT_HIST_SUB - 1);
+    return (msb - LAT_HIST_SUB_BITS + 1) * LAT_HIST_SUB + sub;
+}
+
+#define LAT_HIST_BUMP(p, d) \
+    __atomic_store_n((p), __atomic_load_n((p), __ATOMIC_RELAXED) + (d), __ATOMIC_RELAXED)
+
+/* Single writer only. */
+static inline void lat_hist_add(lat_hist_t *h, uint64_t ns)
+{
+    LAT_HIST_BUMP(&h->count[lat_hist_bucket(ns)], 1);
+    LAT_HIST_BUMP(&h->samples, 1);
+    LAT_HIST_BUMP(&h->sum, ns);
+    if (ns < __atomic_load_n(&h->min, __ATOMIC_RELAXED)) __atomic_store_n(&h->min, ns, __ATOMIC_RELAXED);
+    if (ns > __atomic_load_n(&h->max, __ATOMIC_RELAXED)) __atomic_store_n(&h->max, ns, __ATOMIC_RELAXED);
+}
+
+/* dst += src. dst must not be written concurrently. */
+void lat_hist_merge(lat_hist_t *dst, const lat_hist_t *src);
+
+/* out = now - before: the samples added between two snapshots, for
+ * periodic reports. before is a private copy (e.g. from lat_hist_merge);
+ * min/max of out are bucket bounds, not exact values. */
+void lat_hist_since(lat_hist_t *out, const lat_hist_t *now, const lat_hist_t *before);
+
+/* Value at quantile q (0..1), bucket midpoint; 0 for an empty histogram. */
+uint64_t lat_hist_quantile(const lat_hist_t *h, double q);
+
+/* One line: samples, min/mean/p50/p90/p99/p99.9/max, scaled to us or ms. */
+void lat_hist_print(const lat_hist_t *h, const char *name, FILE *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LAT_HIST_H
@@ -0,0 +1,63 @@
+/*
+ * link_stats.c - Live loss, reordering and latency from v2 frame headers
+ */
+
+#include "link_stats.h"
+
+#include <string.h>
+
+void link_stats_init(link_stats_t *ls)
+{
+    memset(ls, 0, sizeof(*ls));
+    lat_hist_init(&ls->latency);
+}
+
+void link_stats_update(link_stats_t *ls, const frame_meta_t *m, uint64_t now_us)
+{
+    ls->version = m->version;
+    if (m->version < FRAME_V2) {
+        ls->v1_frames++;
+        return;
+    }
+    ls->v2_frames++;
+
+    if (!ls->have_seq) {
+        ls->have_seq = 1;
+        ls->first_seq = ls->max_seq = m->seq;
+    } else {
+        // Serial-number arithmetic, so the u32 counter may wrap
+        int32_t d = (int32_t)(m->seq - ls->max_seq);
+        if (d > 0) {
+            ls->max_seq = m->seq;
+        } else if (d < 0) {
+            ls->reordered++;
+            // Older than anything so far: the window grows backwards
+            if ((int32_t)(m->seq - ls->first_seq) < 0) ls->first_seq = m->seq;
+        }
+    }
+
+    int64_t lat = (int64_t)(now_us - m->ts_us);
+    ls->last_latency_us = lat;
+    if (lat < 0) {
+        ls->clock_behind++;
+        lat = 0;
+    }
+    lat_hist_add(&ls->latency, (uint64_t)lat * 1000u);
+}
+
+unsigned long link_stats_expected(const link_stats_t *ls)
+{
+    return ls->have_seq ? (unsigned long)(uint32_t)(ls->max_seq - ls->first_seq) + 1 : 0;
+}
+
+unsigned long link_stats_lost(const link_stats_t *ls)
+{
+    unsigned long expected = link_stats_expected(ls);
+    return expected > ls->v2_frames ? expected - ls->v2_frames : 0;
+}
+
+double link_stats_loss_pct(const link_stats_t *ls)
+{
+    unsigned long expected = link_stats_expected(ls);
+    return expected ? 100.0 * (double)link_stats_lost(ls) / (double)expected : 0.0;
+}
@@ -0,0 +1,59 @@
+/*
+ * link_stats.h - Live loss, reordering and latency from v2 frame headers
+ *
+ * Fed with the meta of every decoded frame of one connection:
+ *
+ *   loss       sequence numbers between the first and the highest seen
+ *              that never arrived (late arrivals are subtracted again)
+ *   reordered  frames that arrived after a higher sequence number, e.g.
+ *              buffered frames a client replays after a reconnect
+ *   latency    receive time minus the sender's timestamp; exact on one
+ *              host, otherwise includes the clock offset between the two
+ *
+ * v1 frames carry neither, so they are only counted.
+ */
+
+#ifndef LINK_STATS_H
+#define LINK_STATS_H
+
+#include <stdint.h>
+
+#include "lat_hist.h"
+#include "telemetry_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    unsigned long v1_frames;
+    unsigned long v2_frames;
+    int version;                    // of the last frame, 0 before the first
+
+    int have_seq;
+    uint32_t first_seq;
+    uint32_t max_seq;
+    unsigned long reordered;
+    unsigned long clock_behind;     // sender timestamp in our future
+
+    int64_t last_latency_us;
+    lat_hist_t latency;             // ns
+} link_stats_t;
+
+void link_stats_init(link_stats_t *ls);
+
+/* now_us: receiver CLOCK_REALTIME in microseconds. */
+void link_stats_update(link_stats_t *ls, const frame_meta_t *m, uint64_t now_us);
+
+/* Sequence numbers expected so far (first..max), and missing among them. */
+unsigned long link_stats_expected(const link_stats_t *ls);
+unsigned long link_stats_lost(const link_stats_t *ls);
+
+/* 0..100 */
+double link_stats_loss_pct(const link_stats_t *ls);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LINK_STATS_H
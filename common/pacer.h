@@ -0,0 +1,119 @@
+/*
+ * pacer.h - Absolute-deadline pacing on CLOCK_MONOTONIC
+ *
+ * "work, then sleep(interval)" makes the real period interval + work,
+ * which drifts at 150 ms and falls apart at 1-5 ms. The pacer instead
+ * sleeps until the next point of a fixed grid (start + k * period) with
+ * clock_nanosleep(TIMER_ABSTIME), so work time and sleep overshoot do
+ * not accumulate.
+ *
+ * When a deadline is already past on wake-up (overrun), the catch-up
+ * policy decides what happens to the missed grid points:
+ *
+ *   PACER_SKIP   drop them and continue at the next future grid point;
+ *                the phase is kept, the count of sends is not
+ *   PACER_BURST  run them back to back, up to max_burst, then skip the
+ *                rest; the count of sends is kept when the overrun is short
+ *
+ *     pacer_t p;
+ *     pacer_init(&p, 150 * 1000000ull, PACER_SKIP, 0);
+ *     while (running) {
+ *         uint64_t late = pacer_wait(&p);
+ *         do_work();
+ *     }
+ */
+
+#ifndef PACER_H
+#define PACER_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef enum {
+    PACER_SKIP,
+    PACER_BURST,
+} pacer_policy_t;
+
+typedef struct {
+    uint64_t period_ns;
+    uint64_t next_ns;               // next deadline
+    pacer_policy_t policy;
+    unsigned max_burst;             // PACER_BURST: catch-up sends in a row
+    unsigned burst;                 // catch-up sends done so far
+
+    unsigned long ticks;
+    unsigned long overruns;         // woke up at least one period late
+    unsigned long skipped;          // grid points dropped
+} pacer_t;
+
+static inline uint64_t pacer_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline void pacer_sleep_until(uint64_t deadline_ns)
+{
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+    ts.tv_nsec = (long)(deadline_ns % 1000000000ull);
+    // Absolute, so a signal (e.g. SIGUSR1 for stats) cannot shift the grid
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+/* max_burst 0 means 4 periods' worth of catch-up. */
+static inline void pacer_init(pacer_t *p, uint64_t period_ns, pacer_policy_t policy,
+                              unsigned max_burst)
+{
+    p->period_ns = period_ns ? period_ns : 1;
+    p->next_ns = pacer_now_ns();
+    p->policy = policy;
+    p->max_burst = max_burst ? max_burst : 4;
+    p->burst = 0;
+    p->ticks = p->overruns = p->skipped = 0;
+}
+
+/* Advance the deadline after a tick that ran at now_ns. Returns how late
+ * the tick was against its own deadline. Usable without sleeping, e.g.
+ * by a loop that multiplexes many pacers over one wake-up. */
+static inline uint64_t pacer_advance(pacer_t *p, uint64_t now_ns)
+{
+    uint64_t late = now_ns > p->next_ns ? now_ns - p->next_ns : 0;
+
+    p->ticks++;
+    p->next_ns += p->period_ns;
+    if (p->next_ns > now_ns) {
+        p->burst = 0;
+        return late;
+    }
+
+    // Missed at least one further grid point
+    if (p->burst == 0) p->overruns++;
+    if (p->policy == PACER_BURST && p->burst < p->max_burst) {
+        p->burst++;
+        return late;
+    }
+
+    uint64_t behind = (now_ns - p->next_ns) / p->period_ns + 1;
+    p->next_ns += behind * p->period_ns;
+    p->skipped += (unsigned long)behind;
+    p->burst = 0;
+    return late;
+}
+
+/* Sleep until the next deadline and advance. Returns the lateness of this
+ * wake-up against its deadline, in ns. */
+static inline uint64_t pacer_wait(pacer_t *p)
+{
+    uint64_t now = pacer_now_ns();
+    if (now < p->next_ns) {
+        pacer_sleep_until(p->next_ns);
+        now = pacer_now_ns();
+    }
+    return pacer_advance(p, now);
+}
+
+#endif // PACER_H
@@ -0,0 +1,532 @@
+/*
+ * pubsub.c - Fan-out of decoded telemetry to local subscribers
+ */
+
+#define _GNU_SOURCE
+#include "pubsub.h"
+#include "vehicle_store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define PUBSUB_LINE_MAX  320
+#define PUBSUB_IOV       64             // iovecs per writev()
+#define PUBSUB_IN_MAX    256            // longest filter line
+
+enum {
+#define X(name, type, byte, shift, width) PS_IDX_##name,
+    TELEM_FIELDS(X)
+#undef X
+    PS_NFIELDS
+};
+
+#define PS_ALL_FIELDS ((1u << PS_NFIELDS) - 1)
+
+static const char *const field_names[PS_NFIELDS] = {
+#define X(name, type, byte, shift, width) #name,
+    TELEM_FIELDS(X)
+#undef X
+};
+
+/* One formatted line, shared by every subscriber that queued it.
+ * buf = header, then one " name=value" segment per field, then '\n';
+ * seg[0] ends the header and seg[i + 1] ends field i. */
+typedef struct pubsub_msg {
+    unsigned refs;
+    uint64_t key;                   // 0 for replies to a subscriber
+    uint16_t len;
+    uint16_t seg[PS_NFIELDS + 1];
+    char buf[PUBSUB_LINE_MAX];
+} pubsub_msg_t;
+
+struct pubsub_sub {
+    int fd;
+    unsigned id;
+    uint64_t vehicle;               // 0 = all
+    uint32_t fields;                // bit per TELEM_FIELDS entry
+    char in[PUBSUB_IN_MAX];         // partial filter line
+    size_t in_len;
+
+    pubsub_msg_t **q;               // ring of queue_len
+    size_t head, count;
+    size_t sent;                    // bytes of the head line already written
+    uint32_t sent_fields;           // the fields it was started with
+    int want_out;                   // EPOLLOUT armed
+    int dead;
+
+    unsigned long delivered;
+    unsigned long dropped;
+    unsigned long conflated;
+};
+
+static pubsub_msg_t *msg_new(uint64_t key)
+{
+    pubsub_msg_t *m = malloc(sizeof(*m));
+    if (m) {
+        m->refs = 0;
+        m->key = key;
+    }
+    return m;
+}
+
+static void msg_unref(pubsub_msg_t *m)
+{
+    if (m && --m->refs == 0) free(m);
+}
+
+static pubsub_msg_t *msg_format(uint64_t key, const telemetry_t *t, const frame_meta_t *meta,
+                                uint64_t rx_us)
+{
+    char name[VEHICLE_NAME_LEN];
+    pubsub_msg_t *m = msg_new(key);
+    if (!m) return NULL;
+
+    vehicle_key_str(key, name, sizeof(name));
+    int n = snprintf(m->buf, sizeof(m->buf), "vehicle=%s rx_us=%llu", name,
+                     (unsigned long long)rx_us);
+    if (meta->version >= FRAME_V2) {
+        n += snprintf(m->buf + n, sizeof(m->buf) - n, " seq=%u ts_us=%llu", meta->seq,
+                      (unsigned long long)meta->ts_us);
+    }
+    m->seg[0] = (uint16_t)n;
+#define X(name, type, byte, shift, width)                                               \
+    n += snprintf(m->buf + n, sizeof(m->buf) - n, " " #name "=%u", (unsigned)t->name); \
+    m->seg[PS_IDX_##name + 1] = (uint16_t)n;
+    TELEM_FIELDS(X)
+#undef X
+    m->buf[n++] = '\n';
+    m->len = (uint16_t)n;
+    return m;
+}
+
+/* A reply line ("# ..."); it has no field segments, so every filter shows it */
+static pubsub_msg_t *msg_text(const char *text)
+{
+    pubsub_msg_t *m = msg_new(0);
+    if (!m) return NULL;
+
+    int n = snprintf(m->buf, sizeof(m->buf) - 1, "%s", text);
+    if (n > (int)sizeof(m->buf) - 2) n = (int)sizeof(m->buf) - 2;
+    for (int i = 0; i <= PS_NFIELDS; i++) m->seg[i] = (uint16_t)n;
+    m->buf[n++] = '\n';
+    m->len = (uint16_t)n;
+    return m;
+}
+
+static void iov_add(struct iovec *iov, int *niov, const char *p, size_t len)
+{
+    if (len == 0) return;
+    if (*niov > 0 && (const char *)iov[*niov - 1].iov_base + iov[*niov - 1].iov_len == p) {
+        iov[*niov - 1].iov_len += len;      // adjacent segments: one iovec
+        return;
+    }
+    iov[*niov].iov_base = (void *)p;
+    iov[*niov].iov_len = len;
+    (*niov)++;
+}
+
+/* The subscriber's projection of m: at most PS_NFIELDS + 2 iovecs */
+static int msg_iov(const pubsub_msg_t *m, uint32_t fields, struct iovec *iov, size_t *len)
+{
+    int n = 0;
+
+    iov_add(iov, &n, m->buf, m->seg[0]);
+    for (int i = 0; i < PS_NFIELDS; i++) {
+        if (fields & (1u << i)) iov_add(iov, &n, m->buf + m->seg[i], m->seg[i + 1] - m->seg[i]);
+    }
+    iov_add(iov, &n, m->buf + m->len - 1, 1);
+
+    *len = 0;
+    for (int i = 0; i < n; i++) *len += iov[i].iov_len;
+    return n;
+}
+
+static pubsub_msg_t **q_at(const pubsub_t *ps, pubsub_sub_t *s, size_t k)
+{
+    return &s->q[(s->head + k) % ps->queue_len];
+}
+
+static void q_pop(pubsub_t *ps, pubsub_sub_t *s)
+{
+    msg_unref(*q_at(ps, s, 0));
+    s->head = (s->head + 1) % ps->queue_len;
+    s->count--;
+    s->sent = 0;
+}
+
+static void q_push(pubsub_t *ps, pubsub_sub_t *s, pubsub_msg_t *m)
+{
+    m->refs++;
+    *q_at(ps, s, s->count) = m;
+    s->count++;
+}
+
+/* A SUB line may change fields while the head line is half written; the
+ * rest of that line keeps the projection it was started with */
+static uint32_t head_fields(const pubsub_sub_t *s)
+{
+    return s->sent > 0 ? s->sent_fields : s->fields;
+}
+
+static void set_want_out(pubsub_t *ps, pubsub_sub_t *s, int on)
+{
+    if (s->want_out == on) return;
+    struct epoll_event ev = { .events = EPOLLIN | (on ? EPOLLOUT : 0), .data.ptr = s };
+    epoll_ctl(ps->epfd, EPOLL_CTL_MOD, s->fd, &ev);
+    s->want_out = on;
+}
+
+static void sub_flush(pubsub_t *ps, pubsub_sub_t *s)
+{
+    while (s->count > 0 && !s->dead) {
+        struct iovec iov[PUBSUB_IOV];
+        int niov = 0;
+        size_t len;
+
+        // As many queued lines as fit one writev()
+        for (size_t k = 0; k < s->count && niov + PS_NFIELDS + 2 <= PUBSUB_IOV; k++) {
+            int first = niov;
+            niov += msg_iov(*q_at(ps, s, k), k == 0 ? head_fields(s) : s->fields,
+                            iov + niov, &len);
+            if (k == 0 && s->sent > 0) {
+                size_t skip = s->sent;
+                while (skip >= iov[first].iov_len) skip -= iov[first++].iov_len;
+                iov[first].iov_base = (char *)iov[first].iov_base + skip;
+                iov[first].iov_len -= skip;
+                memmove(iov, iov + first, (size_t)(niov - first) * sizeof(*iov));
+                niov -= first;
+            }
+        }
+
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = (size_t)niov };
+        ssize_t n = sendmsg(s->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                set_want_out(ps, s, 1);
+                return;
+            }
+            s->dead = 1;
+            return;
+        }
+
+        // Retire whole lines; a partly written one stays at the head
+        while (n > 0) {
+            msg_iov(*q_at(ps, s, 0), head_fields(s), iov, &len);
+            size_t rest = len - s->sent;
+            if ((size_t)n < rest) {
+                s->sent_fields = head_fields(s);
+                s->sent += (size_t)n;
+                break;
+            }
+            n -= (ssize_t)rest;
+            if ((*q_at(ps, s, 0))->key) {
+                s->delivered++;
+                ps->delivered++;
+            }
+            q_pop(ps, s);
+        }
+    }
+    if (s->count == 0) set_want_out(ps, s, 0);
+}
+
+/* Queue m for s, applying the slow-subscriber policy when the queue is full */
+static void sub_enqueue(pubsub_t *ps, pubsub_sub_t *s, pubsub_msg_t *m)
+{
+    if (s->count < ps->queue_len) {
+        q_push(ps, s, m);
+        return;
+    }
+
+    switch (ps->policy) {
+    case PUBSUB_DROP:
+        break;
+    case PUBSUB_DISCONNECT:
+        s->dead = 1;
+        ps->kicked++;
+        return;
+    case PUBSUB_CONFLATE: {
+        // A partly written head line has to finish as it is
+        size_t first = s->sent > 0 ? 1 : 0;
+        for (size_t k = first; m->key && k < s->count; k++) {
+            pubsub_msg_t **slot = q_at(ps, s, k);
+            if ((*slot)->key == m->key) {
+                msg_unref(*slot);
+                *slot = m;
+                m->refs++;
+                s->conflated++;
+                ps->conflated++;
+                return;
+            }
+        }
+        if (first >= s->count) break;
+        // No older line of this vehicle: evict the oldest unsent one
+        pubsub_msg_t **oldest = q_at(ps, s, first);
+        msg_unref(*oldest);
+        if (first) *oldest = *q_at(ps, s, 0);
+        s->head = (s->head + 1) % ps->queue_len;
+        s->count--;
+        q_push(ps, s, m);
+        s->dropped++;
+        ps->dropped++;
+        return;
+    }
+    }
+    s->dropped++;
+    ps->dropped++;
+}
+
+static void sub_reply(pubsub_t *ps, pubsub_sub_t *s, const char *text)
+{
+    pubsub_msg_t *m = msg_text(text);
+    if (!m) return;
+    if (s->count < ps->queue_len) q_push(ps, s, m);
+    if (m->refs == 0) free(m);
+}
+
+/* "SUB vehicle=... fields=a,b" */
+static void sub_parse(pubsub_t *ps, pubsub_sub_t *s, char *line)
+{
+    char reply[PUBSUB_LINE_MAX], *save = NULL;
+    uint64_t vehicle = s->vehicle;
+    uint32_t fields = s->fields;
+
+    char *tok = strtok_r(line, " \t\r", &save);
+    if (!tok) return;
+    if (strcmp(tok, "SUB") != 0) {
+        snprintf(reply, sizeof(reply), "# error: expected SUB vehicle=... fields=...");
+        sub_reply(ps, s, reply);
+        return;
+    }
+
+    while ((tok = strtok_r(NULL, " \t\r", &save))) {
+        if (strncmp(tok, "vehicle=", 8) == 0) {
+            const char *v = tok + 8;
+            if (strcmp(v, "*") == 0) vehicle = 0;
+            else if (v[0] == '#') vehicle = strtoull(v + 1, NULL, 16);
+            else vehicle = vehicle_key(v);
+        } else if (strncmp(tok, "fields=", 7) == 0) {
+            char *f, *fsave = NULL;
+            if (strcmp(tok + 7, "*") == 0) {
+                fields = PS_ALL_FIELDS;
+                continue;
+            }
+            fields = 0;
+            for (f = strtok_r(tok + 7, ",", &fsave); f; f = strtok_r(NULL, ",", &fsave)) {
+                int i;
+                for (i = 0; i < PS_NFIELDS && strcmp(f, field_names[i]) != 0; i++) {}
+                if (i == PS_NFIELDS) {
+                    snprintf(reply, sizeof(reply), "# error: unknown field %.64s", f);
+                    sub_reply(ps, s, reply);
+                    return;
+                }
+                fields |= 1u << i;
+            }
+        } else {
+            snprintf(reply, sizeof(reply), "# error: unknown option %.64s", tok);
+            sub_reply(ps, s, reply);
+            return;
+        }
+    }
+
+    s->vehicle = vehicle;
+    s->fields = fields;
+
+    char name[VEHICLE_NAME_LEN] = "*";
+    if (vehicle) vehicle_key_str(vehicle, name, sizeof(name));
+    int n = snprintf(reply, sizeof(reply), "# subscribed vehicle=%s fields=", name);
+    if (fields == PS_ALL_FIELDS) {
+        snprintf(reply + n, sizeof(reply) - n, "*");
+    } else {
+        for (int i = 0; i < PS_NFIELDS && n < (int)sizeof(reply); i++) {
+            if (fields & (1u << i))
+                n += snprintf(reply + n, sizeof(reply) - n, "%s%s",
+                              reply[n - 1] == '=' ? "" : ",", field_names[i]);
+        }
+    }
+    sub_reply(ps, s, reply);
+}
+
+static void sub_read(pubsub_t *ps, pubsub_sub_t *s)
+{
+    for (;;) {
+        ssize_t n = read(s->fd, s->in + s->in_len, sizeof(s->in) - 1 - s->in_len);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            s->dead = 1;
+            return;
+        }
+        if (n < 0) break;
+        s->in_len += (size_t)n;
+
+        char *nl;
+        while ((nl = memchr(s->in, '\n', s->in_len))) {
+            *nl = '\0';
+            sub_parse(ps, s, s->in);
+            s->in_len -= (size_t)(nl + 1 - s->in);
+            memmove(s->in, nl + 1, s->in_len);
+        }
+        if (s->in_len == sizeof(s->in) - 1) s->in_len = 0;     // overlong line
+    }
+    sub_flush(ps, s);
+}
+
+static void sub_free(pubsub_t *ps, pubsub_sub_t *s)
+{
+    while (s->count > 0) q_pop(ps, s);
+    epoll_ctl(ps->epfd, EPOLL_CTL_DEL, s->fd, NULL);
+    close(s->fd);
+    free(s->q);
+    free(s);
+}
+
+static void reap(pubsub_t *ps)
+{
+    for (size_t i = 0; i < ps->nsubs;) {
+        if (ps->subs[i]->dead) {
+            sub_free(ps, ps->subs[i]);
+            ps->subs[i] = ps->subs[--ps->nsubs];
+        } else {
+            i++;
+        }
+    }
+}
+
+static void accept_subs(pubsub_t *ps)
+{
+    int fd;
+    while ((fd = accept4(ps->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        pubsub_sub_t *s = NULL;
+        if (ps->nsubs < PUBSUB_MAX_SUBS) s = calloc(1, sizeof(*s));
+        if (s) s->q = calloc(ps->queue_len, sizeof(*s->q));
+        if (!s || !s->q) {
+            if (s) free(s);
+            close(fd);
+            ps->rejected++;
+            continue;
+        }
+
+        s->fd = fd;
+        s->id = (unsigned)++ps->accepted;
+        s->fields = PS_ALL_FIELDS;
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = s };
+        if (epoll_ctl(ps->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            free(s->q);
+            free(s);
+            close(fd);
+            ps->rejected++;
+            continue;
+        }
+        ps->subs[ps->nsubs++] = s;
+    }
+}
+
+int pubsub_init(pubsub_t *ps, int listen_fd, size_t queue_len, pubsub_policy_t policy)
+{
+    memset(ps, 0, sizeof(*ps));
+    ps->listen_fd = listen_fd;
+    ps->queue_len = queue_len ? queue_len : PUBSUB_DEFAULT_QUEUE;
+    ps->policy = policy;
+
+    ps->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (ps->epfd < 0) return -1;
+
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL, 0) | O_NONBLOCK);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epoll_ctl(ps->epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
+        int err = errno;
+        close(ps->epfd);
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+void pubsub_publish(pubsub_t *ps, uint64_t key, const telemetry_t *t, const frame_meta_t *meta,
+                    uint64_t rx_us)
+{
+    pubsub_msg_t *m = NULL;
+
+    ps->published++;
+    for (size_t i = 0; i < ps->nsubs; i++) {
+        pubsub_sub_t *s = ps->subs[i];
+        if (s->dead || (s->vehicle && s->vehicle != key)) continue;
+
+        // Formatted once, for the first subscriber that wants it
+        if (!m) {
+            m = msg_format(key, t, meta, rx_us);
+            if (!m) return;
+            ps->formatted++;
+            m->refs = 1;            // ours until the loop is done
+        }
+        sub_enqueue(ps, s, m);
+        if (!s->want_out) sub_flush(ps, s);
+    }
+    msg_unref(m);
+    reap(ps);
+}
+
+void pubsub_poll(pubsub_t *ps)
+{
+    struct epoll_event evs[PUBSUB_MAX_SUBS + 1];
+
+    int n = epoll_wait(ps->epfd, evs, PUBSUB_MAX_SUBS + 1, 0);
+    for (int i = 0; i < n; i++) {
+        pubsub_sub_t *s = (pubsub_sub_t *)evs[i].data.ptr;
+        if (!s) {
+            accept_subs(ps);
+            continue;
+        }
+        if (s->dead) continue;
+        if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) sub_read(ps, s);
+        if (!s->dead && (evs[i].events & EPOLLOUT)) sub_flush(ps, s);
+    }
+    reap(ps);
+}
+
+void pubsub_close(pubsub_t *ps)
+{
+    for (size_t i = 0; i < ps->nsubs; i++) sub_free(ps, ps->subs[i]);
+    ps->nsubs = 0;
+    if (ps->epfd >= 0) close(ps->epfd);
+    ps->epfd = -1;
+}
+
+int pubsub_policy_parse(const char *s, pubsub_policy_t *out)
+{
+    if (strcmp(s, "drop") == 0) *out = PUBSUB_DROP;
+    else if (strcmp(s, "conflate") == 0) *out = PUBSUB_CONFLATE;
+    else if (strcmp(s, "disconnect") == 0) *out = PUBSUB_DISCONNECT;
+    else return -1;
+    return 0;
+}
+
+const char *pubsub_policy_str(pubsub_policy_t p)
+{
+    switch (p) {
+    case PUBSUB_DROP:       return "drop";
+    case PUBSUB_CONFLATE:   return "conflate";
+    case PUBSUB_DISCONNECT: return "disconnect";
+    }
+    return "?";
+}
+
+void pubsub_print(const pubsub_t *ps, FILE *f)
+{
+    fprintf(f, "[INFO] Pub/sub (%s, queue %zu): %lu frames, %lu formatted, %lu lines delivered, "
+               "%lu dropped, %lu conflated, %lu subscriber(s) kicked\n",
+            pubsub_policy_str(ps->policy), ps->queue_len, ps->published, ps->formatted,
+            ps->delivered, ps->dropped, ps->conflated, ps->kicked);
+    for (size_t i = 0; i < ps->nsubs; i++) {
+        const pubsub_sub_t *s = ps->subs[i];
+        char name[VEHICLE_NAME_LEN] = "*";
+        if (s->vehicle) vehicle_key_str(s->vehicle, name, sizeof(name));
+        fprintf(f, "  sub #%u: vehicle %s, %lu delivered, %lu dropped, %lu conflated, %zu queued\n",
+                s->id, name, s->delivered, s->dropped, s->conflated, s->count);
+    }
+}
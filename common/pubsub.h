@@ -0,0 +1,99 @@
+/*
+ * pubsub.h - Fan-out of decoded telemetry to local subscribers
+ *
+ * Subscribers connect to a Unix stream socket, optionally send a filter
+ * line and then receive one text line per frame:
+ *
+ *   -> SUB vehicle=AA:BB:CC:DD:EE:FF fields=speed,battery
+ *   <- # subscribed vehicle=AA:BB:CC:DD:EE:FF fields=speed,battery
+ *   <- vehicle=AA:BB:CC:DD:EE:FF rx_us=... seq=812 ts_us=... speed=46 battery=80
+ *
+ * "vehicle=*" and "fields=*" (the defaults) select everything; a new SUB
+ * line replaces the filter. seq and ts_us are only present for v2 frames.
+ *
+ * Every frame is formatted once, as a header and one segment per field,
+ * into a reference-counted message. Each subscriber queues a pointer to
+ * it and writes its own selection of segments with writev(), so the cost
+ * per subscriber is a queue slot and a syscall, not a copy.
+ *
+ * Each subscriber has a bounded queue. When it is full:
+ *
+ *   drop        the new frame is not queued
+ *   conflate    the new frame replaces a queued one of the same vehicle
+ *               (else the oldest unsent one): the slow reader still gets
+ *               every vehicle's latest state
+ *   disconnect  the subscriber is dropped
+ *
+ * Sockets are non-blocking; pubsub_poll() accepts, reads filters and
+ * flushes backlogs. The publisher never blocks.
+ */
+
+#ifndef PUBSUB_H
+#define PUBSUB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "telemetry_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PUBSUB_DEFAULT_QUEUE  256       // frames per subscriber
+#define PUBSUB_MAX_SUBS       64
+
+typedef enum {
+    PUBSUB_DROP,
+    PUBSUB_CONFLATE,
+    PUBSUB_DISCONNECT,
+} pubsub_policy_t;
+
+typedef struct pubsub_sub pubsub_sub_t;
+
+typedef struct {
+    int listen_fd;
+    int epfd;
+    pubsub_policy_t policy;
+    size_t queue_len;
+
+    pubsub_sub_t *subs[PUBSUB_MAX_SUBS];
+    size_t nsubs;
+
+    unsigned long published;        // frames offered
+    unsigned long formatted;        // frames some subscriber wanted
+    unsigned long delivered;        // lines fully written, all subscribers
+    unsigned long dropped;
+    unsigned long conflated;
+    unsigned long kicked;           // disconnected as too slow
+    unsigned long accepted;
+    unsigned long rejected;         // over PUBSUB_MAX_SUBS
+} pubsub_t;
+
+/* listen_fd must be a bound, listening Unix stream socket; it is made
+ * non-blocking. Returns 0, or -1 with errno set. */
+int pubsub_init(pubsub_t *ps, int listen_fd, size_t queue_len, pubsub_policy_t policy);
+
+/* Offer one decoded frame. key is vehicle_key() of the sender. */
+void pubsub_publish(pubsub_t *ps, uint64_t key, const telemetry_t *t, const frame_meta_t *meta,
+                    uint64_t rx_us);
+
+/* Accept subscribers, read filter lines, flush backlogs. Never blocks. */
+void pubsub_poll(pubsub_t *ps);
+
+/* Disconnect every subscriber (not listen_fd). */
+void pubsub_close(pubsub_t *ps);
+
+/* "drop", "conflate", "disconnect". Returns 0, or -1 if unknown. */
+int pubsub_policy_parse(const char *s, pubsub_policy_t *out);
+const char *pubsub_policy_str(pubsub_policy_t p);
+
+/* Totals and one line per connected subscriber. */
+void pubsub_print(const pubsub_t *ps, FILE *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PUBSUB_H
@@ -0,0 +1,89 @@
+/*
+ * rate_ctl.c - Adaptive send period from socket backlog and echo RTT
+ */
+
+#include "rate_ctl.h"
+
+#include <string.h>
+
+static uint64_t clamp_period(const rate_ctl_t *rc, uint64_t p)
+{
+    if (p < rc->min_ns) return rc->min_ns;
+    if (p > rc->max_ns) return rc->max_ns;
+    return p;
+}
+
+void rate_ctl_init(rate_ctl_t *rc, uint64_t start_ns, uint64_t min_ns, uint64_t max_ns,
+                   uint64_t target_ns, uint64_t now_ns)
+{
+    memset(rc, 0, sizeof(*rc));
+    rc->min_ns = min_ns ? min_ns : 1;
+    rc->max_ns = max_ns > rc->min_ns ? max_ns : rc->min_ns;
+    rc->target_ns = target_ns;
+    rc->period_ns = clamp_period(rc, start_ns);
+    rc->lo_ns = rc->hi_ns = rc->period_ns;
+    rc->next_ns = now_ns + RATE_CTL_INTERVAL_NS;
+    rc->win_min_ns = rc->prev_min_ns = UINT64_MAX;
+    lat_hist_init(&rc->delay);
+}
+
+static void track_base_rtt(rate_ctl_t *rc, uint64_t rtt_ns)
+{
+    if (rtt_ns && rtt_ns < rc->win_min_ns) rc->win_min_ns = rtt_ns;
+    if (++rc->win_n >= RATE_CTL_BASE_WINDOW) {
+        // Forget old minima, so a route that got slower for good is not
+        // taken for a queue forever
+        rc->prev_min_ns = rc->win_min_ns;
+        rc->win_min_ns = UINT64_MAX;
+        rc->win_n = 0;
+    }
+    uint64_t base = rc->win_min_ns < rc->prev_min_ns ? rc->win_min_ns : rc->prev_min_ns;
+    rc->base_rtt_ns = base == UINT64_MAX ? 0 : base;
+}
+
+int rate_ctl_update(rate_ctl_t *rc, uint64_t now_ns, size_t backlog_frames, uint64_t rtt_ns)
+{
+    if (now_ns < rc->next_ns) return 0;
+
+    // Give a change at least two periods to show in the backlog
+    uint64_t iv = 2 * rc->period_ns;
+    rc->next_ns = now_ns + (iv > RATE_CTL_INTERVAL_NS ? iv : RATE_CTL_INTERVAL_NS);
+
+    uint64_t delay = (uint64_t)backlog_frames * rc->period_ns;
+
+    track_base_rtt(rc, rtt_ns);
+    if (rtt_ns && rc->base_rtt_ns && rtt_ns - rc->base_rtt_ns > delay) {
+        delay = rtt_ns - rc->base_rtt_ns;
+    }
+    lat_hist_add(&rc->delay, delay);
+    rc->last_backlog = backlog_frames;
+
+    uint64_t p = rc->period_ns;
+    if (delay > rc->target_ns && delay >= rc->last_delay_ns) {
+        p = clamp_period(rc, p + p / 2);
+    } else if (delay < rc->target_ns / 2) {
+        double lo = 1e9 / (double)rc->max_ns, hi = 1e9 / (double)rc->min_ns;
+        double hz = 1e9 / (double)p + (hi - lo) / RATE_CTL_RAMP_STEPS;
+        p = clamp_period(rc, (uint64_t)(1e9 / hz));
+    }
+    rc->last_delay_ns = delay;
+
+    if (p > rc->period_ns) rc->decreases++;
+    else if (p < rc->period_ns) rc->increases++;
+    else rc->holds++;
+
+    rc->period_ns = p;
+    if (p < rc->lo_ns) rc->lo_ns = p;
+    if (p > rc->hi_ns) rc->hi_ns = p;
+    return 1;
+}
+
+void rate_ctl_print(const rate_ctl_t *rc, const char *tag, FILE *f)
+{
+    fprintf(f, "%s period %.1f ms (%.1f Hz), bounds %.1f..%.1f ms, used %.1f..%.1f ms\n",
+            tag, rc->period_ns / 1e6, 1e9 / rc->period_ns, rc->min_ns / 1e6, rc->max_ns / 1e6,
+            rc->lo_ns / 1e6, rc->hi_ns / 1e6);
+    fprintf(f, "  %lu faster, %lu slower, %lu held; backlog %zu frames, base RTT %.2f ms\n",
+            rc->increases, rc->decreases, rc->holds, rc->last_backlog, rc->base_rtt_ns / 1e6);
+    lat_hist_print(&rc->delay, "  queueing delay", f);
+}
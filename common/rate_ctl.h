@@ -0,0 +1,90 @@
+/*
+ * rate_ctl.h - Adaptive send period from socket backlog and echo RTT
+ *
+ * A fixed period is only right while the link keeps up. When it does
+ * not, frames pile up in the socket's send queue and everything the
+ * receiver shows is as old as the queue is long. The controller picks
+ * the sample period within [min, max] so that the queueing delay stays
+ * under a target, AIMD style:
+ *
+ *   delay = max(backlog frames * period, RTT - base RTT)
+ *
+ *   delay > target, not shrinking  rate *= 2/3 (period * 1.5)
+ *   delay > target, shrinking      hold, the last cut is still draining
+ *   delay < target / 2             rate += (max rate - min rate) / 32
+ *   otherwise                      hold
+ *
+ * The backlog is counted in frames that were already queued before this
+ * tick's send: the kernel's unsent queue (TIOCOUTQ) plus what a short
+ * send() left in user space. Each of them has waited at least a period,
+ * so frames * period estimates how stale the receiver's data is (roughly:
+ * frames queued before a slow-down were produced faster).
+ *
+ * The RTT term is optional: the base RTT is the smallest RTT seen over
+ * the last two ~10 s windows, and what a control interval adds on top of
+ * it, judged by that interval's smallest sample, is a standing queue
+ * somewhere on the path.
+ *
+ *     rate_ctl_t rc;
+ *     rate_ctl_init(&rc, start_ns, min_ns, max_ns, 50 * 1000000ull, now);
+ *     ...
+ *     if (rate_ctl_update(&rc, now, backlog_frames, rtt_min_ns))
+ *         pacer.period_ns = rc.period_ns;
+ */
+
+#ifndef RATE_CTL_H
+#define RATE_CTL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "lat_hist.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RATE_CTL_INTERVAL_NS   200000000ull    // decisions at most this often
+#define RATE_CTL_BASE_WINDOW   50              // decisions per base RTT window
+#define RATE_CTL_RAMP_STEPS    32              // increases from min to max rate
+
+typedef struct {
+    uint64_t min_ns;                // period bounds
+    uint64_t max_ns;
+    uint64_t target_ns;             // acceptable queueing delay
+    uint64_t period_ns;             // current decision
+    uint64_t next_ns;               // earliest time of the next decision
+    uint64_t last_delay_ns;
+
+    uint64_t base_rtt_ns;           // 0 = no RTT seen yet
+    uint64_t win_min_ns;
+    uint64_t prev_min_ns;
+    unsigned win_n;
+
+    unsigned long increases;
+    unsigned long decreases;
+    unsigned long holds;
+    uint64_t lo_ns;                 // shortest/longest period used
+    uint64_t hi_ns;
+    size_t last_backlog;            // frames
+    lat_hist_t delay;               // estimated queueing delay per decision
+} rate_ctl_t;
+
+/* start_ns is clamped to [min_ns, max_ns]. */
+void rate_ctl_init(rate_ctl_t *rc, uint64_t start_ns, uint64_t min_ns, uint64_t max_ns,
+                   uint64_t target_ns, uint64_t now_ns);
+
+/* Feed the backlog and the smallest RTT since the last decision (0 =
+ * none). Returns 1 when a decision was taken and period_ns may have
+ * changed, 0 when it is too early. */
+int rate_ctl_update(rate_ctl_t *rc, uint64_t now_ns, size_t backlog_frames, uint64_t rtt_ns);
+
+/* Period, bounds, decisions and the queueing delay histogram. */
+void rate_ctl_print(const rate_ctl_t *rc, const char *tag, FILE *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RATE_CTL_H
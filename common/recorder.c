@@ -0,0 +1,624 @@
+/*
+ * recorder.c - Append-only recording of received frames, indexed by time
+ */
+
+#define _GNU_SOURCE
+#include "recorder.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "crc32c.h"
+
+#define REC_MAGIC     "TRECSG1"
+#define REC_VERSION   1
+#define REC_HDR_SIZE  4096          // records start on the second page
+#define REC_IDLE_US   2000          // flusher sleep when the queue is empty
+
+#define LOAD(p)      __atomic_load_n((p), __ATOMIC_RELAXED)
+#define BUMP(p, n)   __atomic_store_n((p), *(p) + (n), __ATOMIC_RELAXED)
+
+struct rec_seg_hdr {
+    char magic[8];
+    uint32_t version;
+    uint32_t index_every;
+    uint64_t seg_bytes;
+    uint64_t index_off;
+    uint64_t created_us;
+    // Valid once sealed is set; a crash leaves it 0 and readers scan instead
+    uint32_t sealed;
+    uint32_t reserved;
+    uint64_t data_end;
+    uint64_t records;
+    uint64_t index_n;
+    uint64_t first_us;
+    uint64_t last_us;
+};
+
+/* Record header; the frame follows and the record is padded to 8 bytes */
+typedef struct {
+    uint32_t crc;                   // CRC-32C of the rest of the header and the frame
+    uint8_t len;                    // frame bytes, never 0
+    uint8_t reserved[3];
+    uint64_t rx_us;
+    uint64_t key;
+} rec_hdr_t;
+
+typedef struct {
+    uint64_t t_us;                  // latest rx_us up to and including the record
+    uint64_t off;
+} rec_index_t;
+
+struct rec_slot {
+    uint64_t rx_us;
+    uint64_t key;
+    uint8_t len;
+    uint8_t frame[FRAME_MAX_SIZE];
+};
+
+TELEM_STATIC_ASSERT(sizeof(rec_seg_hdr_t) <= REC_HDR_SIZE, "segment header fits its page");
+TELEM_STATIC_ASSERT(sizeof(rec_hdr_t) == 24, "rec_hdr_t is part of the file format");
+TELEM_STATIC_ASSERT(FRAME_MAX_SIZE <= UINT8_MAX, "frame length is stored in a byte");
+
+static size_t rec_size(size_t len)
+{
+    return (sizeof(rec_hdr_t) + len + 7) & ~(size_t)7;
+}
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static uint64_t mono_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ull + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static rec_index_t *seg_index(const rec_seg_t *s)
+{
+    return (rec_index_t *)(s->map + s->index_off);
+}
+
+static size_t seg_index_cap(const rec_seg_t *s)
+{
+    return (s->map_len - s->index_off) / sizeof(rec_index_t);
+}
+
+/* Valid record at off, below limit? A torn or never written one fails the
+ * length or CRC check. */
+static int record_at(const uint8_t *map, size_t off, size_t limit, rec_entry_t *e)
+{
+    rec_hdr_t h;
+
+    if (off + sizeof(h) > limit) return 0;
+    memcpy(&h, map + off, sizeof(h));
+    if (h.len == 0 || h.len > FRAME_MAX_SIZE || off + rec_size(h.len) > limit) return 0;
+    if (crc32c(map + off + sizeof(h.crc), sizeof(h) - sizeof(h.crc) + h.len) != h.crc) return 0;
+
+    e->rx_us = h.rx_us;
+    e->key = h.key;
+    e->frame = map + off + sizeof(h);
+    e->len = h.len;
+    return 1;
+}
+
+/* Recover an unsealed segment's extent from the records themselves */
+static void seg_scan(rec_seg_t *s)
+{
+    rec_entry_t e;
+    size_t off = REC_HDR_SIZE;
+
+    s->records = 0;
+    s->first_us = s->last_us = s->index_max_us = 0;
+    while (record_at(s->map, off, s->index_off, &e)) {
+        if (s->records == 0) s->first_us = e.rx_us;
+        s->last_us = e.rx_us;
+        if (e.rx_us > s->index_max_us) s->index_max_us = e.rx_us;
+        s->records++;
+        off += rec_size(e.len);
+    }
+    s->data_end = off;
+
+    // Entries are written after their record; stop at one that is not
+    const rec_index_t *ix = seg_index(s);
+    size_t cap = seg_index_cap(s);
+    s->index_n = 0;
+    while (s->index_n < cap && ix[s->index_n].off >= REC_HDR_SIZE && ix[s->index_n].off < s->data_end &&
+           (s->index_n == 0 || ix[s->index_n].off > ix[s->index_n - 1].off)) {
+        s->index_n++;
+    }
+}
+
+static int seg_map(rec_seg_t *s, const char *path, int writable)
+{
+    struct stat st;
+
+    memset(s, 0, sizeof(*s));
+    s->fd = open(path, (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (s->fd < 0) return -1;
+    if (fstat(s->fd, &st) < 0) goto fail;
+    if (st.st_size < (off_t)REC_MIN_SEG_BYTES) {
+        errno = EINVAL;
+        goto fail;
+    }
+
+    s->map_len = (size_t)st.st_size;
+    void *p = mmap(NULL, s->map_len, PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, s->fd, 0);
+    if (p == MAP_FAILED) goto fail;
+    s->map = (uint8_t *)p;
+    s->hdr = (rec_seg_hdr_t *)p;
+
+    const rec_seg_hdr_t *h = s->hdr;
+    if (memcmp(h->magic, REC_MAGIC, sizeof(h->magic)) != 0 || h->version != REC_VERSION ||
+        h->index_every != REC_INDEX_EVERY || h->seg_bytes != s->map_len ||
+        h->index_off <= REC_HDR_SIZE || h->index_off >= s->map_len || h->index_off % 8 != 0) {
+        errno = EINVAL;
+        goto fail;
+    }
+    s->index_off = h->index_off;
+
+    if (h->sealed && h->data_end >= REC_HDR_SIZE && h->data_end <= s->index_off &&
+        h->index_n <= seg_index_cap(s)) {
+        s->sealed = 1;
+        s->data_end = h->data_end;
+        s->records = h->records;
+        s->index_n = h->index_n;
+        s->first_us = h->first_us;
+        s->last_us = s->index_max_us = h->last_us;
+    } else {
+        seg_scan(s);
+    }
+    return 0;
+
+fail:;
+    int err = errno;
+    rec_seg_close(s);
+    errno = err;
+    return -1;
+}
+
+int rec_seg_open(rec_seg_t *s, const char *path)
+{
+    return seg_map(s, path, 0);
+}
+
+void rec_seg_close(rec_seg_t *s)
+{
+    if (s->map) munmap(s->map, s->map_len);
+    if (s->fd >= 0) close(s->fd);
+    memset(s, 0, sizeof(*s));
+    s->fd = -1;
+}
+
+size_t rec_seg_begin(const rec_seg_t *s)
+{
+    (void)s;
+    return REC_HDR_SIZE;
+}
+
+size_t rec_seg_seek(const rec_seg_t *s, uint64_t t_us)
+{
+    const rec_index_t *ix = seg_index(s);
+    size_t lo = 0, hi = s->index_n;
+    rec_entry_t e;
+
+    // Last entry whose running maximum is still before t_us: every record
+    // up to it is too early, and one of the next REC_INDEX_EVERY is not
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ix[mid].t_us < t_us) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t off = lo > 0 ? ix[lo - 1].off : REC_HDR_SIZE;
+
+    while (record_at(s->map, off, s->data_end, &e) && e.rx_us < t_us) off += rec_size(e.len);
+    return off < s->data_end ? off : s->data_end;
+}
+
+int rec_seg_next(const rec_seg_t *s, size_t *off, rec_entry_t *e)
+{
+    if (!record_at(s->map, *off, s->data_end, e)) return 0;
+    *off += rec_size(e->len);
+    return 1;
+}
+
+/* ---- Segment files ---- */
+
+static int seg_number(const char *name, uint32_t *no)
+{
+    unsigned n;
+    int end = 0;
+
+    if (sscanf(name, "seg-%8u.trec%n", &n, &end) != 1 || end == 0 || name[end] != '\0') return -1;
+    *no = n;
+    return 0;
+}
+
+typedef struct {
+    uint32_t no;
+    char *path;
+} seg_name_t;
+
+static int cmp_seg_name(const void *a, const void *b)
+{
+    uint32_t x = ((const seg_name_t *)a)->no, y = ((const seg_name_t *)b)->no;
+    return (x > y) - (x < y);
+}
+
+int rec_list(const char *dir, char ***paths)
+{
+    DIR *d = opendir(dir);
+    struct dirent *de;
+    seg_name_t *v = NULL;
+    size_t n = 0, cap = 0;
+
+    *paths = NULL;
+    if (!d) return -1;
+    while ((de = readdir(d)) != NULL) {
+        uint32_t no;
+        if (seg_number(de->d_name, &no) < 0) continue;
+        if (n == cap) {
+            cap = cap ? 2 * cap : 16;
+            seg_name_t *nv = realloc(v, cap * sizeof(*v));
+            if (!nv) goto fail;
+            v = nv;
+        }
+        size_t len = strlen(dir) + strlen(de->d_name) + 2;
+        v[n].no = no;
+        v[n].path = malloc(len);
+        if (!v[n].path) goto fail;
+        snprintf(v[n].path, len, "%s/%s", dir, de->d_name);
+        n++;
+    }
+    closedir(d);
+    d = NULL;
+
+    qsort(v, n, sizeof(*v), cmp_seg_name);
+    *paths = malloc((n ? n : 1) * sizeof(char *));
+    if (!*paths) goto fail;
+    for (size_t i = 0; i < n; i++) (*paths)[i] = v[i].path;
+    free(v);
+    return (int)n;
+
+fail:;
+    int err = errno;
+    if (d) closedir(d);
+    for (size_t i = 0; i < n; i++) free(v[i].path);
+    free(v);
+    errno = err;
+    return -1;
+}
+
+void rec_list_free(char **paths, int n)
+{
+    for (int i = 0; i < n; i++) free(paths[i]);
+    free(paths);
+}
+
+/* msync the page-aligned span covering [from, to) */
+static int sync_range(const rec_seg_t *s, size_t from, size_t to)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    from &= ~(page - 1);
+    if (to <= from) return 0;
+    return msync(s->map + from, to - from, MS_SYNC);
+}
+
+/* Data and index reach the disk before the header claims them */
+static int seg_seal(rec_seg_t *s)
+{
+    rec_seg_hdr_t *h = s->hdr;
+
+    if (sync_range(s, REC_HDR_SIZE, s->data_end) < 0 ||
+        sync_range(s, s->index_off, s->index_off + s->index_n * sizeof(rec_index_t)) < 0)
+        return -1;
+    h->data_end = s->data_end;
+    h->records = s->records;
+    h->index_n = s->index_n;
+    h->first_us = s->first_us;
+    h->last_us = s->last_us;
+    h->sealed = 1;
+    s->sealed = 1;
+    return sync_range(s, 0, REC_HDR_SIZE);
+}
+
+static int seg_create(recorder_t *rec)
+{
+    rec_seg_t *s = &rec->seg;
+    char path[REC_PATH_LEN + 32];
+    int err;
+
+    snprintf(path, sizeof(path), "%s/seg-%08u.trec", rec->dir, rec->seg_no + 1);
+    memset(s, 0, sizeof(*s));
+    s->fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (s->fd < 0) return -1;
+
+    // Allocate the blocks now: a full disk must fail here, not as a
+    // SIGBUS on a store into the mapping
+    if ((err = posix_fallocate(s->fd, 0, (off_t)rec->seg_bytes)) != 0) {
+        errno = err;
+        goto fail;
+    }
+    s->map_len = rec->seg_bytes;
+    void *p = mmap(NULL, s->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+    if (p == MAP_FAILED) goto fail;
+    s->map = (uint8_t *)p;
+    s->hdr = (rec_seg_hdr_t *)p;
+
+    // One 16-byte entry per REC_INDEX_EVERY records of at least 40 bytes
+    // needs 1/80 of the data; 1/64 leaves room to spare
+    s->index_off = (rec->seg_bytes - rec->seg_bytes / 64) & ~(size_t)4095;
+    s->data_end = REC_HDR_SIZE;
+
+    rec_seg_hdr_t *h = s->hdr;
+    memcpy(h->magic, REC_MAGIC, sizeof(h->magic));
+    h->version = REC_VERSION;
+    h->index_every = REC_INDEX_EVERY;
+    h->seg_bytes = rec->seg_bytes;
+    h->index_off = s->index_off;
+    h->created_us = now_us();
+
+    // Make the new file's name durable along with its contents
+    int dfd = open(rec->dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd >= 0) {
+        fsync(dfd);
+        close(dfd);
+    }
+
+    rec->seg_no++;
+    rec->synced = 0;
+    rec->index_synced = 0;
+    BUMP(&rec->segments, 1);
+    return 0;
+
+fail:
+    err = errno;
+    rec_seg_close(s);
+    unlink(path);
+    errno = err;
+    return -1;
+}
+
+static int seg_finish(recorder_t *rec)
+{
+    int ret = seg_seal(&rec->seg);
+    rec_seg_close(&rec->seg);
+    return ret;
+}
+
+static int rec_sync(recorder_t *rec)
+{
+    rec_seg_t *s = &rec->seg;
+    size_t index_end = s->index_off + s->index_n * sizeof(rec_index_t);
+
+    if (s->fd < 0) return 0;
+    if (sync_range(s, rec->synced, s->data_end) < 0 ||
+        sync_range(s, s->index_off + rec->index_synced, index_end) < 0)
+        return -1;
+    rec->synced = s->data_end;
+    rec->index_synced = index_end - s->index_off;
+    BUMP(&rec->syncs, 1);
+    return 0;
+}
+
+static int rec_append(recorder_t *rec, const rec_slot_t *q)
+{
+    rec_seg_t *s = &rec->seg;
+    size_t need = rec_size(q->len);
+
+    if (s->fd < 0 || s->data_end + need > s->index_off ||
+        (s->records % REC_INDEX_EVERY == 0 && s->index_n == seg_index_cap(s))) {
+        if (s->fd >= 0 && seg_finish(rec) < 0) return -1;
+        if (seg_create(rec) < 0) return -1;
+    }
+
+    uint8_t *p = s->map + s->data_end;
+    rec_hdr_t h;
+    memset(&h, 0, sizeof(h));
+    h.len = q->len;
+    h.rx_us = q->rx_us;
+    h.key = q->key;
+    memcpy(p + sizeof(h.crc), (const uint8_t *)&h + sizeof(h.crc), sizeof(h) - sizeof(h.crc));
+    memcpy(p + sizeof(h), q->frame, q->len);
+    memset(p + sizeof(h) + q->len, 0, need - sizeof(h) - q->len);
+    h.crc = crc32c(p + sizeof(h.crc), sizeof(h) - sizeof(h.crc) + q->len);
+    memcpy(p, &h.crc, sizeof(h.crc));
+
+    if (q->rx_us > s->index_max_us) s->index_max_us = q->rx_us;
+    if (s->records % REC_INDEX_EVERY == 0) {
+        rec_index_t *ix = &seg_index(s)[s->index_n++];
+        ix->t_us = s->index_max_us;
+        ix->off = s->data_end;
+    }
+    if (s->records == 0) s->first_us = q->rx_us;
+    s->last_us = q->rx_us;
+    s->records++;
+    s->data_end += need;
+
+    BUMP(&rec->written, 1);
+    BUMP(&rec->bytes, need);
+    return 0;
+}
+
+static size_t rec_drain(recorder_t *rec)
+{
+    uint64_t head = rec->q_head;
+    uint64_t tail = __atomic_load_n(&rec->q_tail, __ATOMIC_ACQUIRE);
+    size_t n = 0;
+
+    for (; head != tail; head++, n++) {
+        if (rec_append(rec, &rec->q[head & rec->q_mask]) < 0) {
+            __atomic_store_n(&rec->error, errno ? errno : EIO, __ATOMIC_RELAXED);
+            break;
+        }
+        __atomic_store_n(&rec->q_head, head + 1, __ATOMIC_RELEASE);
+    }
+    return n;
+}
+
+static void *rec_flusher(void *arg)
+{
+    recorder_t *rec = (recorder_t *)arg;
+    uint64_t last_sync = mono_ms();
+
+    while (!LOAD(&rec->error)) {
+        // Read stop first: whatever was queued before it is drained below
+        int stop = __atomic_load_n(&rec->stop, __ATOMIC_ACQUIRE);
+        size_t n = rec_drain(rec);
+
+        if (rec->sync_ms && mono_ms() - last_sync >= rec->sync_ms) {
+            if (rec_sync(rec) < 0) __atomic_store_n(&rec->error, errno, __ATOMIC_RELAXED);
+            last_sync = mono_ms();
+        }
+        if (n == 0) {
+            if (stop) break;
+            struct timespec ts = { 0, REC_IDLE_US * 1000L };
+            nanosleep(&ts, NULL);
+        }
+    }
+    if (rec->seg.fd >= 0 && seg_finish(rec) < 0 && !LOAD(&rec->error))
+        __atomic_store_n(&rec->error, errno, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+/* Cut a crashed segment at its last valid record and seal it; it is never
+ * appended to again. Returns records kept, or -1. */
+static long seg_repair(const char *path, int *repaired)
+{
+    rec_seg_t s;
+
+    *repaired = 0;
+    if (seg_map(&s, path, 1) < 0) return -1;
+    long records = (long)s.records;
+    if (!s.sealed) {
+        if (seg_seal(&s) < 0) records = -1;
+        else *repaired = 1;
+    }
+    int err = errno;
+    rec_seg_close(&s);
+    errno = err;
+    return records;
+}
+
+int recorder_open(recorder_t *rec, const char *dir, size_t seg_bytes, size_t queue_frames,
+                  unsigned sync_ms)
+{
+    char **paths;
+    size_t q = 1;
+
+    memset(rec, 0, sizeof(*rec));
+    rec->seg.fd = -1;
+    if (seg_bytes < REC_MIN_SEG_BYTES || seg_bytes % 4096 != 0 || strlen(dir) >= sizeof(rec->dir) ||
+        queue_frames > (1u << 24)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (queue_frames == 0) queue_frames = REC_DEFAULT_QUEUE;
+    while (q < queue_frames) q <<= 1;
+
+    snprintf(rec->dir, sizeof(rec->dir), "%s", dir);
+    rec->seg_bytes = seg_bytes;
+    rec->sync_ms = sync_ms;
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) return -1;
+
+    int n = rec_list(dir, &paths);
+    if (n < 0) return -1;
+    for (int i = 0; i < n; i++) {
+        const char *base = strrchr(paths[i], '/') + 1;
+        int repaired;
+        uint32_t no = 0;
+        seg_number(base, &no);
+        if (no > rec->seg_no) rec->seg_no = no;
+
+        long kept = seg_repair(paths[i], &repaired);
+        if (kept < 0 && errno != EINVAL) {
+            int err = errno;
+            rec_list_free(paths, n);
+            errno = err;
+            return -1;
+        }
+        if (repaired) {
+            rec->repaired++;
+            rec->recovered += (unsigned long)kept;
+        }
+    }
+    rec_list_free(paths, n);
+
+    rec->q = calloc(q, sizeof(rec_slot_t));
+    if (!rec->q) return -1;
+    rec->q_mask = q - 1;
+
+    int err = pthread_create(&rec->thread, NULL, rec_flusher, rec);
+    if (err != 0) {
+        free(rec->q);
+        rec->q = NULL;
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+int recorder_put(recorder_t *rec, uint64_t key, uint64_t rx_us, const uint8_t *frame, size_t len)
+{
+    uint64_t tail = rec->q_tail;
+
+    if (len == 0 || len > FRAME_MAX_SIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (tail - __atomic_load_n(&rec->q_head, __ATOMIC_ACQUIRE) > rec->q_mask) {
+        rec->dropped++;
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    rec_slot_t *q = &rec->q[tail & rec->q_mask];
+    q->rx_us = rx_us;
+    q->key = key;
+    q->len = (uint8_t)len;
+    memcpy(q->frame, frame, len);
+    __atomic_store_n(&rec->q_tail, tail + 1, __ATOMIC_RELEASE);
+    rec->put++;
+    return 0;
+}
+
+size_t recorder_backlog(const recorder_t *rec)
+{
+    return (size_t)(__atomic_load_n(&rec->q_tail, __ATOMIC_ACQUIRE) -
+                    __atomic_load_n(&rec->q_head, __ATOMIC_ACQUIRE));
+}
+
+void recorder_close(recorder_t *rec)
+{
+    if (!rec->q) return;
+    __atomic_store_n(&rec->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(rec->thread, NULL);
+    free(rec->q);
+    rec->q = NULL;
+}
+
+void recorder_print(const recorder_t *rec, FILE *f)
+{
+    fprintf(f, "[INFO] Recorder (%s): %lu frames, %llu bytes in %lu segment(s), %lu dropped, "
+               "%zu queued, %lu syncs\n",
+            rec->dir, LOAD(&rec->written), LOAD(&rec->bytes), LOAD(&rec->segments), rec->dropped,
+            rec->q ? recorder_backlog(rec) : 0, LOAD(&rec->syncs));
+    if (rec->repaired > 0)
+        fprintf(f, "[WARN] Recorder: %lu segment(s) not closed cleanly, %lu frames recovered\n",
+                rec->repaired, rec->recovered);
+    int err = LOAD(&rec->error);
+    if (err)
+        fprintf(f, "[ERROR] Recorder stopped: %s\n", strerror(err));
+}
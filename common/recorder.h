@@ -0,0 +1,162 @@
+/*
+ * recorder.h - Append-only recording of received frames, indexed by time
+ *
+ * Frames are kept exactly as they arrived (v1 or v2 bytes, CRC included)
+ * with the server's receive time and the sender's vehicle_key(), in a
+ * directory of fixed-size segment files:
+ *
+ *   DIR/seg-00000001.trec  seg-00000002.trec  ...
+ *
+ * A segment is preallocated and mapped, and laid out as
+ *
+ *   header (4 KiB) | record record ... -> free         | time index
+ *
+ * Each record carries a CRC-32C over its own header and frame, so a record
+ * cut short by a crash is recognised and the segment ends just before it.
+ * Every REC_INDEX_EVERY records the writer appends (time, offset) to the
+ * index at the segment's tail; rec_seg_seek() binary-searches it and then
+ * walks at most REC_INDEX_EVERY records, instead of scanning the segment.
+ *
+ * The receive loop only copies the frame into a queue (recorder_put());
+ * a flusher thread owns the mapping, writes records, takes the page faults
+ * and msync()s every sync_ms. A segment that was not closed cleanly is
+ * cut at its last valid record and sealed when the directory is next
+ * opened for recording; until then readers scan it to find that record.
+ *
+ *     recorder_t rec;
+ *     recorder_open(&rec, "/var/lib/telem", 64 << 20, 0, 1000);
+ *     recorder_put(&rec, key, rx_us, frame, len);     // receive loop
+ *     recorder_close(&rec);
+ *
+ *     rec_seg_t s;                                    // any process
+ *     rec_seg_open(&s, "/var/lib/telem/seg-00000001.trec");
+ *     for (size_t off = rec_seg_seek(&s, from_us); rec_seg_next(&s, &off, &e) > 0; ) ...
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "telemetry_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REC_PATH_LEN          256
+#define REC_INDEX_EVERY       32            // records per index entry
+#define REC_DEFAULT_SEG_BYTES (64u << 20)
+#define REC_MIN_SEG_BYTES     (1u << 20)
+#define REC_DEFAULT_QUEUE     8192          // frames between receive loop and flusher
+#define REC_DEFAULT_SYNC_MS   1000
+
+/* One recorded frame. frame points into the segment mapping. */
+typedef struct {
+    uint64_t rx_us;                 // server CLOCK_REALTIME at receipt
+    uint64_t key;                   // vehicle_key() of the sender
+    const uint8_t *frame;
+    size_t len;
+} rec_entry_t;
+
+typedef struct rec_seg_hdr rec_seg_hdr_t;
+
+/* A segment mapped for reading (or, inside the recorder, for writing) */
+typedef struct {
+    int fd;
+    uint8_t *map;
+    size_t map_len;
+    rec_seg_hdr_t *hdr;
+    size_t data_end;                // offset after the last valid record
+    size_t index_off;               // start of the index region
+    size_t index_n;                 // valid index entries
+    uint64_t records;
+    uint64_t first_us, last_us;     // rx_us of the first and last record
+    uint64_t index_max_us;          // latest time put in the index
+    int sealed;                     // closed cleanly (or repaired)
+} rec_seg_t;
+
+typedef struct rec_slot rec_slot_t;
+
+typedef struct {
+    char dir[REC_PATH_LEN];
+    size_t seg_bytes;
+    unsigned sync_ms;
+
+    // Receive loop -> flusher, single producer / single consumer
+    rec_slot_t *q;
+    size_t q_mask;
+    uint64_t q_head;                // consumed; accessed atomically
+    uint64_t q_tail;                // produced; accessed atomically
+    pthread_t thread;
+    int stop;                       // accessed atomically
+
+    // Flusher thread only
+    rec_seg_t seg;                  // segment being written, fd < 0 = none
+    uint32_t seg_no;
+    size_t synced;                  // data offset already msync()ed
+    size_t index_synced;            // index bytes already msync()ed
+
+    // Counters; put/dropped belong to the producer, the rest to the flusher
+    unsigned long put;
+    unsigned long dropped;          // queue full
+    unsigned long written;
+    unsigned long long bytes;       // record bytes written
+    unsigned long segments;         // created by this recorder
+    unsigned long syncs;
+    unsigned long repaired;         // unsealed segments found at open
+    unsigned long recovered;        // valid records in them
+    int error;                      // errno that stopped the flusher, 0 = none
+} recorder_t;
+
+/* ---- Writing ---- */
+
+/* Create dir if needed, repair segments left unsealed by a crash, and
+ * start the flusher. seg_bytes >= REC_MIN_SEG_BYTES; queue_frames is
+ * rounded up to a power of two (0 = REC_DEFAULT_QUEUE); sync_ms 0 leaves
+ * flushing to the kernel. Returns 0, or -1 with errno set. */
+int recorder_open(recorder_t *rec, const char *dir, size_t seg_bytes, size_t queue_frames,
+                  unsigned sync_ms);
+
+/* Queue one frame (len <= FRAME_MAX_SIZE). Never blocks or touches the
+ * disk; returns 0, or -1 if the queue is full (counted in dropped). */
+int recorder_put(recorder_t *rec, uint64_t key, uint64_t rx_us, const uint8_t *frame, size_t len);
+
+/* Frames queued but not yet written */
+size_t recorder_backlog(const recorder_t *rec);
+
+/* Write everything queued, seal the current segment, stop the flusher. */
+void recorder_close(recorder_t *rec);
+
+void recorder_print(const recorder_t *rec, FILE *f);
+
+/* ---- Reading ---- */
+
+/* Map a segment read-only. An unsealed segment is scanned to its last
+ * valid record. Returns 0, or -1 with errno set (EINVAL: not a segment). */
+int rec_seg_open(rec_seg_t *s, const char *path);
+void rec_seg_close(rec_seg_t *s);
+
+/* Offset of the first record at or after t_us (data_end if none).
+ * O(log n) in the index plus at most REC_INDEX_EVERY records. */
+size_t rec_seg_seek(const rec_seg_t *s, uint64_t t_us);
+
+/* Offset of the first record */
+size_t rec_seg_begin(const rec_seg_t *s);
+
+/* Read the record at *off and advance it. Returns 1, or 0 at the end. */
+int rec_seg_next(const rec_seg_t *s, size_t *off, rec_entry_t *e);
+
+/* Segment paths under dir in recording order, in a malloc'd array of
+ * malloc'd strings. Returns the count, or -1 with errno set. */
+int rec_list(const char *dir, char ***paths);
+void rec_list_free(char **paths, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RECORDER_H
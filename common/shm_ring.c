@@ -0,0 +1,290 @@
+/*
+ * shm_ring.c - Decoded frames in shared memory, one writer, many readers
+ */
+
+#define _GNU_SOURCE
+#include "shm_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define SHM_RING_MAGIC    0x474E5254u   // "TRNG"
+#define SHM_RING_VERSION  1
+#define SHM_RING_WORDS    (sizeof(shm_ring_rec_t) / sizeof(uint64_t))
+
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010
+#endif
+
+TELEM_STATIC_ASSERT(sizeof(shm_ring_rec_t) == 56, "shm_ring_rec_t is part of the shared layout");
+
+struct shm_ring_hdr {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t rec_size;
+    uint32_t nslots;
+    uint8_t pad1[48];
+    uint64_t write_pos;             // records published; own cache line
+    uint8_t pad2[56];
+};
+
+/* seq = 2 * pos + 1 while the record for ring position pos is written,
+ * 2 * pos + 2 once it is complete. Words are copied with relaxed atomics
+ * so readers racing the writer get caught by seq, not a data race. */
+struct shm_ring_slot {
+    uint64_t seq;
+    uint64_t w[SHM_RING_WORDS];
+};
+
+TELEM_STATIC_ASSERT(sizeof(struct shm_ring_hdr) == 128, "header is two cache lines");
+TELEM_STATIC_ASSERT(sizeof(struct shm_ring_slot) == 64, "one cache line per slot");
+
+uint64_t shm_ring_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static size_t ring_bytes(size_t nslots)
+{
+    return sizeof(shm_ring_hdr_t) + nslots * sizeof(shm_ring_slot_t);
+}
+
+int shm_ring_create(shm_ring_t *r, size_t nslots)
+{
+    size_t n = 1;
+
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+    if (nslots == 0 || nslots > (1u << 24)) {
+        errno = EINVAL;
+        return -1;
+    }
+    while (n < nslots) n <<= 1;
+
+    r->fd = memfd_create("telem-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (r->fd < 0) return -1;
+
+    r->map_len = ring_bytes(n);
+    if (ftruncate(r->fd, (off_t)r->map_len) < 0) goto fail;
+
+    void *p = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, 0);
+    if (p == MAP_FAILED) goto fail;
+    r->hdr = (shm_ring_hdr_t *)p;
+    r->slots = (shm_ring_slot_t *)((uint8_t *)p + sizeof(shm_ring_hdr_t));
+    r->nslots = n;
+    r->writable = 1;
+
+    r->hdr->version = SHM_RING_VERSION;
+    r->hdr->rec_size = sizeof(shm_ring_rec_t);
+    r->hdr->nslots = (uint32_t)n;
+    __atomic_store_n(&r->hdr->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+
+    // A reader must not see the file shrink under its mapping (SIGBUS),
+    // nor map it writable. Our own mapping predates the write seal.
+    if (fcntl(r->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) < 0) goto fail;
+    if (fcntl(r->fd, F_ADD_SEALS, F_SEAL_FUTURE_WRITE) == 0) {     // Linux 5.1+
+        r->write_sealed = 1;
+        fcntl(r->fd, F_ADD_SEALS, F_SEAL_SEAL);
+    }
+    return 0;
+
+fail:;
+    int err = errno;
+    shm_ring_close(r);
+    errno = err;
+    return -1;
+}
+
+void shm_ring_publish(shm_ring_t *r, const shm_ring_rec_t *rec)
+{
+    uint64_t w[SHM_RING_WORDS];
+    uint64_t pos = r->hdr->write_pos;
+    shm_ring_slot_t *s = &r->slots[pos & (r->nslots - 1)];
+
+    memcpy(w, rec, sizeof(w));
+    w[0] = shm_ring_now_ns();       // pub_ns
+
+    __atomic_store_n(&s->seq, 2 * pos + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);    // odd seq before any word
+    for (size_t i = 0; i < SHM_RING_WORDS; i++) __atomic_store_n(&s->w[i], w[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seq, 2 * pos + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->hdr->write_pos, pos + 1, __ATOMIC_RELEASE);
+}
+
+int shm_ring_attach(shm_ring_t *r, int fd)
+{
+    struct stat st;
+    shm_ring_hdr_t hdr;
+
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (fstat(fd, &st) < 0 || seals < 0) goto fail;
+    if (!(seals & F_SEAL_SHRINK) || (size_t)st.st_size < sizeof(hdr)) {
+        errno = EPROTO;
+        goto fail;
+    }
+    if (pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) goto fail;
+    if (hdr.magic != SHM_RING_MAGIC || hdr.version != SHM_RING_VERSION ||
+        hdr.rec_size != sizeof(shm_ring_rec_t) || hdr.nslots == 0 ||
+        (hdr.nslots & (hdr.nslots - 1)) || (size_t)st.st_size != ring_bytes(hdr.nslots)) {
+        errno = EPROTO;
+        goto fail;
+    }
+
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) goto fail;
+    r->hdr = (shm_ring_hdr_t *)p;
+    r->slots = (shm_ring_slot_t *)((uint8_t *)p + sizeof(shm_ring_hdr_t));
+    r->nslots = hdr.nslots;
+    r->map_len = (size_t)st.st_size;
+    return 0;
+
+fail:;
+    int err = errno;
+    shm_ring_close(r);
+    errno = err;
+    return -1;
+}
+
+int shm_ring_connect(shm_ring_t *r, const char *path)
+{
+    struct sockaddr_un un;
+
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+    if (strlen(path) >= sizeof(un.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&un, 0, sizeof(un));
+    un.sun_family = AF_UNIX;
+    memcpy(un.sun_path, path, strlen(path) + 1);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return -1;
+    int fd = -1;
+    if (connect(sock, (const struct sockaddr *)&un, sizeof(un)) == 0) fd = shm_ring_recv_fd(sock);
+    int err = errno;
+    close(sock);
+    if (fd < 0) {
+        errno = err;
+        return -1;
+    }
+    return shm_ring_attach(r, fd);
+}
+
+void shm_ring_close(shm_ring_t *r)
+{
+    if (r->hdr) munmap(r->hdr, r->map_len);
+    if (r->fd >= 0) close(r->fd);
+    r->hdr = NULL;
+    r->slots = NULL;
+    r->fd = -1;
+}
+
+int shm_ring_send_fd(int sock, int fd)
+{
+    char tag = 'R';
+    struct iovec iov = { .iov_base = &tag, .iov_len = 1 };
+    union {
+        struct cmsghdr h;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+    struct msghdr msg = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = ctl.buf, .msg_controllen = sizeof(ctl.buf),
+    };
+
+    memset(&ctl, 0, sizeof(ctl));
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(c), &fd, sizeof(int));
+
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) == 1 ? 0 : -1;
+}
+
+int shm_ring_recv_fd(int sock)
+{
+    char tag;
+    struct iovec iov = { .iov_base = &tag, .iov_len = 1 };
+    union {
+        struct cmsghdr h;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+    struct msghdr msg = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = ctl.buf, .msg_controllen = sizeof(ctl.buf),
+    };
+
+    ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    if (n < 0) return -1;
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    if (n != 1 || !c || c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS ||
+        c->cmsg_len != CMSG_LEN(sizeof(int))) {
+        errno = EPROTO;
+        return -1;
+    }
+    int fd;
+    memcpy(&fd, CMSG_DATA(c), sizeof(int));
+    return fd;
+}
+
+uint64_t shm_ring_published(const shm_ring_t *r)
+{
+    return __atomic_load_n(&r->hdr->write_pos, __ATOMIC_ACQUIRE);
+}
+
+void shm_ring_reader_init(shm_ring_reader_t *rd, const shm_ring_t *r)
+{
+    memset(rd, 0, sizeof(*rd));
+    rd->r = r;
+    rd->pos = shm_ring_published(r);
+}
+
+int shm_ring_next(shm_ring_reader_t *rd, shm_ring_rec_t *out)
+{
+    const shm_ring_t *r = rd->r;
+    uint64_t w[SHM_RING_WORDS];
+
+    for (;;) {
+        uint64_t wp = shm_ring_published(r);
+        if (rd->pos >= wp) return 0;
+
+        // Lapped: everything older than one ring is gone
+        if (wp - rd->pos > r->nslots) {
+            rd->lost += wp - r->nslots - rd->pos;
+            rd->pos = wp - r->nslots;
+        }
+
+        const shm_ring_slot_t *s = &r->slots[rd->pos & (r->nslots - 1)];
+        uint64_t want = 2 * rd->pos + 2;
+        uint64_t s0 = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        if (s0 == want) {
+            for (size_t i = 0; i < SHM_RING_WORDS; i++) w[i] = __atomic_load_n(&s->w[i], __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);    // words before the re-check
+            if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == want) {
+                memcpy(out, w, sizeof(*out));
+                rd->pos++;
+                rd->read++;
+                return 1;
+            }
+        }
+        // The writer came round again while we looked: skip the record
+        rd->lost++;
+        rd->pos++;
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ * shm_ring.h - Decoded frames in shared memory, one writer, many readers
+ *
+ * The receiver publishes every decoded frame into a ring of fixed 64-byte
+ * slots in a memfd. Readers (the GUI, tools) get the memfd over a Unix
+ * socket (SCM_RIGHTS) and map it read-only, so they can come and go, or
+ * stall, without touching the link or slowing the writer down.
+ *
+ * The writer never waits: when the ring is full it overwrites the oldest
+ * slot. Every slot carries the ring position it holds (a sequence count,
+ * odd while being written), so a reader that fell more than a ring behind
+ * notices, counts what it missed and carries on from the oldest record
+ * still there. Readers poll; there is no wake-up.
+ *
+ * The file is sealed against resizing before it is handed out, and on
+ * Linux 5.1+ against new writable mappings (write_sealed says which).
+ *
+ *     shm_ring_t r;                            // receiver
+ *     shm_ring_create(&r, 4096);
+ *     shm_ring_publish(&r, &rec);
+ *     shm_ring_send_fd(client_sock, r.fd);
+ *
+ *     shm_ring_t r;                            // reader
+ *     shm_ring_reader_t rd;
+ *     shm_ring_connect(&r, "/tmp/telem.ring");
+ *     shm_ring_reader_init(&rd, &r);
+ *     while (shm_ring_next(&rd, &rec) > 0) ...
+ */
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHM_RING_DEFAULT_SLOTS 4096
+
+/* One decoded frame */
+typedef struct {
+    uint64_t pub_ns;                // CLOCK_MONOTONIC at publish (shm_ring_now_ns)
+    uint64_t rx_us;                 // CLOCK_REALTIME at receive
+    uint64_t key;                   // vehicle_key() of the sender
+    uint64_t ts_us;                 // v2: sender's stamp
+    uint32_t seq;                   // v2: sender's sequence number
+    uint8_t version;
+    uint8_t type;                   // FRAME_TYPE_TELEMETRY or _DELTA
+    uint8_t pad[2];
+    telemetry_t telem;
+} shm_ring_rec_t;
+
+typedef struct shm_ring_hdr shm_ring_hdr_t;
+typedef struct shm_ring_slot shm_ring_slot_t;
+
+typedef struct {
+    shm_ring_hdr_t *hdr;
+    shm_ring_slot_t *slots;
+    size_t nslots;                  // power of two
+    size_t map_len;
+    int fd;
+    int writable;
+    int write_sealed;               // readers cannot map it writable (Linux 5.1+)
+} shm_ring_t;
+
+typedef struct {
+    const shm_ring_t *r;
+    uint64_t pos;                   // next ring position to read
+    unsigned long read;
+    unsigned long lost;             // overwritten before they were read
+} shm_ring_reader_t;
+
+/* Writer: a new sealed memfd with nslots (rounded up to a power of two).
+ * Returns 0, or -1 with errno set. An older kernel without the write seal
+ * is not an error; check write_sealed. */
+int shm_ring_create(shm_ring_t *r, size_t nslots);
+
+/* Stamp pub_ns and store rec in the next slot, overwriting the oldest. */
+void shm_ring_publish(shm_ring_t *r, const shm_ring_rec_t *rec);
+
+/* Reader: map a ring received from the writer. Takes ownership of fd.
+ * Returns 0, or -1 with errno set (EPROTO for a foreign file). */
+int shm_ring_attach(shm_ring_t *r, int fd);
+
+/* Reader: connect to the writer's Unix socket, receive the fd, attach. */
+int shm_ring_connect(shm_ring_t *r, const char *path);
+
+void shm_ring_close(shm_ring_t *r);
+
+/* Pass a descriptor over a connected Unix socket. Returns 0 or -1. */
+int shm_ring_send_fd(int sock, int fd);
+/* Returns the received descriptor, or -1 with errno set. */
+int shm_ring_recv_fd(int sock);
+
+/* Start after the newest record: only frames published from now on. */
+void shm_ring_reader_init(shm_ring_reader_t *rd, const shm_ring_t *r);
+
+/* Copy the next record. Returns 1, or 0 when the reader is caught up. */
+int shm_ring_next(shm_ring_reader_t *rd, shm_ring_rec_t *out);
+
+/* Records published so far */
+uint64_t shm_ring_published(const shm_ring_t *r);
+
+uint64_t shm_ring_now_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SHM_RING_H
@@ -0,0 +1,220 @@
+/*
+ * telem_out.c - Machine-readable telemetry output (NDJSON, CSV, binary)
+ *
+ * No printf on the hot path: keys and separators are string constants
+ * copied with memcpy, numbers are converted by hand.
+ */
+
+#include "telem_out.h"
+#include "vehicle_store.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PUT_LIT(p, s) (memcpy((p), (s), sizeof(s) - 1), (p) += sizeof(s) - 1)
+
+static char *put_u64(char *p, uint64_t v)
+{
+    char tmp[20];
+    int n = 0;
+
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) *p++ = tmp[--n];
+    return p;
+}
+
+/* Same text as vehicle_key_str() */
+static char *put_vehicle(char *p, uint64_t key)
+{
+    static const char upper[] = "0123456789ABCDEF";
+    static const char lower[] = "0123456789abcdef";
+
+    if (key & VEHICLE_KEY_BDADDR) {
+        for (int shift = 40; shift >= 0; shift -= 8) {
+            unsigned b = (unsigned)(key >> shift) & 0xFF;
+            *p++ = upper[b >> 4];
+            *p++ = upper[b & 15];
+            if (shift) *p++ = ':';
+        }
+    } else {
+        *p++ = '#';
+        for (int shift = 60; shift >= 0; shift -= 4) *p++ = lower[(key >> shift) & 15];
+    }
+    return p;
+}
+
+size_t telem_out_ndjson(char *out, uint64_t key, uint64_t rx_us,
+                        const telemetry_t *t, const frame_meta_t *meta)
+{
+    char *p = out;
+
+    PUT_LIT(p, "{\"vehicle\":\"");
+    p = put_vehicle(p, key);
+    PUT_LIT(p, "\",\"rx_us\":");
+    p = put_u64(p, rx_us);
+    if (meta->version >= FRAME_V2) {
+        PUT_LIT(p, ",\"seq\":");
+        p = put_u64(p, meta->seq);
+        PUT_LIT(p, ",\"ts_us\":");
+        p = put_u64(p, meta->ts_us);
+    }
+#define X(name, type, byte, shift, width) \
+    PUT_LIT(p, ",\"" #name "\":");        \
+    p = put_u64(p, t->name);
+    TELEM_FIELDS(X)
+#undef X
+    PUT_LIT(p, "}\n");
+    return (size_t)(p - out);
+}
+
+size_t telem_out_csv_header(char *out)
+{
+    char *p = out;
+
+    PUT_LIT(p, "vehicle,rx_us,seq,ts_us");
+#define X(name, type, byte, shift, width) PUT_LIT(p, "," #name);
+    TELEM_FIELDS(X)
+#undef X
+    *p++ = '\n';
+    return (size_t)(p - out);
+}
+
+size_t telem_out_csv(char *out, uint64_t key, uint64_t rx_us,
+                     const telemetry_t *t, const frame_meta_t *meta)
+{
+    char *p = out;
+
+    p = put_vehicle(p, key);
+    *p++ = ',';
+    p = put_u64(p, rx_us);
+    *p++ = ',';
+    if (meta->version >= FRAME_V2) {
+        p = put_u64(p, meta->seq);
+        *p++ = ',';
+        p = put_u64(p, meta->ts_us);
+    } else {
+        *p++ = ',';
+    }
+#define X(name, type, byte, shift, width) \
+    *p++ = ',';                           \
+    p = put_u64(p, t->name);
+    TELEM_FIELDS(X)
+#undef X
+    *p++ = '\n';
+    return (size_t)(p - out);
+}
+
+size_t telem_out_bin(uint8_t *out, uint64_t key, uint64_t rx_us,
+                     const telemetry_t *t, const frame_meta_t *meta)
+{
+    int v2 = meta->version >= FRAME_V2;
+
+    telem_store_le64(out, rx_us);
+    telem_store_le64(out + 8, key);
+    telem_store_le64(out + 16, v2 ? meta->ts_us : 0);
+    telem_store_le32(out + 24, v2 ? meta->seq : 0);
+    out[28] = meta->version;
+    out[29] = meta->type;
+    out[30] = 0;
+    out[31] = 0;
+    telemetry_pack(t, out + 32);
+    return TELEM_OUT_BIN_SIZE;
+}
+
+int telem_out_parse(const char *s, telem_out_fmt_t *fmt)
+{
+    if (strcmp(s, "text") == 0) *fmt = TELEM_OUT_TEXT;
+    else if (strcmp(s, "ndjson") == 0) *fmt = TELEM_OUT_NDJSON;
+    else if (strcmp(s, "csv") == 0) *fmt = TELEM_OUT_CSV;
+    else if (strcmp(s, "bin") == 0) *fmt = TELEM_OUT_BIN;
+    else return -1;
+    return 0;
+}
+
+const char *telem_out_fmt_str(telem_out_fmt_t fmt)
+{
+    switch (fmt) {
+    case TELEM_OUT_TEXT:    return "text";
+    case TELEM_OUT_NDJSON:  return "ndjson";
+    case TELEM_OUT_CSV:     return "csv";
+    case TELEM_OUT_BIN:     return "bin";
+    }
+    return "?";
+}
+
+int telem_out_init(telem_out_t *o, int fd, telem_out_fmt_t fmt, size_t cap)
+{
+    memset(o, 0, sizeof(*o));
+    if (cap == 0) cap = TELEM_OUT_DEFAULT_BUF;
+    if (cap < 2 * TELEM_OUT_REC_MAX) cap = 2 * TELEM_OUT_REC_MAX;
+    o->buf = malloc(cap);
+    if (!o->buf) return -1;
+    o->fd = fd;
+    o->fmt = fmt;
+    o->cap = cap;
+    if (fmt == TELEM_OUT_CSV) o->len = telem_out_csv_header(o->buf);
+    return 0;
+}
+
+void telem_out_close(telem_out_t *o)
+{
+    if (!o->buf) return;
+    telem_out_flush(o);
+    free(o->buf);
+    o->buf = NULL;
+}
+
+void telem_out_frame(telem_out_t *o, uint64_t key, uint64_t rx_us,
+                     const telemetry_t *t, const frame_meta_t *meta)
+{
+    if (o->closed) return;
+    if (o->cap - o->len < TELEM_OUT_REC_MAX) telem_out_flush(o);
+
+    char *p = o->buf + o->len;
+    switch (o->fmt) {
+    case TELEM_OUT_NDJSON:
+        o->len += telem_out_ndjson(p, key, rx_us, t, meta);
+        break;
+    case TELEM_OUT_CSV:
+        o->len += telem_out_csv(p, key, rx_us, t, meta);
+        break;
+    case TELEM_OUT_BIN:
+        o->len += telem_out_bin((uint8_t *)p, key, rx_us, t, meta);
+        break;
+    case TELEM_OUT_TEXT:
+        return;
+    }
+    o->records++;
+}
+
+int telem_out_flush(telem_out_t *o)
+{
+    size_t off = 0;
+    int ret = 0;
+
+    if (o->closed) {
+        o->len = 0;
+        return -1;
+    }
+    if (o->len == 0) return 0;
+    while (off < o->len) {
+        ssize_t n = write(o->fd, o->buf + off, o->len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EPIPE) o->closed = 1;
+            else o->errors++;
+            ret = -1;
+            break;
+        }
+        off += (size_t)n;
+    }
+    o->bytes += off;
+    o->flushes++;
+    o->len = 0;
+    return ret;
+}
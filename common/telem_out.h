@@ -0,0 +1,93 @@
+/*
+ * telem_out.h - Machine-readable telemetry output (NDJSON, CSV, binary)
+ *
+ * Each decoded frame becomes one record:
+ *
+ *   ndjson  {"vehicle":"AA:BB:CC:DD:EE:FF","rx_us":...,"seq":812,"ts_us":...,"speed":46,...}
+ *   csv     vehicle,rx_us,seq,ts_us,speed,... (header first; seq/ts_us empty for v1)
+ *   bin     TELEM_OUT_BIN_SIZE bytes, little-endian:
+ *             0 rx_us u64   8 key u64   16 ts_us u64   24 seq u32
+ *             28 version u8   29 type u8   30 zero u16
+ *             32 telemetry payload (8 bytes, as in the frame)
+ *
+ * Vehicles are named as by vehicle_key_str(); seq and ts_us only exist
+ * for v2 frames (0 in bin records of v1 frames).
+ *
+ * The serializers write into caller memory and never allocate. A
+ * telem_out_t appends records to one large buffer and writes it out
+ * with one write() when it is nearly full or on telem_out_flush(), which
+ * the server calls once per loop turn.
+ *
+ * Once the reader of fd is gone (EPIPE; SIGPIPE must be ignored) the
+ * output is closed: later records are dropped without a write.
+ */
+
+#ifndef TELEM_OUT_H
+#define TELEM_OUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    TELEM_OUT_TEXT = 0,             // log lines; no records
+    TELEM_OUT_NDJSON,
+    TELEM_OUT_CSV,
+    TELEM_OUT_BIN,
+} telem_out_fmt_t;
+
+#define TELEM_OUT_DEFAULT_BUF   (1u << 20)
+#define TELEM_OUT_REC_MAX       512     // longest record of any format
+#define TELEM_OUT_BIN_SIZE      40
+
+typedef struct {
+    int fd;
+    telem_out_fmt_t fmt;
+    char *buf;
+    size_t len, cap;
+
+    unsigned long long records;
+    unsigned long long bytes;       // written to fd
+    unsigned long flushes;
+    unsigned long errors;           // failed writes; their data is dropped
+    int closed;                     // reader went away, nothing more is written
+} telem_out_t;
+
+/* "text", "ndjson", "csv" or "bin". Returns 0, or -1 if unknown. */
+int telem_out_parse(const char *s, telem_out_fmt_t *fmt);
+const char *telem_out_fmt_str(telem_out_fmt_t fmt);
+
+/* Buffer of cap bytes (0 = default) in front of fd. A CSV header is
+ * queued right away. Returns 0, or -1 with errno set. */
+int telem_out_init(telem_out_t *o, int fd, telem_out_fmt_t fmt, size_t cap);
+
+/* Flushes and frees the buffer; fd stays open. */
+void telem_out_close(telem_out_t *o);
+
+/* Queue one record, flushing first if it might not fit. No-op once closed. */
+void telem_out_frame(telem_out_t *o, uint64_t key, uint64_t rx_us,
+                     const telemetry_t *t, const frame_meta_t *meta);
+
+/* Write out everything queued. Returns 0, or -1 if a write failed or the
+ * output is closed. */
+int telem_out_flush(telem_out_t *o);
+
+/* ---- Serializers: at most TELEM_OUT_REC_MAX bytes, return the length ---- */
+size_t telem_out_ndjson(char *out, uint64_t key, uint64_t rx_us,
+                        const telemetry_t *t, const frame_meta_t *meta);
+size_t telem_out_csv(char *out, uint64_t key, uint64_t rx_us,
+                     const telemetry_t *t, const frame_meta_t *meta);
+size_t telem_out_csv_header(char *out);
+size_t telem_out_bin(uint8_t *out, uint64_t key, uint64_t rx_us,
+                     const telemetry_t *t, const frame_meta_t *meta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEM_OUT_H
@@ -0,0 +1,261 @@
+/*
+ * telem_server.c - Non-blocking epoll loop serving many telemetry clients
+ */
+
+#define _GNU_SOURCE
+#include "telem_server.h"
+#include "transport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/un.h>
+
+#define MAX_EVENTS 64
+#define RECV_CHUNK 2048
+
+static uint64_t mono_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static int set_nonblocking(int fd)
+{
+    int fl = fcntl(fd, F_GETFL, 0);
+    if (fl < 0) return -1;
+    return fcntl(fd, F_SETFL, fl | O_NONBLOCK);
+}
+
+int telem_server_init(telem_server_t *s, int listen_fd,
+                      const telem_server_ops_t *ops, void *ctx)
+{
+    memset(s, 0, sizeof(*s));
+    s->listen_fd = listen_fd;
+    s->ops = *ops;
+    s->ctx = ctx;
+    s->budget = TELEM_DEFAULT_BUDGET;
+    s->max_conns = TELEM_DEFAULT_MAX_CONNS;
+
+    s->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (s->epfd < 0) return -1;
+
+    if (listen_fd >= 0) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+        if (set_nonblocking(listen_fd) < 0 ||
+            epoll_ctl(s->epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
+            int err = errno;
+            close(s->epfd);
+            s->epfd = -1;
+            errno = err;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void conn_free(telem_server_t *s, telem_conn_t *c)
+{
+    if (s->ops.on_disconnect) s->ops.on_disconnect(s->ctx, c);
+
+    epoll_ctl(s->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+
+    // Swap-remove from the dense array
+    telem_conn_t *last = s->conns[--s->nconns];
+    s->conns[c->index] = last;
+    last->index = c->index;
+
+    free(c);
+}
+
+telem_conn_t *telem_server_add(telem_server_t *s, int fd, const char *peer)
+{
+    if (s->nconns >= s->max_conns) {
+        s->rejected++;
+        close(fd);
+        return NULL;
+    }
+
+    if (s->nconns == s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 16;
+        telem_conn_t **grown = realloc(s->conns, cap * sizeof(*grown));
+        if (!grown) {
+            close(fd);
+            return NULL;
+        }
+        s->conns = grown;
+        s->cap = cap;
+    }
+
+    telem_conn_t *c = calloc(1, sizeof(*c));
+    if (!c) {
+        close(fd);
+        return NULL;
+    }
+
+    c->fd = fd;
+    snprintf(c->peer, sizeof(c->peer), "%s", peer);
+    frame_reasm_init(&c->reasm);
+    c->connected_ms = c->last_rx_ms = mono_ms();
+
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP, .data.ptr = c };
+    if (set_nonblocking(fd) < 0 || epoll_ctl(s->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        close(fd);
+        free(c);
+        return NULL;
+    }
+
+    c->index = s->nconns;
+    s->conns[s->nconns++] = c;
+    s->accepted++;
+
+    if (s->ops.on_connect) s->ops.on_connect(s->ctx, c);
+    return c;
+}
+
+static void accept_all(telem_server_t *s)
+{
+    for (;;) {
+        struct sockaddr_storage addr;
+        socklen_t len = sizeof(addr);
+        char peer[TELEM_PEER_LEN];
+
+        int fd = accept4(s->listen_fd, (struct sockaddr *)&addr, &len,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("[ERROR] accept");
+            }
+            return;
+        }
+
+        if (s->ops.peer_name) {
+            s->ops.peer_name(s->ctx, (struct sockaddr *)&addr, len, fd, peer, sizeof(peer));
+        } else {
+            transport_peer_name((struct sockaddr *)&addr, len, fd, peer, sizeof(peer));
+        }
+
+        telem_server_add(s, fd, peer);
+    }
+}
+
+/* Read up to the budget. Returns 0 to keep the connection, -1 to drop it. */
+static int service_conn(telem_server_t *s, telem_conn_t *c)
+{
+    uint8_t buf[RECV_CHUNK];
+    uint8_t frame[FRAME_MAX_SIZE];
+    size_t used = 0;
+
+    while (used < s->budget) {
+        size_t want = s->budget - used;
+        if (want > sizeof(buf)) want = sizeof(buf);
+
+        // read(), not recv(): the connection may be a pty
+        ssize_t n = read(c->fd, buf, want);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        if (n == 0) return -1;
+
+        used += (size_t)n;
+        c->total_bytes += (size_t)n;
+        c->msg_count++;
+        c->last_rx_ms = mono_ms();
+
+        unsigned long frames_before = c->reasm.frames;
+        unsigned long resync_before = c->reasm.resync_bytes;
+
+        size_t off = 0;
+        while (off < (size_t)n) {
+            off += frame_reasm_push(&c->reasm, buf + off, (size_t)n - off);
+            int flen;
+            while (!c->dead && (flen = frame_reasm_next(&c->reasm, frame)) > 0) {
+                if (s->ops.on_frame) s->ops.on_frame(s->ctx, c, frame, (size_t)flen);
+            }
+        }
+
+        c->chunk_frames = c->reasm.frames - frames_before;
+        c->chunk_resync = c->reasm.resync_bytes - resync_before;
+        if (s->ops.on_data) s->ops.on_data(s->ctx, c, buf, (size_t)n);
+
+        if (c->dead) return 0;          // dropped from a callback
+        if ((size_t)n < want) return 0; // socket drained
+    }
+
+    s->budget_yields++;
+    return 0;
+}
+
+int telem_server_poll(telem_server_t *s, int timeout_ms)
+{
+    struct epoll_event evs[MAX_EVENTS];
+
+    int n = epoll_wait(s->epfd, evs, MAX_EVENTS, timeout_ms);
+    if (n < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+
+    s->polling = 1;
+    for (int i = 0; i < n; i++) {
+        telem_conn_t *c = (telem_conn_t *)evs[i].data.ptr;
+
+        if (c == NULL) {
+            accept_all(s);
+            continue;
+        }
+
+        if (!c->dead && service_conn(s, c) < 0) {
+            telem_server_drop(s, c);
+        }
+    }
+    s->polling = 0;
+
+    // Later events of the same batch may still point at a dropped
+    // connection, so nothing is freed until the batch is done.
+    while (s->dead) {
+        telem_conn_t *c = s->dead;
+        s->dead = c->next_dead;
+        conn_free(s, c);
+    }
+
+    return n;
+}
+
+void telem_server_drop(telem_server_t *s, telem_conn_t *c)
+{
+    if (c->dead) return;
+
+    if (!s->polling) {
+        conn_free(s, c);
+        return;
+    }
+
+    c->dead = 1;
+    c->next_dead = s->dead;
+    s->dead = c;
+}
+
+void telem_server_close(telem_server_t *s)
+{
+    while (s->nconns > 0) {
+        conn_free(s, s->conns[s->nconns - 1]);
+    }
+
+    free(s->conns);
+    s->conns = NULL;
+    s->cap = 0;
+
+    if (s->epfd >= 0) close(s->epfd);
+    s->epfd = -1;
+}
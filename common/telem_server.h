@@ -0,0 +1,114 @@
+/*
+ * telem_server.h - Non-blocking epoll loop serving many telemetry clients
+ *
+ * The loop owns a listening socket of any stream family (RFCOMM, TCP,
+ * Unix) and every accepted connection. Each connection keeps its own
+ * frame reassembler and counters; the application gets callbacks for
+ * connect, raw data, every decoded frame and disconnect.
+ *
+ * Fairness: a connection reads at most `budget` bytes per loop iteration.
+ * epoll is level-triggered, so whatever a chatty client left in its
+ * socket is picked up on the next iteration after everyone else had a
+ * turn.
+ *
+ *     telem_server_t srv;
+ *     telem_server_init(&srv, listen_fd, &ops, ctx);
+ *     while (running) telem_server_poll(&srv, 500);
+ *     telem_server_close(&srv);
+ */
+
+#ifndef TELEM_SERVER_H
+#define TELEM_SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "frame_reasm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEM_PEER_LEN          64
+#define TELEM_DEFAULT_BUDGET    4096    // bytes per connection per iteration
+#define TELEM_DEFAULT_MAX_CONNS 1024
+
+typedef struct telem_conn {
+    int fd;
+    char peer[TELEM_PEER_LEN];      // printable peer address
+    frame_reasm_t reasm;
+
+    unsigned long total_bytes;      // bytes received
+    unsigned long msg_count;        // recv() calls that returned data
+    uint64_t connected_ms;          // CLOCK_MONOTONIC
+    uint64_t last_rx_ms;
+
+    // What the most recent recv() chunk yielded, valid inside on_data
+    unsigned long chunk_frames;
+    unsigned long chunk_resync;
+
+    size_t index;                   // slot in telem_server_t.conns
+    int dead;                       // dropped, freed at the end of the poll
+    struct telem_conn *next_dead;
+    void *user;                     // free for the application
+} telem_conn_t;
+
+typedef struct {
+    // Fill out with a printable name for addr; NULL uses
+    // transport_peer_name() (bdaddr, ip:port, unix#N, "fd N").
+    void (*peer_name)(void *ctx, const struct sockaddr *addr, socklen_t len,
+                      int fd, char *out, size_t out_len);
+    void (*on_connect)(void *ctx, telem_conn_t *c);
+    // Called for every complete frame, before on_data for the same chunk
+    void (*on_frame)(void *ctx, telem_conn_t *c, const uint8_t *frame, size_t len);
+    // Raw bytes of one recv(), after its frames were delivered
+    void (*on_data)(void *ctx, telem_conn_t *c, const uint8_t *buf, size_t len);
+    void (*on_disconnect)(void *ctx, telem_conn_t *c);
+} telem_server_ops_t;
+
+typedef struct {
+    int epfd;
+    int listen_fd;
+    telem_server_ops_t ops;
+    void *ctx;
+
+    size_t budget;                  // fairness budget, bytes
+    size_t max_conns;
+
+    telem_conn_t **conns;           // dense array of live connections
+    size_t nconns;
+    size_t cap;
+    telem_conn_t *dead;             // dropped during the current poll
+    int polling;
+
+    unsigned long accepted;
+    unsigned long rejected;         // over max_conns
+    unsigned long budget_yields;    // times a connection hit its budget
+} telem_server_t;
+
+/* listen_fd must already be bound and listening; it is made non-blocking.
+ * Returns 0, or -1 with errno set. */
+int telem_server_init(telem_server_t *s, int listen_fd,
+                      const telem_server_ops_t *ops, void *ctx);
+
+/* Adopt an already connected stream (e.g. a pty) as a client. */
+telem_conn_t *telem_server_add(telem_server_t *s, int fd, const char *peer);
+
+/* Run one iteration: wait up to timeout_ms, accept, read within budget.
+ * Returns the number of ready events, 0 on timeout/EINTR, -1 on error. */
+int telem_server_poll(telem_server_t *s, int timeout_ms);
+
+/* Drop one connection (on_disconnect is called). Safe to call from any
+ * callback; inside telem_server_poll() the free is deferred until all
+ * events of that iteration are handled. */
+void telem_server_drop(telem_server_t *s, telem_conn_t *c);
+
+/* Close every connection and the epoll instance (not listen_fd). */
+void telem_server_close(telem_server_t *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEM_SERVER_H
@@ -0,0 +1,251 @@
+/*
+ * telemetry_batch.c - Decode many recorded frames into columnar arrays
+ *
+ * AVX2 layout: a block of 16 frames is exactly 11 unaligned 16-byte loads
+ * (176 bytes). Byte j of frame t sits at offset 11*t + j, i.e. in load
+ * (11*t + j) / 16, lane (11*t + j) % 16. gather_mask[j][L] is the pshufb
+ * control that pulls the lanes of load L belonging to column j into lane
+ * t; OR-ing the 11 shuffles yields the whole column, one frame per lane.
+ * Fields are then cut out of the byte columns with a shift and a mask,
+ * the same way telemetry_unpack() does it on a single word.
+ *
+ * Two blocks run side by side, one per 128-bit lane. A 128-bit SSSE3
+ * build of the same shuffles lost to the scalar path below, so without
+ * AVX2 the scalar path is used.
+ */
+
+#include "telemetry_batch.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BATCH_IMPL "avx2"
+#else
+#define BATCH_IMPL "scalar"
+#endif
+
+// The column transpose below only knows bytes and 16-bit little-endian pairs
+#define X(name, type, byte, shift, width) \
+    TELEM_STATIC_ASSERT((width) <= 8 ? (shift) + (width) <= 8 : ((width) == 16 && (shift) == 0), \
+                        "field " #name " cannot be decoded from byte columns");
+TELEM_FIELDS(X)
+#undef X
+
+static inline int frame_valid(const uint8_t *f)
+{
+    return (f[0] == FRAME_START) & (f[1] == FRAME_PAYLOAD) & (f[FRAME_SIZE - 1] == FRAME_DELIM);
+}
+
+/* Scalar path, SWAR style: the payloads of 8 frames are 8 words, and an
+ * 8x8 byte transpose turns them into one word per payload byte, frame k
+ * in byte k. A byte-sized field of 8 frames is then one shift and one
+ * mask, stored as a single 8-byte write.
+ *
+ * Writing one byte to each of 15 page-aligned columns per frame thrashes
+ * L1 sets, so a chunk of 64 frames is transposed first and written out
+ * one column (one cache line) at a time. */
+#define SCALAR_CHUNK 64
+#define LANES UINT64_C(0x0101010101010101)
+
+// Swap 4x4, then 2x2, then 1x1 blocks; fully unrolled so w stays in registers
+static inline void transpose8x8(uint64_t w[8])
+{
+#pragma GCC unroll 4
+    for (int k = 0; k < 4; k++) {
+        uint64_t t = ((w[k] >> 32) ^ w[k + 4]) & UINT64_C(0x00000000FFFFFFFF);
+        w[k] ^= t << 32;
+        w[k + 4] ^= t;
+    }
+#pragma GCC unroll 4
+    for (int i = 0; i < 4; i++) {
+        int k = i + (i & 2);                                // 0, 1, 4, 5
+        uint64_t t = ((w[k] >> 16) ^ w[k + 2]) & UINT64_C(0x0000FFFF0000FFFF);
+        w[k] ^= t << 16;
+        w[k + 2] ^= t;
+    }
+#pragma GCC unroll 4
+    for (int k = 0; k < 8; k += 2) {
+        uint64_t t = ((w[k] >> 8) ^ w[k + 1]) & UINT64_C(0x00FF00FF00FF00FF);
+        w[k] ^= t << 8;
+        w[k + 1] ^= t;
+    }
+}
+
+/* Bytes 0-3 of x into the low bytes of four 16-bit lanes */
+static inline uint64_t spread_u16(uint64_t x)
+{
+    x &= UINT64_C(0x00000000FFFFFFFF);
+    x = (x | x << 16) & UINT64_C(0x0000FFFF0000FFFF);
+    return (x | x << 8) & UINT64_C(0x00FF00FF00FF00FF);
+}
+
+/* 8 little-endian 16-bit values from their low and high byte words */
+static inline void store_u16x8(uint16_t *out, uint64_t lo, uint64_t hi)
+{
+    uint64_t w[2] = {
+        spread_u16(lo) | spread_u16(hi) << 8,
+        spread_u16(lo >> 32) | spread_u16(hi >> 32) << 8,
+    };
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (int k = 0; k < 8; k++) out[k] = (uint16_t)(w[k / 4] >> (16 * (k % 4)));
+#else
+    memcpy(out, w, sizeof(w));
+#endif
+}
+
+static size_t decode_scalar(const uint8_t *frames, size_t first, size_t n,
+                            const telemetry_columns_t *cols, uint8_t *valid)
+{
+    size_t good = 0;
+    size_t i = first;
+
+    for (; i + SCALAR_CHUNK <= n; i += SCALAR_CHUNK) {
+        uint64_t col[FRAME_PAYLOAD][SCALAR_CHUNK / 8];     // [payload byte][group of 8]
+
+        for (size_t g = 0; g < SCALAR_CHUNK / 8; g++) {
+            const uint8_t *f = frames + (i + 8 * g) * FRAME_SIZE;
+            uint64_t w[8];
+#pragma GCC unroll 8
+            for (size_t k = 0; k < 8; k++, f += FRAME_SIZE) {
+                w[k] = telem_load_le64(f + 2);
+                valid[i + 8 * g + k] = (uint8_t)frame_valid(f);
+                good += valid[i + 8 * g + k];
+            }
+            transpose8x8(w);
+#pragma GCC unroll 8
+            for (size_t j = 0; j < FRAME_PAYLOAD; j++) col[j][g] = w[j];
+        }
+
+        // 8 frames per store, 8-bit fields and the 16-bit one alike
+#define X(name, type, byte, shift, width)                                               \
+        for (size_t g = 0; g < SCALAR_CHUNK / 8; g++) {                                 \
+            if (sizeof(type) == 1) {                                                    \
+                telem_store_le64((uint8_t *)(cols->name + i + 8 * g),                   \
+                                 (col[byte][g] >> (shift)) & (TELEM_MASK(width) * LANES)); \
+            } else {                                                                    \
+                store_u16x8((uint16_t *)(cols->name + i + 8 * g),                       \
+                            col[byte][g], col[(byte) + 1][g]);                          \
+            }                                                                           \
+        }
+        TELEM_FIELDS(X)
+#undef X
+    }
+
+    for (; i < n; i++) {
+        const uint8_t *f = frames + i * FRAME_SIZE;
+        uint64_t w = telem_load_le64(f + 2);
+        valid[i] = (uint8_t)frame_valid(f);
+        good += valid[i];
+#define X(name, type, byte, shift, width) \
+        cols->name[i] = (type)((w >> TELEM_BITPOS(byte, shift)) & TELEM_MASK(width));
+        TELEM_FIELDS(X)
+#undef X
+    }
+
+    return good;
+}
+
+size_t telemetry_decode_batch_scalar(const uint8_t *frames, size_t n,
+                                     const telemetry_columns_t *cols, uint8_t *valid)
+{
+    return decode_scalar(frames, 0, n, cols, valid);
+}
+
+const char *telemetry_batch_impl(void)
+{
+    return BATCH_IMPL;
+}
+
+#if defined(__AVX2__)
+
+#define BLOCK 16
+
+#define SEL(j, L, t) \
+    ((((11 * (t) + (j)) >> 4) == (L)) ? ((11 * (t) + (j)) & 15) : 0x80)
+#define ROW(j, L) { \
+    SEL(j, L, 0),  SEL(j, L, 1),  SEL(j, L, 2),  SEL(j, L, 3),  \
+    SEL(j, L, 4),  SEL(j, L, 5),  SEL(j, L, 6),  SEL(j, L, 7),  \
+    SEL(j, L, 8),  SEL(j, L, 9),  SEL(j, L, 10), SEL(j, L, 11), \
+    SEL(j, L, 12), SEL(j, L, 13), SEL(j, L, 14), SEL(j, L, 15) }
+#define COL(j) { \
+    ROW(j, 0), ROW(j, 1), ROW(j, 2), ROW(j, 3), ROW(j, 4), ROW(j, 5), \
+    ROW(j, 6), ROW(j, 7), ROW(j, 8), ROW(j, 9), ROW(j, 10) }
+
+static const uint8_t gather_mask[FRAME_SIZE][FRAME_SIZE][16] __attribute__((aligned(16))) = {
+    COL(0), COL(1), COL(2), COL(3), COL(4), COL(5),
+    COL(6), COL(7), COL(8), COL(9), COL(10)
+};
+
+#undef SEL
+#undef ROW
+#undef COL
+
+#define STEP (2 * BLOCK)
+
+size_t telemetry_decode_batch(const uint8_t *frames, size_t n,
+                              const telemetry_columns_t *cols, uint8_t *valid)
+{
+    size_t good = 0;
+    size_t i = 0;
+
+    for (; i + STEP <= n; i += STEP) {
+        const uint8_t *a = frames + i * FRAME_SIZE;
+        const uint8_t *b = a + BLOCK * FRAME_SIZE;
+        __m256i in[FRAME_SIZE];
+        __m256i col[FRAME_SIZE];
+
+        for (int L = 0; L < FRAME_SIZE; L++) {
+            __m128i lo = _mm_loadu_si128((const __m128i *)(a + 16 * L));
+            __m128i hi = _mm_loadu_si128((const __m128i *)(b + 16 * L));
+            in[L] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        }
+
+#pragma GCC unroll 11
+        for (int j = 0; j < FRAME_SIZE; j++) {
+            __m256i c = _mm256_setzero_si256();
+#pragma GCC unroll 11
+            for (int L = 0; L < FRAME_SIZE; L++) {
+                __m256i m = _mm256_broadcastsi128_si256(
+                    _mm_load_si128((const __m128i *)gather_mask[j][L]));
+                c = _mm256_or_si256(c, _mm256_shuffle_epi8(in[L], m));
+            }
+            col[j] = c;
+        }
+
+        __m256i ok = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpeq_epi8(col[0], _mm256_set1_epi8((char)FRAME_START)),
+                             _mm256_cmpeq_epi8(col[1], _mm256_set1_epi8(FRAME_PAYLOAD))),
+            _mm256_cmpeq_epi8(col[FRAME_SIZE - 1], _mm256_set1_epi8(FRAME_DELIM)));
+        _mm256_storeu_si256((__m256i *)(valid + i), _mm256_and_si256(ok, _mm256_set1_epi8(1)));
+        good += (size_t)__builtin_popcount((unsigned)_mm256_movemask_epi8(ok));
+
+        // Payload byte k is column k + 2
+#define X(name, type, byte, shift, width)                                           \
+        if ((width) > 8) {                                                          \
+            __m256i lo = _mm256_unpacklo_epi8(col[(byte) + 2], col[(byte) + 3]);    \
+            __m256i hi = _mm256_unpackhi_epi8(col[(byte) + 2], col[(byte) + 3]);    \
+            __m256i *dst = (__m256i *)(void *)(cols->name + i);                     \
+            _mm256_storeu_si256(dst,     _mm256_permute2x128_si256(lo, hi, 0x20));  \
+            _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(lo, hi, 0x31));  \
+        } else {                                                                    \
+            __m256i v = _mm256_and_si256(_mm256_srli_epi16(col[(byte) + 2], (shift)), \
+                                         _mm256_set1_epi8((char)TELEM_MASK(width))); \
+            _mm256_storeu_si256((__m256i *)(void *)(cols->name + i), v);            \
+        }
+        TELEM_FIELDS(X)
+#undef X
+    }
+
+    return good + decode_scalar(frames, i, n, cols, valid);
+}
+
+#else
+
+size_t telemetry_decode_batch(const uint8_t *frames, size_t n,
+                              const telemetry_columns_t *cols, uint8_t *valid)
+{
+    return decode_scalar(frames, 0, n, cols, valid);
+}
+
+#endif
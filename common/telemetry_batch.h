@@ -0,0 +1,51 @@
+/*
+ * telemetry_batch.h - Decode many recorded frames into columnar arrays
+ *
+ * For offline analysis: takes a contiguous buffer of N back-to-back
+ * 11-byte frames and writes every field into its own column
+ * (speed[], throttle[], total_miles[], battery[], ...). Headers and
+ * delimiters are validated per frame into valid[].
+ *
+ * With -mavx2 (or -march=native) the frames are transposed 32 at a time
+ * with byte shuffles; otherwise 8 at a time in 64-bit words (SWAR).
+ * Both paths produce bit-identical output.
+ */
+
+#ifndef TELEMETRY_BATCH_H
+#define TELEMETRY_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One caller-owned array per field, each with room for n entries. */
+typedef struct {
+#define X(name, type, byte, shift, width) type *name;
+    TELEM_FIELDS(X)
+#undef X
+} telemetry_columns_t;
+
+/* Decode n frames starting at frames (n * FRAME_SIZE bytes).
+ * valid[i] is set to 1 if frame i has a correct start/len/delimiter and
+ * 0 otherwise; fields of invalid frames are decoded from whatever bytes
+ * are there, so always check valid[]. Returns the number of valid frames. */
+size_t telemetry_decode_batch(const uint8_t *frames, size_t n,
+                              const telemetry_columns_t *cols, uint8_t *valid);
+
+/* Plain scalar reference implementation of the above. */
+size_t telemetry_decode_batch_scalar(const uint8_t *frames, size_t n,
+                                     const telemetry_columns_t *cols, uint8_t *valid);
+
+/* "avx2" or "scalar" - the path telemetry_decode_batch() uses. */
+const char *telemetry_batch_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_BATCH_H
@@ -0,0 +1,354 @@
+/*
+ * telemetry_codec.h - The one definition of the telemetry frame layout
+ *
+ * v1 frame on the wire (11 bytes), what existing ESP32 firmware sends:
+ *
+ *     0xCE | len=8 | payload[8] | '\n'
+ *
+ * v2 frame (29 bytes for telemetry), same envelope with a richer header:
+ *
+ *     0xCE | len | ver=2 | type | seq u32 | ts_us u64 | body | crc32c u32 | '\n'
+ *
+ * len counts the bytes between itself and '\n' (18 + body); multi-byte
+ * fields are little-endian; the CRC-32C covers ver through body. v1 always
+ * has len == 8 and v2 always len >= 18, so receivers tell them apart per
+ * frame and no handshake is needed: old firmware keeps working.
+ *
+ * Short v2 frames (len 9..17) use the gap between the two for small
+ * messages that only make sense relative to an earlier full frame, such
+ * as deltas (see telemetry_delta.h):
+ *
+ *     0xCE | len | ver=2 | type | seq u8 | dt_ms u16 | body | crc16 | '\n'
+ *
+ * seq and dt_ms are the low byte of the sequence number and the
+ * milliseconds since the reference frame; crc16 is the low half of the
+ * CRC-32C over ver through body.
+ *
+ * The 8-byte payload is read as one little-endian 64-bit word. Every field
+ * is declared once in TELEM_FIELDS as (name, type, byte, shift, width), and
+ * the struct, pack and unpack code are all expanded from that table, so
+ * bt-client, rfcomm_server_v2 and the GUI cannot drift apart again.
+ * Pack/unpack are straight-line shifts and masks with no branches.
+ *
+ * Header-only; usable from C (C11) and C++ (C++11).
+ */
+
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "crc32c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAME_START      0xCE   // start marker
+#define FRAME_PAYLOAD    8      // length byte value
+#define FRAME_DELIM      '\n'   // trailing delimiter
+#define FRAME_SIZE       11     // 0xCE, len, payload[8], '\n'
+#define FRAME_CTRL_PING  0xFF   // bare keepalive byte sent by bt-client
+
+#define FRAME_V2           2                            // version byte
+#define FRAME_V2_HDR       16                           // 0xCE .. ts_us
+#define FRAME_V2_OVERHEAD  (FRAME_V2_HDR + 4 + 1)       // + crc32c, '\n'
+#define FRAME_V2_MIN_LEN   (FRAME_V2_OVERHEAD - 3)      // len byte, empty body
+#define FRAME_V2_SIZE      (FRAME_V2_OVERHEAD + FRAME_PAYLOAD)
+#define FRAME_MAX_SIZE     64                           // any version, any type
+
+#define FRAME_V2_SHORT_HDR       7                          // 0xCE .. dt_ms
+#define FRAME_V2_SHORT_OVERHEAD  (FRAME_V2_SHORT_HDR + 2 + 1) // + crc16, '\n'
+#define FRAME_V2_SHORT_MAX_BODY  (FRAME_V2_MIN_LEN - 1 - (FRAME_V2_SHORT_OVERHEAD - 3))
+#define FRAME_V2_SHORT_MIN_BODY  (FRAME_PAYLOAD + 1 - (FRAME_V2_SHORT_OVERHEAD - 3))
+
+#define FRAME_TYPE_TELEMETRY  0x01   // full state; a keyframe for deltas
+#define FRAME_TYPE_DELTA      0x02   // short frame, changed fields only
+#define FRAME_TYPE_PING       0x10   // control messages, see ctrl_msg.h
+#define FRAME_TYPE_PONG       0x11
+#define FRAME_TYPE_CONFIG_SET 0x12
+#define FRAME_TYPE_ACK        0x13
+
+/* Control types are 0x10..0x1F: not samples, never spooled or replayed */
+#define FRAME_TYPE_IS_CTRL(t) (((t) & 0xF0) == 0x10)
+
+/*        name          type      byte shift width */
+#define TELEM_FIELDS(X)                                                     \
+    X(speed,        uint8_t,  0,   0,   8)  /* 0-255 (rpm/46)             */ \
+    X(throttle,     uint8_t,  1,   0,   8)  /* 0-255                      */ \
+    X(total_miles,  uint16_t, 2,   0,  16)  /* 16-bit odometer            */ \
+    X(battery,      uint8_t,  4,   0,   7)  /* 0-100%                     */ \
+    X(night_mode,   uint8_t,  4,   7,   1)  /* 0/1                        */ \
+    X(engine_temp,  uint8_t,  5,   0,   6)  /* 0-63 (offset -20°C)        */ \
+    X(turn_signal,  uint8_t,  5,   6,   2)  /* 0=none 1=right 2=left 3=hazard */ \
+    X(battery_temp, uint8_t,  6,   0,   6)  /* 0-63                       */ \
+    X(horn,         uint8_t,  6,   6,   1)  /* 0/1                        */ \
+    X(beam,         uint8_t,  6,   7,   1)  /* 0/1                        */ \
+    X(alert,        uint8_t,  7,   0,   3)  /* 0-7                        */ \
+    X(state,        uint8_t,  7,   3,   2)  /* 1=N 2=D 3=P                */ \
+    X(mode,         uint8_t,  7,   5,   2)  /* 1=ECON 2=COMF 3=SPORT      */ \
+    X(maps,         uint8_t,  7,   7,   1)  /* 0/1                        */
+
+#define TELEM_BITPOS(byte, shift)  ((byte) * 8 + (shift))
+#define TELEM_MASK(width)          ((UINT64_C(1) << (width)) - 1)
+#define TELEM_FIELD_MASK(byte, shift, width) \
+    (TELEM_MASK(width) << TELEM_BITPOS(byte, shift))
+
+/* Telemetry data structure */
+typedef struct {
+#define X(name, type, byte, shift, width) type name;
+    TELEM_FIELDS(X)
+#undef X
+} telemetry_t;
+
+/* ---- Compile-time layout checks ---- */
+#ifdef __cplusplus
+#define TELEM_STATIC_ASSERT(cond, msg) static_assert(cond, msg)
+#else
+#define TELEM_STATIC_ASSERT(cond, msg) _Static_assert(cond, msg)
+#endif
+
+#define TELEM_SUM_MASK(name, type, byte, shift, width) + TELEM_FIELD_MASK(byte, shift, width)
+#define TELEM_OR_MASK(name, type, byte, shift, width)  | TELEM_FIELD_MASK(byte, shift, width)
+
+// Disjoint masks add up to exactly their union; any overlap breaks that.
+TELEM_STATIC_ASSERT((0 TELEM_FIELDS(TELEM_SUM_MASK)) == (0 TELEM_FIELDS(TELEM_OR_MASK)),
+                    "telemetry fields overlap");
+TELEM_STATIC_ASSERT((0 TELEM_FIELDS(TELEM_OR_MASK)) == UINT64_MAX,
+                    "telemetry fields leave payload bits unassigned");
+
+#define X(name, type, byte, shift, width)                                     \
+    TELEM_STATIC_ASSERT((width) >= 1 && (width) <= 8 * sizeof(type),          \
+                        "field " #name " does not fit its type");             \
+    TELEM_STATIC_ASSERT(TELEM_BITPOS(byte, shift) + (width) <= 8 * FRAME_PAYLOAD, \
+                        "field " #name " runs past the payload");
+TELEM_FIELDS(X)
+#undef X
+
+#undef TELEM_SUM_MASK
+#undef TELEM_OR_MASK
+
+/* ---- Pack / unpack ---- */
+static inline uint64_t telem_load_le64(const uint8_t *p)
+{
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+static inline void telem_store_le64(uint8_t *p, uint64_t w)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    memcpy(p, &w, sizeof(w));
+}
+
+static inline uint32_t telem_load_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void telem_store_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void telemetry_unpack(const uint8_t payload[FRAME_PAYLOAD], telemetry_t *t)
+{
+    uint64_t w = telem_load_le64(payload);
+#define X(name, type, byte, shift, width) \
+    t->name = (type)((w >> TELEM_BITPOS(byte, shift)) & TELEM_MASK(width));
+    TELEM_FIELDS(X)
+#undef X
+}
+
+/* Values wider than their field are truncated, like the old "& 0x3F" masks. */
+static inline void telemetry_pack(const telemetry_t *t, uint8_t payload[FRAME_PAYLOAD])
+{
+    uint64_t w = 0;
+#define X(name, type, byte, shift, width) \
+    w |= ((uint64_t)t->name & TELEM_MASK(width)) << TELEM_BITPOS(byte, shift);
+    TELEM_FIELDS(X)
+#undef X
+    telem_store_le64(payload, w);
+}
+
+/* ---- Whole frames ---- */
+static inline void telemetry_encode_frame(const telemetry_t *t, uint8_t out[FRAME_SIZE])
+{
+    out[0] = FRAME_START;
+    out[1] = FRAME_PAYLOAD;
+    telemetry_pack(t, out + 2);
+    out[FRAME_SIZE - 1] = FRAME_DELIM;
+}
+
+/* Returns 0 on success, or
+ *   -1 incomplete frame, -2 invalid start marker,
+ *   -3 invalid length,   -4 missing delimiter */
+static inline int telemetry_decode_frame(const uint8_t *data, size_t len, telemetry_t *t)
+{
+    if (len < FRAME_SIZE) return -1;
+    if (data[0] != FRAME_START) return -2;
+    if (data[1] != FRAME_PAYLOAD) return -3;
+    if (data[FRAME_SIZE - 1] != FRAME_DELIM) return -4;
+
+    telemetry_unpack(data + 2, t);
+    return 0;
+}
+
+/* ---- v2 frames ---- */
+typedef struct {
+    uint8_t version;                // 1 or 2
+    uint8_t type;                   // FRAME_TYPE_*; telemetry for v1
+    uint8_t short_hdr;              // seq/ts_us are the raw u8/u16 ms fields
+    uint32_t seq;                   // v2 only
+    uint64_t ts_us;                 // v2 only: sender CLOCK_REALTIME
+} frame_meta_t;
+
+/* Total bytes of the frame starting at data (data[1] is the len byte). */
+static inline size_t frame_total_len(const uint8_t *data)
+{
+    return (size_t)data[1] + 3;
+}
+
+/* Type byte of a complete frame, without checking it; v1 is telemetry. */
+static inline uint8_t frame_type(const uint8_t *data)
+{
+    return data[1] == FRAME_PAYLOAD ? FRAME_TYPE_TELEMETRY : data[3];
+}
+
+/* Wrap body[0..body_len) in a v2 envelope. out needs FRAME_V2_OVERHEAD +
+ * body_len bytes, at most FRAME_MAX_SIZE. Returns the frame length. */
+static inline size_t frame_v2_encode(uint8_t type, uint32_t seq, uint64_t ts_us,
+                                     const uint8_t *body, size_t body_len, uint8_t *out)
+{
+    size_t total = FRAME_V2_OVERHEAD + body_len;
+
+    out[0] = FRAME_START;
+    out[1] = (uint8_t)(total - 3);
+    out[2] = FRAME_V2;
+    out[3] = type;
+    telem_store_le32(out + 4, seq);
+    telem_store_le64(out + 8, ts_us);
+    memcpy(out + FRAME_V2_HDR, body, body_len);
+    telem_store_le32(out + FRAME_V2_HDR + body_len, crc32c(out + 2, FRAME_V2_HDR - 2 + body_len));
+    out[total - 1] = FRAME_DELIM;
+    return total;
+}
+
+/* Short v2 frame; body_len must be FRAME_V2_SHORT_MIN_BODY..MAX_BODY.
+ * Returns the frame length. */
+static inline size_t frame_v2_short_encode(uint8_t type, uint8_t seq8, uint16_t dt_ms,
+                                           const uint8_t *body, size_t body_len, uint8_t *out)
+{
+    size_t total = FRAME_V2_SHORT_OVERHEAD + body_len;
+
+    out[0] = FRAME_START;
+    out[1] = (uint8_t)(total - 3);
+    out[2] = FRAME_V2;
+    out[3] = type;
+    out[4] = seq8;
+    out[5] = (uint8_t)dt_ms;
+    out[6] = (uint8_t)(dt_ms >> 8);
+    memcpy(out + FRAME_V2_SHORT_HDR, body, body_len);
+    uint32_t crc = crc32c(out + 2, FRAME_V2_SHORT_HDR - 2 + body_len);
+    out[FRAME_V2_SHORT_HDR + body_len] = (uint8_t)crc;
+    out[FRAME_V2_SHORT_HDR + body_len + 1] = (uint8_t)(crc >> 8);
+    out[total - 1] = FRAME_DELIM;
+    return total;
+}
+
+static inline size_t telemetry_encode_frame_v2(const telemetry_t *t, uint32_t seq, uint64_t ts_us,
+                                               uint8_t out[FRAME_V2_SIZE])
+{
+    uint8_t payload[FRAME_PAYLOAD];
+    telemetry_pack(t, payload);
+    return frame_v2_encode(FRAME_TYPE_TELEMETRY, seq, ts_us, payload, sizeof(payload), out);
+}
+
+/* Check a v2 envelope and fill meta. body and body_len point into data.
+ * Returns 0, or -1 incomplete, -2 start, -3 length, -4 delimiter,
+ * -5 CRC mismatch, -6 not a v2 frame. */
+static inline int frame_v2_decode(const uint8_t *data, size_t len, frame_meta_t *meta,
+                                  const uint8_t **body, size_t *body_len)
+{
+    if (len < 3) return -1;
+    if (data[0] != FRAME_START) return -2;
+    if (data[1] <= FRAME_PAYLOAD || frame_total_len(data) > FRAME_MAX_SIZE) return -3;
+    if (data[2] != FRAME_V2) return -6;
+
+    size_t total = frame_total_len(data);
+    if (len < total) return -1;
+    if (data[total - 1] != FRAME_DELIM) return -4;
+
+    if (data[1] < FRAME_V2_MIN_LEN) {
+        size_t blen = total - FRAME_V2_SHORT_OVERHEAD;
+        uint32_t crc = crc32c(data + 2, FRAME_V2_SHORT_HDR - 2 + blen);
+        const uint8_t *c = data + FRAME_V2_SHORT_HDR + blen;
+        if ((uint16_t)crc != (uint16_t)(c[0] | c[1] << 8)) return -5;
+
+        meta->version = FRAME_V2;
+        meta->type = data[3];
+        meta->short_hdr = 1;
+        meta->seq = data[4];
+        meta->ts_us = (uint64_t)(data[5] | data[6] << 8);
+        *body = data + FRAME_V2_SHORT_HDR;
+        *body_len = blen;
+        return 0;
+    }
+
+    size_t blen = total - FRAME_V2_OVERHEAD;
+    if (crc32c(data + 2, FRAME_V2_HDR - 2 + blen) != telem_load_le32(data + FRAME_V2_HDR + blen)) {
+        return -5;
+    }
+
+    meta->version = FRAME_V2;
+    meta->type = data[3];
+    meta->short_hdr = 0;
+    meta->seq = telem_load_le32(data + 4);
+    meta->ts_us = telem_load_le64(data + 8);
+    *body = data + FRAME_V2_HDR;
+    *body_len = blen;
+    return 0;
+}
+
+/* Decode a telemetry frame of either version. Same return codes as
+ * frame_v2_decode(); -7 for a v2 frame of another type. */
+static inline int telemetry_decode_any(const uint8_t *data, size_t len, telemetry_t *t,
+                                       frame_meta_t *meta)
+{
+    if (len >= 2 && data[1] == FRAME_PAYLOAD) {
+        meta->version = 1;
+        meta->type = FRAME_TYPE_TELEMETRY;
+        meta->short_hdr = 0;
+        meta->seq = 0;
+        meta->ts_us = 0;
+        return telemetry_decode_frame(data, len, t);
+    }
+
+    const uint8_t *body;
+    size_t body_len;
+    int ret = frame_v2_decode(data, len, meta, &body, &body_len);
+    if (ret < 0) return ret;
+    if (meta->type != FRAME_TYPE_TELEMETRY || meta->short_hdr || body_len != FRAME_PAYLOAD) {
+        return -7;
+    }
+
+    telemetry_unpack(body, t);
+    return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_CODEC_H
@@ -0,0 +1,173 @@
+/*
+ * telemetry_delta.c - Keyframe/delta encoding of telemetry frames
+ */
+
+#include "telemetry_delta.h"
+
+#include <string.h>
+
+enum {
+#define X(name, type, byte, shift, width) TELEM_IDX_##name,
+    TELEM_FIELDS(X)
+#undef X
+    TELEM_NFIELDS
+};
+
+TELEM_STATIC_ASSERT(TELEM_NFIELDS <= 16, "delta bitmap is 16 bits");
+TELEM_STATIC_ASSERT(2 + FRAME_PAYLOAD <= FRAME_V2_SHORT_MAX_BODY,
+                    "worst-case delta does not fit a short frame");
+
+void telemetry_delta_enc_init(telemetry_delta_enc_t *e, unsigned key_interval)
+{
+    memset(e, 0, sizeof(*e));
+    if (key_interval < 1) key_interval = 1;
+    if (key_interval > TELEM_DELTA_MAX_KEY_INTERVAL) key_interval = TELEM_DELTA_MAX_KEY_INTERVAL;
+    e->key_interval = key_interval;
+}
+
+void telemetry_delta_enc_reset(telemetry_delta_enc_t *e)
+{
+    e->have_key = 0;
+}
+
+size_t telemetry_delta_encode(telemetry_delta_enc_t *e, const telemetry_t *t,
+                              uint32_t seq, uint64_t ts_us, uint8_t out[FRAME_MAX_SIZE])
+{
+    uint8_t payload[FRAME_PAYLOAD];
+    telemetry_t cur;
+    size_t n;
+
+    // Compare what the wire carries, i.e. values masked to their width
+    telemetry_pack(t, payload);
+    telemetry_unpack(payload, &cur);
+
+    int key = !e->have_key ||
+              seq - e->key_seq >= e->key_interval ||
+              seq != e->last_seq + 1 ||
+              ts_us < e->key_ts_us ||
+              (ts_us - e->key_ts_us) / 1000 > 0xFFFF;
+
+    if (key) {
+        n = frame_v2_encode(FRAME_TYPE_TELEMETRY, seq, ts_us, payload, sizeof(payload), out);
+        e->have_key = 1;
+        e->key_seq = seq;
+        e->key_ts_us = ts_us;
+        e->keyframes++;
+    } else {
+        uint16_t changed = 0;
+        uint64_t bits = 0;
+        unsigned nbits = 0;
+#define X(name, type, byte, shift, width)                       \
+        if (cur.name != e->last.name) {                         \
+            changed |= (uint16_t)(1u << TELEM_IDX_##name);      \
+            bits |= (uint64_t)cur.name << nbits;                \
+            nbits += (width);                                   \
+        }
+        TELEM_FIELDS(X)
+#undef X
+        uint8_t body[2 + FRAME_PAYLOAD];
+        size_t vbytes = (nbits + 7) / 8;
+
+        body[0] = (uint8_t)changed;
+        body[1] = (uint8_t)(changed >> 8);
+        telem_store_le64(body + 2, bits);
+        n = frame_v2_short_encode(FRAME_TYPE_DELTA, (uint8_t)seq,
+                                  (uint16_t)((ts_us - e->key_ts_us) / 1000),
+                                  body, 2 + vbytes, out);
+        e->deltas++;
+    }
+
+    e->last = cur;
+    e->last_seq = seq;
+    e->bytes += n;
+    return n;
+}
+
+void telemetry_delta_dec_init(telemetry_delta_dec_t *d)
+{
+    memset(d, 0, sizeof(*d));
+}
+
+static int apply_delta(telemetry_t *s, const uint8_t *body, size_t body_len)
+{
+    uint8_t vals[FRAME_PAYLOAD] = {0};
+    size_t vbytes = body_len - 2;
+    if (vbytes > sizeof(vals)) return -3;
+
+    uint16_t changed = (uint16_t)(body[0] | body[1] << 8);
+    if (changed >> TELEM_NFIELDS) return -3;
+
+    memcpy(vals, body + 2, vbytes);
+    uint64_t bits = telem_load_le64(vals);
+    unsigned nbits = 0;
+    telemetry_t next = *s;
+#define X(name, type, byte, shift, width)                       \
+    if (changed & (1u << TELEM_IDX_##name)) {                   \
+        next.name = (type)((bits >> nbits) & TELEM_MASK(width)); \
+        nbits += (width);                                       \
+    }
+    TELEM_FIELDS(X)
+#undef X
+    if ((nbits + 7) / 8 != vbytes) return -3;
+
+    *s = next;
+    return 0;
+}
+
+int telemetry_delta_decode(telemetry_delta_dec_t *d, const uint8_t *data, size_t len,
+                           telemetry_t *t, frame_meta_t *meta)
+{
+    const uint8_t *body;
+    size_t body_len;
+    int ret;
+
+    // v1 has no sequence numbers to hang deltas on
+    if (len >= 2 && data[1] == FRAME_PAYLOAD) {
+        ret = telemetry_decode_any(data, len, t, meta);
+        if (ret == 0) d->state = *t;
+        d->have_key = d->in_sync = 0;
+        return ret;
+    }
+
+    ret = frame_v2_decode(data, len, meta, &body, &body_len);
+    if (ret < 0) return ret;
+
+    if (!meta->short_hdr && meta->type == FRAME_TYPE_TELEMETRY && body_len == FRAME_PAYLOAD) {
+        telemetry_unpack(body, &d->state);
+        d->have_key = d->in_sync = 1;
+        d->key_seq = d->last_seq = meta->seq;
+        d->key_ts_us = meta->ts_us;
+        d->keyframes++;
+        *t = d->state;
+        return 0;
+    }
+    if (!meta->short_hdr || meta->type != FRAME_TYPE_DELTA) return -7;
+
+    if (!d->have_key) {
+        d->skipped++;
+        return -9;
+    }
+
+    // Widen the u8 seq and u16 ms offset against the keyframe
+    meta->seq = d->key_seq + (uint8_t)(meta->seq - (uint8_t)d->key_seq);
+    meta->ts_us = d->key_ts_us + meta->ts_us * 1000u;
+    meta->short_hdr = 0;
+
+    if (!d->in_sync || meta->seq != d->last_seq + 1) {
+        d->in_sync = 0;
+        d->skipped++;
+        return -8;
+    }
+
+    ret = apply_delta(&d->state, body, body_len);
+    if (ret < 0) {
+        d->in_sync = 0;
+        d->skipped++;
+        return ret;
+    }
+
+    d->last_seq = meta->seq;
+    d->deltas++;
+    *t = d->state;
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * telemetry_delta.h - Keyframe/delta encoding of telemetry frames
+ *
+ * Most of the payload does not change between ticks (lights, mode, state,
+ * battery temperature, alerts). A delta stream sends a full v2 telemetry
+ * frame as keyframe every N frames and, in between, a short v2 frame of
+ * type FRAME_TYPE_DELTA holding only what changed since the previous
+ * frame:
+ *
+ *     body = changed u16 | values
+ *
+ * Bit i of "changed" stands for the i-th field of TELEM_FIELDS; the values
+ * of the changed fields follow bit-packed at their field width, LSB first,
+ * in table order, padded to a whole byte. A typical tick (speed and
+ * battery moved) is a 14-byte frame instead of 29.
+ *
+ * Keyframes are ordinary telemetry frames, so receivers without a delta
+ * decoder keep working, they just only see every Nth sample. A delta is
+ * applied only if its sequence number directly follows the last frame
+ * decoded; after a loss or reordering the decoder waits for the next
+ * keyframe instead of showing wrong values.
+ */
+
+#ifndef TELEMETRY_DELTA_H
+#define TELEMETRY_DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Deltas reference their keyframe by the low byte of seq */
+#define TELEM_DELTA_MAX_KEY_INTERVAL  255
+
+typedef struct {
+    unsigned key_interval;          // frames per keyframe, 1 = keyframes only
+    int have_key;
+    telemetry_t last;
+    uint32_t last_seq;
+    uint32_t key_seq;
+    uint64_t key_ts_us;
+
+    unsigned long keyframes;
+    unsigned long deltas;
+    unsigned long bytes;
+} telemetry_delta_enc_t;
+
+typedef struct {
+    int have_key;                   // key_seq/key_ts_us are valid
+    int in_sync;                    // state matches the last seq decoded
+    telemetry_t state;
+    uint32_t last_seq;
+    uint32_t key_seq;
+    uint64_t key_ts_us;
+
+    unsigned long keyframes;
+    unsigned long deltas;
+    unsigned long skipped;          // deltas that could not be applied
+} telemetry_delta_dec_t;
+
+/* key_interval is clamped to 1..TELEM_DELTA_MAX_KEY_INTERVAL. */
+void telemetry_delta_enc_init(telemetry_delta_enc_t *e, unsigned key_interval);
+
+/* Make the next frame a keyframe, e.g. for a new connection or while
+ * older frames are being replayed out of order. */
+void telemetry_delta_enc_reset(telemetry_delta_enc_t *e);
+
+/* Encode t as a keyframe or a delta. Returns the frame length. */
+size_t telemetry_delta_encode(telemetry_delta_enc_t *e, const telemetry_t *t,
+                              uint32_t seq, uint64_t ts_us, uint8_t out[FRAME_MAX_SIZE]);
+
+void telemetry_delta_dec_init(telemetry_delta_dec_t *d);
+
+/* Decode a v1, v2 or delta frame into the full state. meta carries the
+ * reconstructed 32-bit seq and timestamp for deltas too. Returns 0, the
+ * telemetry_decode_any() codes, or
+ *   -8 delta skipped after a gap (meta is valid),
+ *   -9 delta before any keyframe (meta is not). */
+int telemetry_delta_decode(telemetry_delta_dec_t *d, const uint8_t *data, size_t len,
+                           telemetry_t *t, frame_meta_t *meta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_DELTA_H
@@ -0,0 +1,334 @@
+/*
+ * transport.c - URI-selected stream transports for client, server and GUI
+ */
+
+#define _GNU_SOURCE
+#include "transport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/un.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/rfcomm.h>
+
+static int parse_rfcomm(const char *rest, transport_addr_t *out)
+{
+    char mac[18];
+    unsigned channel = 1;
+    struct sockaddr_rc *rc = (struct sockaddr_rc *)&out->sa;
+
+    // "AA:BB:CC:DD:EE:FF/1", "any/1" or just the MAC (channel 1)
+    const char *slash = strchr(rest, '/');
+    size_t n = slash ? (size_t)(slash - rest) : strlen(rest);
+    if (n >= sizeof(mac)) return -1;
+    memcpy(mac, rest, n);
+    mac[n] = '\0';
+
+    if (slash && sscanf(slash + 1, "%u", &channel) != 1) return -1;
+    if (channel < 1 || channel > 30) return -1;
+
+    rc->rc_family = AF_BLUETOOTH;
+    if (n == 0 || strcmp(mac, "any") == 0) {
+        rc->rc_bdaddr = *BDADDR_ANY;
+    } else if (str2ba(mac, &rc->rc_bdaddr) < 0) {
+        return -1;
+    }
+    rc->rc_channel = (uint8_t)channel;
+    out->sa_len = sizeof(*rc);
+    return 0;
+}
+
+static int parse_tcp(const char *rest, transport_addr_t *out)
+{
+    char host[128];
+    const char *port;
+
+    // "[::1]:5555", "127.0.0.1:5555", ":5555" (any)
+    if (rest[0] == '[') {
+        const char *end = strchr(rest, ']');
+        if (!end || end[1] != ':' || (size_t)(end - rest - 1) >= sizeof(host)) return -1;
+        memcpy(host, rest + 1, (size_t)(end - rest - 1));
+        host[end - rest - 1] = '\0';
+        port = end + 2;
+    } else {
+        const char *colon = strrchr(rest, ':');
+        if (!colon || (size_t)(colon - rest) >= sizeof(host)) return -1;
+        memcpy(host, rest, (size_t)(colon - rest));
+        host[colon - rest] = '\0';
+        port = colon + 1;
+    }
+
+    int any = (host[0] == '\0' || strcmp(host, "*") == 0);
+    struct addrinfo hints = {0}, *res = NULL;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = any ? AI_PASSIVE : 0;
+
+    if (getaddrinfo(any ? NULL : host, port, &hints, &res) != 0 || !res) return -1;
+    memcpy(&out->sa, res->ai_addr, res->ai_addrlen);
+    out->sa_len = res->ai_addrlen;
+    freeaddrinfo(res);
+    return 0;
+}
+
+static int parse_path(const char *rest, transport_addr_t *out)
+{
+    if (rest[0] == '\0' || strlen(rest) >= sizeof(out->path)) return -1;
+    snprintf(out->path, sizeof(out->path), "%s", rest);
+    return 0;
+}
+
+int transport_parse(const char *uri, transport_addr_t *out)
+{
+    int rc = -1;
+
+    memset(out, 0, sizeof(*out));
+    out->keep_fd = -1;
+    snprintf(out->uri, sizeof(out->uri), "%s", uri);
+
+    if (strncmp(uri, "rfcomm://", 9) == 0) {
+        out->kind = TRANSPORT_RFCOMM;
+        rc = parse_rfcomm(uri + 9, out);
+    } else if (strncmp(uri, "tcp://", 6) == 0) {
+        out->kind = TRANSPORT_TCP;
+        rc = parse_tcp(uri + 6, out);
+    } else if (strncmp(uri, "unix://", 7) == 0) {
+        struct sockaddr_un *un = (struct sockaddr_un *)&out->sa;
+        out->kind = TRANSPORT_UNIX;
+        rc = parse_path(uri + 7, out);
+        if (rc == 0) {
+            un->sun_family = AF_UNIX;
+            memcpy(un->sun_path, out->path, strlen(out->path) + 1);
+            out->sa_len = sizeof(*un);
+        }
+    } else if (strncmp(uri, "pty://", 6) == 0) {
+        out->kind = TRANSPORT_PTY;
+        rc = parse_path(uri + 6, out);
+    }
+
+    if (rc < 0) errno = EINVAL;
+    return rc;
+}
+
+static int make_raw(int fd)
+{
+    struct termios tio;
+    if (tcgetattr(fd, &tio) < 0) return -1;
+    cfmakeraw(&tio);
+    return tcsetattr(fd, TCSANOW, &tio);
+}
+
+static int listen_pty(transport_addr_t *a)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (master < 0) return -1;
+
+    const char *slave = NULL;
+    if (grantpt(master) < 0 || unlockpt(master) < 0 || !(slave = ptsname(master)) ||
+        make_raw(master) < 0) {
+        goto fail;
+    }
+
+    // Keep one slave fd open: without it the master reads EIO whenever
+    // no client has the pty open, e.g. before the first one shows up.
+    a->keep_fd = open(slave, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (a->keep_fd < 0) goto fail;
+
+    unlink(a->path);
+    if (symlink(slave, a->path) < 0) goto fail;
+
+    return master;
+
+fail:;
+    int err = errno;
+    if (a->keep_fd >= 0) close(a->keep_fd);
+    a->keep_fd = -1;
+    close(master);
+    errno = err;
+    return -1;
+}
+
+static int socket_for(const transport_addr_t *a)
+{
+    int proto = (a->kind == TRANSPORT_RFCOMM) ? BTPROTO_RFCOMM : 0;
+    int fd = socket(a->sa.ss_family, SOCK_STREAM | SOCK_CLOEXEC, proto);
+
+    // Frames are small and already batched by the sender. With Nagle, a
+    // second write (e.g. a pong next to an echo) waits for the peer's
+    // delayed ACK, which then holds back every later write by a period.
+    // Accepted sockets inherit this from the listener.
+    if (fd >= 0 && a->kind == TRANSPORT_TCP) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+int transport_listen(transport_addr_t *a, int backlog)
+{
+    if (a->kind == TRANSPORT_PTY) return listen_pty(a);
+
+    int fd = socket_for(a);
+    if (fd < 0) return -1;
+
+    if (a->kind == TRANSPORT_TCP) {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    } else if (a->kind == TRANSPORT_UNIX) {
+        unlink(a->path);
+    }
+
+    if (bind(fd, (const struct sockaddr *)&a->sa, a->sa_len) < 0 ||
+        listen(fd, backlog) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    return fd;
+}
+
+int transport_connect_start(const transport_addr_t *a, int *in_progress)
+{
+    *in_progress = 0;
+
+    if (a->kind == TRANSPORT_PTY) {
+        int fd = open(a->path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) return -1;
+        if (make_raw(fd) < 0) {
+            int err = errno;
+            close(fd);
+            errno = err;
+            return -1;
+        }
+        return fd;
+    }
+
+    int fd = socket_for(a);
+    if (fd < 0) return -1;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    if (connect(fd, (const struct sockaddr *)&a->sa, a->sa_len) == 0) {
+        return fd;
+    }
+
+    if (errno == EINPROGRESS) {
+        *in_progress = 1;
+        return fd;
+    }
+
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return -1;
+}
+
+int transport_connect_check(int fd, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0) return (errno == EINTR) ? 0 : -1;
+    if (ret == 0) return 0;
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return 1;
+}
+
+int transport_connect(const transport_addr_t *a, int timeout_ms)
+{
+    int in_progress;
+    int fd = transport_connect_start(a, &in_progress);
+    if (fd < 0 || !in_progress) return fd;
+
+    int ret = transport_connect_check(fd, timeout_ms);
+    if (ret > 0) return fd;
+    if (ret == 0) errno = ETIMEDOUT;
+
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return -1;
+}
+
+ssize_t transport_send(int fd, const void *buf, size_t len)
+{
+    ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == ENOTSOCK) {
+        n = write(fd, buf, len);
+    }
+    return n;
+}
+
+int transport_outq(int fd)
+{
+    int n = 0, domain = 0, sndbuf = 0;
+    socklen_t len = sizeof(domain);
+
+    if (ioctl(fd, TIOCOUTQ, &n) < 0) return -1;
+
+    // Bluetooth sockets answer with the free space instead
+    if (getsockopt(fd, SOL_SOCKET, SO_DOMAIN, &domain, &len) == 0 && domain == AF_BLUETOOTH) {
+        len = sizeof(sndbuf);
+        if (getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &len) < 0) return -1;
+        n = sndbuf > n ? sndbuf - n : 0;
+    }
+    return n;
+}
+
+void transport_peer_name(const struct sockaddr *addr, socklen_t len, int fd,
+                         char *out, size_t out_len)
+{
+    if (addr->sa_family == AF_BLUETOOTH && len >= sizeof(struct sockaddr_rc)) {
+        char bt[18];
+        ba2str(&((const struct sockaddr_rc *)addr)->rc_bdaddr, bt);
+        snprintf(out, out_len, "%s", bt);
+    } else if (addr->sa_family == AF_INET && len >= sizeof(struct sockaddr_in)) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)addr;
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &in->sin_addr, ip, sizeof(ip));
+        snprintf(out, out_len, "%s:%u", ip, ntohs(in->sin_port));
+    } else if (addr->sa_family == AF_INET6 && len >= sizeof(struct sockaddr_in6)) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)addr;
+        char ip[INET6_ADDRSTRLEN];
+        inet_ntop(AF_INET6, &in6->sin6_addr, ip, sizeof(ip));
+        snprintf(out, out_len, "[%s]:%u", ip, ntohs(in6->sin6_port));
+    } else if (addr->sa_family == AF_UNIX) {
+        // Unix clients are usually unnamed, and fds are reused as soon as
+        // one closes: number connections in accept order instead
+        static unsigned long unix_conns;
+        snprintf(out, out_len, "unix#%lu", ++unix_conns);
+    } else {
+        snprintf(out, out_len, "fd %d", fd);
+    }
+}
+
+void transport_cleanup(transport_addr_t *a)
+{
+    if (a->kind == TRANSPORT_UNIX || a->kind == TRANSPORT_PTY) {
+        unlink(a->path);
+    }
+    if (a->keep_fd >= 0) {
+        close(a->keep_fd);
+        a->keep_fd = -1;
+    }
+}
@@ -0,0 +1,102 @@
+/*
+ * transport.h - URI-selected stream transports for client, server and GUI
+ *
+ * Supported URIs:
+ *
+ *     rfcomm://AA:BB:CC:DD:EE:FF/1     Bluetooth RFCOMM, channel 1
+ *     tcp://127.0.0.1:5555             TCP (listen on tcp://:5555 for any)
+ *     unix:///tmp/telem.sock           Unix-domain stream socket
+ *     pty:///tmp/telem.pty             pseudo-terminal
+ *
+ * All backends carry the same byte stream, so everything above this layer
+ * can be load-tested and profiled on a machine without paired radios.
+ *
+ * A pty has no listen/accept: transport_listen() opens the master side in
+ * raw mode and symlinks the slave to the given path, then returns the
+ * master fd, which is already the one and only connection. Clients open
+ * the symlink with transport_connect().
+ */
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRANSPORT_PATH_LEN 108          // sizeof(sockaddr_un.sun_path)
+
+typedef enum {
+    TRANSPORT_RFCOMM,
+    TRANSPORT_TCP,
+    TRANSPORT_UNIX,
+    TRANSPORT_PTY,
+} transport_kind_t;
+
+typedef struct {
+    transport_kind_t kind;
+    struct sockaddr_storage sa;         // socket backends
+    socklen_t sa_len;
+    char path[TRANSPORT_PATH_LEN];      // unix socket or pty symlink
+    char uri[160];                      // as given, for messages
+    int keep_fd;                        // pty: slave held open by the listener
+} transport_addr_t;
+
+/* Parse a URI. Returns 0, or -1 (errno = EINVAL) for an unknown scheme or a
+ * malformed address. */
+int transport_parse(const char *uri, transport_addr_t *out);
+
+/* True when transport_listen() returns a listening socket rather than an
+ * already connected stream (pty). */
+static inline int transport_is_listener(const transport_addr_t *a)
+{
+    return a->kind != TRANSPORT_PTY;
+}
+
+/* Create, bind and listen. Unix socket paths are unlinked first.
+ * Returns the fd, or -1 with errno set. */
+int transport_listen(transport_addr_t *a, int backlog);
+
+/* Connect with a timeout. The returned fd is non-blocking.
+ * Returns the fd, or -1 with errno set (ETIMEDOUT on timeout). */
+int transport_connect(const transport_addr_t *a, int timeout_ms);
+
+/* Non-blocking connect for callers that must keep working meanwhile.
+ * Returns the fd with *in_progress set while the handshake is still
+ * running, or -1 with errno set. */
+int transport_connect_start(const transport_addr_t *a, int *in_progress);
+
+/* Wait up to timeout_ms (0 = just look) for a started connect.
+ * Returns 1 connected, 0 still in progress, -1 failed (errno set; the
+ * caller closes fd). */
+int transport_connect_check(int fd, int timeout_ms);
+
+/* send(MSG_NOSIGNAL) for sockets, write() for a pty. Same return as send(). */
+ssize_t transport_send(int fd, const void *buf, size_t len);
+
+/* How much written data has not left yet (TIOCOUTQ, i.e. SIOCOUTQ on a
+ * socket). The unit is the backend's: payload bytes for TCP and a pty,
+ * buffer memory (several hundred bytes per send()) for unix and RFCOMM
+ * sockets. Returns -1 with errno set where the backend cannot tell. */
+int transport_outq(int fd);
+
+/* Printable peer address for an accepted connection of any backend.
+ * Unnamed Unix peers get "unix#N", N counting this process's Unix
+ * connections, so call it once per accepted connection. */
+void transport_peer_name(const struct sockaddr *addr, socklen_t len, int fd,
+                         char *out, size_t out_len);
+
+/* Undo what transport_listen() left behind besides the returned fd:
+ * the unix socket file, the pty symlink and the held slave. */
+void transport_cleanup(transport_addr_t *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRANSPORT_H
@@ -0,0 +1,61 @@
+/*
+ * tx_batch.c - Sender-side batching of frames into one send()
+ */
+
+#include "tx_batch.h"
+#include "pacer.h"
+#include "transport.h"
+
+#include <errno.h>
+#include <string.h>
+
+void tx_batch_put(tx_batch_t *b, const uint8_t *data, size_t len, bool is_frame, uint64_t now)
+{
+    if (!tx_batch_fits(b, len)) {
+        b->dropped += is_frame;
+        return;
+    }
+    memcpy(b->buf + b->len, data, len);
+    b->len += len;
+    if (is_frame) {
+        if (b->frames++ == 0) b->first_ns = now;
+    }
+}
+
+bool tx_batch_due(const tx_batch_t *b, unsigned batch_frames, uint64_t batch_ns, uint64_t now)
+{
+    if (b->frames >= batch_frames) return true;
+    return b->frames > 0 && now - b->first_ns >= batch_ns;
+}
+
+int tx_batch_flush(int fd, tx_batch_t *b, lat_hist_t *send_lat)
+{
+    if (b->len == 0) return 0;
+
+    uint64_t t0 = pacer_now_ns();
+    ssize_t w = transport_send(fd, b->buf, b->len);
+    lat_hist_add(send_lat, pacer_now_ns() - t0);
+
+    if (w < 0) {
+        // Socket belum siap → coba lagi di flush berikutnya
+        b->stuck = b->len;
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+
+    // Walk the records the kernel took to keep frame counts exact
+    size_t pos = b->head_skip;
+    while (pos < (size_t)w) {
+        if (tx_record_is_sample(b->buf + pos)) {
+            b->sent_frames++;
+            b->frames--;
+        }
+        pos += tx_record_len(b->buf + pos);
+    }
+    b->head_skip = pos - (size_t)w;
+
+    b->sends++;
+    memmove(b->buf, b->buf + w, b->len - (size_t)w);
+    b->len -= (size_t)w;
+    b->stuck = b->len;
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * tx_batch.h - Sender-side batching of frames into one send()
+ *
+ * Frames, pings and acks are appended to one buffer and leave together.
+ * The caller flushes when the batch is due: batch_frames telemetry frames
+ * are queued, or the oldest of them has waited batch_ns. A short write
+ * keeps the unsent tail, which may start in the middle of a record, for
+ * the next flush.
+ *
+ *     tx_batch_put(&b, frame, len, true, now);
+ *     if (tx_batch_due(&b, batch_frames, batch_ns, now) &&
+ *         tx_batch_flush(fd, &b, &send_lat) < 0)
+ *         ... connection broken ...
+ *
+ * Records are frames (0xCE, len, ..., '\n') or single ping bytes. Only
+ * telemetry frames count as frames; control frames ride along.
+ */
+
+#ifndef TX_BATCH_H
+#define TX_BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lat_hist.h"
+#include "telemetry_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TX_BATCH_MAX_FRAMES 256
+
+typedef struct {
+    uint8_t buf[(TX_BATCH_MAX_FRAMES + 1) * FRAME_MAX_SIZE];
+    size_t len;
+    size_t head_skip;           // tail of a half-sent record at the front
+    size_t stuck;               // bytes the last send() did not take
+    unsigned frames;            // whole frames not yet sent
+    uint64_t first_ns;          // when the oldest queued frame was built
+
+    unsigned long sends;        // send() calls that moved data
+    unsigned long sent_frames;
+    unsigned long dropped;      // did not fit, or a delta cut off by a reconnect
+} tx_batch_t;
+
+static inline size_t tx_record_len(const uint8_t *p)
+{
+    return (p[0] == FRAME_START) ? (size_t)p[1] + 3 : 1;
+}
+
+static inline bool tx_record_is_sample(const uint8_t *p)
+{
+    return p[0] == FRAME_START && !FRAME_TYPE_IS_CTRL(frame_type(p));
+}
+
+static inline bool tx_batch_fits(const tx_batch_t *b, size_t len)
+{
+    return sizeof(b->buf) - b->len >= len;
+}
+
+/* Append one record; is_frame for telemetry frames. A record that does
+ * not fit is dropped (and counted, if a frame). */
+void tx_batch_put(tx_batch_t *b, const uint8_t *data, size_t len, bool is_frame, uint64_t now);
+
+/* batch_frames frames queued, or the oldest has waited batch_ns. */
+bool tx_batch_due(const tx_batch_t *b, unsigned batch_frames, uint64_t batch_ns, uint64_t now);
+
+/* One send() for everything queued, timed into send_lat. A short write
+ * keeps the tail for the next flush. Returns 0, or -1 when the
+ * connection is broken. */
+int tx_batch_flush(int fd, tx_batch_t *b, lat_hist_t *send_lat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TX_BATCH_H
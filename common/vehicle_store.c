@@ -0,0 +1,246 @@
+/*
+ * vehicle_store.c - Latest state per vehicle, readable without locks
+ */
+
+#include "vehicle_store.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VEHICLE_WORDS (sizeof(vehicle_state_t) / sizeof(uint64_t))
+
+TELEM_STATIC_ASSERT(sizeof(vehicle_state_t) % sizeof(uint64_t) == 0,
+                    "vehicle_state_t must be whole words");
+
+/* The record is copied word by word with relaxed atomics, so a reader
+ * racing the writer sees stale or mixed words (caught by the sequence
+ * check) but never a data race. Two cache lines per slot. */
+struct vehicle_slot {
+    uint32_t seq;                   // odd while the writer is inside
+    uint32_t pad;
+    uint64_t w[VEHICLE_WORDS];
+} __attribute__((aligned(64)));
+
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static void slot_load(const vehicle_slot_t *s, vehicle_state_t *out)
+{
+    uint64_t w[VEHICLE_WORDS];
+    for (size_t i = 0; i < VEHICLE_WORDS; i++) w[i] = __atomic_load_n(&s->w[i], __ATOMIC_RELAXED);
+    memcpy(out, w, sizeof(*out));
+}
+
+static void slot_store(vehicle_slot_t *s, const vehicle_state_t *st)
+{
+    uint64_t w[VEHICLE_WORDS];
+    memcpy(w, st, sizeof(w));
+
+    uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);    // odd seq before any word
+    for (size_t i = 0; i < VEHICLE_WORDS; i++) __atomic_store_n(&s->w[i], w[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static void slot_read(const vehicle_slot_t *s, vehicle_state_t *out)
+{
+    for (;;) {
+        uint32_t s0 = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        if (s0 & 1) {
+            cpu_relax();
+            continue;
+        }
+        slot_load(s, out);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);    // words before the re-check
+        if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == s0) return;
+    }
+}
+
+static size_t key_hash(uint64_t key)
+{
+    // Bluetooth addresses share their vendor prefix; mix all bits down
+    key ^= key >> 33;
+    key *= UINT64_C(0xff51afd7ed558ccd);
+    key ^= key >> 33;
+    return (size_t)key;
+}
+
+/* Slot holding key, or the empty slot where it would go */
+static size_t probe(const vehicle_store_t *vs, uint64_t key, uint64_t *found)
+{
+    size_t i = key_hash(key) & vs->mask;
+    for (;;) {
+        uint64_t k = __atomic_load_n(&vs->keys[i], __ATOMIC_ACQUIRE);
+        if (k == key || k == 0) {
+            *found = k;
+            return i;
+        }
+        i = (i + 1) & vs->mask;
+    }
+}
+
+int vehicle_store_init(vehicle_store_t *vs, size_t max_vehicles)
+{
+    size_t n = 2;
+
+    memset(vs, 0, sizeof(*vs));
+    if (max_vehicles == 0 || max_vehicles > (SIZE_MAX / sizeof(vehicle_slot_t)) / 4) {
+        errno = EINVAL;
+        return -1;
+    }
+    // At most half full: probes stay short and always end at an empty slot
+    while (n < 2 * max_vehicles) n <<= 1;
+
+    vs->keys = calloc(n, sizeof(*vs->keys));
+    vs->slots = aligned_alloc(64, n * sizeof(*vs->slots));
+    if (!vs->keys || !vs->slots) {
+        vehicle_store_free(vs);
+        errno = ENOMEM;
+        return -1;
+    }
+    memset(vs->slots, 0, n * sizeof(*vs->slots));
+    vs->mask = n - 1;
+    vs->max_vehicles = max_vehicles;
+    return 0;
+}
+
+void vehicle_store_free(vehicle_store_t *vs)
+{
+    free(vs->keys);
+    free(vs->slots);
+    vs->keys = NULL;
+    vs->slots = NULL;
+}
+
+uint64_t vehicle_key(const char *peer)
+{
+    unsigned b[6];
+    char tail;
+
+    if (sscanf(peer, "%2x:%2x:%2x:%2x:%2x:%2x%c", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5],
+               &tail) == 6) {
+        uint64_t key = 0;
+        for (int i = 0; i < 6; i++) key = (key << 8) | b[i];
+        return key | VEHICLE_KEY_BDADDR;
+    }
+
+    // FNV-1a; other transports have no stable address, so the name is it
+    uint64_t h = UINT64_C(0xcbf29ce484222325);
+    for (const unsigned char *p = (const unsigned char *)peer; *p; p++) {
+        h = (h ^ *p) * UINT64_C(0x100000001b3);
+    }
+    h &= ~VEHICLE_KEY_BDADDR;
+    return h ? h : 1;
+}
+
+void vehicle_key_str(uint64_t key, char *out, size_t out_len)
+{
+    if (key & VEHICLE_KEY_BDADDR) {
+        snprintf(out, out_len, "%02X:%02X:%02X:%02X:%02X:%02X",
+                 (unsigned)(key >> 40) & 0xFF, (unsigned)(key >> 32) & 0xFF,
+                 (unsigned)(key >> 24) & 0xFF, (unsigned)(key >> 16) & 0xFF,
+                 (unsigned)(key >> 8) & 0xFF, (unsigned)key & 0xFF);
+    } else {
+        snprintf(out, out_len, "#%016llx", (unsigned long long)key);
+    }
+}
+
+long vehicle_store_connect(vehicle_store_t *vs, uint64_t key, const char *name, uint64_t now_us)
+{
+    vehicle_state_t st;
+    uint64_t found;
+    size_t i = probe(vs, key, &found);
+
+    if (found) {
+        slot_load(&vs->slots[i], &st);
+    } else {
+        if (vs->count >= vs->max_vehicles) {
+            vs->full++;
+            errno = ENOSPC;
+            return -1;
+        }
+        memset(&st, 0, sizeof(st));
+        st.key = key;
+        st.first_seen_us = now_us;
+    }
+
+    snprintf(st.name, sizeof(st.name), "%s", name);
+    st.last_rx_us = now_us;
+    st.sessions++;
+    st.connected = 1;
+    slot_store(&vs->slots[i], &st);
+
+    if (!found) {
+        // Readers find the key only once its record is complete
+        __atomic_store_n(&vs->keys[i], key, __ATOMIC_RELEASE);
+        __atomic_store_n(&vs->count, vs->count + 1, __ATOMIC_RELAXED);
+    }
+    return (long)i;
+}
+
+void vehicle_store_rx(vehicle_store_t *vs, long slot, size_t bytes, uint64_t now_us)
+{
+    vehicle_state_t st;
+    if (slot < 0) return;
+    slot_load(&vs->slots[slot], &st);
+    st.bytes += bytes;
+    st.last_rx_us = now_us;
+    slot_store(&vs->slots[slot], &st);
+}
+
+void vehicle_store_frame(vehicle_store_t *vs, long slot, const telemetry_t *t,
+                         const frame_meta_t *meta, uint64_t now_us)
+{
+    vehicle_state_t st;
+    if (slot < 0) return;
+    slot_load(&vs->slots[slot], &st);
+    st.telem = *t;
+    st.version = meta->version;
+    if (meta->version >= FRAME_V2) {
+        st.last_seq = meta->seq;
+        st.sender_ts_us = meta->ts_us;
+    }
+    st.frames++;
+    st.last_frame_us = now_us;
+    slot_store(&vs->slots[slot], &st);
+}
+
+void vehicle_store_disconnect(vehicle_store_t *vs, long slot, uint64_t now_us)
+{
+    vehicle_state_t st;
+    if (slot < 0) return;
+    slot_load(&vs->slots[slot], &st);
+    st.connected = 0;
+    st.last_rx_us = now_us;
+    slot_store(&vs->slots[slot], &st);
+}
+
+int vehicle_store_get(const vehicle_store_t *vs, uint64_t key, vehicle_state_t *out)
+{
+    uint64_t found;
+    size_t i = probe(vs, key, &found);
+    if (!found) return -1;
+    slot_read(&vs->slots[i], out);
+    return 0;
+}
+
+int vehicle_store_read(const vehicle_store_t *vs, size_t i, vehicle_state_t *out)
+{
+    if (i > vs->mask || !__atomic_load_n(&vs->keys[i], __ATOMIC_ACQUIRE)) return -1;
+    slot_read(&vs->slots[i], out);
+    return 0;
+}
+
+size_t vehicle_store_count(const vehicle_store_t *vs)
+{
+    return __atomic_load_n(&vs->count, __ATOMIC_RELAXED);
+}
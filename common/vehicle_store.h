@@ -0,0 +1,104 @@
+/*
+ * vehicle_store.h - Latest state per vehicle, readable without locks
+ *
+ * The server keeps one record per vehicle that outlives its connections:
+ * the last telemetry, when it was seen, and byte/frame/session counters.
+ * Records live in a fixed open-addressing table (linear probing, power of
+ * two slots, never more than half full) keyed by vehicle_key().
+ *
+ * One thread writes (the receive loop); any number of threads read. Each
+ * record is guarded by a sequence counter: the writer makes it odd, stores
+ * the record, and makes it even again. A reader copies the record and
+ * retries if the counter was odd or changed meanwhile, so it always gets a
+ * consistent snapshot and never makes the writer wait. Keys are published
+ * once, after their record is filled in, and are never removed, so readers
+ * can probe the table while it grows.
+ *
+ *     vehicle_store_t vs;
+ *     vehicle_store_init(&vs, 4096);
+ *     long v = vehicle_store_connect(&vs, vehicle_key(peer), peer, now_us);
+ *     vehicle_store_frame(&vs, v, &telem, &meta, now_us);    // writer
+ *     ...
+ *     vehicle_state_t st;
+ *     if (vehicle_store_get(&vs, key, &st) == 0) ...         // any thread
+ */
+
+#ifndef VEHICLE_STORE_H
+#define VEHICLE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VEHICLE_NAME_LEN   32
+#define VEHICLE_KEY_BDADDR (UINT64_C(1) << 63)    // key holds a 48-bit Bluetooth address
+
+/* One vehicle's record. Times are the server's CLOCK_REALTIME in µs. */
+typedef struct {
+    uint64_t key;
+    char name[VEHICLE_NAME_LEN];    // peer name of the latest session
+    uint64_t first_seen_us;
+    uint64_t last_rx_us;            // any bytes
+    uint64_t last_frame_us;         // last decoded telemetry
+    uint64_t sender_ts_us;          // v2: sender's stamp of that frame
+    uint64_t bytes;
+    uint64_t frames;
+    uint32_t sessions;
+    uint32_t last_seq;              // v2 only
+    telemetry_t telem;              // valid once frames > 0
+    uint8_t version;                // of the last frame
+    uint8_t connected;
+} vehicle_state_t;
+
+typedef struct vehicle_slot vehicle_slot_t;
+
+typedef struct {
+    uint64_t *keys;                 // 0 = empty; accessed atomically
+    vehicle_slot_t *slots;
+    size_t mask;                    // slots - 1
+    size_t max_vehicles;
+    size_t count;                   // accessed atomically
+    unsigned long full;             // connects refused, table at max_vehicles
+} vehicle_store_t;
+
+/* Room for max_vehicles (> 0). Returns 0, or -1 with errno set. */
+int vehicle_store_init(vehicle_store_t *vs, size_t max_vehicles);
+void vehicle_store_free(vehicle_store_t *vs);
+
+/* Bluetooth addresses ("AA:BB:CC:DD:EE:FF") map to the address with
+ * VEHICLE_KEY_BDADDR set; any other peer name to a hash of it. Never 0. */
+uint64_t vehicle_key(const char *peer);
+
+/* "AA:BB:CC:DD:EE:FF" for address keys, "#<hex>" for hashed names. */
+void vehicle_key_str(uint64_t key, char *out, size_t out_len);
+
+/* ---- Writer side: one thread only ---- */
+
+/* Find or add the vehicle and start a session. Returns its slot, or -1
+ * (ENOSPC) when max_vehicles are already known. */
+long vehicle_store_connect(vehicle_store_t *vs, uint64_t key, const char *name, uint64_t now_us);
+void vehicle_store_rx(vehicle_store_t *vs, long slot, size_t bytes, uint64_t now_us);
+void vehicle_store_frame(vehicle_store_t *vs, long slot, const telemetry_t *t,
+                         const frame_meta_t *meta, uint64_t now_us);
+void vehicle_store_disconnect(vehicle_store_t *vs, long slot, uint64_t now_us);
+
+/* ---- Reader side: any thread ---- */
+
+/* Returns 0 and a consistent copy, or -1 if the key is unknown. */
+int vehicle_store_get(const vehicle_store_t *vs, uint64_t key, vehicle_state_t *out);
+
+/* Copy of slot i (0 <= i <= mask). Returns 0, or -1 for an empty slot. */
+int vehicle_store_read(const vehicle_store_t *vs, size_t i, vehicle_state_t *out);
+
+size_t vehicle_store_count(const vehicle_store_t *vs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VEHICLE_STORE_H
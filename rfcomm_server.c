@@ -1,7 +1,7 @@
 /*
  * rfcomm_server.c - Bluetooth RFCOMM server with debug logs
  * 
- * Compile: gcc -o rfcomm_server rfcomm_server.c -lbluetooth
+ * Compile: gcc -o rfcomm_server rfcomm_server.c common/hexfmt.c -lbluetooth
  * Usage:   sudo ./rfcomm_server -e -x
  */
 
@@ -18,6 +18,8 @@
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/rfcomm.h>
 
+#include "common/hexfmt.h"
+
 static volatile int g_running = 1;
 
 static void handle_signal(int sig) {
@@ -26,12 +28,16 @@ static void handle_signal(int sig) {
     printf("\n[DEBUG] Shutting down server...\n");
 }
 
+#define HEX_LINE_BYTES 2048
+
 static void print_hex(const uint8_t *data, size_t len) {
-    printf("[HEX] ");
-    for (size_t i = 0; i < len; i++) {
-        printf("%02X ", data[i]);
-    }
-    printf("\n");
+    static char line[HEXFMT_LINE_SIZE(HEX_LINE_BYTES)];
+    do {
+        size_t n = len < HEX_LINE_BYTES ? len : HEX_LINE_BYTES;
+        fwrite(line, 1, hexfmt_line(line, data, n), stdout);
+        data += n;
+        len -= n;
+    } while (len > 0);
 }
 
 static void print_timestamp(void) {
@@ -76,14 +82,7 @@ static void handle_client(int client_sock, const char *client_addr, int echo_mod
             print_hex(buf, bytes_read);
         } else {
             buf[bytes_read] = '\0';
-            int printable = 1;
-            for (ssize_t i = 0; i < bytes_read; i++) {
-                if (buf[i] < 32 && buf[i] != '\n' && buf[i] != '\r' && buf[i] != '\t') {
-                    printable = 0;
-                    break;
-                }
-            }
-            if (printable) {
+            if (hexfmt_is_text(buf, (size_t)bytes_read)) {
                 printf("%s", buf);
                 if (buf[bytes_read - 1] != '\n') printf("\n");
             } else {
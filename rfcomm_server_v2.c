@@ -1,10 +1,19 @@
 /*
- * rfcomm_server.c - Bluetooth RFCOMM server with debug logs
+ * rfcomm_server_v2.c - Bluetooth RFCOMM server that decodes telemetry frames
  * 
- * Compile: gcc -o rfcomm_server rfcomm_server.c -lbluetooth
- * Usage:   sudo ./rfcomm_server -e -x
+ * Compile: gcc -o rfcomm_server_v2 rfcomm_server_v2.c common/telem_server.c common/frame_reasm.c \
+ *          common/transport.c common/crc32c.c common/lat_hist.c common/link_stats.c \
+ *          common/telemetry_delta.c common/ctrl_msg.c common/vehicle_store.c common/shm_ring.c \
+ *          common/pubsub.c common/recorder.c common/hexfmt.c common/telem_out.c -lbluetooth -pthread
+ * Usage:   sudo ./rfcomm_server_v2 -e -x
+ *          ./rfcomm_server_v2 --listen unix:///tmp/telem.sock --config interval_ms=100
+ *          sudo ./rfcomm_server_v2 --shm /tmp/telem.ring     (GUI: listen URI shm:///tmp/telem.ring)
+ *          sudo ./rfcomm_server_v2 --pub /tmp/telem.pub      (socat - UNIX-CONNECT:/tmp/telem.pub)
+ *          sudo ./rfcomm_server_v2 --record /var/lib/telem
+ *          sudo ./rfcomm_server_v2 --format ndjson --view 500 > telem.ndjson
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,29 +23,26 @@
 #include <time.h>
 #include <stdint.h>
 
+#include <fcntl.h>
 #include <sys/socket.h>
-#include <bluetooth/bluetooth.h>
-#include <bluetooth/rfcomm.h>
 
-/* Telemetry data structure */
-typedef struct {
-    uint8_t speed;           // B0: 0-255 (rpm/46)
-    uint8_t throttle;        // B1: 0-255
-    uint16_t total_miles;    // B2-B3: 16-bit odometer
-    uint8_t battery;         // B4[0-6]: 0-100%
-    uint8_t night_mode;      // B4[7]: 0/1
-    uint8_t engine_temp;     // B5[0-5]: 0-63 (offset -20°C)
-    uint8_t turn_signal;     // B5[6-7]: 0=none, 1=right, 2=left, 3=hazard
-    uint8_t battery_temp;    // B6[0-5]: 0-63
-    uint8_t horn;            // B6[6]: 0/1
-    uint8_t beam;            // B6[7]: 0/1
-    uint8_t alert;           // B7[0-2]: 0-7
-    uint8_t state;           // B7[3-4]: 1=N, 2=D, 3=P
-    uint8_t mode;            // B7[5-6]: 1=ECON, 2=COMF, 3=SPORT
-    uint8_t maps;            // B7[7]: 0/1
-} telemetry_t;
+#include "common/ctrl_msg.h"
+#include "common/hexfmt.h"
+#include "common/link_stats.h"
+#include "common/pubsub.h"
+#include "common/recorder.h"
+#include "common/shm_ring.h"
+#include "common/telem_server.h"
+#include "common/telemetry_codec.h"
+#include "common/telem_out.h"
+#include "common/telemetry_delta.h"
+#include "common/transport.h"
+#include "common/vehicle_store.h"
+
+#define DEFAULT_MAX_VEHICLES 4096
 
 static volatile int g_running = 1;
+static volatile sig_atomic_t g_dump_vehicles = 0;  // SIGUSR1
 
 static void handle_signal(int sig) {
     (void)sig;
@@ -44,12 +50,21 @@ static void handle_signal(int sig) {
     printf("\n[DEBUG] Shutting down server...\n");
 }
 
+static void handle_sigusr1(int sig) {
+    (void)sig;
+    g_dump_vehicles = 1;
+}
+
+#define HEX_LINE_BYTES 2048
+
 static void print_hex(const uint8_t *data, size_t len) {
-    printf("[HEX] ");
-    for (size_t i = 0; i < len; i++) {
-        printf("%02X ", data[i]);
-    }
-    printf("\n");
+    static char line[HEXFMT_LINE_SIZE(HEX_LINE_BYTES)];
+    do {
+        size_t n = len < HEX_LINE_BYTES ? len : HEX_LINE_BYTES;
+        fwrite(line, 1, hexfmt_line(line, data, n), stdout);
+        data += n;
+        len -= n;
+    } while (len > 0);
 }
 
 static void print_timestamp(void) {
@@ -60,172 +75,530 @@ static void print_timestamp(void) {
     printf("[%s] ", buf);
 }
 
-static int parse_telemetry(const uint8_t *data, size_t len, telemetry_t *telem) {
-    // Expected frame: 0xCE, len(8), data[8], '\n' = 11 bytes
-    if (len < 11) {
-        return -1;  // incomplete frame
-    }
-    
-    if (data[0] != 0xCE) {
-        return -2;  // invalid start marker
-    }
-    
-    if (data[1] != 8) {
-        return -3;  // invalid length
-    }
-    
-    if (data[10] != '\n') {
-        return -4;  // missing delimiter
-    }
-    
-    // Parse payload
-    telem->speed = data[2];
-    telem->throttle = data[3];
-    telem->total_miles = (uint16_t)data[4] | ((uint16_t)data[5] << 8);
-    telem->battery = data[6] & 0x7F;
-    telem->night_mode = (data[6] >> 7) & 0x01;
-    telem->engine_temp = data[7] & 0x3F;
-    telem->turn_signal = (data[7] >> 6) & 0x03;
-    telem->battery_temp = data[8] & 0x3F;
-    telem->horn = (data[8] >> 6) & 0x01;
-    telem->beam = (data[8] >> 7) & 0x01;
-    telem->alert = data[9] & 0x07;
-    telem->state = (data[9] >> 3) & 0x03;
-    telem->mode = (data[9] >> 5) & 0x03;
-    telem->maps = (data[9] >> 7) & 0x01;
-    
-    return 0;
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
 }
 
-static void print_telemetry(const telemetry_t *telem) {
-    const char *state_str[] = {"", "N", "D", "P"};
-    const char *mode_str[] = {"", "ECON", "COMF", "SPORT"};
-    const char *signal_str[] = {"none", "right", "left", "hazard"};
-    
-    printf("\n╔══════════════════════════════════════════════════════════╗\n");
-    printf("║                 TELEMETRY DATA RECEIVED                  ║\n");
-    printf("╠══════════════════════════════════════════════════════════╣\n");
-    printf("║ Speed:          %d RPM                                   ║\n", 
-           telem->speed * 46);
-    printf("║ Throttle:       %3d                                      ║\n", 
-           telem->throttle);
-    printf("║ Odometer:       %.1f km                                 ║\n", 
-           telem->total_miles * 1.60934);
-    printf("║ Battery:        %3d%%                                    ║\n", 
-           telem->battery);
-    printf("║ Engine Temp:    %d°C                                     ║\n", 
-           (int)telem->engine_temp - 20);
-    printf("║ Battery Temp:   %3d                                      ║\n", 
-           telem->battery_temp);
-    printf("║ State:          %s                                       ║\n", 
-           state_str[telem->state]);
-    printf("║ Mode:           %-5s                                    ║\n", 
-           mode_str[telem->mode]);
-    printf("║ Turn Signal:    %-6s                                   ║\n", 
-           signal_str[telem->turn_signal]);
-    printf("║ Night Mode:     %s                                       ║\n", 
-           telem->night_mode ? "ON " : "OFF");
-    printf("║ High Beam:      %s                                       ║\n", 
-           telem->beam ? "ON " : "OFF");
-    printf("║ Horn:           %s                                       ║\n", 
-           telem->horn ? "ON " : "OFF");
-    printf("║ Alert:          %d                                        ║\n", 
-           telem->alert);
-    printf("║ Maps Switch:    %s                                       ║\n", 
-           telem->maps ? "ON " : "OFF");
-    printf("╚══════════════════════════════════════════════════════════╝\n\n");
+static uint64_t realtime_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
 }
 
-static void handle_client(int client_sock, const char *client_addr, int echo_mode, int hex_mode) {
-    uint8_t buf[1024];
-    ssize_t bytes_read;
-    unsigned long total_bytes = 0;
-    unsigned long msg_count = 0;
-    telemetry_t telem;
+static void print_link(const frame_meta_t *m, const link_stats_t *ls) {
+    printf("[LINK] v2 seq %u  latency %.3f ms  lost %lu/%lu (%.2f%%)  reordered %lu\n",
+           m->seq, ls->last_latency_us / 1000.0, link_stats_lost(ls),
+           link_stats_expected(ls), link_stats_loss_pct(ls), ls->reordered);
+}
 
-    printf("[INFO] Handling client %s\n", client_addr);
+static const char *const state_str[] = {"", "N", "D", "P"};
+static const char *const mode_str[] = {"", "ECON", "COMF", "SPORT"};
+static const char *const signal_str[] = {"none", "right", "left", "hazard"};
+
+/* One line per frame in the text log */
+static void print_frame(const char *peer, const telemetry_t *t, const frame_meta_t *m) {
+    printf("[FRAME] from %s%s: %d RPM, throttle %d, %.1f km, battery %d%%, engine %d°C, "
+           "battery temp %d, %s %s, turn %s, night %s, beam %s, horn %s, alert %d, maps %s\n",
+           peer, m->type == FRAME_TYPE_DELTA ? " (delta)" : "",
+           t->speed * 46, t->throttle, t->total_miles * 1.60934, t->battery,
+           (int)t->engine_temp - 20, t->battery_temp, state_str[t->state], mode_str[t->mode],
+           signal_str[t->turn_signal], t->night_mode ? "ON" : "OFF", t->beam ? "ON" : "OFF",
+           t->horn ? "ON" : "OFF", t->alert, t->maps ? "ON" : "OFF");
+}
 
-    while (g_running) {
-        printf("[DEBUG] Waiting for data from client...\n");
-        bytes_read = recv(client_sock, buf, sizeof(buf) - 1, 0);
+/* The box drawn by --view; with its header line it takes VIEW_LINES rows */
+#define VIEW_LINES 19
+
+static size_t format_box(char *out, size_t cap, const telemetry_t *telem) {
+    int n = snprintf(out, cap,
+        "╔══════════════════════════════════════════════════════════╗\n"
+        "║                 TELEMETRY DATA RECEIVED                  ║\n"
+        "╠══════════════════════════════════════════════════════════╣\n"
+        "║ Speed:          %5d RPM                                ║\n"
+        "║ Throttle:       %3d                                      ║\n"
+        "║ Odometer:       %8.1f km                              ║\n"
+        "║ Battery:        %3d%%                                     ║\n"
+        "║ Engine Temp:    %3d°C                                    ║\n"
+        "║ Battery Temp:   %3d                                      ║\n"
+        "║ State:          %-5s                                    ║\n"
+        "║ Mode:           %-5s                                    ║\n"
+        "║ Turn Signal:    %-6s                                   ║\n"
+        "║ Night Mode:     %s                                      ║\n"
+        "║ High Beam:      %s                                      ║\n"
+        "║ Horn:           %s                                      ║\n"
+        "║ Alert:          %d                                        ║\n"
+        "║ Maps Switch:    %s                                      ║\n"
+        "╚══════════════════════════════════════════════════════════╝\n",
+        telem->speed * 46, telem->throttle, telem->total_miles * 1.60934, telem->battery,
+        (int)telem->engine_temp - 20, telem->battery_temp, state_str[telem->state],
+        mode_str[telem->mode], signal_str[telem->turn_signal],
+        telem->night_mode ? "ON " : "OFF", telem->beam ? "ON " : "OFF",
+        telem->horn ? "ON " : "OFF", telem->alert, telem->maps ? "ON " : "OFF");
+    return n < 0 ? 0 : (size_t)n < cap ? (size_t)n : cap - 1;
+}
 
-        if (bytes_read < 0) {
-            if (errno == EINTR) continue;
-            perror("[ERROR] recv");
-            break;
+/* Per-server settings shared by all connections */
+typedef struct {
+    int echo_mode;
+    int hex_mode;
+    ctrl_cfg_t cfg[CTRL_CFG_MAX];   // --config, pushed to every v2 client
+    size_t ncfg;
+    vehicle_store_t vehicles;       // outlives connections
+    shm_ring_t ring;                // --shm: decoded frames for local readers
+    int ring_listen;                // where readers fetch the ring fd, -1 = off
+    transport_addr_t ring_addr;
+    unsigned long ring_readers;
+    pubsub_t pub;                   // --pub: text lines for local subscribers
+    int pub_listen;                 // -1 = off
+    transport_addr_t pub_addr;
+    recorder_t rec;                 // --record: raw frames to disk
+    int recording;
+    telem_out_fmt_t format;         // --format: records on stdout unless text
+    telem_out_t out;
+    int frame_log;                  // a text line per chunk and frame
+    int view_ms;                    // --view: box refresh period, 0 = off
+    int view_tty;                   // box pinned above the scrolling log
+    int view_have;
+    uint64_t view_key;              // latest frame, as the box shows it
+    telemetry_t view_telem;
+    frame_meta_t view_meta;
+    unsigned long frames;           // decoded, all connections
+} server_ctx_t;
+
+/* Per-connection decoding state, hung off telem_conn_t.user */
+typedef struct {
+    link_stats_t link;
+    telemetry_delta_dec_t delta;
+    int config_sent;
+    unsigned long pings;
+    long vehicle;                   // slot in server_ctx_t.vehicles, -1 = untracked
+    uint64_t key;                   // vehicle_key() of the peer
+    unsigned long bad_chunks;       // reads that held no frame
+    unsigned long bad_bytes;
+    unsigned long echoed;           // bytes echoed back
+    unsigned long echo_dropped;     // echoes lost or cut short, send buffer full
+} conn_state_t;
+
+static void on_connect(void *ctx, telem_conn_t *c) {
+    server_ctx_t *srv = (server_ctx_t *)ctx;
+    print_timestamp();
+    printf("[INFO] Client connected: %s (fd %d)\n", c->peer, c->fd);
+
+    conn_state_t *cs = calloc(1, sizeof(*cs));
+    if (cs) {
+        link_stats_init(&cs->link);
+        telemetry_delta_dec_init(&cs->delta);
+        cs->key = vehicle_key(c->peer);
+        cs->vehicle = vehicle_store_connect(&srv->vehicles, cs->key, c->peer, realtime_us());
+        if (cs->vehicle < 0)
+            printf("[WARN] Vehicle table full (%zu), %s not tracked\n",
+                   srv->vehicles.max_vehicles, c->peer);
+    }
+    c->user = cs;
+}
+
+/* Latest state of every vehicle seen since start, connected or not */
+static void print_vehicles(const vehicle_store_t *vs) {
+    uint64_t now = realtime_us();
+    vehicle_state_t st;
+
+    printf("[INFO] Vehicles: %zu known", vehicle_store_count(vs));
+    if (vs->full > 0) printf(", %lu refused (table full)", vs->full);
+    printf("\n");
+    printf("  %-24s %-7s %8s %10s %12s %9s %6s %4s\n",
+           "vehicle", "state", "sessions", "frames", "bytes", "seen ago", "speed", "batt");
+    for (size_t i = 0; i <= vs->mask; i++) {
+        if (vehicle_store_read(vs, i, &st) < 0) continue;
+        printf("  %-24s %-7s %8u %10llu %12llu %8.1fs",
+               st.name, st.connected ? "online" : "offline", st.sessions,
+               (unsigned long long)st.frames, (unsigned long long)st.bytes,
+               (now - st.last_rx_us) / 1e6);
+        if (st.frames > 0)
+            printf(" %6u %3u%%\n", st.telem.speed, st.telem.battery);
+        else
+            printf(" %6s %4s\n", "-", "-");
+    }
+}
+
+/* Settings go out once the client has shown it speaks v2; v1 firmware
+ * would not know what to do with them. */
+static void push_config(const server_ctx_t *srv, telem_conn_t *c, conn_state_t *cs) {
+    uint8_t out[FRAME_MAX_SIZE];
+    size_t n = ctrl_encode_config(1, realtime_us(), srv->cfg, srv->ncfg, out);
+
+    cs->config_sent = 1;
+    if (transport_send(c->fd, out, n) != (ssize_t)n) {
+        printf("[WARN] Config to %s not sent: %s\n", c->peer, strerror(errno));
+        return;
+    }
+    print_timestamp();
+    printf("[CTRL] Config sent to %s:", c->peer);
+    for (size_t i = 0; i < srv->ncfg; i++)
+        printf(" %s=%u", ctrl_cfg_name(srv->cfg[i].key), srv->cfg[i].value);
+    printf("\n");
+}
+
+static void publish_frame(server_ctx_t *srv, uint64_t key, const telemetry_t *t,
+                          const frame_meta_t *meta, uint64_t now_us) {
+    shm_ring_rec_t rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.rx_us = now_us;
+    rec.key = key;
+    rec.version = meta->version;
+    rec.type = meta->type;
+    if (meta->version >= FRAME_V2) {
+        rec.seq = meta->seq;
+        rec.ts_us = meta->ts_us;
+    }
+    rec.telem = *t;
+    shm_ring_publish(&srv->ring, &rec);
+}
+
+/* Hand the ring to every reader waiting on the --shm socket */
+static void share_ring(server_ctx_t *srv) {
+    int fd;
+    while ((fd = accept4(srv->ring_listen, NULL, NULL, SOCK_CLOEXEC)) >= 0) {
+        if (shm_ring_send_fd(fd, srv->ring.fd) == 0) {
+            srv->ring_readers++;
+            print_timestamp();
+            printf("[INFO] Ring reader #%lu attached\n", srv->ring_readers);
+        } else {
+            perror("[WARN] ring fd");
         }
+        close(fd);
+    }
+}
 
-        if (bytes_read == 0) {
-            printf("[INFO] Client %s disconnected\n", client_addr);
-            break;
+static int on_telemetry(void *ctx, void *conn, const uint8_t *frame, size_t len) {
+    server_ctx_t *srv = (server_ctx_t *)ctx;
+    telem_conn_t *c = (telem_conn_t *)conn;
+    telemetry_t telem;
+    frame_meta_t meta;
+    conn_state_t *cs = (conn_state_t *)c->user;
+    uint64_t now = realtime_us();
+    int ret;
+
+    // As received, before decoding: a replay feeds the same bytes back in
+    if (srv->recording) recorder_put(&srv->rec, cs ? cs->key : vehicle_key(c->peer), now, frame, len);
+
+    if (!cs) {
+        ret = telemetry_decode_any(frame, len, &telem, &meta);
+    } else {
+        ret = telemetry_delta_decode(&cs->delta, frame, len, &telem, &meta);
+        // A skipped delta still arrived; only its content is unusable
+        if (ret == 0 || ret == -8) link_stats_update(&cs->link, &meta, now);
+        if (ret == 0) {
+            vehicle_store_frame(&srv->vehicles, cs->vehicle, &telem, &meta, now);
+            if (srv->ring_listen >= 0) publish_frame(srv, cs->key, &telem, &meta, now);
+            if (srv->pub_listen >= 0) pubsub_publish(&srv->pub, cs->key, &telem, &meta, now);
+        }
+    }
+
+    if (ret == 0) {
+        uint64_t key = cs ? cs->key : vehicle_key(c->peer);
+        srv->frames++;
+        if (srv->format != TELEM_OUT_TEXT) telem_out_frame(&srv->out, key, now, &telem, &meta);
+        if (srv->view_ms) {
+            srv->view_key = key;
+            srv->view_telem = telem;
+            srv->view_meta = meta;
+            srv->view_have = 1;
+        }
+        if (srv->frame_log) {
+            print_timestamp();
+            print_frame(c->peer, &telem, &meta);
+            if (cs && meta.version >= FRAME_V2) print_link(&meta, &cs->link);
         }
+    } else if (ret == -8 || ret == -9) {
+        print_timestamp();
+        printf("[WARN] Delta from %s skipped, waiting for a keyframe\n", c->peer);
+    }
+
+    if (cs && !cs->config_sent && srv->ncfg && ret == 0 && meta.version >= FRAME_V2) {
+        push_config(srv, c, cs);
+    }
+    return ret;
+}
 
-        total_bytes += bytes_read;
-        msg_count++;
+static int on_ping(void *ctx, void *conn, const uint8_t *frame, size_t len) {
+    (void)ctx;
+    telem_conn_t *c = (telem_conn_t *)conn;
+    conn_state_t *cs = (conn_state_t *)c->user;
+    ctrl_msg_t m;
+    uint8_t out[FRAME_MAX_SIZE];
 
+    int ret = ctrl_decode(frame, len, &m);
+    if (ret < 0) return ret;
+
+    // Non-blocking socket: a full send buffer loses the pong, and the
+    // client's liveness check will notice if that keeps happening
+    size_t n = ctrl_encode_pong(&m.meta, realtime_us(), out);
+    if (transport_send(c->fd, out, n) == (ssize_t)n && cs) cs->pings++;
+    return 0;
+}
+
+static int on_ack(void *ctx, void *conn, const uint8_t *frame, size_t len) {
+    (void)ctx;
+    telem_conn_t *c = (telem_conn_t *)conn;
+    ctrl_msg_t m;
+
+    int ret = ctrl_decode(frame, len, &m);
+    if (ret < 0) return ret;
+
+    print_timestamp();
+    if (m.status == CTRL_ACK_OK) {
+        printf("[CTRL] %s applied config #%u\n", c->peer, m.meta.seq);
+    } else {
+        printf("[WARN] %s rejected config #%u: %s%s%s\n", c->peer, m.meta.seq,
+               ctrl_ack_status_str(m.status), m.key ? " " : "", m.key ? ctrl_cfg_name(m.key) : "");
+    }
+    return 0;
+}
+
+static const frame_dispatch_t frame_handlers = {{
+    [FRAME_TYPE_TELEMETRY] = on_telemetry,
+    [FRAME_TYPE_DELTA]     = on_telemetry,
+    [FRAME_TYPE_PING]      = on_ping,
+    [FRAME_TYPE_ACK]       = on_ack,
+}};
+
+static void on_frame(void *ctx, telem_conn_t *c, const uint8_t *frame, size_t len) {
+    if (frame_dispatch(&frame_handlers, ctx, c, frame, len) == -7) {
         print_timestamp();
-        printf("[RX] %zd bytes from %s\n", bytes_read, client_addr);
+        printf("[WARN] Unhandled frame type 0x%02X from %s\n", frame_type(frame), c->peer);
+    }
+}
 
-        if (hex_mode) {
-            print_hex(buf, bytes_read);
-        }
+static void on_data(void *ctx, telem_conn_t *c, const uint8_t *buf, size_t len) {
+    server_ctx_t *srv = (server_ctx_t *)ctx;
+    conn_state_t *cs = (conn_state_t *)c->user;
 
-        // Try to parse as telemetry data
-        int parse_result = parse_telemetry(buf, bytes_read, &telem);
-        if (parse_result == 0) {
-            print_telemetry(&telem);
-        } else {
-            printf("[WARN] Failed to parse telemetry (code: %d)\n", parse_result);
-            if (!hex_mode) {
+    if (cs) vehicle_store_rx(&srv->vehicles, cs->vehicle, len, realtime_us());
+
+    if (srv->frame_log) {
+        print_timestamp();
+        printf("[RX] %zu bytes from %s, %lu frame(s)\n", len, c->peer, c->chunk_frames);
+    }
+
+    if (srv->hex_mode) {
+        print_hex(buf, len);
+    }
+
+    if (c->chunk_frames == 0 && c->chunk_resync > 0) {
+        if (cs) {
+            cs->bad_chunks++;
+            cs->bad_bytes += c->chunk_resync;
+        }
+        if (srv->frame_log) {
+            printf("[WARN] Failed to parse telemetry from %s (%lu resync bytes)\n",
+                   c->peer, c->chunk_resync);
+            if (!srv->hex_mode) {
                 // Show hex if not already shown
-                print_hex(buf, bytes_read);
+                print_hex(buf, len);
             }
             // Try to show as text if printable
-            buf[bytes_read] = '\0';
-            int printable = 1;
-            for (ssize_t i = 0; i < bytes_read; i++) {
-                if (buf[i] < 32 && buf[i] != '\n' && buf[i] != '\r' && buf[i] != '\t') {
-                    printable = 0;
-                    break;
-                }
-            }
-            if (printable) {
-                printf("[TEXT] %s", buf);
-                if (buf[bytes_read - 1] != '\n') printf("\n");
+            if (hexfmt_is_text(buf, len)) {
+                printf("[TEXT] %.*s", (int)len, (const char *)buf);
+                if (buf[len - 1] != '\n') printf("\n");
             }
         }
+    }
 
-        if (echo_mode) {
-            ssize_t sent = send(client_sock, buf, bytes_read, 0);
-            if (sent < 0) {
-                perror("[ERROR] send");
-                break;
-            }
+    if (srv->echo_mode) {
+        // Non-blocking socket: a full send buffer drops the echo, not the client
+        ssize_t sent = transport_send(c->fd, buf, len);
+        if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            perror("[ERROR] send");
+            return;
+        }
+        if (cs) {
+            cs->echoed += sent > 0 ? (unsigned long)sent : 0;
+            if (sent != (ssize_t)len) cs->echo_dropped++;
+        }
+        if (srv->frame_log) {
             print_timestamp();
-            printf("[TX] Echoed %zd bytes\n", sent);
+            printf("[TX] Echoed %zd bytes to %s\n", sent < 0 ? 0 : sent, c->peer);
         }
     }
+}
 
+static void on_disconnect(void *ctx, telem_conn_t *c) {
+    server_ctx_t *srv = (server_ctx_t *)ctx;
+    print_timestamp();
     printf("[INFO] Client %s session ended. Total: %lu bytes, %lu messages\n",
-           client_addr, total_bytes, msg_count);
+           c->peer, c->total_bytes, c->msg_count);
+    printf("[INFO] Frames: %lu, resync bytes: %lu, keepalive bytes: %lu, CRC errors: %lu\n",
+           c->reasm.frames, c->reasm.resync_bytes, c->reasm.control_bytes,
+           c->reasm.crc_errors);
+
+    conn_state_t *cs = (conn_state_t *)c->user;
+    if (!cs) return;
+    vehicle_store_disconnect(&srv->vehicles, cs->vehicle, realtime_us());
+    link_stats_t *ls = &cs->link;
+    if (ls->v2_frames > 0) {
+        printf("[INFO] Link v2: %lu frames, lost %lu/%lu (%.2f%%), reordered %lu\n",
+               ls->v2_frames, link_stats_lost(ls), link_stats_expected(ls),
+               link_stats_loss_pct(ls), ls->reordered);
+        lat_hist_print(&ls->latency, "[INFO] Latency", stdout);
+        if (ls->clock_behind > 0)
+            printf("[WARN] %lu frame(s) stamped in the future, clocks differ\n",
+                   ls->clock_behind);
+    }
+    if (ls->v1_frames > 0)
+        printf("[INFO] Link v1: %lu frames (no sequence numbers)\n", ls->v1_frames);
+    if (cs->delta.deltas > 0 || cs->delta.skipped > 0)
+        printf("[INFO] Delta: %lu keyframes, %lu deltas, %lu skipped\n",
+               cs->delta.keyframes, cs->delta.deltas, cs->delta.skipped);
+    if (cs->pings > 0)
+        printf("[INFO] Control: %lu pings answered\n", cs->pings);
+    if (srv->echo_mode)
+        printf("[INFO] Echo: %lu bytes, %lu dropped or cut short\n", cs->echoed, cs->echo_dropped);
+    if (cs->bad_chunks > 0)
+        printf("[WARN] %lu read(s) without a frame (%lu resync bytes)\n",
+               cs->bad_chunks, cs->bad_bytes);
+    free(cs);
+    c->user = NULL;
+}
+
+/* --view on a terminal: the box keeps the top rows, the log scrolls below */
+static void view_start(const server_ctx_t *srv) {
+    if (!srv->view_tty) return;
+    printf("\033[2J\033[%d;r\033[%d;1H", VIEW_LINES + 2, VIEW_LINES + 2);
+    fflush(stdout);
+}
+
+static void view_stop(const server_ctx_t *srv) {
+    if (!srv->view_tty) return;
+    printf("\033[r\033[999;1H\n");
+}
+
+/* The latest frame, redrawn in place (terminal) or appended, in one write */
+static void view_draw(const server_ctx_t *srv, double rate) {
+    static char buf[4096];
+    char name[VEHICLE_NAME_LEN];
+    const char *eol = srv->view_tty ? "\033[K" : "";    // clear what a longer line left
+    size_t n = 0;
+
+    if (srv->view_tty) n += (size_t)snprintf(buf, sizeof(buf), "\0337\033[H");
+    if (srv->view_have) {
+        vehicle_key_str(srv->view_key, name, sizeof(name));
+        n += (size_t)snprintf(buf + n, sizeof(buf) - n, "%s", name);
+        if (srv->view_meta.version >= FRAME_V2) {
+            n += (size_t)snprintf(buf + n, sizeof(buf) - n, "  seq %u", srv->view_meta.seq);
+        }
+        n += (size_t)snprintf(buf + n, sizeof(buf) - n, "  %lu frames, %.0f/s%s\n",
+                              srv->frames, rate, eol);
+        n += format_box(buf + n, sizeof(buf) - n, &srv->view_telem);
+    } else {
+        n += (size_t)snprintf(buf + n, sizeof(buf) - n, "Waiting for telemetry...%s\n", eol);
+    }
+    n += (size_t)snprintf(buf + n, sizeof(buf) - n, srv->view_tty ? "\0338" : "\n");
+    fwrite(buf, 1, n < sizeof(buf) ? n : sizeof(buf) - 1, stdout);
+    fflush(stdout);
 }
 
 int main(int argc, char **argv) {
     uint8_t channel = 1;
-    int echo_mode = 0;
-    int hex_mode = 0;
-    int server_sock, client_sock;
-    struct sockaddr_rc loc_addr = {0}, rem_addr = {0};
-    socklen_t opt = sizeof(rem_addr);
-    char client_addr[18];
+    const char *listen_uri = NULL;
+    char rfcomm_uri[32];
+    transport_addr_t addr;
+    server_ctx_t ctx = {0};
+    const char *shm_path = NULL;
+    size_t shm_slots = SHM_RING_DEFAULT_SLOTS;
+    const char *pub_path = NULL;
+    size_t pub_queue = PUBSUB_DEFAULT_QUEUE;
+    pubsub_policy_t pub_policy = PUBSUB_DROP;
+    const char *rec_dir = NULL;
+    size_t rec_seg_mb = REC_DEFAULT_SEG_BYTES >> 20;
+    size_t max_clients = TELEM_DEFAULT_MAX_CONNS;
+    size_t budget = TELEM_DEFAULT_BUDGET;
+    size_t max_vehicles = DEFAULT_MAX_VEHICLES;
+    int data_fd = -1;
+    int server_sock;
+    telem_server_t srv;
+    static const telem_server_ops_t ops = {
+        .on_connect = on_connect,
+        .on_frame = on_frame,
+        .on_data = on_data,
+        .on_disconnect = on_disconnect,
+    };
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-e") == 0 || strcmp(argv[i], "--echo") == 0) {
-            echo_mode = 1;
+            ctx.echo_mode = 1;
         } else if (strcmp(argv[i], "-x") == 0 || strcmp(argv[i], "--hex") == 0) {
-            hex_mode = 1;
+            ctx.hex_mode = 1;
+        } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            listen_uri = argv[++i];
+        } else if (strcmp(argv[i], "--max-clients") == 0 && i + 1 < argc) {
+            max_clients = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            budget = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shm_path = argv[++i];
+        } else if (strcmp(argv[i], "--shm-slots") == 0 && i + 1 < argc) {
+            shm_slots = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--pub") == 0 && i + 1 < argc) {
+            pub_path = argv[++i];
+        } else if (strcmp(argv[i], "--pub-queue") == 0 && i + 1 < argc) {
+            pub_queue = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--pub-policy") == 0 && i + 1 < argc) {
+            if (pubsub_policy_parse(argv[++i], &pub_policy) < 0) {
+                fprintf(stderr, "[ERROR] --pub-policy drop|conflate|disconnect\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            rec_dir = argv[++i];
+        } else if (strcmp(argv[i], "--record-seg-mb") == 0 && i + 1 < argc) {
+            rec_seg_mb = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-vehicles") == 0 && i + 1 < argc) {
+            max_vehicles = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            int n = ctrl_cfg_parse(argv[++i], ctx.cfg, CTRL_CFG_MAX);
+            if (n <= 0) {
+                fprintf(stderr, "[ERROR] --config interval_ms=N,delta=N\n");
+                return 1;
+            }
+            ctx.ncfg = (size_t)n;
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (telem_out_parse(argv[++i], &ctx.format) < 0) {
+                fprintf(stderr, "[ERROR] --format text|ndjson|csv|bin\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--view") == 0 && i + 1 < argc) {
+            ctx.view_ms = atoi(argv[++i]);
+            if (ctx.view_ms < 0) ctx.view_ms = 0;
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
-            printf("Usage: %s [-e|--echo] [-x|--hex] [channel]\n", argv[0]);
+            printf("Usage: %s [-e|--echo] [-x|--hex] [--listen URI] [--max-clients N] "
+                   "[--budget BYTES] [--max-vehicles N] [--config K=V,...]\n"
+                   "       [--shm PATH [--shm-slots N]]\n"
+                   "       [--pub PATH [--pub-queue N] [--pub-policy drop|conflate|disconnect]]\n"
+                   "       [--record DIR [--record-seg-mb N]]\n"
+                   "       [--format text|ndjson|csv|bin] [--view MS]\n"
+                   "       [channel]\n"
+                   "URI: rfcomm://any/1 (default), tcp://:5555, unix:///tmp/telem.sock,\n"
+                   "     pty:///tmp/telem.pty\n"
+                   "--config pushes settings to each v2 client once it starts sending:\n"
+                   "     interval_ms=N (send period), delta=N (keyframe interval, 0 = off)\n"
+                   "--max-vehicles bounds the per-vehicle state table (default %d); it is\n"
+                   "     printed on SIGUSR1 and at shutdown\n"
+                   "--shm publishes decoded frames to a shared-memory ring (default %d\n"
+                   "     slots); readers fetch it from the Unix socket at PATH\n"
+                   "--pub sends one text line per frame to each subscriber of the Unix\n"
+                   "     socket at PATH; 'SUB vehicle=MAC fields=speed,battery' filters.\n"
+                   "     A full queue (default %d lines) drops, conflates or disconnects\n"
+                   "--record appends every telemetry frame as received to %u MiB segment\n"
+                   "     files in DIR, written and synced by a background thread\n"
+                   "--format writes one record per frame to stdout, buffered and flushed\n"
+                   "     once per loop turn; the log then goes to stderr. text (default)\n"
+                   "     logs a line per frame instead\n"
+                   "--view redraws the latest frame as a box every MS milliseconds, pinned\n"
+                   "     to the top of the terminal; per-frame log lines are then off\n",
+                   argv[0], DEFAULT_MAX_VEHICLES, SHM_RING_DEFAULT_SLOTS, PUBSUB_DEFAULT_QUEUE,
+                   REC_DEFAULT_SEG_BYTES >> 20);
             return 0;
         } else {
             int ch = atoi(argv[i]);
@@ -233,66 +606,191 @@ int main(int argc, char **argv) {
         }
     }
 
+    // Records own stdout; the log moves to stderr
+    if (ctx.format != TELEM_OUT_TEXT) {
+        data_fd = dup(STDOUT_FILENO);
+        if (data_fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0 ||
+            telem_out_init(&ctx.out, data_fd, ctx.format, 0) < 0) {
+            perror("[ERROR] --format");
+            return 1;
+        }
+    }
+    ctx.frame_log = ctx.format == TELEM_OUT_TEXT && ctx.view_ms == 0;
+    ctx.view_tty = ctx.view_ms > 0 && isatty(STDOUT_FILENO);
+
     signal(SIGINT, handle_signal);
     signal(SIGTERM, handle_signal);
+    signal(SIGUSR1, handle_sigusr1);
+    // A reader that quits (| head) is seen as EPIPE by telem_out_flush
+    if (ctx.format != TELEM_OUT_TEXT) signal(SIGPIPE, SIG_IGN);
 
-    printf("[DEBUG] Creating RFCOMM socket...\n");
-    server_sock = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
-    if (server_sock < 0) {
-        perror("[ERROR] socket");
+    if (vehicle_store_init(&ctx.vehicles, max_vehicles) < 0) {
+        perror("[ERROR] --max-vehicles");
         return 1;
     }
 
-    loc_addr.rc_family = AF_BLUETOOTH;
-    loc_addr.rc_bdaddr = *BDADDR_ANY;
-    loc_addr.rc_channel = channel;
+    ctx.ring_listen = -1;
+    if (shm_path) {
+        char uri[TRANSPORT_PATH_LEN + 8];
+        snprintf(uri, sizeof(uri), "unix://%s", shm_path);
+        if (transport_parse(uri, &ctx.ring_addr) < 0 || shm_ring_create(&ctx.ring, shm_slots) < 0 ||
+            (ctx.ring_listen = transport_listen(&ctx.ring_addr, 16)) < 0) {
+            perror("[ERROR] --shm");
+            return 1;
+        }
+        fcntl(ctx.ring_listen, F_SETFL, fcntl(ctx.ring_listen, F_GETFL, 0) | O_NONBLOCK);
+        if (!ctx.ring.write_sealed)
+            printf("[WARN] --shm: kernel cannot seal the ring against writes (needs Linux 5.1+); "
+                   "readers could map it writable\n");
+    }
+
+    ctx.pub_listen = -1;
+    if (pub_path) {
+        char uri[TRANSPORT_PATH_LEN + 8];
+        snprintf(uri, sizeof(uri), "unix://%s", pub_path);
+        if (transport_parse(uri, &ctx.pub_addr) < 0 ||
+            (ctx.pub_listen = transport_listen(&ctx.pub_addr, 16)) < 0 ||
+            pubsub_init(&ctx.pub, ctx.pub_listen, pub_queue, pub_policy) < 0) {
+            perror("[ERROR] --pub");
+            return 1;
+        }
+    }
+
+    if (rec_dir) {
+        if (recorder_open(&ctx.rec, rec_dir, rec_seg_mb << 20, 0, REC_DEFAULT_SYNC_MS) < 0) {
+            perror("[ERROR] --record");
+            return 1;
+        }
+        ctx.recording = 1;
+        if (ctx.rec.repaired > 0) recorder_print(&ctx.rec, stdout);
+    }
 
-    printf("[DEBUG] Binding socket to channel %d...\n", channel);
-    if (bind(server_sock, (struct sockaddr *)&loc_addr, sizeof(loc_addr)) < 0) {
-        perror("[ERROR] bind");
-        close(server_sock);
+    if (!listen_uri) {
+        snprintf(rfcomm_uri, sizeof(rfcomm_uri), "rfcomm://any/%u", channel);
+        listen_uri = rfcomm_uri;
+    }
+    if (transport_parse(listen_uri, &addr) < 0) {
+        fprintf(stderr, "[ERROR] Invalid listen URI: %s\n", listen_uri);
         return 1;
     }
 
-    printf("[DEBUG] Listening for connections...\n");
-    if (listen(server_sock, 1) < 0) {
+    printf("[DEBUG] Listening on %s...\n", addr.uri);
+    server_sock = transport_listen(&addr, SOMAXCONN);
+    if (server_sock < 0) {
         perror("[ERROR] listen");
+        return 1;
+    }
+
+    // A pty is already the connection; there is nothing to accept
+    int listener = transport_is_listener(&addr);
+    if (telem_server_init(&srv, listener ? server_sock : -1, &ops, &ctx) < 0) {
+        perror("[ERROR] epoll");
         close(server_sock);
+        transport_cleanup(&addr);
         return 1;
     }
+    if (!listener) {
+        char peer[TELEM_PEER_LEN];
+        snprintf(peer, sizeof(peer), "pty:%.*s", (int)sizeof(peer) - 5, addr.path);
+        telem_server_add(&srv, server_sock, peer);
+    }
+    srv.max_conns = max_clients;
+    if (budget > 0) srv.budget = budget;
 
     printf("==========================================\n");
     printf("  RFCOMM Server\n");
     printf("==========================================\n");
-    printf("  MAC:        74:70:FD:0D:CA:45\n");
-    printf("  Channel:    %d\n", channel);
-    printf("  Echo mode:  %s\n", echo_mode ? "ON" : "OFF");
-    printf("  Hex output: %s\n", hex_mode ? "ON" : "OFF");
+    printf("  Listen:     %s\n", addr.uri);
+    printf("  Echo mode:  %s\n", ctx.echo_mode ? "ON" : "OFF");
+    printf("  Hex output: %s\n", ctx.hex_mode ? "ON" : "OFF");
+    printf("  Clients:    up to %zu, %zu bytes/turn\n", srv.max_conns, srv.budget);
+    if (ctx.ring_listen >= 0)
+        printf("  Shm ring:   %s, %zu slots\n", shm_path, ctx.ring.nslots);
+    if (ctx.pub_listen >= 0)
+        printf("  Pub/sub:    %s, queue %zu, %s\n", pub_path, ctx.pub.queue_len,
+               pubsub_policy_str(ctx.pub.policy));
+    if (ctx.recording)
+        printf("  Recording:  %s, %zu MiB segments\n", rec_dir, ctx.rec.seg_bytes >> 20);
+    printf("  Output:     %s%s\n", telem_out_fmt_str(ctx.format),
+           ctx.format != TELEM_OUT_TEXT ? " on stdout, log on stderr" : "");
+    if (ctx.view_ms)
+        printf("  View:       every %d ms\n", ctx.view_ms);
     printf("==========================================\n");
     printf("[INFO] Waiting for connections...\n\n");
 
+    view_start(&ctx);
+    uint64_t view_last = monotonic_ms();
+    unsigned long view_frames = 0;
+
     while (g_running) {
-        printf("[DEBUG] Waiting for accept()...\n");
-        client_sock = accept(server_sock, (struct sockaddr *)&rem_addr, &opt);
-        if (client_sock < 0) {
-            if (errno == EINTR) continue;
-            perror("[ERROR] accept");
-            continue;
+        // Ring readers and subscribers are served between polls
+        int local = ctx.ring_listen >= 0 || ctx.pub_listen >= 0;
+        int timeout = local ? 100 : 500;
+        if (ctx.view_ms && ctx.view_ms < timeout) timeout = ctx.view_ms;
+        if (telem_server_poll(&srv, timeout) < 0) {
+            perror("[ERROR] epoll_wait");
+            break;
+        }
+        // Everything decoded this turn leaves in one write
+        if (ctx.format != TELEM_OUT_TEXT) {
+            telem_out_flush(&ctx.out);
+            if (ctx.out.closed) {
+                printf("[INFO] Output reader went away, shutting down...\n");
+                break;
+            }
+        }
+        if (ctx.view_ms) {
+            uint64_t now = monotonic_ms();
+            if (now - view_last >= (uint64_t)ctx.view_ms) {
+                view_draw(&ctx, (ctx.frames - view_frames) * 1000.0 / (double)(now - view_last));
+                view_last = now;
+                view_frames = ctx.frames;
+            }
+        }
+        if (ctx.ring_listen >= 0) share_ring(&ctx);
+        if (ctx.pub_listen >= 0) pubsub_poll(&ctx.pub);
+        if (g_dump_vehicles) {
+            g_dump_vehicles = 0;
+            print_vehicles(&ctx.vehicles);
+            if (ctx.pub_listen >= 0) pubsub_print(&ctx.pub, stdout);
+            if (ctx.recording) recorder_print(&ctx.rec, stdout);
         }
-
-        ba2str(&rem_addr.rc_bdaddr, client_addr);
-        print_timestamp();
-        printf("[INFO] Client connected: %s\n", client_addr);
-
-        handle_client(client_sock, client_addr, echo_mode, hex_mode);
-
-        close(client_sock);
-        printf("[INFO] Waiting for next connection...\n\n");
     }
 
-    close(server_sock);
-    printf("[INFO] Server shut down.\n");
+    view_stop(&ctx);
+    telem_server_close(&srv);
+    if (listener) close(server_sock);
+    transport_cleanup(&addr);
+    printf("[INFO] Server shut down. Accepted %lu, rejected %lu, budget yields %lu\n",
+           srv.accepted, srv.rejected, srv.budget_yields);
+    print_vehicles(&ctx.vehicles);
+    vehicle_store_free(&ctx.vehicles);
+    if (ctx.ring_listen >= 0) {
+        printf("[INFO] Ring: %llu frames published, %lu reader(s) attached\n",
+               (unsigned long long)shm_ring_published(&ctx.ring), ctx.ring_readers);
+        close(ctx.ring_listen);
+        transport_cleanup(&ctx.ring_addr);
+        shm_ring_close(&ctx.ring);
+    }
+    if (ctx.pub_listen >= 0) {
+        pubsub_print(&ctx.pub, stdout);
+        pubsub_close(&ctx.pub);
+        close(ctx.pub_listen);
+        transport_cleanup(&ctx.pub_addr);
+    }
+    if (ctx.recording) {
+        recorder_close(&ctx.rec);
+        recorder_print(&ctx.rec, stdout);
+    }
+    if (ctx.format != TELEM_OUT_TEXT) {
+        telem_out_close(&ctx.out);
+        printf("[INFO] Output: %llu %s records, %llu bytes in %lu writes",
+               ctx.out.records, telem_out_fmt_str(ctx.format), ctx.out.bytes, ctx.out.flushes);
+        if (ctx.out.errors) printf(", %lu failed", ctx.out.errors);
+        if (ctx.out.closed) printf(", reader went away");
+        printf("\n");
+        close(data_fd);
+    }
 
     return 0;
 }
-
@@ -0,0 +1,451 @@
+/*
+ * telem_replay.c - Play a recording back into the server or the GUI
+ *
+ * Compile: gcc -O2 -pthread -o telem_replay telem_replay.c common/recorder.c common/transport.c \
+ *          common/crc32c.c common/lat_hist.c common/vehicle_store.c -lbluetooth
+ * Usage:   ./telem_replay --dir /var/lib/telem --uri tcp://127.0.0.1:5555
+ *          ./telem_replay --dir /var/lib/telem --uri unix:///tmp/telem.sock --speed 10 --clients 50
+ *          ./telem_replay --dir /var/lib/telem --uri tcp://127.0.0.1:5555 --speed max --restamp
+ *
+ * Reads what rfcomm_server_v2 --record wrote and sends the frames again,
+ * byte for byte, with the gaps between them as they were received (scaled
+ * by --speed). Every recorded vehicle gets its own connection, so the
+ * receiver sees the same vehicles it saw live and delta frames stay on the
+ * stream that has their keyframe; --clients N repeats the whole recording
+ * on N sets of connections at once.
+ *
+ * Frames are sent on an absolute schedule (start + recorded offset / speed),
+ * so sleep overshoot does not add up. Frames due at the same moment, or
+ * already late, are batched per connection into one send(). The 1 s lines
+ * and the final report compare the achieved frame rate with the one the
+ * recording asks for, and show how late frames went out (except with
+ * --speed max, which has no schedule).
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+
+#include <sys/socket.h>
+
+#include "common/lat_hist.h"
+#include "common/pacer.h"
+#include "common/recorder.h"
+#include "common/telemetry_codec.h"
+#include "common/transport.h"
+#include "common/vehicle_store.h"
+
+#define REPLAY_OUTBUF        4096
+#define REPLAY_MAX_VEHICLES  1024
+#define REPLAY_SLEEP_NS      100000000ull  // longest single sleep, to notice SIGINT
+#define REPLAY_DRAIN_NS      100000000ull  // discard what the receiver sends back
+
+static volatile bool g_running = true;
+
+static void handle_sigint(int sig) {
+    (void)sig;
+    g_running = false;
+}
+
+typedef struct {
+    int fd;                         // -1 once lost
+    size_t len;
+    uint8_t out[REPLAY_OUTBUF];
+} replay_conn_t;
+
+typedef struct {
+    uint64_t key;
+    unsigned long frames;
+    replay_conn_t *conns;           // one per --clients
+} replay_vehicle_t;
+
+/* Records of the selected range, in recording order, across segments */
+typedef struct {
+    char **paths;
+    int nsegs;
+    int next_seg;
+    rec_seg_t seg;
+    bool open;
+    size_t off;
+    uint64_t from_us, to_us;
+} replay_cursor_t;
+
+typedef struct {
+    double speed;                   // 0 = as fast as possible
+    unsigned clients;
+    double from_s, to_s;            // to_s 0 = until the end
+    double max_gap_s;               // 0 = keep gaps as recorded
+    const char *vehicle;            // NULL = all
+    bool restamp;
+} replay_opts_t;
+
+static uint64_t realtime_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void cursor_rewind(replay_cursor_t *c) {
+    if (c->open) rec_seg_close(&c->seg);
+    c->open = false;
+    c->next_seg = 0;
+}
+
+static int cursor_next(replay_cursor_t *c, rec_entry_t *e) {
+    for (;;) {
+        if (!c->open) {
+            if (c->next_seg >= c->nsegs) return 0;
+            const char *path = c->paths[c->next_seg++];
+            if (rec_seg_open(&c->seg, path) < 0) {
+                fprintf(stderr, "[WARN] %s: %s\n", path, strerror(errno));
+                continue;
+            }
+            c->open = true;
+            if (c->seg.records == 0 || c->seg.last_us < c->from_us) {
+                rec_seg_close(&c->seg);
+                c->open = false;
+                continue;
+            }
+            // The segment index finds the start without reading up to it
+            c->off = rec_seg_seek(&c->seg, c->from_us);
+        }
+        if (rec_seg_next(&c->seg, &c->off, e)) {
+            if (e->rx_us <= c->to_us) return 1;
+            c->next_seg = c->nsegs;
+        }
+        rec_seg_close(&c->seg);
+        c->open = false;
+    }
+}
+
+static bool want_vehicle(const replay_opts_t *o, uint64_t key) {
+    char name[VEHICLE_NAME_LEN];
+    if (!o->vehicle) return true;
+    vehicle_key_str(key, name, sizeof(name));
+    return strcasecmp(name, o->vehicle) == 0;
+}
+
+static replay_vehicle_t *find_vehicle(replay_vehicle_t *veh, size_t nveh, uint64_t key) {
+    for (size_t i = 0; i < nveh; i++) {
+        if (veh[i].key == key) return &veh[i];
+    }
+    return NULL;
+}
+
+/* Recorded time to play time: gaps beyond max_gap shrink to it */
+static uint64_t play_step_us(uint64_t prev_us, uint64_t rx_us, const replay_opts_t *o) {
+    if (rx_us <= prev_us) return 0;
+    uint64_t gap = rx_us - prev_us;
+    uint64_t max_gap = (uint64_t)(o->max_gap_s * 1e6);
+    return (max_gap && gap > max_gap) ? max_gap : gap;
+}
+
+/* Give a v2 frame a fresh send timestamp so the receiver's latency figures
+ * mean something. Short headers carry no absolute time and are left alone. */
+static void restamp_frame(uint8_t *f, size_t len, uint64_t ts_us) {
+    if (len < FRAME_V2_OVERHEAD || f[2] != FRAME_V2 || f[1] < FRAME_V2_MIN_LEN) return;
+    size_t body_len = frame_total_len(f) - FRAME_V2_OVERHEAD;
+    telem_store_le64(f + 8, ts_us);
+    telem_store_le32(f + FRAME_V2_HDR + body_len, crc32c(f + 2, FRAME_V2_HDR - 2 + body_len));
+}
+
+/* Write everything queued, waiting for the socket if it is full. */
+static void conn_flush(replay_conn_t *c, unsigned long *lost) {
+    size_t off = 0;
+    while (c->fd >= 0 && off < c->len) {
+        ssize_t n = transport_send(c->fd, c->out + off, c->len - off);
+        if (n > 0) {
+            off += (size_t)n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            struct pollfd p = { .fd = c->fd, .events = POLLOUT };
+            poll(&p, 1, 100);
+            if (!g_running) break;
+        } else {
+            fprintf(stderr, "[WARN] connection lost: %s\n", n < 0 ? strerror(errno) : "closed");
+            close(c->fd);
+            c->fd = -1;
+            (*lost)++;
+        }
+    }
+    c->len = 0;
+}
+
+/* Echoes, pongs and config from the receiver are not needed; keep its
+ * sends from backing up. */
+static void conn_drain(replay_conn_t *c) {
+    uint8_t buf[4096];
+    while (c->fd >= 0 && recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+    }
+}
+
+static void for_each_conn(replay_vehicle_t *veh, size_t nveh, unsigned clients,
+                          void (*fn)(replay_conn_t *, unsigned long *), unsigned long *lost) {
+    for (size_t i = 0; i < nveh; i++) {
+        for (unsigned k = 0; k < clients; k++) fn(&veh[i].conns[k], lost);
+    }
+}
+
+static void drain_one(replay_conn_t *c, unsigned long *unused) {
+    (void)unused;
+    conn_drain(c);
+}
+
+static int run_replay(replay_cursor_t *cur, const transport_addr_t *addr, const replay_opts_t *o) {
+    replay_vehicle_t *veh = calloc(REPLAY_MAX_VEHICLES, sizeof(*veh));
+    size_t nveh = 0;
+    rec_entry_t e;
+    unsigned long frames = 0, skipped = 0;
+    uint64_t first_us = 0, prev_us = 0, play_us = 0;
+    int ret = 1;
+
+    if (!veh) {
+        fprintf(stderr, "[ERR] out of memory\n");
+        return 1;
+    }
+
+    // First pass: which vehicles, how many frames, how long
+    while (cursor_next(cur, &e)) {
+        if (!want_vehicle(o, e.key)) continue;
+        replay_vehicle_t *v = find_vehicle(veh, nveh, e.key);
+        if (!v) {
+            if (nveh == REPLAY_MAX_VEHICLES) {
+                skipped++;
+                continue;
+            }
+            v = &veh[nveh++];
+            v->key = e.key;
+        }
+        if (frames == 0) first_us = prev_us = e.rx_us;
+        play_us += play_step_us(prev_us, e.rx_us, o);
+        if (e.rx_us > prev_us) prev_us = e.rx_us;
+        v->frames++;
+        frames++;
+    }
+    cursor_rewind(cur);
+    if (frames == 0) {
+        fprintf(stderr, "[ERR] No frames in the selected range\n");
+        goto done;
+    }
+    if (skipped)
+        fprintf(stderr, "[WARN] More than %d vehicles; %lu frames of the rest skipped\n",
+                REPLAY_MAX_VEHICLES, skipped);
+
+    double play_s = play_us / 1e6 / (o->speed > 0 ? o->speed : 1);
+    double requested = o->speed > 0 && play_us > 0 ? frames * (double)o->clients / play_s : 0;
+    fprintf(stderr, "[REPLAY] %lu frames from %zu vehicle(s), %.1f s recorded\n",
+            frames, nveh, play_us / 1e6);
+    if (o->speed > 0)
+        fprintf(stderr, "[REPLAY] %u client(s) x %zu connection(s) to %s at %gx: %.1f s, %.0f frames/s\n",
+                o->clients, nveh, addr->uri, o->speed, play_s, requested);
+    else
+        fprintf(stderr, "[REPLAY] %u client(s) x %zu connection(s) to %s, as fast as possible\n",
+                o->clients, nveh, addr->uri);
+
+    size_t up = 0;
+    for (size_t i = 0; i < nveh; i++) {
+        veh[i].conns = calloc(o->clients, sizeof(replay_conn_t));
+        if (!veh[i].conns) {
+            fprintf(stderr, "[ERR] out of memory\n");
+            goto done;
+        }
+        for (unsigned k = 0; k < o->clients; k++) {
+            veh[i].conns[k].fd = transport_connect(addr, 2000);
+            if (veh[i].conns[k].fd >= 0) up++;
+        }
+    }
+    if (up == 0) {
+        fprintf(stderr, "[ERR] Cannot connect to %s: %s\n", addr->uri, strerror(errno));
+        goto done;
+    }
+    if (up < nveh * o->clients)
+        fprintf(stderr, "[WARN] %zu of %zu connections up\n", up, nveh * o->clients);
+
+    // Second pass: send on schedule
+    lat_hist_t late;
+    lat_hist_init(&late);
+    unsigned long sent = 0, lost = 0, last_sent = 0;
+    uint64_t t0 = pacer_now_ns(), last_report = t0, last_drain = t0, deadline = t0;
+    play_us = 0;
+    prev_us = first_us;
+
+    while (g_running && cursor_next(cur, &e)) {
+        replay_vehicle_t *v = find_vehicle(veh, nveh, e.key);
+        if (!v || !want_vehicle(o, e.key)) continue;
+
+        play_us += play_step_us(prev_us, e.rx_us, o);
+        if (e.rx_us > prev_us) prev_us = e.rx_us;
+        if (o->speed > 0) deadline = t0 + (uint64_t)(play_us * 1000.0 / o->speed);
+
+        uint64_t now = pacer_now_ns();
+        if (deadline > now) {
+            // Nothing else is due before this frame: send what is queued
+            for_each_conn(veh, nveh, o->clients, conn_flush, &lost);
+            while (g_running && (now = pacer_now_ns()) < deadline)
+                pacer_sleep_until(deadline - now > REPLAY_SLEEP_NS ? now + REPLAY_SLEEP_NS : deadline);
+        }
+        // --speed max has no schedule to be late against
+        if (o->speed > 0) lat_hist_add(&late, now > deadline ? now - deadline : 0);
+
+        uint8_t frame[FRAME_MAX_SIZE];
+        memcpy(frame, e.frame, e.len);
+        if (o->restamp) restamp_frame(frame, e.len, realtime_us());
+        for (unsigned k = 0; k < o->clients; k++) {
+            replay_conn_t *c = &v->conns[k];
+            if (c->fd < 0) continue;
+            if (c->len + e.len > sizeof(c->out)) conn_flush(c, &lost);
+            memcpy(c->out + c->len, frame, e.len);
+            c->len += e.len;
+            sent++;
+        }
+
+        if (now - last_drain >= REPLAY_DRAIN_NS) {
+            for_each_conn(veh, nveh, o->clients, drain_one, NULL);
+            last_drain = now;
+        }
+        if (now - last_report >= 1000000000ull) {
+            double dt = (now - last_report) / 1e9;
+            fprintf(stderr, "[REPLAY] %6.0f s  %9.0f frames/s", (now - t0) / 1e9, (sent - last_sent) / dt);
+            if (requested > 0)
+                fprintf(stderr, " (%.1f%%)  behind %.1f ms", 100.0 * (sent - last_sent) / dt / requested,
+                        now > deadline ? (now - deadline) / 1e6 : 0.0);
+            fprintf(stderr, "  at %.1f s of the recording\n", (e.rx_us - first_us) / 1e6);
+            last_report = now;
+            last_sent = sent;
+        }
+    }
+    for_each_conn(veh, nveh, o->clients, conn_flush, &lost);
+
+    double secs = (pacer_now_ns() - t0) / 1e9;
+    fprintf(stderr, "\n[REPLAY] %lu frames in %.2f s: %.0f frames/s", sent, secs, secs > 0 ? sent / secs : 0.0);
+    if (requested > 0)
+        fprintf(stderr, " of %.0f requested (%.1f%%), %.2f s expected\n",
+                requested, 100.0 * sent / secs / requested, play_s);
+    else
+        fprintf(stderr, ", as fast as possible\n");
+    if (o->speed > 0)
+        fprintf(stderr, "[REPLAY] Late against schedule: p50 %.2f, p99 %.2f, max %.2f ms\n",
+                lat_hist_quantile(&late, 0.50) / 1e6, lat_hist_quantile(&late, 0.99) / 1e6,
+                late.max / 1e6);
+    if (lost) fprintf(stderr, "[WARN] %lu connection(s) lost\n", lost);
+    if (!g_running) fprintf(stderr, "[REPLAY] Interrupted\n");
+    ret = 0;
+
+done:
+    for (size_t i = 0; i < nveh; i++) {
+        if (!veh[i].conns) continue;
+        for (unsigned k = 0; k < o->clients; k++) {
+            if (veh[i].conns[k].fd >= 0) close(veh[i].conns[k].fd);
+        }
+        free(veh[i].conns);
+    }
+    free(veh);
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    const char *dir = NULL;
+    const char *uri = NULL;
+    replay_opts_t opts = {
+        .speed = 1.0,
+        .clients = 1,
+    };
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--dir") && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (!strcmp(argv[i], "--uri") && i + 1 < argc) {
+            uri = argv[++i];
+        } else if (!strcmp(argv[i], "--speed") && i + 1 < argc) {
+            const char *s = argv[++i];
+            opts.speed = !strcmp(s, "max") ? 0 : atof(s);
+            if (opts.speed < 0 || (opts.speed == 0 && strcmp(s, "max"))) {
+                fprintf(stderr, "[ERR] --speed X (e.g. 0.5, 10) or max\n");
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--clients") && i + 1 < argc) {
+            opts.clients = (unsigned)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--from") && i + 1 < argc) {
+            opts.from_s = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--to") && i + 1 < argc) {
+            opts.to_s = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-gap") && i + 1 < argc) {
+            opts.max_gap_s = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--vehicle") && i + 1 < argc) {
+            opts.vehicle = argv[++i];
+        } else if (!strcmp(argv[i], "--restamp")) {
+            opts.restamp = true;
+        } else if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h")) {
+            fprintf(stderr,
+                "Usage: %s --dir DIR --uri URI [--speed 1|X|max] [--clients 1]\n"
+                "       [--from SEC] [--to SEC] [--max-gap SEC] [--vehicle ID] [--restamp]\n"
+                "\n"
+                "Sends the frames recorded in DIR (rfcomm_server_v2 --record) to URI,\n"
+                "one connection per recorded vehicle, keeping the recorded gaps.\n"
+                "  --speed      0.5 = half speed, 10 = ten times faster, max = no waiting\n"
+                "  --clients    play the recording on N sets of connections at once\n"
+                "  --from/--to  seconds after the first recorded frame\n"
+                "  --max-gap    shorten longer pauses (e.g. a parked vehicle) to SEC\n"
+                "  --vehicle    only AA:BB:CC:DD:EE:FF (or #hex, as the server prints it)\n"
+                "  --restamp    put the replay's send time into v2 frames\n"
+                "\n"
+                "URI: rfcomm://AA:BB:CC:DD:EE:FF/1, tcp://HOST:PORT,\n"
+                "     unix:///path/to.sock, pty:///path/to/pty\n",
+                argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown arg: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (!dir || !uri) {
+        fprintf(stderr, "[ERR] --dir <DIR> dan --uri <URI> wajib.\n");
+        return 1;
+    }
+    if (opts.clients == 0) {
+        fprintf(stderr, "[ERR] --clients harus > 0.\n");
+        return 1;
+    }
+
+    transport_addr_t addr;
+    if (transport_parse(uri, &addr) < 0) {
+        fprintf(stderr, "[ERR] Invalid URI: %s\n", uri);
+        return 1;
+    }
+
+    replay_cursor_t cur;
+    memset(&cur, 0, sizeof(cur));
+    cur.nsegs = rec_list(dir, &cur.paths);
+    if (cur.nsegs <= 0) {
+        fprintf(stderr, "[ERR] No recording in %s%s%s\n", dir,
+                cur.nsegs < 0 ? ": " : "", cur.nsegs < 0 ? strerror(errno) : "");
+        return 1;
+    }
+
+    // Times are relative to the first frame of the first segment
+    rec_seg_t s;
+    uint64_t start_us = 0;
+    for (int i = 0; i < cur.nsegs && !start_us; i++) {
+        if (rec_seg_open(&s, cur.paths[i]) < 0) continue;
+        if (s.records > 0) start_us = s.first_us;
+        rec_seg_close(&s);
+    }
+    cur.from_us = start_us + (uint64_t)(opts.from_s * 1e6);
+    cur.to_us = opts.to_s > 0 ? start_us + (uint64_t)(opts.to_s * 1e6) : UINT64_MAX;
+
+    signal(SIGINT, handle_sigint);
+    signal(SIGTERM, handle_sigint);
+
+    int ret = run_replay(&cur, &addr, &opts);
+    cursor_rewind(&cur);
+    rec_list_free(cur.paths, cur.nsegs);
+    return ret;
+}